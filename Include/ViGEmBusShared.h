@@ -365,19 +365,6 @@ VOID FORCEINLINE DS4_SUBMIT_REPORT_INIT(
 
 #pragma region XGIP (aka Xbox One device) section - EXPERIMENTAL
 
-typedef struct _XGIP_REPORT
-{
-    UCHAR Buttons1;
-    UCHAR Buttons2;
-    SHORT LeftTrigger;
-    SHORT RightTrigger;
-    SHORT ThumbLX;
-    SHORT ThumbLY;
-    SHORT ThumbRX;
-    SHORT ThumbRY;
-
-} XGIP_REPORT, *PXGIP_REPORT;
-
 //
 // Xbox One request data
 // 
@@ -204,3 +204,120 @@ VOID FORCEINLINE DS4_REPORT_INIT(
     DS4_SET_DPAD(Report, DS4_BUTTON_DPAD_NONE);
 }
 
+#define DS4_USB_INPUT_REPORT_LENGTH     64
+#define DS4_USB_INPUT_REPORT_ID         0x01
+#define DS4_TOUCH_PACKETS_MAX           3
+
+//
+// DualShock 4 touch pad contact
+// 
+typedef struct _DS4_TOUCH_POINT
+{
+    //
+    // FALSE if the finger has been lifted
+    // 
+    BOOLEAN bIsDown;
+
+    //
+    // Tracking number of the contact (0 - 127)
+    // 
+    BYTE bTrackingNum;
+
+    //
+    // Position on the touch pad (12 bits each)
+    // 
+    USHORT wX;
+    USHORT wY;
+
+} DS4_TOUCH_POINT, *PDS4_TOUCH_POINT;
+
+//
+// DualShock 4 touch pad sample of up to two contacts
+// 
+typedef struct _DS4_TOUCH_PACKET
+{
+    BYTE bPacketCounter;
+
+    DS4_TOUCH_POINT Touch[2];
+
+} DS4_TOUCH_PACKET, *PDS4_TOUCH_PACKET;
+
+//
+// DualShock 4 input state including motion, battery and touch data
+// 
+typedef struct _DS4_REPORT_EX
+{
+    DS4_REPORT Report;
+
+    BYTE bTemperature;
+
+    SHORT wGyroX;
+    SHORT wGyroY;
+    SHORT wGyroZ;
+
+    SHORT wAccelX;
+    SHORT wAccelY;
+    SHORT wAccelZ;
+
+    //
+    // Battery level (0 - 15) and charging cable state
+    // 
+    BYTE bBatteryLevel;
+    BOOLEAN bCableConnected;
+
+    //
+    // Number of valid touch packets (0 before the first contact)
+    // 
+    BYTE bTouchPacketCount;
+
+    DS4_TOUCH_PACKET TouchPackets[DS4_TOUCH_PACKETS_MAX];
+
+} DS4_REPORT_EX, *PDS4_REPORT_EX;
+
+VOID FORCEINLINE DS4_REPORT_EX_INIT(
+    _Out_ PDS4_REPORT_EX Report
+)
+{
+    RtlZeroMemory(Report, sizeof(DS4_REPORT_EX));
+
+    DS4_REPORT_INIT(&Report->Report);
+}
+
+//
+// Xbox One (GIP) digital buttons, split in two bytes
+// 
+typedef enum _XGIP_BUTTONS
+{
+    XGIP_BUTTON1_MENU               = 1 << 2,
+    XGIP_BUTTON1_VIEW               = 1 << 3,
+    XGIP_BUTTON1_A                  = 1 << 4,
+    XGIP_BUTTON1_B                  = 1 << 5,
+    XGIP_BUTTON1_X                  = 1 << 6,
+    XGIP_BUTTON1_Y                  = 1 << 7,
+
+    XGIP_BUTTON2_DPAD_UP            = 1 << 0,
+    XGIP_BUTTON2_DPAD_DOWN          = 1 << 1,
+    XGIP_BUTTON2_DPAD_LEFT          = 1 << 2,
+    XGIP_BUTTON2_DPAD_RIGHT         = 1 << 3,
+    XGIP_BUTTON2_SHOULDER_LEFT      = 1 << 4,
+    XGIP_BUTTON2_SHOULDER_RIGHT     = 1 << 5,
+    XGIP_BUTTON2_THUMB_LEFT         = 1 << 6,
+    XGIP_BUTTON2_THUMB_RIGHT        = 1 << 7
+
+} XGIP_BUTTONS, *PXGIP_BUTTONS;
+
+//
+// Xbox One (GIP) input report, triggers range from 0 to 1023
+// 
+typedef struct _XGIP_REPORT
+{
+    UCHAR Buttons1;
+    UCHAR Buttons2;
+    SHORT LeftTrigger;
+    SHORT RightTrigger;
+    SHORT ThumbLX;
+    SHORT ThumbLY;
+    SHORT ThumbRX;
+    SHORT ThumbRY;
+
+} XGIP_REPORT, *PXGIP_REPORT;
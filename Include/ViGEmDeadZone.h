@@ -0,0 +1,398 @@
+/*
+MIT License
+
+Copyright (c) 2017 Benjamin "Nefarius" Hglinger
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#pragma once
+
+#include "ViGEmCommon.h"
+#include "XnaGuardianShared.h"
+#include <limits.h>
+
+//
+// Thumb stick dead zone and response curve tables.
+//
+// A VIGEM_STICK_PROFILE is compiled once into a fixed-point lookup table,
+// applying it to a stick sample is integer-only and branch-light, so it is
+// usable from kernel- and user-mode alike.
+//
+// Axial tables hold the output magnitude indexed by the input magnitude of
+// a single axis. Radial tables hold a Q16 gain indexed by the squared
+// stick deflection, which spares the square root per sample. Both are
+// interpolated linearly between entries.
+//
+
+#define VIGEM_STICK_LUT_ENTRIES         4097
+#define VIGEM_STICK_LUT_AXIAL_SHIFT     3
+#define VIGEM_STICK_LUT_RADIAL_SHIFT    19
+#define VIGEM_STICK_LUT_GAIN_SHIFT      16
+#define VIGEM_STICK_AXIS_MAX            32767
+
+typedef enum _VIGEM_STICK_DEADZONE_MODE
+{
+    //
+    // Each axis is treated on its own
+    //
+    VIGEM_STICK_DEADZONE_AXIAL,
+    //
+    // Both axes are scaled by the deflection of the stick
+    //
+    VIGEM_STICK_DEADZONE_RADIAL
+
+} VIGEM_STICK_DEADZONE_MODE, *PVIGEM_STICK_DEADZONE_MODE;
+
+typedef enum _VIGEM_STICK_RESPONSE_CURVE
+{
+    VIGEM_STICK_RESPONSE_LINEAR,
+    VIGEM_STICK_RESPONSE_QUADRATIC,
+    VIGEM_STICK_RESPONSE_CUBIC
+
+} VIGEM_STICK_RESPONSE_CURVE, *PVIGEM_STICK_RESPONSE_CURVE;
+
+//
+// Describes how raw stick values are transformed.
+//
+typedef struct _VIGEM_STICK_PROFILE
+{
+    VIGEM_STICK_DEADZONE_MODE Mode;
+
+    VIGEM_STICK_RESPONSE_CURVE Curve;
+
+    //
+    // Deflection (0 to 32767) below which the output is zero
+    //
+    USHORT InnerDeadZone;
+
+    //
+    // Deflection (InnerDeadZone + 1 to 32767) above which the output is saturated
+    //
+    USHORT OuterDeadZone;
+
+} VIGEM_STICK_PROFILE, *PVIGEM_STICK_PROFILE;
+
+//
+// Compiled representation of a VIGEM_STICK_PROFILE.
+//
+typedef struct _VIGEM_STICK_LUT
+{
+    VIGEM_STICK_DEADZONE_MODE Mode;
+
+    ULONG Table[VIGEM_STICK_LUT_ENTRIES];
+
+} VIGEM_STICK_LUT, *PVIGEM_STICK_LUT;
+
+//
+// Initializes a VIGEM_STICK_PROFILE structure.
+//
+VOID FORCEINLINE VIGEM_STICK_PROFILE_INIT(
+    _Out_ PVIGEM_STICK_PROFILE Profile,
+    _In_ VIGEM_STICK_DEADZONE_MODE Mode,
+    _In_ USHORT InnerDeadZone,
+    _In_ USHORT OuterDeadZone
+)
+{
+    RtlZeroMemory(Profile, sizeof(VIGEM_STICK_PROFILE));
+
+    Profile->Mode = Mode;
+    Profile->Curve = VIGEM_STICK_RESPONSE_LINEAR;
+    Profile->InnerDeadZone = InnerDeadZone;
+    Profile->OuterDeadZone = OuterDeadZone;
+}
+
+//
+// Integer square root of a 64-bit value.
+//
+ULONG FORCEINLINE VIGEM_STICK_ISQRT(
+    _In_ ULONGLONG Value
+)
+{
+    ULONGLONG root = 0;
+    ULONGLONG bit = 1ULL << 62;
+
+    while (bit > Value)
+        bit >>= 2;
+
+    while (bit != 0)
+    {
+        if (Value >= root + bit)
+        {
+            Value -= root + bit;
+            root = (root >> 1) + bit;
+        }
+        else
+        {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+
+    return (ULONG)root;
+}
+
+//
+// Evaluates the profile for a stick deflection, returns 0 to 32767.
+//
+ULONG FORCEINLINE VIGEM_STICK_PROFILE_EVALUATE(
+    _In_ const VIGEM_STICK_PROFILE* Profile,
+    _In_ ULONG Deflection
+)
+{
+    ULONGLONG t;
+
+    if (Deflection <= Profile->InnerDeadZone)
+        return 0;
+
+    if (Deflection >= Profile->OuterDeadZone)
+        return VIGEM_STICK_AXIS_MAX;
+
+    //
+    // Position between the dead zones in Q30
+    //
+    t = ((ULONGLONG)(Deflection - Profile->InnerDeadZone) << 30)
+        / (ULONG)(Profile->OuterDeadZone - Profile->InnerDeadZone);
+
+    switch (Profile->Curve)
+    {
+    case VIGEM_STICK_RESPONSE_QUADRATIC:
+        t = (t * t) >> 30;
+        break;
+    case VIGEM_STICK_RESPONSE_CUBIC:
+        t = (((t * t) >> 30) * t) >> 30;
+        break;
+    default:
+        break;
+    }
+
+    return (ULONG)((t * VIGEM_STICK_AXIS_MAX + (1ULL << 29)) >> 30);
+}
+
+//
+// Compiles a profile into a lookup table.
+//
+// Returns FALSE if the dead zones are out of range.
+//
+BOOLEAN FORCEINLINE VIGEM_STICK_LUT_INIT(
+    _Out_ PVIGEM_STICK_LUT Lut,
+    _In_ const VIGEM_STICK_PROFILE* Profile
+)
+{
+    ULONG index;
+    ULONGLONG deflection;
+
+    if (Profile->OuterDeadZone > VIGEM_STICK_AXIS_MAX
+        || Profile->InnerDeadZone >= Profile->OuterDeadZone)
+    {
+        return FALSE;
+    }
+
+    Lut->Mode = Profile->Mode;
+
+    for (index = 0; index < VIGEM_STICK_LUT_ENTRIES; index++)
+    {
+        if (Profile->Mode == VIGEM_STICK_DEADZONE_AXIAL)
+        {
+            Lut->Table[index] = VIGEM_STICK_PROFILE_EVALUATE(
+                Profile, index << VIGEM_STICK_LUT_AXIAL_SHIFT);
+            continue;
+        }
+
+        //
+        // The first bucket is sampled at its center to keep the gain
+        // defined for a profile without inner dead zone
+        //
+        deflection = VIGEM_STICK_ISQRT((index == 0)
+            ? (1ULL << (VIGEM_STICK_LUT_RADIAL_SHIFT - 1))
+            : ((ULONGLONG)index << VIGEM_STICK_LUT_RADIAL_SHIFT));
+
+        Lut->Table[index] = (ULONG)(((ULONGLONG)VIGEM_STICK_PROFILE_EVALUATE(
+            Profile, (ULONG)deflection) << VIGEM_STICK_LUT_GAIN_SHIFT) / deflection);
+    }
+
+    return TRUE;
+}
+
+//
+// Atomically replaces the table a slot points to and returns the former one.
+//
+// The former table must stay valid until every batch which has acquired it
+// has completed, e.g. by swapping between frames of the same thread.
+//
+PVIGEM_STICK_LUT FORCEINLINE VIGEM_STICK_LUT_EXCHANGE(
+    _Inout_ PVIGEM_STICK_LUT volatile* Slot,
+    _In_ PVIGEM_STICK_LUT Lut
+)
+{
+    return (PVIGEM_STICK_LUT)InterlockedExchangePointer((PVOID volatile*)Slot, Lut);
+}
+
+//
+// Reads the table a slot points to, to be used for a whole batch.
+//
+PVIGEM_STICK_LUT FORCEINLINE VIGEM_STICK_LUT_ACQUIRE(
+    _In_ PVIGEM_STICK_LUT volatile* Slot
+)
+{
+    return (PVIGEM_STICK_LUT)InterlockedCompareExchangePointer((PVOID volatile*)Slot, NULL, NULL);
+}
+
+//
+// Transforms a single axis with an axial table.
+//
+SHORT FORCEINLINE VIGEM_STICK_LUT_APPLY_AXIS(
+    _In_ const VIGEM_STICK_LUT* Lut,
+    _In_ SHORT Value
+)
+{
+    LONG sign = Value >> 15;
+    ULONG magnitude = (ULONG)((Value ^ sign) - sign);
+    ULONG index = magnitude >> VIGEM_STICK_LUT_AXIAL_SHIFT;
+    ULONG fraction = magnitude & ((1 << VIGEM_STICK_LUT_AXIAL_SHIFT) - 1);
+    LONG low;
+    LONG high;
+    LONG result;
+
+    //
+    // 32768 is the last entry, it has no successor to interpolate with
+    //
+    index -= index >> 12;
+    fraction |= (magnitude >> 15) << VIGEM_STICK_LUT_AXIAL_SHIFT;
+
+    low = (LONG)Lut->Table[index];
+    high = (LONG)Lut->Table[index + 1];
+    result = low + (((high - low) * (LONG)fraction) >> VIGEM_STICK_LUT_AXIAL_SHIFT);
+
+    return (SHORT)((result ^ sign) - sign);
+}
+
+//
+// Transforms both axes of a stick with a radial table.
+//
+VOID FORCEINLINE VIGEM_STICK_LUT_APPLY_RADIAL(
+    _In_ const VIGEM_STICK_LUT* Lut,
+    _Inout_ PSHORT X,
+    _Inout_ PSHORT Y
+)
+{
+    LONG x = *X;
+    LONG y = *Y;
+    ULONG squared = (ULONG)(x * x) + (ULONG)(y * y);
+    ULONG index = squared >> VIGEM_STICK_LUT_RADIAL_SHIFT;
+    ULONG fraction = (squared >> (VIGEM_STICK_LUT_RADIAL_SHIFT - 16)) & 0xFFFF;
+    LONGLONG low;
+    LONGLONG gain;
+
+    //
+    // A full diagonal deflection lands on the last entry
+    //
+    index -= index >> 12;
+    fraction |= (squared >> 31) << 16;
+
+    low = Lut->Table[index];
+    gain = low + ((((LONGLONG)Lut->Table[index + 1] - low) * fraction) >> 16);
+
+    x = (LONG)((x * gain + (1 << (VIGEM_STICK_LUT_GAIN_SHIFT - 1))) >> VIGEM_STICK_LUT_GAIN_SHIFT);
+    y = (LONG)((y * gain + (1 << (VIGEM_STICK_LUT_GAIN_SHIFT - 1))) >> VIGEM_STICK_LUT_GAIN_SHIFT);
+
+    *X = (SHORT)((x > SHRT_MAX) ? SHRT_MAX : (x < SHRT_MIN) ? SHRT_MIN : x);
+    *Y = (SHORT)((y > SHRT_MAX) ? SHRT_MAX : (y < SHRT_MIN) ? SHRT_MIN : y);
+}
+
+//
+// Transforms both axes of a stick with a table of either mode.
+//
+VOID FORCEINLINE VIGEM_STICK_LUT_APPLY(
+    _In_ const VIGEM_STICK_LUT* Lut,
+    _Inout_ PSHORT X,
+    _Inout_ PSHORT Y
+)
+{
+    if (Lut->Mode == VIGEM_STICK_DEADZONE_RADIAL)
+    {
+        VIGEM_STICK_LUT_APPLY_RADIAL(Lut, X, Y);
+    }
+    else
+    {
+        *X = VIGEM_STICK_LUT_APPLY_AXIS(Lut, *X);
+        *Y = VIGEM_STICK_LUT_APPLY_AXIS(Lut, *Y);
+    }
+}
+
+//
+// Applies stick tables to an array of XUSB reports. Either table may be
+// NULL to leave the according stick untouched.
+//
+VOID FORCEINLINE XUSB_REPORT_APPLY_STICK_LUT_BATCH(
+    _In_opt_ const VIGEM_STICK_LUT* Left,
+    _In_opt_ const VIGEM_STICK_LUT* Right,
+    _Inout_updates_(Count) PXUSB_REPORT Reports,
+    _In_ size_t Count
+)
+{
+    size_t index;
+
+    if (Left)
+    {
+        for (index = 0; index < Count; index++)
+        {
+            VIGEM_STICK_LUT_APPLY(Left, &Reports[index].sThumbLX, &Reports[index].sThumbLY);
+        }
+    }
+
+    if (Right)
+    {
+        for (index = 0; index < Count; index++)
+        {
+            VIGEM_STICK_LUT_APPLY(Right, &Reports[index].sThumbRX, &Reports[index].sThumbRY);
+        }
+    }
+}
+
+//
+// Applies stick tables to an array of gamepad states. Either table may be
+// NULL to leave the according stick untouched.
+//
+VOID FORCEINLINE XINPUT_GAMEPAD_STATE_APPLY_STICK_LUT_BATCH(
+    _In_opt_ const VIGEM_STICK_LUT* Left,
+    _In_opt_ const VIGEM_STICK_LUT* Right,
+    _Inout_updates_(Count) PXINPUT_GAMEPAD_STATE States,
+    _In_ size_t Count
+)
+{
+    size_t index;
+
+    if (Left)
+    {
+        for (index = 0; index < Count; index++)
+        {
+            VIGEM_STICK_LUT_APPLY(Left, &States[index].sThumbLX, &States[index].sThumbLY);
+        }
+    }
+
+    if (Right)
+    {
+        for (index = 0; index < Count; index++)
+        {
+            VIGEM_STICK_LUT_APPLY(Right, &States[index].sThumbRX, &States[index].sThumbRY);
+        }
+    }
+}
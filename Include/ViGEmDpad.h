@@ -0,0 +1,116 @@
+/*
+MIT License
+
+Copyright (c) 2017 Benjamin "Nefarius" Hglinger
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#pragma once
+
+//
+// D-PAD conversion between the direction bit mask shared by XUSB, XInput
+// and GIP (UP 0x1, DOWN 0x2, LEFT 0x4, RIGHT 0x8) and the HAT switch values
+// of the DualShock 4 (NORTH 0, clockwise, NONE 8) and of the XBONE HID
+// report (NONE 0, NORTH 1, clockwise).
+//
+// Contradicting directions resolve as noted per entry, which matches the
+// if-chain formerly used by XUSB_TO_DS4_REPORT.
+// Every HAT table has 16 entries so the low nibble of a report can be used
+// as index without a range check, invalid HAT values map to no direction.
+//
+
+#define VIGEM_DPAD_MASK             0x0F
+
+//
+// DualShock 4 HAT value indexed by direction bit mask.
+//
+static const BYTE VIGEM_DPAD_MASK_TO_DS4_HAT[16] = {
+    0x8,    // -                        NONE
+    0x0,    // UP                       NORTH
+    0x4,    // DOWN                     SOUTH
+    0x4,    // UP + DOWN                SOUTH
+    0x6,    // LEFT                     WEST
+    0x7,    // UP + LEFT                NORTHWEST
+    0x5,    // DOWN + LEFT              SOUTHWEST
+    0x7,    // UP + DOWN + LEFT         NORTHWEST
+    0x2,    // RIGHT                    EAST
+    0x1,    // UP + RIGHT               NORTHEAST
+    0x3,    // DOWN + RIGHT             SOUTHEAST
+    0x3,    // UP + DOWN + RIGHT        SOUTHEAST
+    0x6,    // LEFT + RIGHT             WEST
+    0x7,    // UP + LEFT + RIGHT        NORTHWEST
+    0x5,    // DOWN + LEFT + RIGHT      SOUTHWEST
+    0x7     // UP + DOWN + LEFT + RIGHT NORTHWEST
+};
+
+//
+// Direction bit mask indexed by DualShock 4 HAT value.
+//
+static const BYTE VIGEM_DS4_HAT_TO_DPAD_MASK[16] = {
+    0x1,    // NORTH                    UP
+    0x9,    // NORTHEAST                UP + RIGHT
+    0x8,    // EAST                     RIGHT
+    0xA,    // SOUTHEAST                DOWN + RIGHT
+    0x2,    // SOUTH                    DOWN
+    0x6,    // SOUTHWEST                DOWN + LEFT
+    0x4,    // WEST                     LEFT
+    0x5,    // NORTHWEST                UP + LEFT
+    0x0,    // NONE
+    0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0
+};
+
+//
+// XBONE HID HAT value indexed by direction bit mask.
+//
+static const BYTE VIGEM_DPAD_MASK_TO_XBONE_HAT[16] = {
+    0x0,    // -                        NONE
+    0x1,    // UP                       N
+    0x5,    // DOWN                     S
+    0x5,    // UP + DOWN                S
+    0x7,    // LEFT                     W
+    0x8,    // UP + LEFT                NW
+    0x6,    // DOWN + LEFT              SW
+    0x8,    // UP + DOWN + LEFT         NW
+    0x3,    // RIGHT                    E
+    0x2,    // UP + RIGHT               NE
+    0x4,    // DOWN + RIGHT             SE
+    0x4,    // UP + DOWN + RIGHT        SE
+    0x7,    // LEFT + RIGHT             W
+    0x8,    // UP + LEFT + RIGHT        NW
+    0x6,    // DOWN + LEFT + RIGHT      SW
+    0x8     // UP + DOWN + LEFT + RIGHT NW
+};
+
+//
+// Direction bit mask indexed by XBONE HID HAT value.
+//
+static const BYTE VIGEM_XBONE_HAT_TO_DPAD_MASK[16] = {
+    0x0,    // NONE
+    0x1,    // N                        UP
+    0x9,    // NE                       UP + RIGHT
+    0x8,    // E                        RIGHT
+    0xA,    // SE                       DOWN + RIGHT
+    0x2,    // S                        DOWN
+    0x6,    // SW                       DOWN + LEFT
+    0x4,    // W                        LEFT
+    0x5,    // NW                       UP + LEFT
+    0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0
+};
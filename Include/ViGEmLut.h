@@ -0,0 +1,68 @@
+/*
+MIT License
+
+Copyright (c) 2017 Benjamin "Nefarius" Hglinger
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#pragma once
+
+//
+// Compile-time lookup table generators.
+//
+// Expands to a comma-separated initializer list of _entry_(index) for the
+// given range, where _entry_ is a function-like macro which must evaluate
+// to a constant expression. Usable from both kernel- and user-mode C code.
+//
+// Example:
+//
+//   #define SQUARE(_i_) ((_i_) * (_i_))
+//   static const USHORT Squares[256] = { VIGEM_LUT_256(SQUARE, 0) };
+//
+#define VIGEM_LUT_4(_entry_, _base_)        \
+    _entry_((_base_)),                      \
+    _entry_((_base_) + 1),                  \
+    _entry_((_base_) + 2),                  \
+    _entry_((_base_) + 3)
+
+#define VIGEM_LUT_16(_entry_, _base_)       \
+    VIGEM_LUT_4(_entry_, (_base_)),         \
+    VIGEM_LUT_4(_entry_, (_base_) + 4),     \
+    VIGEM_LUT_4(_entry_, (_base_) + 8),     \
+    VIGEM_LUT_4(_entry_, (_base_) + 12)
+
+#define VIGEM_LUT_64(_entry_, _base_)       \
+    VIGEM_LUT_16(_entry_, (_base_)),        \
+    VIGEM_LUT_16(_entry_, (_base_) + 16),   \
+    VIGEM_LUT_16(_entry_, (_base_) + 32),   \
+    VIGEM_LUT_16(_entry_, (_base_) + 48)
+
+#define VIGEM_LUT_256(_entry_, _base_)      \
+    VIGEM_LUT_64(_entry_, (_base_)),        \
+    VIGEM_LUT_64(_entry_, (_base_) + 64),   \
+    VIGEM_LUT_64(_entry_, (_base_) + 128),  \
+    VIGEM_LUT_64(_entry_, (_base_) + 192)
+
+#define VIGEM_LUT_1024(_entry_, _base_)     \
+    VIGEM_LUT_256(_entry_, (_base_)),       \
+    VIGEM_LUT_256(_entry_, (_base_) + 256), \
+    VIGEM_LUT_256(_entry_, (_base_) + 512), \
+    VIGEM_LUT_256(_entry_, (_base_) + 768)
@@ -0,0 +1,352 @@
+/*
+MIT License
+
+Copyright (c) 2017 Benjamin "Nefarius" Hglinger
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#pragma once
+
+#include "ViGEmCommon.h"
+#include "ViGEmUtil.h"
+#include "ViGEmDeadZone.h"
+#include "XInputOverrides.h"
+
+//
+// Structure-of-arrays storage for the state of many pads.
+//
+// Every field of XUSB_REPORT lives in its own column, so passes which only
+// touch some fields (dead zones, override merges, diffing, translation)
+// run over contiguous memory the compiler can vectorize. The store does
+// not allocate, the caller provides a buffer of VIGEM_PAD_STATE_STORE_SIZE
+// bytes which is split into columns aligned to VIGEM_PAD_STATE_STORE_ALIGNMENT.
+//
+
+#define VIGEM_PAD_STATE_STORE_ALIGNMENT     64
+
+#define VIGEM_PAD_STATE_STORE_COLUMN_SIZE(_count_, _type_) \
+    (((_count_) * sizeof(_type_) + VIGEM_PAD_STATE_STORE_ALIGNMENT - 1) & ~(size_t)(VIGEM_PAD_STATE_STORE_ALIGNMENT - 1))
+
+//
+// Buffer size required for a store of _count_ pads, including the slack
+// needed to align an arbitrary buffer.
+//
+#define VIGEM_PAD_STATE_STORE_SIZE(_count_)                             \
+    (VIGEM_PAD_STATE_STORE_COLUMN_SIZE(_count_, USHORT)                 \
+    + 2 * VIGEM_PAD_STATE_STORE_COLUMN_SIZE(_count_, BYTE)              \
+    + 4 * VIGEM_PAD_STATE_STORE_COLUMN_SIZE(_count_, SHORT)             \
+    + VIGEM_PAD_STATE_STORE_ALIGNMENT - 1)
+
+typedef struct _VIGEM_PAD_STATE_STORE
+{
+    //
+    // Number of pads
+    //
+    size_t Count;
+
+    PUSHORT Buttons;
+    PUCHAR LeftTrigger;
+    PUCHAR RightTrigger;
+    PSHORT ThumbLX;
+    PSHORT ThumbLY;
+    PSHORT ThumbRX;
+    PSHORT ThumbRY;
+
+} VIGEM_PAD_STATE_STORE, *PVIGEM_PAD_STATE_STORE;
+
+//
+// Lays out a store of Count pads in Buffer and resets all pads.
+//
+// Returns FALSE if Buffer is smaller than VIGEM_PAD_STATE_STORE_SIZE(Count).
+//
+BOOLEAN FORCEINLINE VIGEM_PAD_STATE_STORE_INIT(
+    _Out_ PVIGEM_PAD_STATE_STORE Store,
+    _Out_writes_bytes_(BufferSize) PVOID Buffer,
+    _In_ size_t BufferSize,
+    _In_ size_t Count
+)
+{
+    ULONG_PTR column;
+
+    RtlZeroMemory(Store, sizeof(VIGEM_PAD_STATE_STORE));
+
+    if (BufferSize < VIGEM_PAD_STATE_STORE_SIZE(Count))
+        return FALSE;
+
+    RtlZeroMemory(Buffer, BufferSize);
+
+    column = ((ULONG_PTR)Buffer + VIGEM_PAD_STATE_STORE_ALIGNMENT - 1)
+        & ~(ULONG_PTR)(VIGEM_PAD_STATE_STORE_ALIGNMENT - 1);
+
+    Store->Count = Count;
+
+    Store->Buttons = (PUSHORT)column;
+    column += VIGEM_PAD_STATE_STORE_COLUMN_SIZE(Count, USHORT);
+    Store->LeftTrigger = (PUCHAR)column;
+    column += VIGEM_PAD_STATE_STORE_COLUMN_SIZE(Count, BYTE);
+    Store->RightTrigger = (PUCHAR)column;
+    column += VIGEM_PAD_STATE_STORE_COLUMN_SIZE(Count, BYTE);
+    Store->ThumbLX = (PSHORT)column;
+    column += VIGEM_PAD_STATE_STORE_COLUMN_SIZE(Count, SHORT);
+    Store->ThumbLY = (PSHORT)column;
+    column += VIGEM_PAD_STATE_STORE_COLUMN_SIZE(Count, SHORT);
+    Store->ThumbRX = (PSHORT)column;
+    column += VIGEM_PAD_STATE_STORE_COLUMN_SIZE(Count, SHORT);
+    Store->ThumbRY = (PSHORT)column;
+
+    return TRUE;
+}
+
+#pragma region Gather/scatter
+
+//
+// Copies Count XUSB reports into the store, starting at pad First.
+//
+VOID FORCEINLINE VIGEM_PAD_STATE_STORE_LOAD_XUSB(
+    _Inout_ PVIGEM_PAD_STATE_STORE Store,
+    _In_ size_t First,
+    _In_reads_(Count) const XUSB_REPORT* Reports,
+    _In_ size_t Count
+)
+{
+    size_t index;
+
+    for (index = 0; index < Count; index++)
+    {
+        Store->Buttons[First + index] = Reports[index].wButtons;
+        Store->LeftTrigger[First + index] = Reports[index].bLeftTrigger;
+        Store->RightTrigger[First + index] = Reports[index].bRightTrigger;
+        Store->ThumbLX[First + index] = Reports[index].sThumbLX;
+        Store->ThumbLY[First + index] = Reports[index].sThumbLY;
+        Store->ThumbRX[First + index] = Reports[index].sThumbRX;
+        Store->ThumbRY[First + index] = Reports[index].sThumbRY;
+    }
+}
+
+//
+// Copies Count pads, starting at pad First, into XUSB reports.
+//
+VOID FORCEINLINE VIGEM_PAD_STATE_STORE_SAVE_XUSB(
+    _In_ const VIGEM_PAD_STATE_STORE* Store,
+    _In_ size_t First,
+    _Out_writes_(Count) PXUSB_REPORT Reports,
+    _In_ size_t Count
+)
+{
+    size_t index;
+
+    for (index = 0; index < Count; index++)
+    {
+        Reports[index].wButtons = Store->Buttons[First + index];
+        Reports[index].bLeftTrigger = Store->LeftTrigger[First + index];
+        Reports[index].bRightTrigger = Store->RightTrigger[First + index];
+        Reports[index].sThumbLX = Store->ThumbLX[First + index];
+        Reports[index].sThumbLY = Store->ThumbLY[First + index];
+        Reports[index].sThumbRX = Store->ThumbRX[First + index];
+        Reports[index].sThumbRY = Store->ThumbRY[First + index];
+    }
+}
+
+//
+// Converts Count DualShock 4 reports into the store, starting at pad First.
+//
+VOID FORCEINLINE VIGEM_PAD_STATE_STORE_LOAD_DS4(
+    _Inout_ PVIGEM_PAD_STATE_STORE Store,
+    _In_ size_t First,
+    _In_reads_(Count) const DS4_REPORT* Reports,
+    _In_ size_t Count
+)
+{
+    size_t index;
+    XUSB_REPORT report;
+
+    for (index = 0; index < Count; index++)
+    {
+        DS4_TO_XUSB_REPORT(&Reports[index], &report);
+        VIGEM_PAD_STATE_STORE_LOAD_XUSB(Store, First + index, &report, 1);
+    }
+}
+
+//
+// Converts Count pads, starting at pad First, into DualShock 4 reports.
+//
+// Like XUSB_TO_DS4_REPORT, buttons are merged into the existing reports.
+//
+VOID FORCEINLINE VIGEM_PAD_STATE_STORE_SAVE_DS4(
+    _In_ const VIGEM_PAD_STATE_STORE* Store,
+    _In_ size_t First,
+    _Inout_updates_(Count) PDS4_REPORT Reports,
+    _In_ size_t Count
+)
+{
+    size_t index;
+    XUSB_REPORT report;
+
+    for (index = 0; index < Count; index++)
+    {
+        VIGEM_PAD_STATE_STORE_SAVE_XUSB(Store, First + index, &report, 1);
+        XUSB_TO_DS4_REPORT(&report, &Reports[index]);
+    }
+}
+
+#pragma endregion
+
+#pragma region Column kernels
+
+//
+// Applies stick tables to all pads. Either table may be NULL to leave the
+// according stick untouched.
+//
+VOID FORCEINLINE VIGEM_PAD_STATE_STORE_APPLY_STICK_LUT(
+    _Inout_ PVIGEM_PAD_STATE_STORE Store,
+    _In_opt_ const VIGEM_STICK_LUT* Left,
+    _In_opt_ const VIGEM_STICK_LUT* Right
+)
+{
+    size_t index;
+
+    if (Left && Left->Mode == VIGEM_STICK_DEADZONE_AXIAL)
+    {
+        for (index = 0; index < Store->Count; index++)
+            Store->ThumbLX[index] = VIGEM_STICK_LUT_APPLY_AXIS(Left, Store->ThumbLX[index]);
+        for (index = 0; index < Store->Count; index++)
+            Store->ThumbLY[index] = VIGEM_STICK_LUT_APPLY_AXIS(Left, Store->ThumbLY[index]);
+    }
+    else if (Left)
+    {
+        for (index = 0; index < Store->Count; index++)
+            VIGEM_STICK_LUT_APPLY_RADIAL(Left, &Store->ThumbLX[index], &Store->ThumbLY[index]);
+    }
+
+    if (Right && Right->Mode == VIGEM_STICK_DEADZONE_AXIAL)
+    {
+        for (index = 0; index < Store->Count; index++)
+            Store->ThumbRX[index] = VIGEM_STICK_LUT_APPLY_AXIS(Right, Store->ThumbRX[index]);
+        for (index = 0; index < Store->Count; index++)
+            Store->ThumbRY[index] = VIGEM_STICK_LUT_APPLY_AXIS(Right, Store->ThumbRY[index]);
+    }
+    else if (Right)
+    {
+        for (index = 0; index < Store->Count; index++)
+            VIGEM_STICK_LUT_APPLY_RADIAL(Right, &Store->ThumbRX[index], &Store->ThumbRY[index]);
+    }
+}
+
+//
+// Replaces the fields selected by Overrides (XINPUT_GAMEPAD_OVERRIDES) of
+// every pad with the values of the same pad in Source.
+//
+VOID FORCEINLINE VIGEM_PAD_STATE_STORE_MERGE(
+    _Inout_ PVIGEM_PAD_STATE_STORE Store,
+    _In_ const VIGEM_PAD_STATE_STORE* Source,
+    _In_ ULONG Overrides
+)
+{
+    size_t index;
+    size_t count = min(Store->Count, Source->Count);
+    USHORT mask = (USHORT)(Overrides & 0xFFFF);
+
+#define VIGEM_PAD_STATE_STORE_MERGE_COLUMN(_column_, _override_)            \
+    if (Overrides & (_override_))                                           \
+    {                                                                       \
+        RtlCopyMemory(Store->_column_, Source->_column_,                    \
+            count * sizeof(Store->_column_[0]));                            \
+    }
+
+    VIGEM_PAD_STATE_STORE_MERGE_COLUMN(LeftTrigger, XINPUT_GAMEPAD_OVERRIDE_LEFT_TRIGGER)
+    VIGEM_PAD_STATE_STORE_MERGE_COLUMN(RightTrigger, XINPUT_GAMEPAD_OVERRIDE_RIGHT_TRIGGER)
+    VIGEM_PAD_STATE_STORE_MERGE_COLUMN(ThumbLX, XINPUT_GAMEPAD_OVERRIDE_LEFT_THUMB_X)
+    VIGEM_PAD_STATE_STORE_MERGE_COLUMN(ThumbLY, XINPUT_GAMEPAD_OVERRIDE_LEFT_THUMB_Y)
+    VIGEM_PAD_STATE_STORE_MERGE_COLUMN(ThumbRX, XINPUT_GAMEPAD_OVERRIDE_RIGHT_THUMB_X)
+    VIGEM_PAD_STATE_STORE_MERGE_COLUMN(ThumbRY, XINPUT_GAMEPAD_OVERRIDE_RIGHT_THUMB_Y)
+
+#undef VIGEM_PAD_STATE_STORE_MERGE_COLUMN
+
+    if (mask == 0)
+        return;
+
+    for (index = 0; index < count; index++)
+    {
+        Store->Buttons[index] = (USHORT)((Store->Buttons[index] & ~mask)
+            | (Source->Buttons[index] & mask));
+    }
+}
+
+//
+// Sets Changed[n] to a non-zero value if pad n differs between Store and
+// Previous, to zero otherwise. Returns the number of changed pads.
+//
+size_t FORCEINLINE VIGEM_PAD_STATE_STORE_DIFF(
+    _In_ const VIGEM_PAD_STATE_STORE* Store,
+    _In_ const VIGEM_PAD_STATE_STORE* Previous,
+    _Out_writes_(Store->Count) PUCHAR Changed
+)
+{
+    size_t index;
+    size_t changes = 0;
+    size_t count = min(Store->Count, Previous->Count);
+
+    for (index = 0; index < count; index++)
+    {
+        Changed[index] = (UCHAR)(
+            ((Store->Buttons[index] ^ Previous->Buttons[index])
+            | (Store->LeftTrigger[index] ^ Previous->LeftTrigger[index])
+            | (Store->RightTrigger[index] ^ Previous->RightTrigger[index])
+            | (USHORT)(Store->ThumbLX[index] ^ Previous->ThumbLX[index])
+            | (USHORT)(Store->ThumbLY[index] ^ Previous->ThumbLY[index])
+            | (USHORT)(Store->ThumbRX[index] ^ Previous->ThumbRX[index])
+            | (USHORT)(Store->ThumbRY[index] ^ Previous->ThumbRY[index])) != 0);
+    }
+
+    for (index = 0; index < count; index++)
+    {
+        changes += Changed[index];
+    }
+
+    for (index = count; index < Store->Count; index++)
+    {
+        Changed[index] = 1;
+        changes++;
+    }
+
+    return changes;
+}
+
+//
+// Copies all pads of Source into Store, both must hold the same count.
+//
+VOID FORCEINLINE VIGEM_PAD_STATE_STORE_COPY(
+    _Inout_ PVIGEM_PAD_STATE_STORE Store,
+    _In_ const VIGEM_PAD_STATE_STORE* Source
+)
+{
+    size_t count = min(Store->Count, Source->Count);
+
+    RtlCopyMemory(Store->Buttons, Source->Buttons, count * sizeof(USHORT));
+    RtlCopyMemory(Store->LeftTrigger, Source->LeftTrigger, count * sizeof(BYTE));
+    RtlCopyMemory(Store->RightTrigger, Source->RightTrigger, count * sizeof(BYTE));
+    RtlCopyMemory(Store->ThumbLX, Source->ThumbLX, count * sizeof(SHORT));
+    RtlCopyMemory(Store->ThumbLY, Source->ThumbLY, count * sizeof(SHORT));
+    RtlCopyMemory(Store->ThumbRX, Source->ThumbRX, count * sizeof(SHORT));
+    RtlCopyMemory(Store->ThumbRY, Source->ThumbRY, count * sizeof(SHORT));
+}
+
+#pragma endregion
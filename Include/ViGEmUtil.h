@@ -1,50 +1,458 @@
 #pragma once
 
 #include "ViGEmCommon.h"
+#include "ViGEmLut.h"
+#include "ViGEmDpad.h"
+#include "XnaGuardianShared.h"
 #include <limits.h>
 
+#pragma region XUSB to DualShock 4 lookup tables
+
+//
+// Maps the XUSB buttons of a single input byte to DualShock 4 buttons.
+//
+#define XUSB_TO_DS4_BUTTONS(_buttons_) (USHORT)(                                            \
+    (((_buttons_) & XUSB_GAMEPAD_BACK)            ? DS4_BUTTON_SHARE          : 0) |        \
+    (((_buttons_) & XUSB_GAMEPAD_START)           ? DS4_BUTTON_OPTIONS        : 0) |        \
+    (((_buttons_) & XUSB_GAMEPAD_LEFT_THUMB)      ? DS4_BUTTON_THUMB_LEFT     : 0) |        \
+    (((_buttons_) & XUSB_GAMEPAD_RIGHT_THUMB)     ? DS4_BUTTON_THUMB_RIGHT    : 0) |        \
+    (((_buttons_) & XUSB_GAMEPAD_LEFT_SHOULDER)   ? DS4_BUTTON_SHOULDER_LEFT  : 0) |        \
+    (((_buttons_) & XUSB_GAMEPAD_RIGHT_SHOULDER)  ? DS4_BUTTON_SHOULDER_RIGHT : 0) |        \
+    (((_buttons_) & XUSB_GAMEPAD_A)               ? DS4_BUTTON_CROSS          : 0) |        \
+    (((_buttons_) & XUSB_GAMEPAD_B)               ? DS4_BUTTON_CIRCLE         : 0) |        \
+    (((_buttons_) & XUSB_GAMEPAD_X)               ? DS4_BUTTON_SQUARE         : 0) |        \
+    (((_buttons_) & XUSB_GAMEPAD_Y)               ? DS4_BUTTON_TRIANGLE       : 0))
+
+#define XUSB_TO_DS4_BUTTONS_LOW_ENTRY(_index_)  XUSB_TO_DS4_BUTTONS(_index_)
+#define XUSB_TO_DS4_BUTTONS_HIGH_ENTRY(_index_) XUSB_TO_DS4_BUTTONS((_index_) << 8)
+
+//
+// DualShock 4 buttons indexed by the low byte of XUSB_REPORT.wButtons.
+//
+static const USHORT XUSB_TO_DS4_BUTTONS_LOW[256] = {
+    VIGEM_LUT_256(XUSB_TO_DS4_BUTTONS_LOW_ENTRY, 0)
+};
+
+//
+// DualShock 4 buttons indexed by the high byte of XUSB_REPORT.wButtons.
+//
+static const USHORT XUSB_TO_DS4_BUTTONS_HIGH[256] = {
+    VIGEM_LUT_256(XUSB_TO_DS4_BUTTONS_HIGH_ENTRY, 0)
+};
+
+#pragma endregion
+
+//
+// Converts an XUSB report into a DualShock 4 report.
+//
+// Buttons are merged into the existing content of Output, the D-PAD value
+// of Output is left untouched if no D-PAD direction is pressed on Input.
+//
 VOID FORCEINLINE XUSB_TO_DS4_REPORT(
-    _Out_ PXUSB_REPORT Input,
-    _Out_ PDS4_REPORT Output
-)
-{
-    if (Input->wButtons & XUSB_GAMEPAD_BACK) Output->wButtons |= DS4_BUTTON_SHARE;
-    if (Input->wButtons & XUSB_GAMEPAD_START) Output->wButtons |= DS4_BUTTON_OPTIONS;
-    if (Input->wButtons & XUSB_GAMEPAD_LEFT_THUMB) Output->wButtons |= DS4_BUTTON_THUMB_LEFT;
-    if (Input->wButtons & XUSB_GAMEPAD_RIGHT_THUMB) Output->wButtons |= DS4_BUTTON_THUMB_RIGHT;
-    if (Input->wButtons & XUSB_GAMEPAD_LEFT_SHOULDER) Output->wButtons |= DS4_BUTTON_SHOULDER_LEFT;
-    if (Input->wButtons & XUSB_GAMEPAD_RIGHT_SHOULDER) Output->wButtons |= DS4_BUTTON_SHOULDER_RIGHT;
-    if (Input->wButtons & XUSB_GAMEPAD_GUIDE) Output->bSpecial |= DS4_SPECIAL_BUTTON_PS;
-    if (Input->wButtons & XUSB_GAMEPAD_A) Output->wButtons |= DS4_BUTTON_CROSS;
-    if (Input->wButtons & XUSB_GAMEPAD_B) Output->wButtons |= DS4_BUTTON_CIRCLE;
-    if (Input->wButtons & XUSB_GAMEPAD_X) Output->wButtons |= DS4_BUTTON_SQUARE;
-    if (Input->wButtons & XUSB_GAMEPAD_Y) Output->wButtons |= DS4_BUTTON_TRIANGLE;
+    _In_ const XUSB_REPORT* Input,
+    _Inout_ PDS4_REPORT Output
+)
+{
+    USHORT dpad = Input->wButtons & 0xF;
+    //
+    // 0xF if no direction is pressed (keep current D-PAD value), 0x0 otherwise
+    //
+    USHORT keep = (USHORT)((((dpad + 0xF) >> 4) - 1) & 0xF);
+    USHORT buttons = XUSB_TO_DS4_BUTTONS_LOW[Input->wButtons & 0xFF]
+        | XUSB_TO_DS4_BUTTONS_HIGH[Input->wButtons >> 8]
+        | (USHORT)((Input->bLeftTrigger != 0) * DS4_BUTTON_TRIGGER_LEFT)
+        | (USHORT)((Input->bRightTrigger != 0) * DS4_BUTTON_TRIGGER_RIGHT);
+    BYTE thumbY;
+
+    Output->wButtons = (USHORT)(((Output->wButtons | buttons) & (~0xF | keep))
+        | (VIGEM_DPAD_MASK_TO_DS4_HAT[dpad] & ~keep));
+    Output->bSpecial |= (BYTE)((Input->wButtons & XUSB_GAMEPAD_GUIDE) >> 10);
 
     Output->bTriggerL = Input->bLeftTrigger;
     Output->bTriggerR = Input->bRightTrigger;
 
-    if (Input->bLeftTrigger > 0)Output->wButtons |= DS4_BUTTON_TRIGGER_LEFT;
-    if (Input->bRightTrigger > 0)Output->wButtons |= DS4_BUTTON_TRIGGER_RIGHT;
+    //
+    // Y axes are inverted, 0x00 is reported as 0xFF
+    //
+    Output->bThumbLX = (BYTE)((Input->sThumbLX + ((USHRT_MAX / 2) + 1)) / 257);
+    thumbY = (BYTE)(-(Input->sThumbLY + ((USHRT_MAX / 2) - 1)) / 257);
+    Output->bThumbLY = (BYTE)(thumbY - (thumbY == 0));
+    Output->bThumbRX = (BYTE)((Input->sThumbRX + ((USHRT_MAX / 2) + 1)) / 257);
+    thumbY = (BYTE)(-(Input->sThumbRY + ((USHRT_MAX / 2) + 1)) / 257);
+    Output->bThumbRY = (BYTE)(thumbY - (thumbY == 0));
+}
+
+//
+// Converts an array of XUSB reports into DualShock 4 reports.
+//
+VOID FORCEINLINE XUSB_TO_DS4_REPORT_BATCH(
+    _In_reads_(Count) const XUSB_REPORT* Input,
+    _Inout_updates_(Count) PDS4_REPORT Output,
+    _In_ size_t Count
+)
+{
+    size_t index;
+
+    for (index = 0; index < Count; index++)
+    {
+        XUSB_TO_DS4_REPORT(&Input[index], &Output[index]);
+    }
+}
+
+#pragma region DualShock 4 to XUSB lookup tables
+
+//
+// Maps the DualShock 4 buttons of a single input byte to XUSB buttons.
+//
+#define DS4_TO_XUSB_BUTTONS(_buttons_) (USHORT)(                                            \
+    (((_buttons_) & DS4_BUTTON_SHARE)             ? XUSB_GAMEPAD_BACK           : 0) |      \
+    (((_buttons_) & DS4_BUTTON_OPTIONS)           ? XUSB_GAMEPAD_START          : 0) |      \
+    (((_buttons_) & DS4_BUTTON_THUMB_LEFT)        ? XUSB_GAMEPAD_LEFT_THUMB     : 0) |      \
+    (((_buttons_) & DS4_BUTTON_THUMB_RIGHT)       ? XUSB_GAMEPAD_RIGHT_THUMB    : 0) |      \
+    (((_buttons_) & DS4_BUTTON_SHOULDER_LEFT)     ? XUSB_GAMEPAD_LEFT_SHOULDER  : 0) |      \
+    (((_buttons_) & DS4_BUTTON_SHOULDER_RIGHT)    ? XUSB_GAMEPAD_RIGHT_SHOULDER : 0) |      \
+    (((_buttons_) & DS4_BUTTON_CROSS)             ? XUSB_GAMEPAD_A              : 0) |      \
+    (((_buttons_) & DS4_BUTTON_CIRCLE)            ? XUSB_GAMEPAD_B              : 0) |      \
+    (((_buttons_) & DS4_BUTTON_SQUARE)            ? XUSB_GAMEPAD_X              : 0) |      \
+    (((_buttons_) & DS4_BUTTON_TRIANGLE)          ? XUSB_GAMEPAD_Y              : 0))
+
+#define DS4_TO_XUSB_BUTTONS_LOW_ENTRY(_index_)  DS4_TO_XUSB_BUTTONS(_index_)
+#define DS4_TO_XUSB_BUTTONS_HIGH_ENTRY(_index_) DS4_TO_XUSB_BUTTONS((_index_) << 8)
+
+//
+// Inverse of the Y axis conversion in XUSB_TO_DS4_REPORT. Picks the value
+// of the XUSB range which converts back to the same byte, so the round trip
+// DS4 -> XUSB -> DS4 is lossless for every value XUSB_TO_DS4_REPORT produces.
+//
+#define DS4_TO_XUSB_THUMB_Y(_index_, _offset_) (SHORT)(                                     \
+    ((_index_) == 0xFF) ? SHRT_MIN :                                                        \
+    (((_offset_) - 257 * (_index_)) > SHRT_MAX) ? SHRT_MAX :                                \
+    ((_offset_) - 257 * (_index_)))
+
+#define DS4_TO_XUSB_THUMB_LY_ENTRY(_index_)     DS4_TO_XUSB_THUMB_Y(_index_, 33026)
+#define DS4_TO_XUSB_THUMB_RY_ENTRY(_index_)     DS4_TO_XUSB_THUMB_Y(_index_, 33024)
+
+//
+// XUSB buttons indexed by the low byte of DS4_REPORT.wButtons (D-PAD excluded).
+//
+static const USHORT DS4_TO_XUSB_BUTTONS_LOW[256] = {
+    VIGEM_LUT_256(DS4_TO_XUSB_BUTTONS_LOW_ENTRY, 0)
+};
+
+//
+// XUSB buttons indexed by the high byte of DS4_REPORT.wButtons.
+//
+static const USHORT DS4_TO_XUSB_BUTTONS_HIGH[256] = {
+    VIGEM_LUT_256(DS4_TO_XUSB_BUTTONS_HIGH_ENTRY, 0)
+};
+
+//
+// XUSB Y axis values indexed by DS4_REPORT.bThumbLY.
+//
+static const SHORT DS4_TO_XUSB_THUMB_LY[256] = {
+    VIGEM_LUT_256(DS4_TO_XUSB_THUMB_LY_ENTRY, 0)
+};
+
+//
+// XUSB Y axis values indexed by DS4_REPORT.bThumbRY.
+//
+static const SHORT DS4_TO_XUSB_THUMB_RY[256] = {
+    VIGEM_LUT_256(DS4_TO_XUSB_THUMB_RY_ENTRY, 0)
+};
+
+#pragma endregion
+
+//
+// Converts a DualShock 4 report into an XUSB report.
+//
+// The touchpad click and the digital trigger buttons have no XUSB
+// counterpart and are dropped; triggers are taken from the analog values.
+//
+VOID FORCEINLINE DS4_TO_XUSB_REPORT(
+    _In_ const DS4_REPORT* Input,
+    _Out_ PXUSB_REPORT Output
+)
+{
+    Output->wButtons = (USHORT)(DS4_TO_XUSB_BUTTONS_LOW[Input->wButtons & 0xFF]
+        | DS4_TO_XUSB_BUTTONS_HIGH[Input->wButtons >> 8]
+        | VIGEM_DS4_HAT_TO_DPAD_MASK[Input->wButtons & VIGEM_DPAD_MASK]
+        | ((Input->bSpecial & DS4_SPECIAL_BUTTON_PS) << 10));
+
+    Output->bLeftTrigger = Input->bTriggerL;
+    Output->bRightTrigger = Input->bTriggerR;
+
+    Output->sThumbLX = (SHORT)(Input->bThumbLX * 257 + SHRT_MIN);
+    Output->sThumbLY = DS4_TO_XUSB_THUMB_LY[Input->bThumbLY];
+    Output->sThumbRX = (SHORT)(Input->bThumbRX * 257 + SHRT_MIN);
+    Output->sThumbRY = DS4_TO_XUSB_THUMB_RY[Input->bThumbRY];
+}
+
+//
+// Converts an array of DualShock 4 reports into XUSB reports.
+//
+VOID FORCEINLINE DS4_TO_XUSB_REPORT_BATCH(
+    _In_reads_(Count) const DS4_REPORT* Input,
+    _Out_writes_(Count) PXUSB_REPORT Output,
+    _In_ size_t Count
+)
+{
+    size_t index;
+
+    for (index = 0; index < Count; index++)
+    {
+        DS4_TO_XUSB_REPORT(&Input[index], &Output[index]);
+    }
+}
+
+#pragma region XUSB <-> XGIP trigger lookup tables
+
+//
+// Converts an 8-bit XUSB trigger value into a 10-bit XGIP trigger value,
+// the same rescaling XnaGuardian applies to high resolution overrides.
+//
+#define XUSB_TO_XGIP_TRIGGER(_value_)   (SHORT)XINPUT_TRIGGER_TO_HIGH_RES(_value_)
+
+//
+// Converts a 10-bit XGIP trigger value into an 8-bit XUSB trigger value.
+//
+#define XGIP_TO_XUSB_TRIGGER(_value_)   XINPUT_TRIGGER_FROM_HIGH_RES(_value_)
+
+//
+// 10-bit trigger values indexed by 8-bit trigger values (0 -> 0, 255 -> 1023).
+//
+static const SHORT XUSB_TO_XGIP_TRIGGERS[256] = {
+    VIGEM_LUT_256(XUSB_TO_XGIP_TRIGGER, 0)
+};
+
+//
+// 8-bit trigger values indexed by 10-bit trigger values, rounded to nearest.
+//
+static const BYTE XGIP_TO_XUSB_TRIGGERS[1024] = {
+    VIGEM_LUT_1024(XGIP_TO_XUSB_TRIGGER, 0)
+};
+
+#pragma endregion
+
+//
+// Converts an XUSB report into an Xbox One (GIP) report.
+//
+// The D-PAD, shoulder and thumb buttons keep their relative order between
+// XUSB_BUTTON and Buttons2, as do START/BACK and A/B/X/Y in Buttons1, so
+// the buttons are moved with shifts and masks. GUIDE is not part of the
+// GIP input report and is dropped.
+//
+VOID FORCEINLINE XUSB_TO_XGIP_REPORT(
+    _In_ const XUSB_REPORT* Input,
+    _Out_ PXGIP_REPORT Output
+)
+{
+    USHORT wButtons = Input->wButtons;
+
+    Output->Buttons1 = (UCHAR)(((wButtons >> 2) & (XGIP_BUTTON1_MENU | XGIP_BUTTON1_VIEW))
+        | ((wButtons >> 8) & (XGIP_BUTTON1_A | XGIP_BUTTON1_B | XGIP_BUTTON1_X | XGIP_BUTTON1_Y)));
+    Output->Buttons2 = (UCHAR)((wButtons & 0xCF)
+        | ((wButtons >> 4) & (XGIP_BUTTON2_SHOULDER_LEFT | XGIP_BUTTON2_SHOULDER_RIGHT)));
+
+    Output->LeftTrigger = XUSB_TO_XGIP_TRIGGERS[Input->bLeftTrigger];
+    Output->RightTrigger = XUSB_TO_XGIP_TRIGGERS[Input->bRightTrigger];
 
-    if (Input->wButtons & XUSB_GAMEPAD_DPAD_UP) DS4_SET_DPAD(Output, DS4_BUTTON_DPAD_NORTH);
-    if (Input->wButtons & XUSB_GAMEPAD_DPAD_RIGHT) DS4_SET_DPAD(Output, DS4_BUTTON_DPAD_EAST);
-    if (Input->wButtons & XUSB_GAMEPAD_DPAD_DOWN) DS4_SET_DPAD(Output, DS4_BUTTON_DPAD_SOUTH);
-    if (Input->wButtons & XUSB_GAMEPAD_DPAD_LEFT) DS4_SET_DPAD(Output, DS4_BUTTON_DPAD_WEST);
+    Output->ThumbLX = Input->sThumbLX;
+    Output->ThumbLY = Input->sThumbLY;
+    Output->ThumbRX = Input->sThumbRX;
+    Output->ThumbRY = Input->sThumbRY;
+}
 
-    if (Input->wButtons & XUSB_GAMEPAD_DPAD_UP
-        && Input->wButtons & XUSB_GAMEPAD_DPAD_RIGHT) DS4_SET_DPAD(Output, DS4_BUTTON_DPAD_NORTHEAST);
-    if (Input->wButtons & XUSB_GAMEPAD_DPAD_RIGHT
-        && Input->wButtons & XUSB_GAMEPAD_DPAD_DOWN) DS4_SET_DPAD(Output, DS4_BUTTON_DPAD_SOUTHEAST);
-    if (Input->wButtons & XUSB_GAMEPAD_DPAD_DOWN
-        && Input->wButtons & XUSB_GAMEPAD_DPAD_LEFT) DS4_SET_DPAD(Output, DS4_BUTTON_DPAD_SOUTHWEST);
-    if (Input->wButtons & XUSB_GAMEPAD_DPAD_LEFT
-        && Input->wButtons & XUSB_GAMEPAD_DPAD_UP) DS4_SET_DPAD(Output, DS4_BUTTON_DPAD_NORTHWEST);
+//
+// Converts an array of XUSB reports into Xbox One (GIP) reports.
+//
+VOID FORCEINLINE XUSB_TO_XGIP_REPORT_BATCH(
+    _In_reads_(Count) const XUSB_REPORT* Input,
+    _Out_writes_(Count) PXGIP_REPORT Output,
+    _In_ size_t Count
+)
+{
+    size_t index;
 
-    Output->bThumbLX = ((Input->sThumbLX + ((USHRT_MAX / 2) + 1)) / 257);
-    Output->bThumbLY = (-(Input->sThumbLY + ((USHRT_MAX / 2) - 1)) / 257);
-    Output->bThumbLY = (Output->bThumbLY == 0) ? 0xFF : Output->bThumbLY;
-    Output->bThumbRX = ((Input->sThumbRX + ((USHRT_MAX / 2) + 1)) / 257);
-    Output->bThumbRY = (-(Input->sThumbRY + ((USHRT_MAX / 2) + 1)) / 257);
-    Output->bThumbRY = (Output->bThumbRY == 0) ? 0xFF : Output->bThumbRY;
+    for (index = 0; index < Count; index++)
+    {
+        XUSB_TO_XGIP_REPORT(&Input[index], &Output[index]);
+    }
 }
 
+//
+// Converts an Xbox One (GIP) report into an XUSB report.
+//
+// Trigger values outside of 0 to 1023 are clamped.
+//
+VOID FORCEINLINE XGIP_TO_XUSB_REPORT(
+    _In_ const XGIP_REPORT* Input,
+    _Out_ PXUSB_REPORT Output
+)
+{
+    LONG leftTrigger = Input->LeftTrigger;
+    LONG rightTrigger = Input->RightTrigger;
+
+    leftTrigger = (leftTrigger < 0) ? 0 : (leftTrigger > 1023) ? 1023 : leftTrigger;
+    rightTrigger = (rightTrigger < 0) ? 0 : (rightTrigger > 1023) ? 1023 : rightTrigger;
+
+    Output->wButtons = (USHORT)((Input->Buttons2 & 0xCF)
+        | ((Input->Buttons2 & (XGIP_BUTTON2_SHOULDER_LEFT | XGIP_BUTTON2_SHOULDER_RIGHT)) << 4)
+        | ((Input->Buttons1 & (XGIP_BUTTON1_MENU | XGIP_BUTTON1_VIEW)) << 2)
+        | ((Input->Buttons1 & (XGIP_BUTTON1_A | XGIP_BUTTON1_B | XGIP_BUTTON1_X | XGIP_BUTTON1_Y)) << 8));
+
+    Output->bLeftTrigger = XGIP_TO_XUSB_TRIGGERS[leftTrigger];
+    Output->bRightTrigger = XGIP_TO_XUSB_TRIGGERS[rightTrigger];
+
+    Output->sThumbLX = Input->ThumbLX;
+    Output->sThumbLY = Input->ThumbLY;
+    Output->sThumbRX = Input->ThumbRX;
+    Output->sThumbRY = Input->ThumbRY;
+}
+
+//
+// Converts an array of Xbox One (GIP) reports into XUSB reports.
+//
+VOID FORCEINLINE XGIP_TO_XUSB_REPORT_BATCH(
+    _In_reads_(Count) const XGIP_REPORT* Input,
+    _Out_writes_(Count) PXUSB_REPORT Output,
+    _In_ size_t Count
+)
+{
+    size_t index;
+
+    for (index = 0; index < Count; index++)
+    {
+        XGIP_TO_XUSB_REPORT(&Input[index], &Output[index]);
+    }
+}
+
+//
+// Incrementally encoded fields of a DualShock 4 USB input report, one per pad.
+//
+typedef struct _DS4_USB_REPORT_CONTEXT
+{
+    //
+    // 6-bit report counter
+    //
+    BYTE FrameCounter;
+
+    //
+    // Report timestamp in units of 5.33 microseconds
+    //
+    USHORT Timestamp;
+
+    //
+    // Timestamp increment per report (e.g. 188 for 1 ms, 752 for 4 ms)
+    //
+    USHORT TimestampInterval;
+
+} DS4_USB_REPORT_CONTEXT, *PDS4_USB_REPORT_CONTEXT;
+
+VOID FORCEINLINE DS4_USB_REPORT_CONTEXT_INIT(
+    _Out_ PDS4_USB_REPORT_CONTEXT Context,
+    _In_ USHORT TimestampInterval
+)
+{
+    RtlZeroMemory(Context, sizeof(DS4_USB_REPORT_CONTEXT));
+
+    Context->TimestampInterval = TimestampInterval;
+}
+
+//
+// Writes a touch contact in its packed 4-byte representation.
+//
+VOID FORCEINLINE DS4_TOUCH_POINT_SERIALIZE(
+    _In_ const DS4_TOUCH_POINT* Touch,
+    _Out_writes_bytes_(4) PUCHAR Buffer
+)
+{
+    Buffer[0] = (UCHAR)((Touch->bIsDown ? 0x00 : 0x80) | (Touch->bTrackingNum & 0x7F));
+    Buffer[1] = (UCHAR)Touch->wX;
+    Buffer[2] = (UCHAR)(((Touch->wX >> 8) & 0x0F) | ((Touch->wY & 0x0F) << 4));
+    Buffer[3] = (UCHAR)(Touch->wY >> 4);
+}
+
+//
+// Writes a complete 64-byte DualShock 4 USB input report into Buffer.
+//
+// The frame counter and timestamp are taken from Context and advanced
+// afterwards.
+//
+VOID FORCEINLINE DS4_REPORT_EX_TO_USB_REPORT(
+    _In_ const DS4_REPORT_EX* Input,
+    _Inout_ PDS4_USB_REPORT_CONTEXT Context,
+    _Out_writes_bytes_(DS4_USB_INPUT_REPORT_LENGTH) PUCHAR Buffer
+)
+{
+    ULONG index;
+
+    RtlZeroMemory(Buffer, DS4_USB_INPUT_REPORT_LENGTH);
+
+    Buffer[0] = DS4_USB_INPUT_REPORT_ID;
+    Buffer[1] = Input->Report.bThumbLX;
+    Buffer[2] = Input->Report.bThumbLY;
+    Buffer[3] = Input->Report.bThumbRX;
+    Buffer[4] = Input->Report.bThumbRY;
+    Buffer[5] = (UCHAR)Input->Report.wButtons;
+    Buffer[6] = (UCHAR)(Input->Report.wButtons >> 8);
+    Buffer[7] = (UCHAR)((Input->Report.bSpecial & 0x03) | (Context->FrameCounter << 2));
+    Buffer[8] = Input->Report.bTriggerL;
+    Buffer[9] = Input->Report.bTriggerR;
+    Buffer[10] = (UCHAR)Context->Timestamp;
+    Buffer[11] = (UCHAR)(Context->Timestamp >> 8);
+    Buffer[12] = Input->bTemperature;
+    Buffer[13] = (UCHAR)Input->wGyroX;
+    Buffer[14] = (UCHAR)(Input->wGyroX >> 8);
+    Buffer[15] = (UCHAR)Input->wGyroY;
+    Buffer[16] = (UCHAR)(Input->wGyroY >> 8);
+    Buffer[17] = (UCHAR)Input->wGyroZ;
+    Buffer[18] = (UCHAR)(Input->wGyroZ >> 8);
+    Buffer[19] = (UCHAR)Input->wAccelX;
+    Buffer[20] = (UCHAR)(Input->wAccelX >> 8);
+    Buffer[21] = (UCHAR)Input->wAccelY;
+    Buffer[22] = (UCHAR)(Input->wAccelY >> 8);
+    Buffer[23] = (UCHAR)Input->wAccelZ;
+    Buffer[24] = (UCHAR)(Input->wAccelZ >> 8);
+    Buffer[30] = (UCHAR)((Input->bBatteryLevel & 0x0F) | (Input->bCableConnected ? 0x10 : 0x00));
+    Buffer[33] = Input->bTouchPacketCount;
+
+    //
+    // Touch packets: counter, followed by two contacts of 4 bytes each
+    //
+    for (index = 0; index < DS4_TOUCH_PACKETS_MAX; index++)
+    {
+        Buffer[34 + index * 9] = Input->TouchPackets[index].bPacketCounter;
+        DS4_TOUCH_POINT_SERIALIZE(&Input->TouchPackets[index].Touch[0], &Buffer[35 + index * 9]);
+        DS4_TOUCH_POINT_SERIALIZE(&Input->TouchPackets[index].Touch[1], &Buffer[39 + index * 9]);
+    }
+
+    //
+    // Truncated fourth touch packet, never valid
+    //
+    Buffer[62] = 0x80;
+
+    Context->FrameCounter = (BYTE)((Context->FrameCounter + 1) & 0x3F);
+    Context->Timestamp = (USHORT)(Context->Timestamp + Context->TimestampInterval);
+}
+
+//
+// Writes Count contiguous 64-byte DualShock 4 USB input reports, one per
+// pad, each with its own context.
+//
+VOID FORCEINLINE DS4_REPORT_EX_TO_USB_REPORT_BATCH(
+    _In_reads_(Count) const DS4_REPORT_EX* Input,
+    _Inout_updates_(Count) PDS4_USB_REPORT_CONTEXT Context,
+    _Out_writes_bytes_(Count * DS4_USB_INPUT_REPORT_LENGTH) PUCHAR Buffer,
+    _In_ size_t Count
+)
+{
+    size_t index;
+
+    for (index = 0; index < Count; index++)
+    {
+        DS4_REPORT_EX_TO_USB_REPORT(
+            &Input[index],
+            &Context[index],
+            &Buffer[index * DS4_USB_INPUT_REPORT_LENGTH]);
+    }
+}
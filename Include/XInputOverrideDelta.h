@@ -0,0 +1,183 @@
+/*
+MIT License
+
+Copyright (c) 2017 Benjamin "Nefarius" Hglinger
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#pragma once
+
+#include "XnaGuardianShared.h"
+
+//
+// Compact encoding of IOCTL_XINPUT_EXT_OVERRIDE_GAMEPAD_DELTA requests.
+//
+// A delta carries the user index, a little-endian 16-bit field bitmap and
+// then only the fields of XINPUT_EXT_OVERRIDE_GAMEPAD that changed, packed
+// without padding in bitmap order. Both sides keep the last override sent
+// on a handle, the driver applies the delta on top of it. Decoding rejects
+// unknown bits and any length not matching the bitmap exactly.
+//
+
+#define XINPUT_EXT_DELTA_FIELD_OVERRIDES            0x0001
+#define XINPUT_EXT_DELTA_FIELD_BUTTONS              0x0002
+#define XINPUT_EXT_DELTA_FIELD_LEFT_TRIGGER         0x0004
+#define XINPUT_EXT_DELTA_FIELD_RIGHT_TRIGGER        0x0008
+#define XINPUT_EXT_DELTA_FIELD_LEFT_THUMB_X         0x0010
+#define XINPUT_EXT_DELTA_FIELD_LEFT_THUMB_Y         0x0020
+#define XINPUT_EXT_DELTA_FIELD_RIGHT_THUMB_X        0x0040
+#define XINPUT_EXT_DELTA_FIELD_RIGHT_THUMB_Y        0x0080
+#define XINPUT_EXT_DELTA_FIELD_LEFT_TRIGGER_HIGH_RES    0x0100
+#define XINPUT_EXT_DELTA_FIELD_RIGHT_TRIGGER_HIGH_RES   0x0200
+#define XINPUT_EXT_DELTA_FIELDS_ALL                 0x03FF
+
+//
+// User index and field bitmap
+//
+#define XINPUT_EXT_OVERRIDE_GAMEPAD_DELTA_HEADER_SIZE   3
+
+//
+// Header and all fields
+//
+#define XINPUT_EXT_OVERRIDE_GAMEPAD_DELTA_MAX_SIZE      (XINPUT_EXT_OVERRIDE_GAMEPAD_DELTA_HEADER_SIZE + 20)
+
+C_ASSERT(XINPUT_EXT_OVERRIDE_GAMEPAD_DELTA_MAX_SIZE == XINPUT_EXT_OVERRIDE_GAMEPAD_DELTA_HEADER_SIZE
+    + sizeof(ULONG) + sizeof(XINPUT_GAMEPAD_STATE) + 2 * sizeof(USHORT));
+
+//
+// Fields in wire order, _entry_(flag, member of XINPUT_EXT_OVERRIDE_GAMEPAD)
+//
+#define XINPUT_EXT_DELTA_FIELD_TABLE(_entry_)                                   \
+    _entry_(XINPUT_EXT_DELTA_FIELD_OVERRIDES, Overrides)                        \
+    _entry_(XINPUT_EXT_DELTA_FIELD_BUTTONS, Gamepad.wButtons)                   \
+    _entry_(XINPUT_EXT_DELTA_FIELD_LEFT_TRIGGER, Gamepad.bLeftTrigger)          \
+    _entry_(XINPUT_EXT_DELTA_FIELD_RIGHT_TRIGGER, Gamepad.bRightTrigger)        \
+    _entry_(XINPUT_EXT_DELTA_FIELD_LEFT_THUMB_X, Gamepad.sThumbLX)              \
+    _entry_(XINPUT_EXT_DELTA_FIELD_LEFT_THUMB_Y, Gamepad.sThumbLY)              \
+    _entry_(XINPUT_EXT_DELTA_FIELD_RIGHT_THUMB_X, Gamepad.sThumbRX)             \
+    _entry_(XINPUT_EXT_DELTA_FIELD_RIGHT_THUMB_Y, Gamepad.sThumbRY)             \
+    _entry_(XINPUT_EXT_DELTA_FIELD_LEFT_TRIGGER_HIGH_RES, LeftTrigger)          \
+    _entry_(XINPUT_EXT_DELTA_FIELD_RIGHT_TRIGGER_HIGH_RES, RightTrigger)
+
+//
+// Encodes the fields of Current differing from Previous into Buffer, which
+// must hold XINPUT_EXT_OVERRIDE_GAMEPAD_DELTA_MAX_SIZE bytes. Returns the
+// encoded length, XINPUT_EXT_OVERRIDE_GAMEPAD_DELTA_HEADER_SIZE if nothing
+// changed or zero if Buffer is too small.
+//
+ULONG FORCEINLINE XINPUT_EXT_OVERRIDE_GAMEPAD_DELTA_ENCODE(
+    _Out_writes_bytes_(BufferLength) PUCHAR Buffer,
+    _In_ size_t BufferLength,
+    _In_ const XINPUT_EXT_OVERRIDE_GAMEPAD* Previous,
+    _In_ const XINPUT_EXT_OVERRIDE_GAMEPAD* Current
+)
+{
+    ULONG   length = XINPUT_EXT_OVERRIDE_GAMEPAD_DELTA_HEADER_SIZE;
+    USHORT  fields = 0;
+
+    if (BufferLength < XINPUT_EXT_OVERRIDE_GAMEPAD_DELTA_MAX_SIZE)
+        return 0;
+
+#define XINPUT_EXT_DELTA_ENCODE_FIELD(_flag_, _field_)                              \
+    if (Current->_field_ != Previous->_field_)                                      \
+    {                                                                               \
+        RtlCopyMemory(&Buffer[length], &Current->_field_, sizeof(Current->_field_));\
+        length += sizeof(Current->_field_);                                         \
+        fields |= (_flag_);                                                         \
+    }
+
+    XINPUT_EXT_DELTA_FIELD_TABLE(XINPUT_EXT_DELTA_ENCODE_FIELD)
+
+#undef XINPUT_EXT_DELTA_ENCODE_FIELD
+
+    Buffer[0] = Current->UserIndex;
+    Buffer[1] = (UCHAR)(fields & 0xFF);
+    Buffer[2] = (UCHAR)(fields >> 8);
+
+    return length;
+}
+
+//
+// Returns the user index a delta applies to, Length must be at least
+// XINPUT_EXT_OVERRIDE_GAMEPAD_DELTA_HEADER_SIZE.
+//
+UCHAR FORCEINLINE XINPUT_EXT_OVERRIDE_GAMEPAD_DELTA_USER_INDEX(
+    _In_reads_bytes_(XINPUT_EXT_OVERRIDE_GAMEPAD_DELTA_HEADER_SIZE) const UCHAR* Buffer
+)
+{
+    return Buffer[0];
+}
+
+//
+// Applies a delta of Length bytes to Target, which must be the override of
+// the pad the delta was encoded for. Target is left untouched and FALSE is
+// returned if the delta is malformed.
+//
+BOOLEAN FORCEINLINE XINPUT_EXT_OVERRIDE_GAMEPAD_DELTA_DECODE(
+    _In_reads_bytes_(Length) const UCHAR* Buffer,
+    _In_ size_t Length,
+    _Inout_ PXINPUT_EXT_OVERRIDE_GAMEPAD Target
+)
+{
+    size_t  expected = XINPUT_EXT_OVERRIDE_GAMEPAD_DELTA_HEADER_SIZE;
+    size_t  offset = XINPUT_EXT_OVERRIDE_GAMEPAD_DELTA_HEADER_SIZE;
+    USHORT  fields;
+
+    if (Length < XINPUT_EXT_OVERRIDE_GAMEPAD_DELTA_HEADER_SIZE
+        || Buffer[0] != Target->UserIndex)
+    {
+        return FALSE;
+    }
+
+    fields = (USHORT)(Buffer[1] | (Buffer[2] << 8));
+
+    if (fields & ~XINPUT_EXT_DELTA_FIELDS_ALL)
+        return FALSE;
+
+    //
+    // Validate the complete length before touching Target
+    //
+#define XINPUT_EXT_DELTA_SIZE_FIELD(_flag_, _field_)                                \
+    if (fields & (_flag_))                                                          \
+    {                                                                               \
+        expected += sizeof(Target->_field_);                                        \
+    }
+
+    XINPUT_EXT_DELTA_FIELD_TABLE(XINPUT_EXT_DELTA_SIZE_FIELD)
+
+#undef XINPUT_EXT_DELTA_SIZE_FIELD
+
+    if (Length != expected)
+        return FALSE;
+
+#define XINPUT_EXT_DELTA_DECODE_FIELD(_flag_, _field_)                              \
+    if (fields & (_flag_))                                                          \
+    {                                                                               \
+        RtlCopyMemory(&Target->_field_, &Buffer[offset], sizeof(Target->_field_));  \
+        offset += sizeof(Target->_field_);                                          \
+    }
+
+    XINPUT_EXT_DELTA_FIELD_TABLE(XINPUT_EXT_DELTA_DECODE_FIELD)
+
+#undef XINPUT_EXT_DELTA_DECODE_FIELD
+
+    return TRUE;
+}
@@ -0,0 +1,107 @@
+/*
+MIT License
+
+Copyright (c) 2017 Benjamin "Nefarius" Hglinger
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#pragma once
+
+#include "XInputOverrides.h"
+#include "XnaGuardianShared.h"
+
+//
+// Branch-free merge of XINPUT_GAMEPAD_STATE values.
+//
+// An override bit set (XINPUT_GAMEPAD_OVERRIDES) is expanded once into a
+// mask of the same layout as XINPUT_GAMEPAD_STATE, every field being either
+// all ones (take the override value) or zero (keep the physical value).
+// Button bits map one to one. Merging is then a plain bitwise select over
+// the three 32-bit words of the structure, which works on unaligned
+// buffers and which compilers turn into vector code for batches.
+//
+
+#define XINPUT_GAMEPAD_STATE_WORDS     (sizeof(XINPUT_GAMEPAD_STATE) / sizeof(ULONG))
+
+C_ASSERT(sizeof(XINPUT_GAMEPAD_STATE) == XINPUT_GAMEPAD_STATE_WORDS * sizeof(ULONG));
+
+//
+// Expands Overrides into a per-field merge mask.
+//
+VOID FORCEINLINE XINPUT_GAMEPAD_MERGE_MASK_FROM_OVERRIDES(
+    _In_ ULONG Overrides,
+    _Out_ PXINPUT_GAMEPAD_STATE Mask
+)
+{
+    Mask->wButtons = (USHORT)(Overrides & 0xFFFF);
+    Mask->bLeftTrigger = (BYTE)(0 - ((Overrides & XINPUT_GAMEPAD_OVERRIDE_LEFT_TRIGGER) != 0));
+    Mask->bRightTrigger = (BYTE)(0 - ((Overrides & XINPUT_GAMEPAD_OVERRIDE_RIGHT_TRIGGER) != 0));
+    Mask->sThumbLX = (SHORT)(0 - ((Overrides & XINPUT_GAMEPAD_OVERRIDE_LEFT_THUMB_X) != 0));
+    Mask->sThumbLY = (SHORT)(0 - ((Overrides & XINPUT_GAMEPAD_OVERRIDE_LEFT_THUMB_Y) != 0));
+    Mask->sThumbRX = (SHORT)(0 - ((Overrides & XINPUT_GAMEPAD_OVERRIDE_RIGHT_THUMB_X) != 0));
+    Mask->sThumbRY = (SHORT)(0 - ((Overrides & XINPUT_GAMEPAD_OVERRIDE_RIGHT_THUMB_Y) != 0));
+}
+
+//
+// Replaces the fields of Target selected by Mask with the ones of Value.
+// Target may point into an unaligned request buffer.
+//
+VOID FORCEINLINE XINPUT_GAMEPAD_STATE_MERGE(
+    _Inout_ PXINPUT_GAMEPAD_STATE Target,
+    _In_ const XINPUT_GAMEPAD_STATE* Value,
+    _In_ const XINPUT_GAMEPAD_STATE* Mask
+)
+{
+    ULONG target[XINPUT_GAMEPAD_STATE_WORDS];
+    ULONG value[XINPUT_GAMEPAD_STATE_WORDS];
+    ULONG mask[XINPUT_GAMEPAD_STATE_WORDS];
+    ULONG index;
+
+    RtlCopyMemory(target, Target, sizeof(target));
+    RtlCopyMemory(value, Value, sizeof(value));
+    RtlCopyMemory(mask, Mask, sizeof(mask));
+
+    for (index = 0; index < XINPUT_GAMEPAD_STATE_WORDS; index++)
+    {
+        target[index] = (target[index] & ~mask[index]) | (value[index] & mask[index]);
+    }
+
+    RtlCopyMemory(Target, target, sizeof(target));
+}
+
+//
+// Merges Count states at once, Targets[n] receives the fields of Values[n]
+// selected by Masks[n].
+//
+VOID FORCEINLINE XINPUT_GAMEPAD_STATE_MERGE_BATCH(
+    _Inout_updates_(Count) PXINPUT_GAMEPAD_STATE Targets,
+    _In_reads_(Count) const XINPUT_GAMEPAD_STATE* Values,
+    _In_reads_(Count) const XINPUT_GAMEPAD_STATE* Masks,
+    _In_ size_t Count
+)
+{
+    size_t index;
+
+    for (index = 0; index < Count; index++)
+    {
+        XINPUT_GAMEPAD_STATE_MERGE(&Targets[index], &Values[index], &Masks[index]);
+    }
+}
@@ -0,0 +1,220 @@
+/*
+MIT License
+
+Copyright (c) 2017 Benjamin "Nefarius" Hglinger
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#pragma once
+
+#include "XInputOverrideMerge.h"
+
+//
+// Time-ordered queue of scheduled overrides of a pad.
+//
+// Entries are kept sorted by activation time. Evaluating the queue at a
+// given time drops expired entries and merges all active ones, an entry
+// activated later wins over an earlier one for the controls both of them
+// override. Times are opaque 64-bit values, callers only need to use the
+// same clock for scheduling and evaluation. No locking is done here.
+//
+
+#define XINPUT_OVERRIDE_SCHEDULE_MAX            0x10
+
+typedef struct _XINPUT_OVERRIDE_SCHEDULE_ENTRY
+{
+    ULONGLONG ActivationTime;
+
+    ULONGLONG ExpirationTime;
+
+    //
+    // Opaque identity of the requester
+    //
+    PVOID Owner;
+
+    XINPUT_EXT_OVERRIDE_GAMEPAD Override;
+
+} XINPUT_OVERRIDE_SCHEDULE_ENTRY, *PXINPUT_OVERRIDE_SCHEDULE_ENTRY;
+
+typedef struct _XINPUT_OVERRIDE_SCHEDULE
+{
+    ULONG Count;
+
+    XINPUT_OVERRIDE_SCHEDULE_ENTRY Entries[XINPUT_OVERRIDE_SCHEDULE_MAX];
+
+} XINPUT_OVERRIDE_SCHEDULE, *PXINPUT_OVERRIDE_SCHEDULE;
+
+VOID FORCEINLINE XINPUT_OVERRIDE_SCHEDULE_INIT(
+    _Out_ PXINPUT_OVERRIDE_SCHEDULE Schedule
+)
+{
+    Schedule->Count = 0;
+}
+
+//
+// Converts a schedule request of Owner received at time Now into an entry.
+// An activation time of zero means Now, the expiration time saturates.
+//
+VOID FORCEINLINE XINPUT_OVERRIDE_SCHEDULE_ENTRY_FROM_REQUEST(
+    _Out_ PXINPUT_OVERRIDE_SCHEDULE_ENTRY Entry,
+    _In_ const XINPUT_EXT_SCHEDULE_GAMEPAD* Request,
+    _In_ PVOID Owner,
+    _In_ ULONGLONG Now
+)
+{
+    Entry->ActivationTime = (Request->ActivationTime != 0) ? Request->ActivationTime : Now;
+    Entry->ExpirationTime = Entry->ActivationTime + Request->Duration;
+
+    if (Entry->ExpirationTime < Entry->ActivationTime)
+        Entry->ExpirationTime = (ULONGLONG)-1;
+
+    Entry->Owner = Owner;
+    Entry->Override = Request->Override;
+}
+
+//
+// Inserts Entry after all entries activating at the same time or earlier.
+// Returns FALSE if the queue is full.
+//
+BOOLEAN FORCEINLINE XINPUT_OVERRIDE_SCHEDULE_INSERT(
+    _Inout_ PXINPUT_OVERRIDE_SCHEDULE Schedule,
+    _In_ const XINPUT_OVERRIDE_SCHEDULE_ENTRY* Entry
+)
+{
+    ULONG position;
+
+    if (Schedule->Count >= XINPUT_OVERRIDE_SCHEDULE_MAX)
+        return FALSE;
+
+    for (position = Schedule->Count;
+        position > 0 && Schedule->Entries[position - 1].ActivationTime > Entry->ActivationTime;
+        position--)
+    {
+        Schedule->Entries[position] = Schedule->Entries[position - 1];
+    }
+
+    Schedule->Entries[position] = *Entry;
+    Schedule->Count++;
+
+    return TRUE;
+}
+
+//
+// Removes all entries of Owner, keeping the order of the others. Returns
+// the number of removed entries.
+//
+ULONG FORCEINLINE XINPUT_OVERRIDE_SCHEDULE_REMOVE_OWNER(
+    _Inout_ PXINPUT_OVERRIDE_SCHEDULE Schedule,
+    _In_ PVOID Owner
+)
+{
+    ULONG index;
+    ULONG count = 0;
+    ULONG removed;
+
+    for (index = 0; index < Schedule->Count; index++)
+    {
+        if (Schedule->Entries[index].Owner == Owner)
+            continue;
+
+        if (count != index)
+            Schedule->Entries[count] = Schedule->Entries[index];
+
+        count++;
+    }
+
+    removed = Schedule->Count - count;
+    Schedule->Count = count;
+
+    return removed;
+}
+
+//
+// Drops the entries expired at Time and merges the active ones into
+// Result, which must be initialized by the caller. Trigger values are
+// always returned in high resolution. Returns FALSE if no entry is active.
+//
+BOOLEAN FORCEINLINE XINPUT_OVERRIDE_SCHEDULE_EVALUATE(
+    _Inout_ PXINPUT_OVERRIDE_SCHEDULE Schedule,
+    _In_ ULONGLONG Time,
+    _Inout_ PXINPUT_EXT_OVERRIDE_GAMEPAD Result
+)
+{
+    PXINPUT_OVERRIDE_SCHEDULE_ENTRY pEntry;
+    XINPUT_GAMEPAD_STATE            mask;
+    ULONG                           index;
+    ULONG                           count = 0;
+    ULONG                           overrides;
+
+    Result->Overrides = 0;
+    Result->LeftTrigger = 0;
+    Result->RightTrigger = 0;
+    RtlZeroMemory(&Result->Gamepad, sizeof(XINPUT_GAMEPAD_STATE));
+
+    for (index = 0; index < Schedule->Count; index++)
+    {
+        pEntry = &Schedule->Entries[index];
+
+        if (pEntry->ExpirationTime <= Time)
+            continue;
+
+        //
+        // Compact in place, the order is preserved
+        //
+        if (count != index)
+            Schedule->Entries[count] = *pEntry;
+
+        pEntry = &Schedule->Entries[count++];
+
+        if (pEntry->ActivationTime > Time)
+            continue;
+
+        overrides = pEntry->Override.Overrides & ~XINPUT_GAMEPAD_OVERRIDE_HIGH_RES_TRIGGERS;
+
+        XINPUT_GAMEPAD_MERGE_MASK_FROM_OVERRIDES(overrides, &mask);
+        XINPUT_GAMEPAD_STATE_MERGE(&Result->Gamepad, &pEntry->Override.Gamepad, &mask);
+
+        if (overrides & XINPUT_GAMEPAD_OVERRIDE_LEFT_TRIGGER)
+        {
+            Result->LeftTrigger = (pEntry->Override.Overrides & XINPUT_GAMEPAD_OVERRIDE_HIGH_RES_TRIGGERS)
+                ? pEntry->Override.LeftTrigger
+                : XINPUT_TRIGGER_TO_HIGH_RES(pEntry->Override.Gamepad.bLeftTrigger);
+        }
+
+        if (overrides & XINPUT_GAMEPAD_OVERRIDE_RIGHT_TRIGGER)
+        {
+            Result->RightTrigger = (pEntry->Override.Overrides & XINPUT_GAMEPAD_OVERRIDE_HIGH_RES_TRIGGERS)
+                ? pEntry->Override.RightTrigger
+                : XINPUT_TRIGGER_TO_HIGH_RES(pEntry->Override.Gamepad.bRightTrigger);
+        }
+
+        Result->Overrides |= overrides;
+    }
+
+    Schedule->Count = count;
+
+    if (Result->Overrides == 0)
+        return FALSE;
+
+    Result->Overrides |= XINPUT_GAMEPAD_OVERRIDE_HIGH_RES_TRIGGERS;
+
+    return TRUE;
+}
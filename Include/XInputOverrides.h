@@ -46,6 +46,7 @@ typedef enum _XINPUT_GAMEPAD_OVERRIDES
     XINPUT_GAMEPAD_OVERRIDE_LEFT_THUMB_X        = 0x00040000,
     XINPUT_GAMEPAD_OVERRIDE_LEFT_THUMB_Y        = 0x00080000,
     XINPUT_GAMEPAD_OVERRIDE_RIGHT_THUMB_X       = 0x00100000,
-    XINPUT_GAMEPAD_OVERRIDE_RIGHT_THUMB_Y       = 0x00200000
+    XINPUT_GAMEPAD_OVERRIDE_RIGHT_THUMB_Y       = 0x00200000,
+    XINPUT_GAMEPAD_OVERRIDE_HIGH_RES_TRIGGERS   = 0x00400000
 } XINPUT_GAMEPAD_OVERRIDES, *PXINPUT_GAMEPAD_OVERRIDES;
 
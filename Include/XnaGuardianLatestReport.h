@@ -0,0 +1,130 @@
+/*
+MIT License
+
+Copyright (c) 2017 Benjamin "Nefarius" Hglinger
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+
+
+#pragma once
+
+//
+// Latest report mailbox of an interrupt-IN pipe.
+//
+// A report read while no upper request is pending is kept here instead of
+// being dropped, the next request is completed with it right away. A newer
+// report replaces one not taken yet, which is counted as coalesced. A
+// report longer than the mailbox is never stored truncated, it is counted
+// as dropped instead. Each stored report is taken at most once. No locking is done here, callers
+// serialize on the lock guarding the pending requests.
+//
+
+#define XNA_LATEST_REPORT_MAX_LENGTH    0x40
+
+typedef struct _XNA_LATEST_REPORT
+{
+    UCHAR           Report[XNA_LATEST_REPORT_MAX_LENGTH];
+
+    //
+    // Zero while no report is stored
+    //
+    ULONG           Length;
+
+    //
+    // Time the stored report was read
+    //
+    ULONGLONG       Time;
+
+    //
+    // Stored reports replaced by a newer one before any request took them
+    //
+    volatile LONG   Coalesced;
+
+    //
+    // Reports too long to be stored
+    //
+    volatile LONG   Dropped;
+
+} XNA_LATEST_REPORT, *PXNA_LATEST_REPORT;
+
+//
+// Stores a report of up to XNA_LATEST_REPORT_MAX_LENGTH bytes. A longer
+// one is dropped and leaves the mailbox untouched. Returns TRUE if a report
+// not taken yet got replaced.
+//
+BOOLEAN FORCEINLINE XNA_LATEST_REPORT_STORE(
+    _Inout_ PXNA_LATEST_REPORT Latest,
+    _In_ const UCHAR* Report,
+    _In_ ULONG Length,
+    _In_ ULONGLONG Time
+)
+{
+    BOOLEAN replaced;
+
+    if (Length > XNA_LATEST_REPORT_MAX_LENGTH)
+    {
+        InterlockedIncrement(&Latest->Dropped);
+        return FALSE;
+    }
+
+    replaced = (Latest->Length > 0);
+
+    if (replaced)
+        InterlockedIncrement(&Latest->Coalesced);
+
+    Latest->Length = Length;
+    Latest->Time = Time;
+    RtlCopyMemory(Latest->Report, Report, Latest->Length);
+
+    return replaced;
+}
+
+//
+// Copies the stored report to Report, which must hold
+// XNA_LATEST_REPORT_MAX_LENGTH bytes, and empties the mailbox. Returns
+// FALSE if no report is stored.
+//
+BOOLEAN FORCEINLINE XNA_LATEST_REPORT_TAKE(
+    _Inout_ PXNA_LATEST_REPORT Latest,
+    _Out_ PUCHAR Report,
+    _Out_ PULONG Length,
+    _Out_ PULONGLONG Time
+)
+{
+    *Length = Latest->Length;
+    *Time = Latest->Time;
+    RtlCopyMemory(Report, Latest->Report, *Length);
+    Latest->Length = 0;
+
+    return (*Length > 0);
+}
+
+//
+// Empties the mailbox without taking the report, e.g. when it was
+// delivered another way or the device leaves D0.
+//
+VOID FORCEINLINE XNA_LATEST_REPORT_DISCARD(
+    _Inout_ PXNA_LATEST_REPORT Latest
+)
+{
+    Latest->Length = 0;
+}
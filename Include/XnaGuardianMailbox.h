@@ -0,0 +1,125 @@
+/*
+MIT License
+
+Copyright (c) 2017 Benjamin "Nefarius" Hglinger
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#pragma once
+
+#include "XnaGuardianSeqLock.h"
+
+//
+// Shared memory override mailbox.
+//
+// A process allocates an XNA_GUARDIAN_MAILBOX (page aligned, e.g. from
+// VirtualAlloc) and hands it to the driver with IOCTL_XINPUT_EXT_MAILBOX_ATTACH
+// as output buffer. The driver keeps that request pending, so the pages
+// stay locked and mapped, until IOCTL_XINPUT_EXT_MAILBOX_DETACH is issued
+// on the same handle, the request is cancelled or the handle is closed.
+//
+// While attached, every pad has an override slot on its own cache line.
+// The process publishes overrides with XNA_GUARDIAN_MAILBOX_SLOT_WRITE and
+// the driver applies them on top of the regular overrides on every report,
+// no I/O request is needed per update. Each slot must have a single writer.
+//
+
+#define XNA_GUARDIAN_MAILBOX_ALIGNMENT      64
+
+//
+// Override data of a pad, same semantics as XINPUT_EXT_OVERRIDE_GAMEPAD
+//
+typedef struct _XNA_GUARDIAN_MAILBOX_OVERRIDE
+{
+    ULONG Overrides;
+
+    XINPUT_GAMEPAD_STATE Gamepad;
+
+    //
+    // Used if XINPUT_GAMEPAD_OVERRIDE_HIGH_RES_TRIGGERS is set in Overrides
+    //
+    USHORT LeftTrigger;
+
+    USHORT RightTrigger;
+
+} XNA_GUARDIAN_MAILBOX_OVERRIDE, *PXNA_GUARDIAN_MAILBOX_OVERRIDE;
+
+typedef struct _XNA_GUARDIAN_MAILBOX_SLOT
+{
+    XNA_SEQ_LOCK Lock;
+
+    XNA_GUARDIAN_MAILBOX_OVERRIDE Override;
+
+    UCHAR Reserved[XNA_GUARDIAN_MAILBOX_ALIGNMENT - sizeof(XNA_SEQ_LOCK) - sizeof(XNA_GUARDIAN_MAILBOX_OVERRIDE)];
+
+} XNA_GUARDIAN_MAILBOX_SLOT, *PXNA_GUARDIAN_MAILBOX_SLOT;
+
+C_ASSERT(sizeof(XNA_GUARDIAN_MAILBOX_SLOT) == XNA_GUARDIAN_MAILBOX_ALIGNMENT);
+
+typedef struct _XNA_GUARDIAN_MAILBOX
+{
+    ULONG Size;
+
+    UCHAR Reserved[XNA_GUARDIAN_MAILBOX_ALIGNMENT - sizeof(ULONG)];
+
+    XNA_GUARDIAN_MAILBOX_SLOT Slots[XINPUT_MAX_DEVICES];
+
+} XNA_GUARDIAN_MAILBOX, *PXNA_GUARDIAN_MAILBOX;
+
+C_ASSERT(FIELD_OFFSET(XNA_GUARDIAN_MAILBOX, Slots) == XNA_GUARDIAN_MAILBOX_ALIGNMENT);
+
+VOID FORCEINLINE XNA_GUARDIAN_MAILBOX_INIT(
+    _Out_ PXNA_GUARDIAN_MAILBOX Mailbox
+)
+{
+    RtlZeroMemory(Mailbox, sizeof(XNA_GUARDIAN_MAILBOX));
+
+    Mailbox->Size = sizeof(XNA_GUARDIAN_MAILBOX);
+}
+
+//
+// Publishes new override data of a pad.
+//
+VOID FORCEINLINE XNA_GUARDIAN_MAILBOX_SLOT_WRITE(
+    _Inout_ PXNA_GUARDIAN_MAILBOX_SLOT Slot,
+    _In_ const XNA_GUARDIAN_MAILBOX_OVERRIDE* Override
+)
+{
+    XNA_SEQ_LOCK_WRITE(&Slot->Lock, &Slot->Override, Override, sizeof(XNA_GUARDIAN_MAILBOX_OVERRIDE));
+}
+
+//
+// Number of attempts of a reader before it falls back to older data
+//
+#define XNA_GUARDIAN_MAILBOX_READ_ATTEMPTS  16
+
+//
+// Takes a consistent snapshot of the override data of a pad without
+// waiting for the writer. Returns FALSE if the writer was busy.
+//
+BOOLEAN FORCEINLINE XNA_GUARDIAN_MAILBOX_SLOT_TRY_READ(
+    _In_ const XNA_GUARDIAN_MAILBOX_SLOT* Slot,
+    _Out_ PXNA_GUARDIAN_MAILBOX_OVERRIDE Override
+)
+{
+    return XNA_SEQ_LOCK_TRY_READ(&Slot->Lock, Override, &Slot->Override,
+        sizeof(XNA_GUARDIAN_MAILBOX_OVERRIDE), XNA_GUARDIAN_MAILBOX_READ_ATTEMPTS);
+}
@@ -0,0 +1,187 @@
+/*
+MIT License
+
+Copyright (c) 2017 Benjamin "Nefarius" Hglinger
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#pragma once
+
+#include "XnaGuardianShared.h"
+
+//
+// Ownership table of override layers.
+//
+// Every layer of every pad is owned by the handle that set it last and may
+// carry a lease, after which it is dropped unless set again. Layers are
+// identified by one bit of a ULONG slot mask, so releasing an owner or
+// expiring leases reports exactly the layers that went away and only the
+// affected pads need to be resolved again. Owners are opaque pointers,
+// no locking is done here.
+//
+
+#define XNA_OWNERSHIP_SLOTS                 (XINPUT_MAX_DEVICES * XINPUT_OVERRIDE_LAYERS_MAX)
+
+#define XNA_OWNERSHIP_SLOT(_index_, _layer_)    ((_index_) * XINPUT_OVERRIDE_LAYERS_MAX + (_layer_))
+
+//
+// Layer bits of a pad in a slot mask
+//
+#define XNA_OWNERSHIP_PAD_LAYERS(_slots_, _index_)  \
+    (((_slots_) >> ((_index_) * XINPUT_OVERRIDE_LAYERS_MAX)) & ((1UL << XINPUT_OVERRIDE_LAYERS_MAX) - 1))
+
+C_ASSERT(XNA_OWNERSHIP_SLOTS <= sizeof(ULONG) * 8);
+
+typedef struct _XNA_OWNERSHIP_ENTRY
+{
+    PVOID Owner;
+
+    //
+    // Zero if the layer has no lease
+    //
+    ULONGLONG ExpirationTime;
+
+} XNA_OWNERSHIP_ENTRY, *PXNA_OWNERSHIP_ENTRY;
+
+typedef struct _XNA_OWNERSHIP_TABLE
+{
+    //
+    // Slot mask of the owned layers
+    //
+    ULONG InUse;
+
+    XNA_OWNERSHIP_ENTRY Entries[XNA_OWNERSHIP_SLOTS];
+
+} XNA_OWNERSHIP_TABLE, *PXNA_OWNERSHIP_TABLE;
+
+VOID FORCEINLINE XNA_OWNERSHIP_TABLE_INIT(
+    _Out_ PXNA_OWNERSHIP_TABLE Table
+)
+{
+    RtlZeroMemory(Table, sizeof(XNA_OWNERSHIP_TABLE));
+}
+
+//
+// Hands a layer to Owner, replacing the previous owner and lease.
+//
+VOID FORCEINLINE XNA_OWNERSHIP_TABLE_CLAIM(
+    _Inout_ PXNA_OWNERSHIP_TABLE Table,
+    _In_ UCHAR UserIndex,
+    _In_ UCHAR LayerId,
+    _In_ PVOID Owner,
+    _In_ ULONGLONG ExpirationTime
+)
+{
+    ULONG slot = XNA_OWNERSHIP_SLOT(UserIndex, LayerId);
+
+    Table->Entries[slot].Owner = Owner;
+    Table->Entries[slot].ExpirationTime = ExpirationTime;
+    Table->InUse |= 1UL << slot;
+}
+
+//
+// Forgets the owner of a layer which was removed.
+//
+VOID FORCEINLINE XNA_OWNERSHIP_TABLE_DROP(
+    _Inout_ PXNA_OWNERSHIP_TABLE Table,
+    _In_ UCHAR UserIndex,
+    _In_ UCHAR LayerId
+)
+{
+    ULONG slot = XNA_OWNERSHIP_SLOT(UserIndex, LayerId);
+
+    Table->Entries[slot].Owner = NULL;
+    Table->Entries[slot].ExpirationTime = 0;
+    Table->InUse &= ~(1UL << slot);
+}
+
+//
+// Drops all layers of Owner and returns their slot mask.
+//
+ULONG FORCEINLINE XNA_OWNERSHIP_TABLE_RELEASE(
+    _Inout_ PXNA_OWNERSHIP_TABLE Table,
+    _In_ PVOID Owner
+)
+{
+    ULONG slots = 0;
+    ULONG slot;
+
+    for (slot = 0; slot < XNA_OWNERSHIP_SLOTS; slot++)
+    {
+        if ((Table->InUse & (1UL << slot)) && Table->Entries[slot].Owner == Owner)
+        {
+            slots |= 1UL << slot;
+
+            XNA_OWNERSHIP_TABLE_DROP(Table, (UCHAR)(slot / XINPUT_OVERRIDE_LAYERS_MAX), (UCHAR)(slot % XINPUT_OVERRIDE_LAYERS_MAX));
+        }
+    }
+
+    return slots;
+}
+
+//
+// Drops all layers whose lease ended at Time and returns their slot mask.
+//
+ULONG FORCEINLINE XNA_OWNERSHIP_TABLE_EXPIRE(
+    _Inout_ PXNA_OWNERSHIP_TABLE Table,
+    _In_ ULONGLONG Time
+)
+{
+    ULONG slots = 0;
+    ULONG slot;
+
+    for (slot = 0; slot < XNA_OWNERSHIP_SLOTS; slot++)
+    {
+        if ((Table->InUse & (1UL << slot))
+            && Table->Entries[slot].ExpirationTime != 0
+            && Table->Entries[slot].ExpirationTime <= Time)
+        {
+            slots |= 1UL << slot;
+
+            XNA_OWNERSHIP_TABLE_DROP(Table, (UCHAR)(slot / XINPUT_OVERRIDE_LAYERS_MAX), (UCHAR)(slot % XINPUT_OVERRIDE_LAYERS_MAX));
+        }
+    }
+
+    return slots;
+}
+
+//
+// Returns the earliest lease expiration time, zero if no layer is leased.
+//
+ULONGLONG FORCEINLINE XNA_OWNERSHIP_TABLE_NEXT_EXPIRATION(
+    _In_ const XNA_OWNERSHIP_TABLE* Table
+)
+{
+    ULONGLONG next = 0;
+    ULONG slot;
+
+    for (slot = 0; slot < XNA_OWNERSHIP_SLOTS; slot++)
+    {
+        if ((Table->InUse & (1UL << slot))
+            && Table->Entries[slot].ExpirationTime != 0
+            && (next == 0 || Table->Entries[slot].ExpirationTime < next))
+        {
+            next = Table->Entries[slot].ExpirationTime;
+        }
+    }
+
+    return next;
+}
@@ -0,0 +1,92 @@
+/*
+MIT License
+
+Copyright (c) 2017 Benjamin "Nefarius" Hglinger
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+
+
+#pragma once
+
+#include "XnaGuardianShared.h"
+#include "XnaGuardianSeqLock.h"
+
+//
+// Versioned peek cache of a pad.
+//
+// The physical state of the pad is kept under a sequence lock whose
+// sequence is the version handed to readers. A waiter passing the version
+// it saw last pends only while that version is current. An update changing
+// the state bumps the version and must complete all pended waiters, an
+// update repeating the state changes nothing and wakes no one. Updates and
+// the wait decision must be serialized by the caller with one lock, then no
+// update can fall between the version check and pending a waiter. Reads
+// don't take that lock.
+//
+
+typedef struct _XNA_PEEK_CACHE_ENTRY
+{
+    XNA_SEQ_LOCK            Sequence;
+
+    XINPUT_GAMEPAD_STATE    State;
+
+} XNA_PEEK_CACHE_ENTRY, *PXNA_PEEK_CACHE_ENTRY;
+
+//
+// Stores the state of a pad. Returns TRUE if it differs from the cached
+// state, the pended waiters must then be completed.
+//
+BOOLEAN FORCEINLINE XNA_PEEK_CACHE_UPDATE(
+    _Inout_ PXNA_PEEK_CACHE_ENTRY Entry,
+    _In_ const XINPUT_GAMEPAD_STATE* State
+)
+{
+    if (RtlEqualMemory(&Entry->State, State, sizeof(XINPUT_GAMEPAD_STATE)))
+        return FALSE;
+
+    XNA_SEQ_LOCK_WRITE(&Entry->Sequence, &Entry->State, State, sizeof(XINPUT_GAMEPAD_STATE));
+
+    return TRUE;
+}
+
+//
+// Copies a consistent snapshot of the cached state and returns its version.
+//
+ULONG FORCEINLINE XNA_PEEK_CACHE_GET(
+    _In_ const XNA_PEEK_CACHE_ENTRY* Entry,
+    _Out_ PXINPUT_GAMEPAD_STATE State
+)
+{
+    return (ULONG)XNA_SEQ_LOCK_READ(&Entry->Sequence, State, &Entry->State, sizeof(XINPUT_GAMEPAD_STATE));
+}
+
+//
+// Returns TRUE if Sequence is the current version, a waiter passing it
+// pends. Otherwise the waiter missed an update and completes right away.
+//
+BOOLEAN FORCEINLINE XNA_PEEK_CACHE_IS_CURRENT(
+    _In_ const XNA_PEEK_CACHE_ENTRY* Entry,
+    _In_ ULONG Sequence
+)
+{
+    return (ULONG)Entry->Sequence.Sequence == Sequence;
+}
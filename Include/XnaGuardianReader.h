@@ -0,0 +1,92 @@
+/*
+MIT License
+
+Copyright (c) 2017 Benjamin "Nefarius" Hglinger
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#pragma once
+
+//
+// Continuous reader parameters of the interrupt-IN pipe.
+//
+// Every pending read can take one report, a poll of the device finding no
+// read pending is NAKed and its report delayed to the next serviced poll.
+// Pads polled every (micro)frame need more reads in flight to ride out
+// completion latency spikes than slower ones. The defaults are derived
+// from the endpoint and can be overridden per device, the result is then
+// clamped so a read never truncates a packet or a supported report.
+//
+
+//
+// Continuous reader defaults, overridable per device by the DWORD values
+// ContinuousReaderPendingReads and ContinuousReaderTransferLength in the
+// hardware key of the device
+//
+#define XNA_READER_PENDING_READS_DEFAULT        2
+#define XNA_READER_PENDING_READS_FAST_POLLING   4
+#define XNA_READER_PENDING_READS_MAX            10
+#define XNA_READER_TRANSFER_LENGTH_DEFAULT      20
+#define XNA_READER_TRANSFER_LENGTH_MAX          0x400
+
+//
+// Longest bInterval of a high-speed endpoint still polled every frame, its
+// period is 2^(bInterval - 1) microframes of 125 us
+//
+#define XNA_READER_HIGH_SPEED_INTERVAL_FAST     4
+
+//
+// Derives the defaults from bInterval and wMaxPacketSize of the endpoint.
+// bInterval counts frames on low and full speed but is an exponent of
+// microframes on high speed, both are fast at a period of 1 ms or less.
+// An interval of zero is out of spec and polled as fast as possible.
+//
+VOID FORCEINLINE XNA_READER_PARAMETERS_FROM_ENDPOINT(
+    _In_ BOOLEAN HighSpeed,
+    _In_ ULONG Interval,
+    _In_ ULONG MaximumPacketSize,
+    _Out_ PULONG PendingReads,
+    _Out_ PULONG TransferLength
+)
+{
+    *PendingReads = (Interval <= (HighSpeed ? XNA_READER_HIGH_SPEED_INTERVAL_FAST : 1))
+        ? XNA_READER_PENDING_READS_FAST_POLLING
+        : XNA_READER_PENDING_READS_DEFAULT;
+    *TransferLength = (MaximumPacketSize > 0)
+        ? MaximumPacketSize
+        : XNA_READER_TRANSFER_LENGTH_DEFAULT;
+}
+
+//
+// Limits possibly overridden parameters to what the framework accepts and
+// the pipe needs, ReportLength being the longest supported report.
+//
+VOID FORCEINLINE XNA_READER_PARAMETERS_CLAMP(
+    _In_ ULONG MaximumPacketSize,
+    _In_ ULONG ReportLength,
+    _Inout_ PULONG PendingReads,
+    _Inout_ PULONG TransferLength
+)
+{
+    *PendingReads = max(1, min(*PendingReads, XNA_READER_PENDING_READS_MAX));
+    *TransferLength = max(max(ReportLength, MaximumPacketSize),
+        min(*TransferLength, XNA_READER_TRANSFER_LENGTH_MAX));
+}
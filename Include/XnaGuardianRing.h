@@ -0,0 +1,200 @@
+/*
+MIT License
+
+Copyright (c) 2017 Benjamin "Nefarius" Hglinger
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#pragma once
+
+//
+// Bounded multi-producer multi-consumer ring of pointers.
+//
+// Every cell carries a sequence telling producers and consumers whose turn
+// it is, so enqueue and dequeue only contend on their own position and
+// never take a lock. Usable from kernel and user mode at any IRQL.
+//
+// Items can be cancelled while held in the ring through a claim state the
+// item keeps itself: a consumer must XNA_RING_ITEM_CLAIM a dequeued item
+// before using it and skip it if the canceller won the race.
+//
+#define XNA_REQUEST_RING_CAPACITY   0x20
+#define XNA_REQUEST_RING_MASK       (XNA_REQUEST_RING_CAPACITY - 1)
+
+C_ASSERT((XNA_REQUEST_RING_CAPACITY & XNA_REQUEST_RING_MASK) == 0);
+
+typedef struct _XNA_REQUEST_RING_CELL
+{
+    volatile LONG   Sequence;
+    PVOID           Item;
+
+} XNA_REQUEST_RING_CELL, *PXNA_REQUEST_RING_CELL;
+
+typedef struct _XNA_REQUEST_RING
+{
+    XNA_REQUEST_RING_CELL   Cells[XNA_REQUEST_RING_CAPACITY];
+
+    volatile LONG           EnqueuePosition;
+
+    volatile LONG           DequeuePosition;
+
+} XNA_REQUEST_RING, *PXNA_REQUEST_RING;
+
+VOID FORCEINLINE XNA_REQUEST_RING_INIT(
+    _Out_ PXNA_REQUEST_RING Ring
+)
+{
+    LONG index;
+
+    for (index = 0; index < XNA_REQUEST_RING_CAPACITY; index++)
+    {
+        Ring->Cells[index].Sequence = index;
+        Ring->Cells[index].Item = NULL;
+    }
+
+    Ring->EnqueuePosition = 0;
+    Ring->DequeuePosition = 0;
+}
+
+//
+// Returns FALSE if the ring is full.
+//
+BOOLEAN FORCEINLINE XNA_REQUEST_RING_ENQUEUE(
+    _Inout_ PXNA_REQUEST_RING Ring,
+    _In_ PVOID Item
+)
+{
+    PXNA_REQUEST_RING_CELL  cell;
+    LONG                    position = Ring->EnqueuePosition;
+    LONG                    observed;
+    LONG                    difference;
+
+    for (;;)
+    {
+        cell = &Ring->Cells[position & XNA_REQUEST_RING_MASK];
+
+        MemoryBarrier();
+
+        difference = (LONG)((ULONG)cell->Sequence - (ULONG)position);
+
+        if (difference == 0)
+        {
+            observed = InterlockedCompareExchange(&Ring->EnqueuePosition, (LONG)((ULONG)position + 1), position);
+            if (observed == position)
+                break;
+
+            position = observed;
+        }
+        else if (difference < 0)
+        {
+            //
+            // The cell still holds an item of the previous lap
+            //
+            return FALSE;
+        }
+        else
+        {
+            position = Ring->EnqueuePosition;
+        }
+    }
+
+    cell->Item = Item;
+
+    //
+    // Full barrier, the item is visible before the cell is handed over
+    //
+    InterlockedExchange(&cell->Sequence, (LONG)((ULONG)position + 1));
+
+    return TRUE;
+}
+
+//
+// Returns FALSE if the ring is empty.
+//
+BOOLEAN FORCEINLINE XNA_REQUEST_RING_DEQUEUE(
+    _Inout_ PXNA_REQUEST_RING Ring,
+    _Out_ PVOID* Item
+)
+{
+    PXNA_REQUEST_RING_CELL  cell;
+    LONG                    position = Ring->DequeuePosition;
+    LONG                    observed;
+    LONG                    difference;
+
+    for (;;)
+    {
+        cell = &Ring->Cells[position & XNA_REQUEST_RING_MASK];
+
+        MemoryBarrier();
+
+        difference = (LONG)((ULONG)cell->Sequence - ((ULONG)position + 1));
+
+        if (difference == 0)
+        {
+            observed = InterlockedCompareExchange(&Ring->DequeuePosition, (LONG)((ULONG)position + 1), position);
+            if (observed == position)
+                break;
+
+            position = observed;
+        }
+        else if (difference < 0)
+        {
+            return FALSE;
+        }
+        else
+        {
+            position = Ring->DequeuePosition;
+        }
+    }
+
+    *Item = cell->Item;
+
+    //
+    // Full barrier, the item is read before the cell is reused
+    //
+    InterlockedExchange(&cell->Sequence, (LONG)((ULONG)position + XNA_REQUEST_RING_CAPACITY));
+
+    return TRUE;
+}
+
+#define XNA_RING_ITEM_PENDING       0
+#define XNA_RING_ITEM_CLAIMED       1
+#define XNA_RING_ITEM_CANCELLED     2
+
+//
+// Returns TRUE if the consumer owns the item, FALSE if it was cancelled.
+//
+BOOLEAN FORCEINLINE XNA_RING_ITEM_CLAIM(
+    _Inout_ volatile LONG* State
+)
+{
+    return InterlockedCompareExchange(State, XNA_RING_ITEM_CLAIMED, XNA_RING_ITEM_PENDING) == XNA_RING_ITEM_PENDING;
+}
+
+//
+// Returns TRUE if the canceller owns the item, FALSE if it was claimed.
+//
+BOOLEAN FORCEINLINE XNA_RING_ITEM_CANCEL(
+    _Inout_ volatile LONG* State
+)
+{
+    return InterlockedCompareExchange(State, XNA_RING_ITEM_CANCELLED, XNA_RING_ITEM_PENDING) == XNA_RING_ITEM_PENDING;
+}
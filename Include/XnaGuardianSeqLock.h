@@ -0,0 +1,175 @@
+/*
+MIT License
+
+Copyright (c) 2017 Benjamin "Nefarius" Hglinger
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#pragma once
+
+//
+// Sequence lock for small, frequently read data.
+//
+// The writer makes the sequence odd while it updates the data and even
+// again afterwards. Readers never block the writer, they copy the data and
+// retry if the sequence was odd or changed meanwhile. Writers must be
+// serialized by the caller and must not be preempted by readers on the
+// same processor, in kernel mode write at DISPATCH_LEVEL if readers run
+// at DISPATCH_LEVEL. Usable from kernel and user mode.
+//
+typedef struct _XNA_SEQ_LOCK
+{
+    volatile LONG Sequence;
+
+} XNA_SEQ_LOCK, *PXNA_SEQ_LOCK;
+
+VOID FORCEINLINE XNA_SEQ_LOCK_INIT(
+    _Out_ PXNA_SEQ_LOCK Lock
+)
+{
+    Lock->Sequence = 0;
+}
+
+VOID FORCEINLINE XNA_SEQ_LOCK_WRITE_BEGIN(
+    _Inout_ PXNA_SEQ_LOCK Lock
+)
+{
+    //
+    // Full barrier, the data stores can't move before the odd sequence
+    //
+    InterlockedIncrement(&Lock->Sequence);
+}
+
+VOID FORCEINLINE XNA_SEQ_LOCK_WRITE_END(
+    _Inout_ PXNA_SEQ_LOCK Lock
+)
+{
+    //
+    // Full barrier, the data stores can't move after the even sequence
+    //
+    InterlockedIncrement(&Lock->Sequence);
+}
+
+//
+// Waits for a pending write to finish and returns the sequence to pass to
+// XNA_SEQ_LOCK_READ_RETRY.
+//
+LONG FORCEINLINE XNA_SEQ_LOCK_READ_BEGIN(
+    _In_ const XNA_SEQ_LOCK* Lock
+)
+{
+    LONG sequence;
+
+    while ((sequence = Lock->Sequence) & 1)
+    {
+        YieldProcessor();
+    }
+
+    MemoryBarrier();
+
+    return sequence;
+}
+
+//
+// Returns TRUE if the data read since XNA_SEQ_LOCK_READ_BEGIN may be torn.
+//
+BOOLEAN FORCEINLINE XNA_SEQ_LOCK_READ_RETRY(
+    _In_ const XNA_SEQ_LOCK* Lock,
+    _In_ LONG Sequence
+)
+{
+    MemoryBarrier();
+
+    return Lock->Sequence != Sequence;
+}
+
+//
+// Replaces the protected data at Target with Length bytes of Source.
+//
+VOID FORCEINLINE XNA_SEQ_LOCK_WRITE(
+    _Inout_ PXNA_SEQ_LOCK Lock,
+    _Out_writes_bytes_(Length) PVOID Target,
+    _In_reads_bytes_(Length) const VOID* Source,
+    _In_ size_t Length
+)
+{
+    XNA_SEQ_LOCK_WRITE_BEGIN(Lock);
+    RtlCopyMemory(Target, Source, Length);
+    XNA_SEQ_LOCK_WRITE_END(Lock);
+}
+
+//
+// Copies a consistent snapshot of Length bytes of the protected data at
+// Source to Target and returns the sequence it was taken at.
+//
+LONG FORCEINLINE XNA_SEQ_LOCK_READ(
+    _In_ const XNA_SEQ_LOCK* Lock,
+    _Out_writes_bytes_(Length) PVOID Target,
+    _In_reads_bytes_(Length) const VOID* Source,
+    _In_ size_t Length
+)
+{
+    LONG sequence;
+
+    do
+    {
+        sequence = XNA_SEQ_LOCK_READ_BEGIN(Lock);
+        RtlCopyMemory(Target, Source, Length);
+    } while (XNA_SEQ_LOCK_READ_RETRY(Lock, sequence));
+
+    return sequence;
+}
+
+//
+// Like XNA_SEQ_LOCK_READ but gives up after Attempts tries instead of
+// waiting for the writer. Required if the writer can't be trusted to make
+// progress, like a user mode writer seen by a kernel mode reader.
+// Returns FALSE if no consistent snapshot could be taken.
+//
+BOOLEAN FORCEINLINE XNA_SEQ_LOCK_TRY_READ(
+    _In_ const XNA_SEQ_LOCK* Lock,
+    _Out_writes_bytes_(Length) PVOID Target,
+    _In_reads_bytes_(Length) const VOID* Source,
+    _In_ size_t Length,
+    _In_ ULONG Attempts
+)
+{
+    LONG sequence;
+
+    while (Attempts--)
+    {
+        sequence = Lock->Sequence;
+
+        if (sequence & 1)
+        {
+            YieldProcessor();
+            continue;
+        }
+
+        MemoryBarrier();
+        RtlCopyMemory(Target, Source, Length);
+
+        if (!XNA_SEQ_LOCK_READ_RETRY(Lock, sequence))
+            return TRUE;
+    }
+
+    return FALSE;
+}
@@ -31,6 +31,14 @@ SOFTWARE.
 
 #define VALID_USER_INDEX(_index_)   ((_index_ >= 0) && (_index_ < XINPUT_MAX_DEVICES))
 
+//
+// Rescaling between 8-bit XInput and 10-bit high resolution trigger values,
+// rounded so that 0 and 255 map to 0 and 1023 and back without loss.
+// 
+#define XINPUT_HIGH_RES_TRIGGER_MAX             1023
+#define XINPUT_TRIGGER_TO_HIGH_RES(_value_)     (USHORT)(((_value_) * 1023 + 127) / 255)
+#define XINPUT_TRIGGER_FROM_HIGH_RES(_value_)   (BYTE)(((_value_) * 255 + 511) / 1023)
+
 //
 // Custom extensions
 // 
@@ -39,6 +47,13 @@ SOFTWARE.
 
 #define IOCTL_XINPUT_EXT_OVERRIDE_GAMEPAD_STATE CTL_CODE(XINPUT_EXT_TYPE, XINPUT_EXT_CODE + 0x01, METHOD_BUFFERED, FILE_WRITE_DATA)
 #define IOCTL_XINPUT_EXT_PEEK_GAMEPAD_STATE     CTL_CODE(XINPUT_EXT_TYPE, XINPUT_EXT_CODE + 0x02, METHOD_BUFFERED, FILE_READ_DATA | FILE_WRITE_DATA)
+#define IOCTL_XINPUT_EXT_OVERRIDE_GAMEPAD_LAYER CTL_CODE(XINPUT_EXT_TYPE, XINPUT_EXT_CODE + 0x03, METHOD_BUFFERED, FILE_WRITE_DATA)
+#define IOCTL_XINPUT_EXT_WAIT_GAMEPAD_STATE     CTL_CODE(XINPUT_EXT_TYPE, XINPUT_EXT_CODE + 0x04, METHOD_BUFFERED, FILE_READ_DATA | FILE_WRITE_DATA)
+#define IOCTL_XINPUT_EXT_OVERRIDE_GAMEPAD_STATE_BATCH   CTL_CODE(XINPUT_EXT_TYPE, XINPUT_EXT_CODE + 0x05, METHOD_BUFFERED, FILE_WRITE_DATA)
+#define IOCTL_XINPUT_EXT_MAILBOX_ATTACH         CTL_CODE(XINPUT_EXT_TYPE, XINPUT_EXT_CODE + 0x06, METHOD_OUT_DIRECT, FILE_READ_DATA | FILE_WRITE_DATA)
+#define IOCTL_XINPUT_EXT_MAILBOX_DETACH         CTL_CODE(XINPUT_EXT_TYPE, XINPUT_EXT_CODE + 0x07, METHOD_BUFFERED, FILE_WRITE_DATA)
+#define IOCTL_XINPUT_EXT_SCHEDULE_GAMEPAD_STATE CTL_CODE(XINPUT_EXT_TYPE, XINPUT_EXT_CODE + 0x08, METHOD_BUFFERED, FILE_WRITE_DATA)
+#define IOCTL_XINPUT_EXT_OVERRIDE_GAMEPAD_DELTA CTL_CODE(XINPUT_EXT_TYPE, XINPUT_EXT_CODE + 0x09, METHOD_BUFFERED, FILE_WRITE_DATA)
 
 
 //
@@ -67,8 +82,23 @@ typedef struct _XINPUT_EXT_OVERRIDE_GAMEPAD
 
     IN XINPUT_GAMEPAD_STATE Gamepad;
 
+    //
+    // 10-bit trigger values, used instead of Gamepad.bLeftTrigger and
+    // Gamepad.bRightTrigger if XINPUT_GAMEPAD_OVERRIDE_HIGH_RES_TRIGGERS
+    // is set in Overrides
+    // 
+    IN USHORT LeftTrigger;
+
+    IN USHORT RightTrigger;
+
 } XINPUT_EXT_OVERRIDE_GAMEPAD, *PXINPUT_EXT_OVERRIDE_GAMEPAD;
 
+//
+// Size of XINPUT_EXT_OVERRIDE_GAMEPAD before the high resolution triggers
+// were added, still accepted by the driver
+// 
+#define XINPUT_EXT_OVERRIDE_GAMEPAD_V1_SIZE     FIELD_OFFSET(XINPUT_EXT_OVERRIDE_GAMEPAD, LeftTrigger)
+
 VOID FORCEINLINE XINPUT_EXT_OVERRIDE_GAMEPAD_INIT(
     _Out_ PXINPUT_EXT_OVERRIDE_GAMEPAD OverrideGamepad,
     _In_ UCHAR UserIndex
@@ -80,6 +110,134 @@ VOID FORCEINLINE XINPUT_EXT_OVERRIDE_GAMEPAD_INIT(
     OverrideGamepad->UserIndex = UserIndex;
 }
 
+//
+// Override state of one pad in IOCTL_XINPUT_EXT_OVERRIDE_GAMEPAD_STATE_BATCH
+// 
+typedef struct _XINPUT_EXT_OVERRIDE_GAMEPAD_BATCH_ENTRY
+{
+    IN UCHAR UserIndex;
+
+    IN ULONG Overrides;
+
+    IN XINPUT_GAMEPAD_STATE Gamepad;
+
+    IN USHORT LeftTrigger;
+
+    IN USHORT RightTrigger;
+
+} XINPUT_EXT_OVERRIDE_GAMEPAD_BATCH_ENTRY, *PXINPUT_EXT_OVERRIDE_GAMEPAD_BATCH_ENTRY;
+
+//
+// Context data for IOCTL_XINPUT_EXT_OVERRIDE_GAMEPAD_STATE_BATCH I/O control
+// code, only the first Count entries are transferred
+// 
+typedef struct _XINPUT_EXT_OVERRIDE_GAMEPAD_BATCH
+{
+    IN ULONG Size;
+
+    IN ULONG Count;
+
+    IN XINPUT_EXT_OVERRIDE_GAMEPAD_BATCH_ENTRY Entries[XINPUT_MAX_DEVICES];
+
+} XINPUT_EXT_OVERRIDE_GAMEPAD_BATCH, *PXINPUT_EXT_OVERRIDE_GAMEPAD_BATCH;
+
+#define XINPUT_EXT_OVERRIDE_GAMEPAD_BATCH_SIZE(_count_) \
+    (ULONG)(FIELD_OFFSET(XINPUT_EXT_OVERRIDE_GAMEPAD_BATCH, Entries) + (_count_) * sizeof(XINPUT_EXT_OVERRIDE_GAMEPAD_BATCH_ENTRY))
+
+VOID FORCEINLINE XINPUT_EXT_OVERRIDE_GAMEPAD_BATCH_INIT(
+    _Out_ PXINPUT_EXT_OVERRIDE_GAMEPAD_BATCH OverrideBatch
+)
+{
+    RtlZeroMemory(OverrideBatch, sizeof(XINPUT_EXT_OVERRIDE_GAMEPAD_BATCH));
+
+    OverrideBatch->Size = XINPUT_EXT_OVERRIDE_GAMEPAD_BATCH_SIZE(0);
+}
+
+//
+// Adds the override state of a pad to a batch or replaces the entry already
+// present for that pad. Returns FALSE if the user index is out of range.
+// 
+BOOLEAN FORCEINLINE XINPUT_EXT_OVERRIDE_GAMEPAD_BATCH_ADD(
+    _Inout_ PXINPUT_EXT_OVERRIDE_GAMEPAD_BATCH OverrideBatch,
+    _In_ const XINPUT_EXT_OVERRIDE_GAMEPAD* Override
+)
+{
+    ULONG index;
+
+    if (!VALID_USER_INDEX(Override->UserIndex))
+        return FALSE;
+
+    for (index = 0; index < OverrideBatch->Count; index++)
+    {
+        if (OverrideBatch->Entries[index].UserIndex == Override->UserIndex)
+            break;
+    }
+
+    if (index == OverrideBatch->Count)
+    {
+        OverrideBatch->Count++;
+        OverrideBatch->Size = XINPUT_EXT_OVERRIDE_GAMEPAD_BATCH_SIZE(OverrideBatch->Count);
+    }
+
+    OverrideBatch->Entries[index].UserIndex = Override->UserIndex;
+    OverrideBatch->Entries[index].Overrides = Override->Overrides;
+    OverrideBatch->Entries[index].Gamepad = Override->Gamepad;
+    OverrideBatch->Entries[index].LeftTrigger = Override->LeftTrigger;
+    OverrideBatch->Entries[index].RightTrigger = Override->RightTrigger;
+
+    return TRUE;
+}
+
+//
+// Validates a batch received in a buffer of BufferLength bytes: the size
+// must match the count and every pad may appear once.
+// 
+BOOLEAN FORCEINLINE XINPUT_EXT_OVERRIDE_GAMEPAD_BATCH_VALIDATE(
+    _In_ const XINPUT_EXT_OVERRIDE_GAMEPAD_BATCH* OverrideBatch,
+    _In_ size_t BufferLength
+)
+{
+    ULONG index;
+    ULONG pads = 0;
+
+    if (BufferLength < XINPUT_EXT_OVERRIDE_GAMEPAD_BATCH_SIZE(0)
+        || OverrideBatch->Count > XINPUT_MAX_DEVICES
+        || OverrideBatch->Size != XINPUT_EXT_OVERRIDE_GAMEPAD_BATCH_SIZE(OverrideBatch->Count)
+        || BufferLength < OverrideBatch->Size)
+    {
+        return FALSE;
+    }
+
+    for (index = 0; index < OverrideBatch->Count; index++)
+    {
+        if (!VALID_USER_INDEX(OverrideBatch->Entries[index].UserIndex)
+            || (pads & (1 << OverrideBatch->Entries[index].UserIndex)))
+        {
+            return FALSE;
+        }
+
+        pads |= 1 << OverrideBatch->Entries[index].UserIndex;
+    }
+
+    return TRUE;
+}
+
+//
+// Expands a batch entry into the single pad request structure.
+// 
+VOID FORCEINLINE XINPUT_EXT_OVERRIDE_GAMEPAD_FROM_BATCH_ENTRY(
+    _Out_ PXINPUT_EXT_OVERRIDE_GAMEPAD Override,
+    _In_ const XINPUT_EXT_OVERRIDE_GAMEPAD_BATCH_ENTRY* Entry
+)
+{
+    XINPUT_EXT_OVERRIDE_GAMEPAD_INIT(Override, Entry->UserIndex);
+
+    Override->Overrides = Entry->Overrides;
+    Override->Gamepad = Entry->Gamepad;
+    Override->LeftTrigger = Entry->LeftTrigger;
+    Override->RightTrigger = Entry->RightTrigger;
+}
+
 //
 // Context data for IOCTL_XINPUT_EXT_PEEK_GAMEPAD_STATE I/O control code
 // 
@@ -102,4 +260,184 @@ VOID FORCEINLINE XINPUT_EXT_PEEK_GAMEPAD_INIT(
     PeekGamepad->UserIndex = UserIndex;
 }
 
+//
+// Output of IOCTL_XINPUT_EXT_WAIT_GAMEPAD_STATE, also returned by
+// IOCTL_XINPUT_EXT_PEEK_GAMEPAD_STATE if the output buffer is large enough.
+// The state leads so callers of the plain peek passing a larger buffer
+// still find it at offset zero.
+// 
+typedef struct _XINPUT_EXT_VERSIONED_GAMEPAD_STATE
+{
+    OUT XINPUT_GAMEPAD_STATE Gamepad;
+
+    //
+    // Incremented whenever the physical state of the pad changes
+    // 
+    OUT ULONG Sequence;
+
+} XINPUT_EXT_VERSIONED_GAMEPAD_STATE, *PXINPUT_EXT_VERSIONED_GAMEPAD_STATE;
+
+C_ASSERT(FIELD_OFFSET(XINPUT_EXT_VERSIONED_GAMEPAD_STATE, Gamepad) == 0);
+
+//
+// Context data for IOCTL_XINPUT_EXT_WAIT_GAMEPAD_STATE I/O control code
+// 
+typedef struct _XINPUT_EXT_WAIT_GAMEPAD
+{
+    IN ULONG Size;
+
+    IN UCHAR UserIndex;
+
+    //
+    // The request completes as soon as the sequence of the pad differs
+    // 
+    IN ULONG Sequence;
+
+} XINPUT_EXT_WAIT_GAMEPAD, *PXINPUT_EXT_WAIT_GAMEPAD;
+
+VOID FORCEINLINE XINPUT_EXT_WAIT_GAMEPAD_INIT(
+    _Out_ PXINPUT_EXT_WAIT_GAMEPAD WaitGamepad,
+    _In_ UCHAR UserIndex,
+    _In_ ULONG Sequence
+)
+{
+    RtlZeroMemory(WaitGamepad, sizeof(XINPUT_EXT_WAIT_GAMEPAD));
+
+    WaitGamepad->Size = sizeof(XINPUT_EXT_WAIT_GAMEPAD);
+    WaitGamepad->UserIndex = UserIndex;
+    WaitGamepad->Sequence = Sequence;
+}
+
+//
+// Number of override layers per pad. Layer 0 stacks the overrides all
+// handles set through IOCTL_XINPUT_EXT_OVERRIDE_GAMEPAD_STATE and can't be
+// set as a layer.
+// 
+#define XINPUT_OVERRIDE_LAYERS_MAX              0x08
+
+#define XINPUT_OVERRIDE_LEGACY_LAYER_ID         0x00
+
+#define VALID_LAYER_ID(_id_)                    ((_id_ > XINPUT_OVERRIDE_LEGACY_LAYER_ID) && (_id_ < XINPUT_OVERRIDE_LAYERS_MAX))
+
+//
+// How a layer combines with the layers of lower priority overriding the
+// same control. Controls no lower layer overrides start out neutral.
+// 
+typedef enum _XINPUT_OVERRIDE_BLEND_MODE
+{
+    //
+    // Value of this layer wins
+    // 
+    XINPUT_OVERRIDE_BLEND_REPLACE = 0,
+
+    //
+    // Sum, saturated to the range of the control
+    // 
+    XINPUT_OVERRIDE_BLEND_ADD,
+
+    //
+    // Larger value, thumb axes compare the deflection from center
+    // 
+    XINPUT_OVERRIDE_BLEND_MAX,
+
+    //
+    // Buttons pressed in any layer, behaves like MAX on axes
+    // 
+    XINPUT_OVERRIDE_BLEND_OR,
+
+    XINPUT_OVERRIDE_BLEND_MODE_MAX
+
+} XINPUT_OVERRIDE_BLEND_MODE, *PXINPUT_OVERRIDE_BLEND_MODE;
+
+//
+// Context data for IOCTL_XINPUT_EXT_OVERRIDE_GAMEPAD_LAYER I/O control code
+// 
+typedef struct _XINPUT_EXT_OVERRIDE_GAMEPAD_LAYER
+{
+    IN ULONG Size;
+
+    IN UCHAR LayerId;
+
+    //
+    // Layers are applied in ascending order of priority, then layer id
+    // 
+    IN LONG Priority;
+
+    IN XINPUT_OVERRIDE_BLEND_MODE BlendMode;
+
+    //
+    // Overrides of this layer, an empty override mask removes the layer
+    // 
+    IN XINPUT_EXT_OVERRIDE_GAMEPAD Override;
+
+    //
+    // The layer is removed this long after it was set (in 100-nanosecond
+    // units) unless set again, zero keeps it until the handle is closed
+    // 
+    IN ULONGLONG LeaseDuration;
+
+} XINPUT_EXT_OVERRIDE_GAMEPAD_LAYER, *PXINPUT_EXT_OVERRIDE_GAMEPAD_LAYER;
+
+//
+// Size of XINPUT_EXT_OVERRIDE_GAMEPAD_LAYER before leases were added, still
+// accepted by the driver
+// 
+#define XINPUT_EXT_OVERRIDE_GAMEPAD_LAYER_V1_SIZE   FIELD_OFFSET(XINPUT_EXT_OVERRIDE_GAMEPAD_LAYER, LeaseDuration)
+
+VOID FORCEINLINE XINPUT_EXT_OVERRIDE_GAMEPAD_LAYER_INIT(
+    _Out_ PXINPUT_EXT_OVERRIDE_GAMEPAD_LAYER OverrideLayer,
+    _In_ UCHAR UserIndex,
+    _In_ UCHAR LayerId
+)
+{
+    RtlZeroMemory(OverrideLayer, sizeof(XINPUT_EXT_OVERRIDE_GAMEPAD_LAYER));
+
+    OverrideLayer->Size = sizeof(XINPUT_EXT_OVERRIDE_GAMEPAD_LAYER);
+    OverrideLayer->LayerId = LayerId;
+    OverrideLayer->BlendMode = XINPUT_OVERRIDE_BLEND_REPLACE;
+
+    XINPUT_EXT_OVERRIDE_GAMEPAD_INIT(&OverrideLayer->Override, UserIndex);
+}
+
+//
+// Context data for IOCTL_XINPUT_EXT_SCHEDULE_GAMEPAD_STATE I/O control code
+// 
+// Times are in 100-nanosecond units of the unbiased interrupt time, as
+// returned by QueryUnbiasedInterruptTime and KeQueryUnbiasedInterruptTime.
+// 
+typedef struct _XINPUT_EXT_SCHEDULE_GAMEPAD
+{
+    IN ULONG Size;
+
+    //
+    // The override applies to reports completed at or after this time,
+    // zero applies it right away
+    // 
+    IN ULONGLONG ActivationTime;
+
+    //
+    // The override stops applying this long after ActivationTime
+    // 
+    IN ULONGLONG Duration;
+
+    IN XINPUT_EXT_OVERRIDE_GAMEPAD Override;
+
+} XINPUT_EXT_SCHEDULE_GAMEPAD, *PXINPUT_EXT_SCHEDULE_GAMEPAD;
+
+VOID FORCEINLINE XINPUT_EXT_SCHEDULE_GAMEPAD_INIT(
+    _Out_ PXINPUT_EXT_SCHEDULE_GAMEPAD ScheduleGamepad,
+    _In_ UCHAR UserIndex,
+    _In_ ULONGLONG ActivationTime,
+    _In_ ULONGLONG Duration
+)
+{
+    RtlZeroMemory(ScheduleGamepad, sizeof(XINPUT_EXT_SCHEDULE_GAMEPAD));
+
+    ScheduleGamepad->Size = sizeof(XINPUT_EXT_SCHEDULE_GAMEPAD);
+    ScheduleGamepad->ActivationTime = ActivationTime;
+    ScheduleGamepad->Duration = Duration;
+
+    XINPUT_EXT_OVERRIDE_GAMEPAD_INIT(&ScheduleGamepad->Override, UserIndex);
+}
+
 
@@ -0,0 +1,98 @@
+/*
+MIT License
+
+Copyright (c) 2017 Benjamin "Nefarius" Hglinger
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#pragma once
+
+#include "XnaGuardianShared.h"
+
+//
+// Pad slots of the HID USB devices.
+//
+// A device takes the lowest free slot on arrival and keeps it until it is
+// removed, the slot is the XInput user index of the pad. Both directions
+// are constant time, the device keeps its slot in its context and the
+// table maps a slot back to the device. Devices are opaque pointers, no
+// locking is done here.
+//
+
+typedef struct _XNA_SLOT_TABLE
+{
+    PVOID Devices[XINPUT_MAX_DEVICES];
+
+} XNA_SLOT_TABLE, *PXNA_SLOT_TABLE;
+
+VOID FORCEINLINE XNA_SLOT_TABLE_INIT(
+    _Out_ PXNA_SLOT_TABLE Table
+)
+{
+    RtlZeroMemory(Table, sizeof(XNA_SLOT_TABLE));
+}
+
+//
+// Assigns the lowest free slot to Device. Returns XINPUT_MAX_DEVICES if
+// all slots are taken.
+//
+ULONG FORCEINLINE XNA_SLOT_TABLE_ACQUIRE(
+    _Inout_ PXNA_SLOT_TABLE Table,
+    _In_ PVOID Device
+)
+{
+    ULONG slot;
+
+    for (slot = 0; slot < XINPUT_MAX_DEVICES; slot++)
+    {
+        if (Table->Devices[slot] == NULL)
+        {
+            Table->Devices[slot] = Device;
+            break;
+        }
+    }
+
+    return slot;
+}
+
+//
+// Frees a slot returned by XNA_SLOT_TABLE_ACQUIRE, including
+// XINPUT_MAX_DEVICES.
+//
+VOID FORCEINLINE XNA_SLOT_TABLE_RELEASE(
+    _Inout_ PXNA_SLOT_TABLE Table,
+    _In_ ULONG Slot
+)
+{
+    if (Slot < XINPUT_MAX_DEVICES)
+        Table->Devices[Slot] = NULL;
+}
+
+//
+// Returns the device of a slot or NULL if the slot is free.
+//
+PVOID FORCEINLINE XNA_SLOT_TABLE_LOOKUP(
+    _In_ const XNA_SLOT_TABLE* Table,
+    _In_ ULONG Slot
+)
+{
+    return (Slot < XINPUT_MAX_DEVICES) ? Table->Devices[Slot] : NULL;
+}
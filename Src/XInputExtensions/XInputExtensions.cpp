@@ -27,16 +27,23 @@ SOFTWARE.
 #include "XInputExtensions.h"
 #include <winioctl.h>
 #include "XnaGuardianShared.h"
+#include "XnaGuardianMailbox.h"
+#include "XInputOverrideDelta.h"
 
 HANDLE                          g_hGuardian = INVALID_HANDLE_VALUE;
+HANDLE                          g_hGuardianWait = INVALID_HANDLE_VALUE;
+INIT_ONCE                       g_GuardianInitOnce = INIT_ONCE_STATIC_INIT;
+INIT_ONCE                       g_GuardianWaitInitOnce = INIT_ONCE_STATIC_INIT;
+SRWLOCK                         g_PadOverridesLock = SRWLOCK_INIT;
 XINPUT_EXT_OVERRIDE_GAMEPAD     PadOverrides[XINPUT_MAX_DEVICES];
+SRWLOCK                         g_MailboxLock = SRWLOCK_INIT;
+PXNA_GUARDIAN_MAILBOX           g_pMailbox = nullptr;
+OVERLAPPED                      g_MailboxOverlapped = {};
 
-DWORD OpenGuardian()
+BOOL CALLBACK OpenGuardianOnce(PINIT_ONCE InitOnce, PVOID Parameter, PVOID* Context)
 {
-    if (g_hGuardian != INVALID_HANDLE_VALUE)
-    {
-        return ERROR_SUCCESS;
-    }
+    UNREFERENCED_PARAMETER(InitOnce);
+    UNREFERENCED_PARAMETER(Context);
 
     g_hGuardian = CreateFile(XNA_GUARDIAN_DEVICE_PATH,
         GENERIC_READ | GENERIC_WRITE,
@@ -46,81 +53,189 @@ DWORD OpenGuardian()
         0, // No special attributes
         nullptr); // No template file
 
-    if (g_hGuardian != INVALID_HANDLE_VALUE)
+    if (g_hGuardian == INVALID_HANDLE_VALUE)
     {
-        for (auto i = 0; i < XINPUT_MAX_DEVICES; i++)
-        {
-            XINPUT_EXT_OVERRIDE_GAMEPAD_INIT(&PadOverrides[i], i);
-        }
+        *static_cast<PDWORD>(Parameter) = GetLastError();
+        return FALSE;
+    }
+
+    for (auto i = 0; i < XINPUT_MAX_DEVICES; i++)
+    {
+        XINPUT_EXT_OVERRIDE_GAMEPAD_INIT(&PadOverrides[i], i);
+    }
+
+    return TRUE;
+}
 
+//
+// Opens g_hGuardian on first use, a failed attempt is retried by the next
+// call. The handle stays open for the lifetime of the process since the
+// driver drops all overrides owned by it once it gets closed.
+// 
+DWORD OpenGuardian()
+{
+    DWORD   error = ERROR_NOT_READY;
+
+    if (InitOnceExecuteOnce(&g_GuardianInitOnce, OpenGuardianOnce, &error, nullptr))
+    {
         return ERROR_SUCCESS;
     }
 
-    return GetLastError();
+    return error;
 }
 
-XINPUTEXTENSIONS_API DWORD XInputOverrideSetMask(DWORD dwUserIndex, DWORD dwMask)
+BOOL CALLBACK OpenGuardianWaitOnce(PINIT_ONCE InitOnce, PVOID Parameter, PVOID* Context)
 {
-    PXINPUT_EXT_OVERRIDE_GAMEPAD    pPad = nullptr;
-    DWORD                           retval = 0;
+    UNREFERENCED_PARAMETER(InitOnce);
+    UNREFERENCED_PARAMETER(Context);
 
-    if (!VALID_USER_INDEX(dwUserIndex)) return ERROR_BAD_ARGUMENTS;
+    g_hGuardianWait = CreateFile(XNA_GUARDIAN_DEVICE_PATH,
+        GENERIC_READ | GENERIC_WRITE,
+        0, // FILE_SHARE_READ | FILE_SHARE_WRITE
+        nullptr, // no SECURITY_ATTRIBUTES structure
+        OPEN_EXISTING, // No special create flags
+        FILE_FLAG_OVERLAPPED,
+        nullptr); // No template file
+
+    if (g_hGuardianWait == INVALID_HANDLE_VALUE)
+    {
+        *static_cast<PDWORD>(Parameter) = GetLastError();
+        return FALSE;
+    }
 
-    if (!SUCCEEDED(HRESULT_FROM_WIN32(OpenGuardian()))) return GetLastError();
+    return TRUE;
+}
 
-    pPad = &PadOverrides[dwUserIndex];
+//
+// Separate handle for overlapped I/O, so pended wait requests don't block
+// the synchronous calls issued on g_hGuardian
+// 
+DWORD OpenGuardianWait()
+{
+    DWORD   error = ERROR_NOT_READY;
 
-    pPad->Overrides = dwMask;
+    if (InitOnceExecuteOnce(&g_GuardianWaitInitOnce, OpenGuardianWaitOnce, &error, nullptr))
+    {
+        return ERROR_SUCCESS;
+    }
+
+    return error;
+}
+
+//
+// Sends the override of a pad as delta against the last one sent on
+// g_hGuardian, which is updated on success. The caller must hold
+// g_PadOverridesLock, so the driver sees the deltas in encoding order.
+// 
+DWORD SendPadOverride(const XINPUT_EXT_OVERRIDE_GAMEPAD* pPad)
+{
+    UCHAR   delta[XINPUT_EXT_OVERRIDE_GAMEPAD_DELTA_MAX_SIZE];
+    DWORD   retval = 0;
+
+    auto length = XINPUT_EXT_OVERRIDE_GAMEPAD_DELTA_ENCODE(delta, sizeof(delta), &PadOverrides[pPad->UserIndex], pPad);
 
     auto ret = DeviceIoControl(
         g_hGuardian,
-        IOCTL_XINPUT_EXT_OVERRIDE_GAMEPAD_STATE,
-        static_cast<LPVOID>(pPad),
-        pPad->Size,
+        IOCTL_XINPUT_EXT_OVERRIDE_GAMEPAD_DELTA,
+        static_cast<LPVOID>(delta),
+        length,
         nullptr,
         0,
         &retval,
         nullptr);
 
-    if (ret > 0) return ERROR_SUCCESS;
-
-    CloseHandle(g_hGuardian);
-    g_hGuardian = nullptr;
+    if (ret > 0)
+    {
+        PadOverrides[pPad->UserIndex] = *pPad;
+        return ERROR_SUCCESS;
+    }
 
     return GetLastError();
 }
 
+XINPUTEXTENSIONS_API DWORD XInputOverrideSetMask(DWORD dwUserIndex, DWORD dwMask)
+{
+    XINPUT_EXT_OVERRIDE_GAMEPAD     pad;
+
+    if (!VALID_USER_INDEX(dwUserIndex)) return ERROR_BAD_ARGUMENTS;
+
+    auto error = OpenGuardian();
+    if (error != ERROR_SUCCESS) return error;
+
+    AcquireSRWLockExclusive(&g_PadOverridesLock);
+
+    //
+    // Work on a copy, the cached pad state is only updated on success
+    // 
+    pad = PadOverrides[dwUserIndex];
+
+    pad.Overrides = dwMask;
+
+    error = SendPadOverride(&pad);
+
+    ReleaseSRWLockExclusive(&g_PadOverridesLock);
+
+    return error;
+}
+
 XINPUTEXTENSIONS_API DWORD XInputOverrideSetState(DWORD dwUserIndex, PXINPUT_GAMEPAD pGamepad)
 {
-    PXINPUT_EXT_OVERRIDE_GAMEPAD    pPad = nullptr;
-    DWORD                           retval = 0;
+    XINPUT_EXT_OVERRIDE_GAMEPAD     pad;
 
     if (!pGamepad) return ERROR_BAD_ARGUMENTS;
 
     if (!VALID_USER_INDEX(dwUserIndex)) return ERROR_BAD_ARGUMENTS;
 
-    if (!SUCCEEDED(HRESULT_FROM_WIN32(OpenGuardian()))) return GetLastError();
+    auto error = OpenGuardian();
+    if (error != ERROR_SUCCESS) return error;
 
-    pPad = &PadOverrides[dwUserIndex];
+    AcquireSRWLockExclusive(&g_PadOverridesLock);
 
-    pPad->Gamepad = *reinterpret_cast<PXINPUT_GAMEPAD_STATE>(pGamepad);
+    //
+    // Work on a copy, the cached pad state is only updated on success
+    // 
+    pad = PadOverrides[dwUserIndex];
 
-    auto ret = DeviceIoControl(
-        g_hGuardian,
-        IOCTL_XINPUT_EXT_OVERRIDE_GAMEPAD_STATE,
-        static_cast<LPVOID>(pPad),
-        pPad->Size,
-        nullptr,
-        0,
-        &retval,
-        nullptr);
+    pad.Gamepad = *reinterpret_cast<PXINPUT_GAMEPAD_STATE>(pGamepad);
+    pad.LeftTrigger = XINPUT_TRIGGER_TO_HIGH_RES(pad.Gamepad.bLeftTrigger);
+    pad.RightTrigger = XINPUT_TRIGGER_TO_HIGH_RES(pad.Gamepad.bRightTrigger);
 
-    if (ret > 0) return ERROR_SUCCESS;
+    error = SendPadOverride(&pad);
 
-    CloseHandle(g_hGuardian);
-    g_hGuardian = nullptr;
+    ReleaseSRWLockExclusive(&g_PadOverridesLock);
 
-    return GetLastError();
+    return error;
+}
+
+XINPUTEXTENSIONS_API DWORD XInputOverrideApply(DWORD dwUserIndex, DWORD dwMask, PXINPUT_GAMEPAD pGamepad)
+{
+    XINPUT_EXT_OVERRIDE_GAMEPAD     pad;
+
+    if (!pGamepad) return ERROR_BAD_ARGUMENTS;
+
+    if (!VALID_USER_INDEX(dwUserIndex)) return ERROR_BAD_ARGUMENTS;
+
+    auto error = OpenGuardian();
+    if (error != ERROR_SUCCESS) return error;
+
+    AcquireSRWLockExclusive(&g_PadOverridesLock);
+
+    //
+    // Mask and state travel in the same delta, the driver never pairs the
+    // new mask with the old state
+    // 
+    pad = PadOverrides[dwUserIndex];
+
+    pad.Overrides = dwMask;
+    pad.Gamepad = *reinterpret_cast<PXINPUT_GAMEPAD_STATE>(pGamepad);
+    pad.LeftTrigger = XINPUT_TRIGGER_TO_HIGH_RES(pad.Gamepad.bLeftTrigger);
+    pad.RightTrigger = XINPUT_TRIGGER_TO_HIGH_RES(pad.Gamepad.bRightTrigger);
+
+    error = SendPadOverride(&pad);
+
+    ReleaseSRWLockExclusive(&g_PadOverridesLock);
+
+    return error;
 }
 
 XINPUTEXTENSIONS_API DWORD XInputOverridePeekState(DWORD dwUserIndex, PXINPUT_GAMEPAD pGamepad)
@@ -132,7 +247,8 @@ XINPUTEXTENSIONS_API DWORD XInputOverridePeekState(DWORD dwUserIndex, PXINPUT_GA
 
     if (!VALID_USER_INDEX(dwUserIndex)) return ERROR_BAD_ARGUMENTS;
 
-    if (!SUCCEEDED(HRESULT_FROM_WIN32(OpenGuardian()))) return GetLastError();
+    auto error = OpenGuardian();
+    if (error != ERROR_SUCCESS) return error;
 
     XINPUT_EXT_PEEK_GAMEPAD_INIT(&peek, dwUserIndex);
 
@@ -148,10 +264,460 @@ XINPUTEXTENSIONS_API DWORD XInputOverridePeekState(DWORD dwUserIndex, PXINPUT_GA
 
     if (ret > 0) return ERROR_SUCCESS;
 
-    CloseHandle(g_hGuardian);
-    g_hGuardian = nullptr;
+    return GetLastError();
+}
+
+XINPUTEXTENSIONS_API DWORD XInputOverrideSetTriggers(DWORD dwUserIndex, WORD wLeftTrigger, WORD wRightTrigger)
+{
+    XINPUT_EXT_OVERRIDE_GAMEPAD     pad;
+
+    if (!VALID_USER_INDEX(dwUserIndex)) return ERROR_BAD_ARGUMENTS;
+
+    if (wLeftTrigger > XINPUT_HIGH_RES_TRIGGER_MAX || wRightTrigger > XINPUT_HIGH_RES_TRIGGER_MAX)
+        return ERROR_BAD_ARGUMENTS;
+
+    auto error = OpenGuardian();
+    if (error != ERROR_SUCCESS) return error;
+
+    AcquireSRWLockExclusive(&g_PadOverridesLock);
+
+    //
+    // Work on a copy, the cached pad state is only updated on success
+    // 
+    pad = PadOverrides[dwUserIndex];
+
+    //
+    // Only used by the driver if XINPUT_GAMEPAD_OVERRIDE_HIGH_RES_TRIGGERS
+    // is part of the override mask
+    // 
+    pad.LeftTrigger = wLeftTrigger;
+    pad.RightTrigger = wRightTrigger;
+    pad.Gamepad.bLeftTrigger = XINPUT_TRIGGER_FROM_HIGH_RES(wLeftTrigger);
+    pad.Gamepad.bRightTrigger = XINPUT_TRIGGER_FROM_HIGH_RES(wRightTrigger);
+
+    error = SendPadOverride(&pad);
+
+    ReleaseSRWLockExclusive(&g_PadOverridesLock);
+
+    return error;
+}
+
+XINPUTEXTENSIONS_API DWORD XInputOverrideSetStateBatch(DWORD dwCount, const XINPUT_OVERRIDE_STATE* pStates)
+{
+    XINPUT_EXT_OVERRIDE_GAMEPAD_BATCH   batch;
+    XINPUT_EXT_OVERRIDE_GAMEPAD         pads[XINPUT_MAX_DEVICES];
+    DWORD                               retval = 0;
+
+    if (!pStates || dwCount > XINPUT_MAX_DEVICES) return ERROR_BAD_ARGUMENTS;
+
+    for (DWORD i = 0; i < dwCount; i++)
+    {
+        if (!VALID_USER_INDEX(pStates[i].dwUserIndex)) return ERROR_BAD_ARGUMENTS;
+    }
+
+    auto error = OpenGuardian();
+    if (error != ERROR_SUCCESS) return error;
+
+    AcquireSRWLockExclusive(&g_PadOverridesLock);
+
+    //
+    // Work on copies, the cached pad states are only updated on success
+    // 
+    RtlCopyMemory(pads, PadOverrides, sizeof(pads));
+
+    XINPUT_EXT_OVERRIDE_GAMEPAD_BATCH_INIT(&batch);
+
+    for (DWORD i = 0; i < dwCount; i++)
+    {
+        auto pPad = &pads[pStates[i].dwUserIndex];
+
+        pPad->Overrides = pStates[i].dwMask;
+        pPad->Gamepad = *reinterpret_cast<const XINPUT_GAMEPAD_STATE*>(&pStates[i].Gamepad);
+        pPad->LeftTrigger = XINPUT_TRIGGER_TO_HIGH_RES(pPad->Gamepad.bLeftTrigger);
+        pPad->RightTrigger = XINPUT_TRIGGER_TO_HIGH_RES(pPad->Gamepad.bRightTrigger);
+
+        XINPUT_EXT_OVERRIDE_GAMEPAD_BATCH_ADD(&batch, pPad);
+    }
+
+    //
+    // Duplicate user indices are merged by XINPUT_EXT_OVERRIDE_GAMEPAD_BATCH_ADD
+    // 
+    if (batch.Count != dwCount)
+    {
+        error = ERROR_BAD_ARGUMENTS;
+    }
+    else if (DeviceIoControl(
+        g_hGuardian,
+        IOCTL_XINPUT_EXT_OVERRIDE_GAMEPAD_STATE_BATCH,
+        static_cast<LPVOID>(&batch),
+        batch.Size,
+        nullptr,
+        0,
+        &retval,
+        nullptr))
+    {
+        RtlCopyMemory(PadOverrides, pads, sizeof(pads));
+    }
+    else
+    {
+        error = GetLastError();
+    }
+
+    ReleaseSRWLockExclusive(&g_PadOverridesLock);
+
+    return error;
+}
+
+XINPUTEXTENSIONS_API DWORD XInputOverrideTransactionBegin(PXINPUT_OVERRIDE_TRANSACTION pTransaction)
+{
+    if (!pTransaction) return ERROR_BAD_ARGUMENTS;
+
+    RtlZeroMemory(pTransaction, sizeof(XINPUT_OVERRIDE_TRANSACTION));
+
+    return ERROR_SUCCESS;
+}
+
+XINPUTEXTENSIONS_API DWORD XInputOverrideTransactionSetState(PXINPUT_OVERRIDE_TRANSACTION pTransaction, DWORD dwUserIndex, DWORD dwMask, PXINPUT_GAMEPAD pGamepad)
+{
+    DWORD   i;
+
+    if (!pTransaction || !pGamepad) return ERROR_BAD_ARGUMENTS;
+
+    if (!VALID_USER_INDEX(dwUserIndex) || pTransaction->dwCount > XUSER_MAX_COUNT) return ERROR_BAD_ARGUMENTS;
+
+    //
+    // A pad set again replaces its earlier state
+    // 
+    for (i = 0; i < pTransaction->dwCount; i++)
+    {
+        if (pTransaction->States[i].dwUserIndex == dwUserIndex) break;
+    }
+
+    if (i == XUSER_MAX_COUNT) return ERROR_BAD_ARGUMENTS;
+
+    if (i == pTransaction->dwCount) pTransaction->dwCount++;
+
+    pTransaction->States[i].dwUserIndex = dwUserIndex;
+    pTransaction->States[i].dwMask = dwMask;
+    pTransaction->States[i].Gamepad = *pGamepad;
+
+    return ERROR_SUCCESS;
+}
+
+XINPUTEXTENSIONS_API DWORD XInputOverrideTransactionCommit(PXINPUT_OVERRIDE_TRANSACTION pTransaction)
+{
+    if (!pTransaction) return ERROR_BAD_ARGUMENTS;
+
+    if (pTransaction->dwCount == 0) return ERROR_SUCCESS;
+
+    auto error = XInputOverrideSetStateBatch(pTransaction->dwCount, pTransaction->States);
+
+    //
+    // Kept on failure, so the caller may retry the commit
+    // 
+    if (error == ERROR_SUCCESS) pTransaction->dwCount = 0;
+
+    return error;
+}
+
+XINPUTEXTENSIONS_API DWORD XInputOverrideSetLayer(DWORD dwUserIndex, BYTE bLayerId, LONG lPriority, DWORD dwBlendMode, DWORD dwMask, PXINPUT_GAMEPAD pGamepad)
+{
+    return XInputOverrideSetLayerLease(dwUserIndex, bLayerId, lPriority, dwBlendMode, dwMask, pGamepad, 0);
+}
+
+XINPUTEXTENSIONS_API DWORD XInputOverrideSetLayerLease(DWORD dwUserIndex, BYTE bLayerId, LONG lPriority, DWORD dwBlendMode, DWORD dwMask, PXINPUT_GAMEPAD pGamepad, ULONGLONG ullLeaseDuration)
+{
+    XINPUT_EXT_OVERRIDE_GAMEPAD_LAYER   layer;
+    DWORD                               retval = 0;
+
+    if (!pGamepad) return ERROR_BAD_ARGUMENTS;
+
+    if (!VALID_USER_INDEX(dwUserIndex)) return ERROR_BAD_ARGUMENTS;
+
+    if (!VALID_LAYER_ID(bLayerId) || dwBlendMode >= XINPUT_OVERRIDE_BLEND_MODE_MAX) return ERROR_BAD_ARGUMENTS;
+
+    auto error = OpenGuardian();
+    if (error != ERROR_SUCCESS) return error;
+
+    XINPUT_EXT_OVERRIDE_GAMEPAD_LAYER_INIT(&layer, static_cast<UCHAR>(dwUserIndex), bLayerId);
+
+    layer.Priority = lPriority;
+    layer.BlendMode = static_cast<XINPUT_OVERRIDE_BLEND_MODE>(dwBlendMode);
+    layer.Override.Overrides = dwMask;
+    layer.Override.Gamepad = *reinterpret_cast<PXINPUT_GAMEPAD_STATE>(pGamepad);
+    layer.Override.LeftTrigger = XINPUT_TRIGGER_TO_HIGH_RES(layer.Override.Gamepad.bLeftTrigger);
+    layer.Override.RightTrigger = XINPUT_TRIGGER_TO_HIGH_RES(layer.Override.Gamepad.bRightTrigger);
+    layer.LeaseDuration = ullLeaseDuration;
+
+    auto ret = DeviceIoControl(
+        g_hGuardian,
+        IOCTL_XINPUT_EXT_OVERRIDE_GAMEPAD_LAYER,
+        static_cast<LPVOID>(&layer),
+        layer.Size,
+        nullptr,
+        0,
+        &retval,
+        nullptr);
+
+    if (ret > 0) return ERROR_SUCCESS;
+
+    return GetLastError();
+}
+
+XINPUTEXTENSIONS_API DWORD XInputOverrideScheduleState(DWORD dwUserIndex, DWORD dwMask, PXINPUT_GAMEPAD pGamepad, ULONGLONG ullActivationTime, ULONGLONG ullDuration)
+{
+    XINPUT_EXT_SCHEDULE_GAMEPAD     schedule;
+    DWORD                           retval = 0;
+
+    if (!pGamepad) return ERROR_BAD_ARGUMENTS;
+
+    if (!VALID_USER_INDEX(dwUserIndex) || ullDuration == 0) return ERROR_BAD_ARGUMENTS;
+
+    auto error = OpenGuardian();
+    if (error != ERROR_SUCCESS) return error;
+
+    XINPUT_EXT_SCHEDULE_GAMEPAD_INIT(&schedule, static_cast<UCHAR>(dwUserIndex), ullActivationTime, ullDuration);
+
+    schedule.Override.Overrides = dwMask;
+    schedule.Override.Gamepad = *reinterpret_cast<PXINPUT_GAMEPAD_STATE>(pGamepad);
+    schedule.Override.LeftTrigger = XINPUT_TRIGGER_TO_HIGH_RES(schedule.Override.Gamepad.bLeftTrigger);
+    schedule.Override.RightTrigger = XINPUT_TRIGGER_TO_HIGH_RES(schedule.Override.Gamepad.bRightTrigger);
+
+    auto ret = DeviceIoControl(
+        g_hGuardian,
+        IOCTL_XINPUT_EXT_SCHEDULE_GAMEPAD_STATE,
+        static_cast<LPVOID>(&schedule),
+        schedule.Size,
+        nullptr,
+        0,
+        &retval,
+        nullptr);
+
+    if (ret > 0) return ERROR_SUCCESS;
 
     return GetLastError();
 }
 
+XINPUTEXTENSIONS_API DWORD XInputOverrideWaitState(DWORD dwUserIndex, DWORD dwLastSequence, DWORD dwMilliseconds, PXINPUT_GAMEPAD pGamepad, PDWORD pdwSequence)
+{
+    XINPUT_EXT_WAIT_GAMEPAD             wait;
+    XINPUT_EXT_VERSIONED_GAMEPAD_STATE  state;
+    OVERLAPPED                          overlapped = {};
+    DWORD                               retval = 0;
+    DWORD                               error;
+
+    if (!pGamepad) return ERROR_BAD_ARGUMENTS;
+
+    if (!VALID_USER_INDEX(dwUserIndex)) return ERROR_BAD_ARGUMENTS;
+
+    error = OpenGuardianWait();
+    if (error != ERROR_SUCCESS) return error;
+
+    overlapped.hEvent = CreateEvent(nullptr, TRUE, FALSE, nullptr);
+    if (!overlapped.hEvent) return GetLastError();
+
+    XINPUT_EXT_WAIT_GAMEPAD_INIT(&wait, static_cast<UCHAR>(dwUserIndex), dwLastSequence);
+
+    auto ret = DeviceIoControl(
+        g_hGuardianWait,
+        IOCTL_XINPUT_EXT_WAIT_GAMEPAD_STATE,
+        static_cast<LPVOID>(&wait),
+        wait.Size,
+        &state,
+        sizeof(XINPUT_EXT_VERSIONED_GAMEPAD_STATE),
+        nullptr,
+        &overlapped);
+
+    if (!ret && GetLastError() == ERROR_IO_PENDING)
+    {
+        //
+        // The request must be finished before overlapped goes out of scope
+        // 
+        if (WaitForSingleObject(overlapped.hEvent, dwMilliseconds) != WAIT_OBJECT_0)
+        {
+            CancelIoEx(g_hGuardianWait, &overlapped);
+        }
+
+        ret = GetOverlappedResult(g_hGuardianWait, &overlapped, &retval, TRUE);
+    }
+
+    error = ret ? ERROR_SUCCESS : GetLastError();
+
+    CloseHandle(overlapped.hEvent);
+
+    if (error == ERROR_OPERATION_ABORTED) return ERROR_TIMEOUT;
+
+    if (error != ERROR_SUCCESS) return error;
+
+    *reinterpret_cast<PXINPUT_GAMEPAD_STATE>(pGamepad) = state.Gamepad;
+
+    if (pdwSequence) *pdwSequence = state.Sequence;
+
+    return ERROR_SUCCESS;
+}
+
+//
+// Allocates the mailbox and attaches it to the driver. The caller must
+// hold g_MailboxLock exclusive.
+// 
+DWORD AttachMailbox()
+{
+    DWORD   error;
+
+    if (g_pMailbox) return ERROR_SUCCESS;
+
+    error = OpenGuardianWait();
+    if (error != ERROR_SUCCESS) return error;
+
+    //
+    // Page aligned, which satisfies the slot alignment the driver demands
+    // 
+    auto pMailbox = static_cast<PXNA_GUARDIAN_MAILBOX>(VirtualAlloc(
+        nullptr, sizeof(XNA_GUARDIAN_MAILBOX), MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE));
+    if (!pMailbox) return GetLastError();
+
+    XNA_GUARDIAN_MAILBOX_INIT(pMailbox);
+
+    g_MailboxOverlapped = {};
+    g_MailboxOverlapped.hEvent = CreateEvent(nullptr, TRUE, FALSE, nullptr);
+    if (!g_MailboxOverlapped.hEvent)
+    {
+        error = GetLastError();
+        VirtualFree(pMailbox, 0, MEM_RELEASE);
+        return error;
+    }
+
+    //
+    // Stays pending while the mailbox is attached
+    // 
+    auto ret = DeviceIoControl(
+        g_hGuardianWait,
+        IOCTL_XINPUT_EXT_MAILBOX_ATTACH,
+        nullptr,
+        0,
+        pMailbox,
+        sizeof(XNA_GUARDIAN_MAILBOX),
+        nullptr,
+        &g_MailboxOverlapped);
+
+    if (!ret && GetLastError() == ERROR_IO_PENDING)
+    {
+        g_pMailbox = pMailbox;
+        return ERROR_SUCCESS;
+    }
+
+    //
+    // Completed right away, the driver refused the mailbox
+    // 
+    error = ret ? ERROR_INVALID_FUNCTION : GetLastError();
+
+    CloseHandle(g_MailboxOverlapped.hEvent);
+    VirtualFree(pMailbox, 0, MEM_RELEASE);
+
+    return error;
+}
+
+XINPUTEXTENSIONS_API DWORD XInputOverrideMailboxEnable()
+{
+    AcquireSRWLockExclusive(&g_MailboxLock);
+
+    auto error = AttachMailbox();
+
+    ReleaseSRWLockExclusive(&g_MailboxLock);
+
+    return error;
+}
+
+XINPUTEXTENSIONS_API DWORD XInputOverrideMailboxSetState(DWORD dwUserIndex, DWORD dwMask, PXINPUT_GAMEPAD pGamepad)
+{
+    XNA_GUARDIAN_MAILBOX_OVERRIDE   override;
+
+    if (!pGamepad) return ERROR_BAD_ARGUMENTS;
+
+    if (!VALID_USER_INDEX(dwUserIndex)) return ERROR_BAD_ARGUMENTS;
 
+    override.Overrides = dwMask;
+    override.Gamepad = *reinterpret_cast<PXINPUT_GAMEPAD_STATE>(pGamepad);
+    override.LeftTrigger = XINPUT_TRIGGER_TO_HIGH_RES(override.Gamepad.bLeftTrigger);
+    override.RightTrigger = XINPUT_TRIGGER_TO_HIGH_RES(override.Gamepad.bRightTrigger);
+
+    //
+    // Taken shared, writers of different pads don't contend, yet a
+    // concurrent disable can't release the pages underneath them
+    // 
+    AcquireSRWLockShared(&g_MailboxLock);
+
+    if (!g_pMailbox)
+    {
+        ReleaseSRWLockShared(&g_MailboxLock);
+        return ERROR_INVALID_HANDLE;
+    }
+
+    //
+    // Picked up by the driver with the next report, no I/O involved
+    // 
+    XNA_GUARDIAN_MAILBOX_SLOT_WRITE(&g_pMailbox->Slots[dwUserIndex], &override);
+
+    ReleaseSRWLockShared(&g_MailboxLock);
+
+    return ERROR_SUCCESS;
+}
+
+//
+// Detaches the mailbox from the driver and releases it. The caller must
+// hold g_MailboxLock exclusive.
+// 
+DWORD DetachMailbox()
+{
+    OVERLAPPED  overlapped = {};
+    DWORD       retval = 0;
+
+    if (!g_pMailbox) return ERROR_SUCCESS;
+
+    overlapped.hEvent = CreateEvent(nullptr, TRUE, FALSE, nullptr);
+    if (!overlapped.hEvent) return GetLastError();
+
+    auto ret = DeviceIoControl(
+        g_hGuardianWait,
+        IOCTL_XINPUT_EXT_MAILBOX_DETACH,
+        nullptr,
+        0,
+        nullptr,
+        0,
+        nullptr,
+        &overlapped);
+
+    if (!ret && GetLastError() == ERROR_IO_PENDING)
+    {
+        GetOverlappedResult(g_hGuardianWait, &overlapped, &retval, TRUE);
+    }
+
+    CloseHandle(overlapped.hEvent);
+
+    //
+    // The pages may only be released once the attach request is finished
+    // 
+    if (!GetOverlappedResult(g_hGuardianWait, &g_MailboxOverlapped, &retval, FALSE)
+        && GetLastError() == ERROR_IO_INCOMPLETE)
+    {
+        CancelIoEx(g_hGuardianWait, &g_MailboxOverlapped);
+        GetOverlappedResult(g_hGuardianWait, &g_MailboxOverlapped, &retval, TRUE);
+    }
+
+    CloseHandle(g_MailboxOverlapped.hEvent);
+    VirtualFree(g_pMailbox, 0, MEM_RELEASE);
+    g_pMailbox = nullptr;
+
+    return ERROR_SUCCESS;
+}
+
+XINPUTEXTENSIONS_API DWORD XInputOverrideMailboxDisable()
+{
+    AcquireSRWLockExclusive(&g_MailboxLock);
+
+    auto error = DetachMailbox();
+
+    ReleaseSRWLockExclusive(&g_MailboxLock);
+
+    return error;
+}
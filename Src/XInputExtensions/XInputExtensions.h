@@ -39,12 +39,105 @@ extern "C"
   // used by C++ source code
 #endif
 
+    //
+    // Override mask and state of one pad for XInputOverrideSetStateBatch
+    // 
+    typedef struct _XINPUT_OVERRIDE_STATE
+    {
+        DWORD           dwUserIndex;
+        DWORD           dwMask;
+        XINPUT_GAMEPAD  Gamepad;
+
+    } XINPUT_OVERRIDE_STATE, *PXINPUT_OVERRIDE_STATE;
+
+    //
+    // Pad states collected by XInputOverrideTransactionSetState, owned by
+    // the caller and not shared between threads
+    // 
+    typedef struct _XINPUT_OVERRIDE_TRANSACTION
+    {
+        DWORD                   dwCount;
+        XINPUT_OVERRIDE_STATE   States[XUSER_MAX_COUNT];
+
+    } XINPUT_OVERRIDE_TRANSACTION, *PXINPUT_OVERRIDE_TRANSACTION;
+
     XINPUTEXTENSIONS_API DWORD XInputOverrideSetMask(DWORD dwUserIndex, DWORD dwMask);
 
     XINPUTEXTENSIONS_API DWORD XInputOverrideSetState(DWORD dwUserIndex, PXINPUT_GAMEPAD pGamepad);
 
+    //
+    // Sets mask and state of a pad in one request, unlike
+    // XInputOverrideSetMask followed by XInputOverrideSetState.
+    // 
+    XINPUTEXTENSIONS_API DWORD XInputOverrideApply(DWORD dwUserIndex, DWORD dwMask, PXINPUT_GAMEPAD pGamepad);
+
     XINPUTEXTENSIONS_API DWORD XInputOverridePeekState(DWORD dwUserIndex, PXINPUT_GAMEPAD pGamepad);
 
+    XINPUTEXTENSIONS_API DWORD XInputOverrideSetTriggers(DWORD dwUserIndex, WORD wLeftTrigger, WORD wRightTrigger);
+
+    //
+    // Sets mask and state of up to XUSER_MAX_COUNT pads in one request,
+    // each pad may appear once.
+    // 
+    XINPUTEXTENSIONS_API DWORD XInputOverrideSetStateBatch(DWORD dwCount, const XINPUT_OVERRIDE_STATE* pStates);
+
+    //
+    // Collects the states of several pads without any I/O and submits them
+    // with XInputOverrideTransactionCommit as one batch. The transaction is
+    // emptied on success and kept otherwise.
+    // 
+    XINPUTEXTENSIONS_API DWORD XInputOverrideTransactionBegin(PXINPUT_OVERRIDE_TRANSACTION pTransaction);
+
+    XINPUTEXTENSIONS_API DWORD XInputOverrideTransactionSetState(PXINPUT_OVERRIDE_TRANSACTION pTransaction, DWORD dwUserIndex, DWORD dwMask, PXINPUT_GAMEPAD pGamepad);
+
+    XINPUTEXTENSIONS_API DWORD XInputOverrideTransactionCommit(PXINPUT_OVERRIDE_TRANSACTION pTransaction);
+
+    //
+    // Sets the override layer bLayerId (1 to 7) of a pad. Layers are blended
+    // in ascending order of lPriority using dwBlendMode (a value of
+    // XINPUT_OVERRIDE_BLEND_MODE), a dwMask of zero removes the layer.
+    // Layer 0 holds the overrides set through XInputOverrideSetState by all
+    // processes, where the process that set a control last wins.
+    // 
+    XINPUTEXTENSIONS_API DWORD XInputOverrideSetLayer(DWORD dwUserIndex, BYTE bLayerId, LONG lPriority, DWORD dwBlendMode, DWORD dwMask, PXINPUT_GAMEPAD pGamepad);
+
+    //
+    // Like XInputOverrideSetLayer, but the layer is removed once
+    // ullLeaseDuration (in 100-nanosecond units) elapsed unless it is set
+    // again. Overrides are always removed when the process closes its handle.
+    // 
+    XINPUTEXTENSIONS_API DWORD XInputOverrideSetLayerLease(DWORD dwUserIndex, BYTE bLayerId, LONG lPriority, DWORD dwBlendMode, DWORD dwMask, PXINPUT_GAMEPAD pGamepad, ULONGLONG ullLeaseDuration);
+
+    //
+    // Applies dwMask and pGamepad to the reports of a pad completed between
+    // ullActivationTime and ullActivationTime + ullDuration. Times are in
+    // 100-nanosecond units as returned by QueryUnbiasedInterruptTime, an
+    // activation time of zero means now. Up to 16 overrides can be pending
+    // per pad, later activations win over earlier ones.
+    // 
+    XINPUTEXTENSIONS_API DWORD XInputOverrideScheduleState(DWORD dwUserIndex, DWORD dwMask, PXINPUT_GAMEPAD pGamepad, ULONGLONG ullActivationTime, ULONGLONG ullDuration);
+
+    //
+    // Blocks until the physical state of a pad differs from the one with
+    // sequence dwLastSequence or until dwMilliseconds elapsed (ERROR_TIMEOUT).
+    // Receives the new state and its sequence, pass 0 to get the first one.
+    // 
+    XINPUTEXTENSIONS_API DWORD XInputOverrideWaitState(DWORD dwUserIndex, DWORD dwLastSequence, DWORD dwMilliseconds, PXINPUT_GAMEPAD pGamepad, PDWORD pdwSequence);
+
+    //
+    // Shares an override mailbox with the driver. While enabled,
+    // XInputOverrideMailboxSetState publishes overrides through shared
+    // memory without issuing a request, they take precedence over all
+    // other overrides of the pad. A dwMask of zero clears the pad.
+    // Enabling, disabling and setting may be called from any thread, but
+    // calls setting the same pad must not overlap.
+    // 
+    XINPUTEXTENSIONS_API DWORD XInputOverrideMailboxEnable();
+
+    XINPUTEXTENSIONS_API DWORD XInputOverrideMailboxSetState(DWORD dwUserIndex, DWORD dwMask, PXINPUT_GAMEPAD pGamepad);
+
+    XINPUTEXTENSIONS_API DWORD XInputOverrideMailboxDisable();
+
 #ifdef __cplusplus
 }
 #endif
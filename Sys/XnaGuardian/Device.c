@@ -31,9 +31,10 @@ SOFTWARE.
 
 
 XINPUT_PAD_STATE_INTERNAL   PadStates[XINPUT_MAX_DEVICES];
-XINPUT_GAMEPAD_STATE        PeekPadCache[XINPUT_MAX_DEVICES];
-WDFCOLLECTION               HidUsbDeviceCollection;
-WDFWAITLOCK                 HidUsbDeviceCollectionLock;
+XNA_SEQ_LOCK                PadStatesSequence[XINPUT_MAX_DEVICES];
+XNA_PEEK_CACHE_ENTRY        PeekPadCache[XINPUT_MAX_DEVICES];
+XNA_SLOT_TABLE              HidUsbDeviceSlots;
+WDFWAITLOCK                 HidUsbDeviceSlotsLock;
 
 #ifdef ALLOC_PRAGMA
 #pragma alloc_text (PAGE, XnaGuardianCreateDevice)
@@ -51,6 +52,8 @@ XnaGuardianCreateDevice(
     NTSTATUS                        status;
     PDEVICE_CONTEXT                 pDeviceContext;
     WDF_PNPPOWER_EVENT_CALLBACKS    pnpPowerCallbacks;
+    WDF_OBJECT_ATTRIBUTES           requestAttributes;
+    ULONG                           slot;
 
     PAGED_CODE();
 
@@ -68,6 +71,13 @@ XnaGuardianCreateDevice(
 
     WdfDeviceInitSetPnpPowerEventCallbacks(DeviceInit, &pnpPowerCallbacks);
 
+    //
+    // Claim state of upper interrupt requests held outside of a queue
+    // 
+    WDF_OBJECT_ATTRIBUTES_INIT_CONTEXT_TYPE(&requestAttributes, UPPER_USB_REQUEST_CONTEXT);
+
+    WdfDeviceInitSetRequestAttributes(DeviceInit, &requestAttributes);
+
     WDF_OBJECT_ATTRIBUTES_INIT_CONTEXT_TYPE(&deviceAttributes, DEVICE_CONTEXT);
 
     //
@@ -179,20 +189,18 @@ XnaGuardianCreateDevice(
 #pragma endregion
 
     //
-    // Add HID USB device to its own collection
+    // Assign the lowest free slot, which stays with the device until it
+    // is removed. Devices beyond XINPUT_MAX_DEVICES are passed through.
     // 
-    WdfWaitLockAcquire(HidUsbDeviceCollectionLock, NULL);
-    status = WdfCollectionAdd(HidUsbDeviceCollection, device);
-    if (!NT_SUCCESS(status))
-    {
-        WdfWaitLockRelease(HidUsbDeviceCollectionLock);
-        KdPrint((DRIVERNAME "WdfCollectionAdd failed with status 0x%X", status));
-        return status;
-    }
-    WdfWaitLockRelease(HidUsbDeviceCollectionLock);
+    WdfWaitLockAcquire(HidUsbDeviceSlotsLock, NULL);
+    slot = XNA_SLOT_TABLE_ACQUIRE(&HidUsbDeviceSlots, device);
+    WdfWaitLockRelease(HidUsbDeviceSlotsLock);
 
+    pDeviceContext->HidUsbSlot = slot;
     pDeviceContext->IsHidUsbDevice = TRUE;
 
+    TraceEvents(TRACE_LEVEL_INFORMATION, TRACE_DRIVER, "HID USB device assigned to slot %d", slot);
+
     TraceEvents(TRACE_LEVEL_INFORMATION, TRACE_DRIVER, "HID USB device detected, loading...");
 
 continueInit:
@@ -292,11 +300,11 @@ VOID XnaGuardianCleanupCallback(
 
     if (pDeviceContext->IsHidUsbDevice)
     {
-        TraceEvents(TRACE_LEVEL_INFORMATION, TRACE_DEVICE, "Removing HID USB device from collection");
+        TraceEvents(TRACE_LEVEL_INFORMATION, TRACE_DEVICE, "Releasing HID USB device slot %d", pDeviceContext->HidUsbSlot);
 
-        WdfWaitLockAcquire(HidUsbDeviceCollectionLock, NULL);
-        WdfCollectionRemove(HidUsbDeviceCollection, Device);
-        WdfWaitLockRelease(HidUsbDeviceCollectionLock);
+        WdfWaitLockAcquire(HidUsbDeviceSlotsLock, NULL);
+        XNA_SLOT_TABLE_RELEASE(&HidUsbDeviceSlots, pDeviceContext->HidUsbSlot);
+        WdfWaitLockRelease(HidUsbDeviceSlotsLock);
     }
 
     TraceEvents(TRACE_LEVEL_INFORMATION, TRACE_DEVICE, "%!FUNC! Exit");
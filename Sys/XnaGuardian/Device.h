@@ -28,6 +28,12 @@ SOFTWARE.
 #include "public.h"
 #include "XInputOverrides.h"
 #include "XnaGuardianShared.h"
+#include "XInputOverrideMerge.h"
+#include "XnaGuardianSeqLock.h"
+#include "XnaGuardianRing.h"
+#include "XnaGuardianSlots.h"
+#include "XnaGuardianLatestReport.h"
+#include "XnaGuardianPeekCache.h"
 
 EXTERN_C_START
 
@@ -45,8 +51,50 @@ typedef struct _XINPUT_PAD_STATE_INTERNAL
     XINPUT_GAMEPAD_OVERRIDES    Overrides;
     XINPUT_GAMEPAD_STATE        Gamepad;
 
+    //
+    // 10-bit trigger values, either supplied by the caller or rescaled
+    // from Gamepad once per override request
+    // 
+    USHORT                      LeftTrigger;
+    USHORT                      RightTrigger;
+
+    //
+    // Overrides expanded to a per-field merge mask
+    // 
+    XINPUT_GAMEPAD_STATE        Mask;
+
 } XINPUT_PAD_STATE_INTERNAL, *PXINPUT_PAD_STATE_INTERNAL;
 
+//
+// Stores an override request in the internal pad state and keeps the
+// 8-bit and 10-bit trigger values of both representations in sync.
+// 
+VOID FORCEINLINE XINPUT_PAD_STATE_INTERNAL_SET(
+    PXINPUT_PAD_STATE_INTERNAL pPad,
+    const XINPUT_EXT_OVERRIDE_GAMEPAD* pOverride
+)
+{
+    pPad->Overrides = pOverride->Overrides;
+    pPad->Gamepad = pOverride->Gamepad;
+
+    if (pOverride->Size >= sizeof(XINPUT_EXT_OVERRIDE_GAMEPAD)
+        && (pOverride->Overrides & XINPUT_GAMEPAD_OVERRIDE_HIGH_RES_TRIGGERS))
+    {
+        pPad->LeftTrigger = min(pOverride->LeftTrigger, XINPUT_HIGH_RES_TRIGGER_MAX);
+        pPad->RightTrigger = min(pOverride->RightTrigger, XINPUT_HIGH_RES_TRIGGER_MAX);
+        pPad->Gamepad.bLeftTrigger = XINPUT_TRIGGER_FROM_HIGH_RES(pPad->LeftTrigger);
+        pPad->Gamepad.bRightTrigger = XINPUT_TRIGGER_FROM_HIGH_RES(pPad->RightTrigger);
+    }
+    else
+    {
+        pPad->Overrides &= ~XINPUT_GAMEPAD_OVERRIDE_HIGH_RES_TRIGGERS;
+        pPad->LeftTrigger = XINPUT_TRIGGER_TO_HIGH_RES(pPad->Gamepad.bLeftTrigger);
+        pPad->RightTrigger = XINPUT_TRIGGER_TO_HIGH_RES(pPad->Gamepad.bRightTrigger);
+    }
+
+    XINPUT_GAMEPAD_MERGE_MASK_FROM_OVERRIDES(pPad->Overrides, &pPad->Mask);
+}
+
 //
 // The device context performs the same job as
 // a WDM device extension in the driver frameworks
@@ -61,8 +109,26 @@ typedef struct _DEVICE_CONTEXT
     PCWSTR              ClassName;
     BOOLEAN             IsXnaDevice;
     BOOLEAN             IsHidUsbDevice;
-    WDFQUEUE            UpperUsbInterruptRequests;
+    //
+    // Index into HidUsbDeviceSlots, equals the XInput user index of the
+    // pad or XINPUT_MAX_DEVICES if all slots were taken on arrival
+    //
+    ULONG               HidUsbSlot;
+    //
+    // Pending upper interrupt-IN requests, each holding a reference
+    //
+    XNA_REQUEST_RING    UpperUsbInterruptRequests;
+    //
+    // Non-zero while the device is in D0, requests are pushed into the
+    // ring only while set
+    //
+    volatile LONG       UpperUsbRequestsAccepted;
     WDFSPINLOCK         UpperUsbInterruptRequestsLock;
+    //
+    // Last report read while no upper request was pending, handed to the
+    // next one. Guarded by UpperUsbInterruptRequestsLock.
+    //
+    XNA_LATEST_REPORT   LatestReport;
     WDFUSBDEVICE        UsbDevice;
     WDFUSBINTERFACE     UsbInterface;
     WDFUSBPIPE          InterruptPipe;
@@ -71,6 +137,20 @@ typedef struct _DEVICE_CONTEXT
 
 WDF_DECLARE_CONTEXT_TYPE_WITH_NAME(DEVICE_CONTEXT, DeviceGetContext)
 
+//
+// Context of every request delivered to the filter
+//
+typedef struct _UPPER_USB_REQUEST_CONTEXT
+{
+    //
+    // XNA_RING_ITEM_* state while held in UpperUsbInterruptRequests
+    //
+    volatile LONG   State;
+
+} UPPER_USB_REQUEST_CONTEXT, *PUPPER_USB_REQUEST_CONTEXT;
+
+WDF_DECLARE_CONTEXT_TYPE_WITH_NAME(UPPER_USB_REQUEST_CONTEXT, UpperUsbRequestGetContext)
+
 typedef struct _XINPUT_PAD_IDENTIFIER_CONTEXT
 {
     ULONG   Index;
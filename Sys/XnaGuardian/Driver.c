@@ -83,21 +83,21 @@ DriverEntry(
         return status;
     }
 
-    status = WdfCollectionCreate(WDF_NO_OBJECT_ATTRIBUTES,
-        &HidUsbDeviceCollection);
+    //
+    // The wait-lock object has the driver object as a default parent.
+    //
+
+    status = WdfWaitLockCreate(WDF_NO_OBJECT_ATTRIBUTES,
+        &FilterDeviceCollectionLock);
     if (!NT_SUCCESS(status))
     {
-        TraceEvents(TRACE_LEVEL_FATAL, TRACE_DRIVER, "WdfCollectionCreate failed with status %!STATUS!", status);
+        TraceEvents(TRACE_LEVEL_FATAL, TRACE_DRIVER, "WdfWaitLockCreate failed with status %!STATUS!", status);
         WPP_CLEANUP(DriverObject);
         return status;
     }
 
-    //
-    // The wait-lock object has the driver object as a default parent.
-    //
-
     status = WdfWaitLockCreate(WDF_NO_OBJECT_ATTRIBUTES,
-        &FilterDeviceCollectionLock);
+        &HidUsbDeviceSlotsLock);
     if (!NT_SUCCESS(status))
     {
         TraceEvents(TRACE_LEVEL_FATAL, TRACE_DRIVER, "WdfWaitLockCreate failed with status %!STATUS!", status);
@@ -106,7 +106,7 @@ DriverEntry(
     }
 
     status = WdfWaitLockCreate(WDF_NO_OBJECT_ATTRIBUTES,
-        &HidUsbDeviceCollectionLock);
+        &PadOverrideLayersLock);
     if (!NT_SUCCESS(status))
     {
         TraceEvents(TRACE_LEVEL_FATAL, TRACE_DRIVER, "WdfWaitLockCreate failed with status %!STATUS!", status);
@@ -114,6 +114,33 @@ DriverEntry(
         return status;
     }
 
+    status = WdfSpinLockCreate(WDF_NO_OBJECT_ATTRIBUTES,
+        &PeekPadCacheLock);
+    if (!NT_SUCCESS(status))
+    {
+        TraceEvents(TRACE_LEVEL_FATAL, TRACE_DRIVER, "WdfSpinLockCreate failed with status %!STATUS!", status);
+        WPP_CLEANUP(DriverObject);
+        return status;
+    }
+
+    status = WdfSpinLockCreate(WDF_NO_OBJECT_ATTRIBUTES,
+        &MailboxLock);
+    if (!NT_SUCCESS(status))
+    {
+        TraceEvents(TRACE_LEVEL_FATAL, TRACE_DRIVER, "WdfSpinLockCreate failed with status %!STATUS!", status);
+        WPP_CLEANUP(DriverObject);
+        return status;
+    }
+
+    status = WdfSpinLockCreate(WDF_NO_OBJECT_ATTRIBUTES,
+        &PadSchedulesLock);
+    if (!NT_SUCCESS(status))
+    {
+        TraceEvents(TRACE_LEVEL_FATAL, TRACE_DRIVER, "WdfSpinLockCreate failed with status %!STATUS!", status);
+        WPP_CLEANUP(DriverObject);
+        return status;
+    }
+
     TraceEvents(TRACE_LEVEL_INFORMATION, TRACE_DRIVER, "XnaGuardian loaded");
 
     return status;
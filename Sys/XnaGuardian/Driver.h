@@ -37,14 +37,19 @@ SOFTWARE.
 #include "KmString.h"
 #include "HidUsb.h"
 #include "Power.h"
+#include "OverrideLayers.h"
+#include "PeekCache.h"
+#include "Mailbox.h"
+#include "Schedule.h"
 
 #define DRIVERNAME "XnaGuardian: "
 
 extern WDFCOLLECTION    FilterDeviceCollection;
 extern WDFWAITLOCK      FilterDeviceCollectionLock;
 extern WDFDEVICE        ControlDevice;
-extern WDFCOLLECTION    HidUsbDeviceCollection;
-extern WDFWAITLOCK      HidUsbDeviceCollectionLock;
+extern XNA_SLOT_TABLE   HidUsbDeviceSlots;
+extern WDFWAITLOCK      HidUsbDeviceSlotsLock;
+extern WDFWAITLOCK      PadOverrideLayersLock;
 
 EXTERN_C_START
 
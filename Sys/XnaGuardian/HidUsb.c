@@ -27,6 +27,238 @@ SOFTWARE.
 #include "hidusb.tmh"
 
 
+const USHORT XInputToXboneHidUsbButtonsLow[256] = {
+    VIGEM_LUT_256(XINPUT_TO_XBONE_HID_USB_BUTTONS_LOW_ENTRY, 0)
+};
+
+const USHORT XInputToXboneHidUsbButtonsHigh[256] = {
+    VIGEM_LUT_256(XINPUT_TO_XBONE_HID_USB_BUTTONS_HIGH_ENTRY, 0)
+};
+
+const USHORT XInputToX360HidUsbButtonsLow[256] = {
+    VIGEM_LUT_256(XINPUT_TO_X360_HID_USB_BUTTONS_LOW_ENTRY, 0)
+};
+
+const USHORT XInputToX360HidUsbButtonsHigh[256] = {
+    VIGEM_LUT_256(XINPUT_TO_X360_HID_USB_BUTTONS_HIGH_ENTRY, 0)
+};
+
+//
+// Gets the transfer buffer and its length of an upper interrupt-IN request.
+// 
+static VOID GetUpperUsbTransferBuffer(
+    WDFREQUEST Request,
+    PUCHAR *Buffer,
+    PULONG BufferLength
+)
+{
+    PURB    pUrb;
+
+    pUrb = URB_FROM_IRP(WdfRequestWdmGetIrp(Request));
+    if (Buffer) *Buffer = (PUCHAR)pUrb->UrbBulkOrInterruptTransfer.TransferBuffer;
+    if (BufferLength) *BufferLength = pUrb->UrbBulkOrInterruptTransfer.TransferBufferLength;
+}
+
+//
+// Reports the number of bytes actually transferred to the upper driver,
+// it reads the report length from the URB on completion.
+// 
+static VOID SetUpperUsbTransferLength(
+    WDFREQUEST Request,
+    ULONG Length
+)
+{
+    PURB    pUrb;
+
+    pUrb = URB_FROM_IRP(WdfRequestWdmGetIrp(Request));
+    pUrb->UrbBulkOrInterruptTransfer.TransferBufferLength = Length;
+}
+
+//
+// Completes an upper interrupt-IN request held in the pending ring with
+// STATUS_CANCELLED, unless a consumer claimed it already. The reference
+// taken on push keeps the request context alive for the consumer that
+// dequeues the request later on.
+// 
+static VOID XnaGuardianEvtUpperUsbRequestCancel(
+    WDFREQUEST Request
+)
+{
+    if (XNA_RING_ITEM_CANCEL(&UpperUsbRequestGetContext(Request)->State))
+    {
+        WdfRequestComplete(Request, STATUS_CANCELLED);
+    }
+}
+
+//
+// Takes ownership of a request dequeued from or not making it into the
+// pending ring and drops its reference. Returns FALSE if the request got
+// cancelled meanwhile.
+// 
+static BOOLEAN UpperUsbRequestClaim(
+    WDFREQUEST Request
+)
+{
+    BOOLEAN owned = FALSE;
+
+    if (XNA_RING_ITEM_CLAIM(&UpperUsbRequestGetContext(Request)->State))
+    {
+        //
+        // The cancel routine backs off once the request is claimed
+        // 
+        if (WdfRequestUnmarkCancelable(Request) == STATUS_CANCELLED)
+        {
+            WdfRequestComplete(Request, STATUS_CANCELLED);
+        }
+        else
+        {
+            owned = TRUE;
+        }
+    }
+
+    WdfObjectDereference(Request);
+
+    return owned;
+}
+
+//
+// Adds an upper interrupt-IN request to the pending ring. On failure the
+// caller still owns the request.
+// 
+static NTSTATUS UpperUsbRequestPush(
+    PDEVICE_CONTEXT DeviceContext,
+    WDFREQUEST Request
+)
+{
+    NTSTATUS    status;
+
+    if (!DeviceContext->UpperUsbRequestsAccepted)
+    {
+        return STATUS_DEVICE_NOT_READY;
+    }
+
+    UpperUsbRequestGetContext(Request)->State = XNA_RING_ITEM_PENDING;
+
+    WdfObjectReference(Request);
+
+    status = WdfRequestMarkCancelableEx(Request, XnaGuardianEvtUpperUsbRequestCancel);
+    if (!NT_SUCCESS(status))
+    {
+        WdfObjectDereference(Request);
+        return status;
+    }
+
+    if (!XNA_REQUEST_RING_ENQUEUE(&DeviceContext->UpperUsbInterruptRequests, Request))
+    {
+        TraceEvents(TRACE_LEVEL_ERROR, TRACE_HIDUSB, "%!FUNC! Pending request ring is full");
+
+        return UpperUsbRequestClaim(Request) ? STATUS_INSUFFICIENT_RESOURCES : STATUS_SUCCESS;
+    }
+
+    //
+    // Pairs with the interlocked clear in XnaGuardianEvtDeviceD0Exit, either
+    // its drain sees the request or the request sees the device leaving D0
+    // 
+    KeMemoryBarrier();
+
+    if (!DeviceContext->UpperUsbRequestsAccepted)
+    {
+        UpperUsbRequestCancelAll(DeviceContext);
+    }
+
+    return STATUS_SUCCESS;
+}
+
+//
+// Dequeues the oldest pending upper interrupt-IN request not cancelled.
+// 
+BOOLEAN UpperUsbRequestPop(
+    PDEVICE_CONTEXT DeviceContext,
+    WDFREQUEST* Request
+)
+{
+    PVOID   item;
+
+    while (XNA_REQUEST_RING_DEQUEUE(&DeviceContext->UpperUsbInterruptRequests, &item))
+    {
+        if (UpperUsbRequestClaim((WDFREQUEST)item))
+        {
+            *Request = (WDFREQUEST)item;
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+//
+// Completes all pending upper interrupt-IN requests with STATUS_CANCELLED
+// and drops the references the ring holds.
+// 
+VOID UpperUsbRequestCancelAll(
+    PDEVICE_CONTEXT DeviceContext
+)
+{
+    WDFREQUEST  request;
+
+    while (UpperUsbRequestPop(DeviceContext, &request))
+    {
+        WdfRequestComplete(request, STATUS_CANCELLED);
+    }
+}
+
+//
+// Takes the report stored while no upper request was pending, if any.
+// 
+static BOOLEAN TakeLatestReport(
+    PDEVICE_CONTEXT pDeviceContext,
+    PUCHAR Report,
+    PULONG ReportLength,
+    PULONGLONG ReportTime
+)
+{
+    BOOLEAN taken;
+
+    URB_QUEUE_LOCK();
+    taken = XNA_LATEST_REPORT_TAKE(&pDeviceContext->LatestReport, Report, ReportLength, ReportTime);
+    URB_QUEUE_UNLOCK();
+
+    return taken;
+}
+
+//
+// Completes an upper interrupt-IN request with a stored report.
+// 
+static VOID CompleteUpperUsbRequest(
+    PDEVICE_CONTEXT DeviceContext,
+    WDFREQUEST Request,
+    const UCHAR* Report,
+    ULONG ReportLength,
+    ULONGLONG ReportTime
+)
+{
+    PUCHAR              pUpperBuffer;
+    ULONG               upperBufferLength;
+
+    GetUpperUsbTransferBuffer(Request, &pUpperBuffer, &upperBufferLength);
+
+    TraceEvents(TRACE_LEVEL_VERBOSE, TRACE_HIDUSB, "%!FUNC! Completing from latest report of length %d", ReportLength);
+
+    RtlCopyBytes(pUpperBuffer, Report, min(ReportLength, upperBufferLength));
+    SetUpperUsbTransferLength(Request, min(ReportLength, upperBufferLength));
+
+    //
+    // Like the decoder, overrides key on the transferred length, a report
+    // truncated by a short upper buffer is passed through unchanged
+    // 
+    if (DeviceContext->HidUsbSlot < XINPUT_MAX_DEVICES && ReportLength <= upperBufferLength)
+    {
+        XnaGuardianHidUsbApplyOverrides((UCHAR)DeviceContext->HidUsbSlot, ReportTime, pUpperBuffer, ReportLength);
+    }
+
+    WdfRequestComplete(Request, STATUS_SUCCESS);
+}
+
 //
 // Gets the next available upper USB request - if any - and
 // returns the associated request, a pointer to the transfer 
@@ -39,9 +271,7 @@ BOOLEAN GetUpperUsbRequest(
     PULONG BufferLength
 )
 {
-    NTSTATUS            status;
     PDEVICE_CONTEXT     pDeviceContext;
-    PURB                pUrb;
 
     TraceEvents(TRACE_LEVEL_INFORMATION, TRACE_HIDUSB, "%!FUNC! Entry");
 
@@ -61,25 +291,104 @@ BOOLEAN GetUpperUsbRequest(
         return FALSE;
     }
 
-    URB_QUEUE_LOCK();
-    status = WdfIoQueueRetrieveNextRequest(pDeviceContext->UpperUsbInterruptRequests, PendingRequest);
-    URB_QUEUE_UNLOCK();
-
-    if (!NT_SUCCESS(status))
+    if (!UpperUsbRequestPop(pDeviceContext, PendingRequest))
     {
-        TraceEvents(TRACE_LEVEL_ERROR, TRACE_HIDUSB, "%!FUNC! Exit - WdfIoQueueRetrieveNextRequest failed with status %!STATUS!", status);
+        TraceEvents(TRACE_LEVEL_VERBOSE, TRACE_HIDUSB, "%!FUNC! Exit - no pending request");
         return FALSE;
     }
 
-    pUrb = URB_FROM_IRP(WdfRequestWdmGetIrp(*PendingRequest));
-    if (Buffer) *Buffer = (PUCHAR)pUrb->UrbBulkOrInterruptTransfer.TransferBuffer;
-    if (BufferLength) *BufferLength = pUrb->UrbBulkOrInterruptTransfer.TransferBufferLength;
+    GetUpperUsbTransferBuffer(*PendingRequest, Buffer, BufferLength);
 
     TraceEvents(TRACE_LEVEL_INFORMATION, TRACE_HIDUSB, "%!FUNC! Exit");
 
     return TRUE;
 }
 
+//
+// Adds an upper interrupt-IN request to the pending ring. If a report was
+// read while no request was pending, the request gets completed with it
+// right away instead.
+// 
+NTSTATUS XnaGuardianHidUsbQueueInterruptRequest(
+    WDFDEVICE Device,
+    WDFREQUEST Request
+)
+{
+    NTSTATUS            status;
+    PDEVICE_CONTEXT     pDeviceContext;
+    UCHAR               report[XNA_LATEST_REPORT_MAX_LENGTH];
+    ULONG               reportLength;
+    ULONGLONG           reportTime;
+    WDFREQUEST          pendingRequest;
+
+    pDeviceContext = DeviceGetContext(Device);
+
+    if (TakeLatestReport(pDeviceContext, report, &reportLength, &reportTime))
+    {
+        CompleteUpperUsbRequest(pDeviceContext, Request, report, reportLength, reportTime);
+        return STATUS_SUCCESS;
+    }
+
+    status = UpperUsbRequestPush(pDeviceContext, Request);
+    if (!NT_SUCCESS(status))
+    {
+        return status;
+    }
+
+    //
+    // The reader may have stored a report after the check above but before
+    // it could see the request. Pairs with the barrier in
+    // XnaGuardianEvtUsbTargetPipeReadComplete, one side sees the other.
+    // 
+    KeMemoryBarrier();
+
+    //
+    // Without a request left the reader got it and completes it with the
+    // same report, so the copy taken here is not lost
+    // 
+    if (pDeviceContext->LatestReport.Length > 0
+        && TakeLatestReport(pDeviceContext, report, &reportLength, &reportTime)
+        && UpperUsbRequestPop(pDeviceContext, &pendingRequest))
+    {
+        CompleteUpperUsbRequest(pDeviceContext, pendingRequest, report, reportLength, reportTime);
+    }
+
+    return STATUS_SUCCESS;
+}
+
+//
+// Applies the overrides of a pad to a HID USB input report, in ascending
+// precedence: effective layers, scheduled overrides evaluated at Time and
+// the shared memory mailbox.
+// 
+VOID XnaGuardianHidUsbApplyOverrides(
+    UCHAR UserIndex,
+    ULONGLONG Time,
+    PUCHAR Buffer,
+    ULONG BufferLength
+)
+{
+    XINPUT_PAD_STATE_INTERNAL       pad;
+    XINPUT_PAD_STATE_INTERNAL       scheduled;
+    XINPUT_PAD_STATE_INTERNAL       mailbox;
+
+    XInputOverrideLayersGetEffective(UserIndex, &pad);
+
+    KdPrint((DRIVERNAME "BUTTON_OVERRIDES: 0x%X\n", pad.Gamepad.wButtons));
+
+    XINPUT_GAMEPAD_TO_HID_USB_INPUT_REPORT(&pad, Buffer, BufferLength);
+
+    if (XInputOverrideScheduleGet(UserIndex, Time, &scheduled))
+    {
+        XINPUT_GAMEPAD_TO_HID_USB_INPUT_REPORT(&scheduled, Buffer, BufferLength);
+    }
+
+    if (XnaGuardianMailboxGet(UserIndex, &mailbox))
+    {
+        XINPUT_GAMEPAD_TO_HID_USB_INPUT_REPORT(&mailbox, Buffer, BufferLength);
+    }
+}
+
 VOID XnaGuardianEvtUsbTargetPipeReadComplete(
     _In_ WDFUSBPIPE Pipe,
     _In_ WDFMEMORY  Buffer,
@@ -87,39 +396,97 @@ VOID XnaGuardianEvtUsbTargetPipeReadComplete(
     _In_ WDFCONTEXT Context
 )
 {
+    PDEVICE_CONTEXT                 pDeviceContext;
     PUCHAR                          pLowerBuffer;
     ULONG                           index;
-    PXINPUT_PAD_STATE_INTERNAL      pPad;
+    ULONGLONG                       completionTime;
     WDFREQUEST                      Request;
     PUCHAR                          pUpperBuffer;
     ULONG                           upperBufferLength;
     size_t                          lowerBufferLength;
-    PX360_HID_USB_INPUT_REPORT      pX360Report;
-    PXBONE_HID_USB_INPUT_REPORT     pXboneReport;
+    ULONG                           reportLength;
+    XINPUT_GAMEPAD_STATE            gamepad;
 
     UNREFERENCED_PARAMETER(Pipe);
-    UNREFERENCED_PARAMETER(pX360Report);
 
     TraceEvents(TRACE_LEVEL_INFORMATION, TRACE_HIDUSB, "%!FUNC! Entry");
 
-    if (!GetUpperUsbRequest(Context, &Request, &pUpperBuffer, &upperBufferLength)) return;
+    //
+    // Scheduled overrides are evaluated at the time the report arrived
+    // 
+    completionTime = KeQueryUnbiasedInterruptTime();
 
+    pDeviceContext = DeviceGetContext(Context);
     pLowerBuffer = WdfMemoryGetBuffer(Buffer, NULL);
     lowerBufferLength = NumBytesTransferred;
 
     //
-    // Map XInput user index to HID USB device by using device arrival order
+    // The slot assigned on arrival is the XInput user index
+    // 
+    index = pDeviceContext->HidUsbSlot;
+
+    //
+    // Cache the values of the physical pad for use in peek call, decoded
+    // straight from the lower buffer so coalesced reports are seen as well
     // 
-    for (index = 0; index < XINPUT_MAX_DEVICES && index < WdfCollectionGetCount(HidUsbDeviceCollection); index++)
+    if (index < XINPUT_MAX_DEVICES
+        && XINPUT_GAMEPAD_FROM_HID_USB_INPUT_REPORT(pLowerBuffer, lowerBufferLength, &gamepad))
     {
-        if (WdfCollectionGetItem(HidUsbDeviceCollection, index) == Context)
+        PeekPadCacheUpdate((UCHAR)index, &gamepad);
+    }
+
+    //
+    // Without a pending upper request the report is kept for the next one,
+    // replacing an older report not picked up yet
+    // 
+    if (!UpperUsbRequestPop(pDeviceContext, &Request))
+    {
+        URB_QUEUE_LOCK();
+        XNA_LATEST_REPORT_STORE(&pDeviceContext->LatestReport, pLowerBuffer, (ULONG)lowerBufferLength, completionTime);
+        URB_QUEUE_UNLOCK();
+
+        //
+        // Pairs with the barrier in XnaGuardianHidUsbQueueInterruptRequest,
+        // a request pushed meanwhile must not wait for the next report
+        // 
+        KeMemoryBarrier();
+
+        if (!UpperUsbRequestPop(pDeviceContext, &Request))
         {
-            KdPrint((DRIVERNAME "HID USB Device 0x%X found at index %d\n", Context, index));
-            break;
+            TraceEvents(TRACE_LEVEL_VERBOSE, TRACE_HIDUSB, "%!FUNC! Exit - report stored, %d coalesced and %d dropped so far",
+                pDeviceContext->LatestReport.Coalesced, pDeviceContext->LatestReport.Dropped);
+            return;
         }
+
+        //
+        // Delivered right below, it must not be handed out a second time
+        // 
+        URB_QUEUE_LOCK();
+        XNA_LATEST_REPORT_DISCARD(&pDeviceContext->LatestReport);
+        URB_QUEUE_UNLOCK();
     }
 
-    RtlCopyBytes(pUpperBuffer, pLowerBuffer, upperBufferLength);
+    GetUpperUsbTransferBuffer(Request, &pUpperBuffer, &upperBufferLength);
+
+    //
+    // The transfer length is configurable, never read past either buffer
+    // 
+    reportLength = (ULONG)min(lowerBufferLength, upperBufferLength);
+
+    RtlCopyBytes(pUpperBuffer, pLowerBuffer, reportLength);
+    SetUpperUsbTransferLength(Request, reportLength);
+
+    //
+    // The peek cache decoded the transferred length, overrides key on the
+    // same one so a truncated report is passed through unchanged
+    // 
+    if (reportLength != lowerBufferLength)
+    {
+        TraceEvents(TRACE_LEVEL_WARNING, TRACE_HIDUSB, "%!FUNC! Exit - Report of length %d truncated to %d",
+            (ULONG)lowerBufferLength, reportLength);
+        WdfRequestComplete(Request, STATUS_SUCCESS);
+        return;
+    }
 
     //
     // Validate range
@@ -133,23 +500,9 @@ VOID XnaGuardianEvtUsbTargetPipeReadComplete(
 
     TraceEvents(TRACE_LEVEL_INFORMATION, TRACE_HIDUSB, "Pad index %d", index);
 
-    pPad = &PadStates[index];
-
-    //
-    // Cache the values of the physical pad for use in peek call
-    // 
-    // TODO: fix
-    //RtlCopyBytes(&PeekPadCache[index], pGamepad, sizeof(XINPUT_GAMEPAD_STATE));
-
-    if (upperBufferLength == XBONE_HID_USB_INPUT_REPORT_BUFFER_LENGTH)
-    {
-        TraceEvents(TRACE_LEVEL_INFORMATION, TRACE_HIDUSB, "Report is XBONE Report");
-        KdPrint((DRIVERNAME "BUTTON_OVERRIDES: 0x%X\n", pPad->Gamepad.wButtons));
-
-        pXboneReport = (PXBONE_HID_USB_INPUT_REPORT)pUpperBuffer;
+    TraceEvents(TRACE_LEVEL_INFORMATION, TRACE_HIDUSB, "Report length %d", reportLength);
 
-        XINPUT_GAMEPAD_TO_XBONE_HID_USB_INPUT_REPORT(pPad, pXboneReport);
-    }
+    XnaGuardianHidUsbApplyOverrides((UCHAR)index, completionTime, pUpperBuffer, reportLength);
 
 #ifdef DBG
     KdPrint((DRIVERNAME "BUFFER_UP: "));
@@ -26,23 +26,50 @@ SOFTWARE.
 #pragma once
 
 #include <limits.h>
+#include "ViGEmLut.h"
+#include "ViGEmDpad.h"
 
 #define X360_HID_USB_INPUT_REPORT_BUFFER_LENGTH     0x0E
 #define XBONE_HID_USB_INPUT_REPORT_BUFFER_LENGTH    0x11
+#define HID_USB_INPUT_REPORT_MAX_LENGTH             XBONE_HID_USB_INPUT_REPORT_BUFFER_LENGTH
 #define XBONE_HID_USB_THUMB_AXIS_OFFSET             ((USHRT_MAX / 2) + 1)
+#define X360_HID_USB_THUMB_AXIS_OFFSET              ((USHRT_MAX / 2) + 1)
+#define X360_HID_USB_Z_AXIS_CENTER                  0x8000
+#define X360_HID_USB_Z_AXIS_TRIGGER_SCALE           0x80
+#define X360_HID_USB_DPAD_SHIFT                     10
+#define X360_HID_USB_DPAD_MASK                      (VIGEM_DPAD_MASK << X360_HID_USB_DPAD_SHIFT)
 
 
+//
+// Layout described in Research/XUSB_XGIB_HID_USB_Notes.txt, the thumb axes
+// are unsigned and centered at X360_HID_USB_THUMB_AXIS_OFFSET like the XBONE
+// ones, the triggers share the Z axis.
+//
 typedef struct _X360_HID_USB_INPUT_REPORT
 {
-    SHORT LeftThumbX;
-    SHORT LeftThumbY;
-    SHORT RightThumbX;
-    SHORT RightThumbY;
+    USHORT LeftThumbX;
+    USHORT LeftThumbY;
+    USHORT RightThumbX;
+    USHORT RightThumbY;
     UCHAR ZAxisEngaged; // 0x00 default, 0x80 engaged
     UCHAR ZAxis; // 0x80 default
-    USHORT Buttons;
+    USHORT Buttons; // buttons in bits 0-9, D-PAD HAT (XBONE values) in bits 10-13
 } X360_HID_USB_INPUT_REPORT, *PX360_HID_USB_INPUT_REPORT;
 
+typedef enum _X360_HID_USB_INPUT_REPORT_BUTTONS
+{
+    X360_HID_USB_INPUT_REPORT_BUTTON_A = 0x0001,
+    X360_HID_USB_INPUT_REPORT_BUTTON_B = 0x0002,
+    X360_HID_USB_INPUT_REPORT_BUTTON_X = 0x0004,
+    X360_HID_USB_INPUT_REPORT_BUTTON_Y = 0x0008,
+    X360_HID_USB_INPUT_REPORT_BUTTON_LEFT_SHOULDER = 0x0010,
+    X360_HID_USB_INPUT_REPORT_BUTTON_RIGHT_SHOULDER = 0x0020,
+    X360_HID_USB_INPUT_REPORT_BUTTON_BACK = 0x0040,
+    X360_HID_USB_INPUT_REPORT_BUTTON_START = 0x0080,
+    X360_HID_USB_INPUT_REPORT_BUTTON_LEFT_THUMB = 0x0100,
+    X360_HID_USB_INPUT_REPORT_BUTTON_RIGHT_THUMB = 0x0200
+} X360_HID_USB_INPUT_REPORT_BUTTONS, *PX360_HID_USB_INPUT_REPORT_BUTTONS;
+
 typedef struct _XBONE_HID_USB_INPUT_REPORT
 {
     USHORT LeftThumbX;
@@ -84,6 +111,15 @@ typedef enum _XBONE_HID_USB_INPUT_REPORT_DPAD
 
 EVT_WDF_USB_READER_COMPLETION_ROUTINE XnaGuardianEvtUsbTargetPipeReadComplete;
 
+BOOLEAN UpperUsbRequestPop(
+    _In_ PDEVICE_CONTEXT DeviceContext,
+    _Out_ WDFREQUEST* Request
+);
+
+VOID UpperUsbRequestCancelAll(
+    _In_ PDEVICE_CONTEXT DeviceContext
+);
+
 BOOLEAN GetUpperUsbRequest(
     WDFDEVICE Device,
     WDFREQUEST* PendingRequest,
@@ -91,102 +127,323 @@ BOOLEAN GetUpperUsbRequest(
     PULONG BufferLength
 );
 
+NTSTATUS XnaGuardianHidUsbQueueInterruptRequest(
+    _In_ WDFDEVICE Device,
+    _In_ WDFREQUEST Request
+);
+
+VOID XnaGuardianHidUsbApplyOverrides(
+    _In_ UCHAR UserIndex,
+    _In_ ULONGLONG Time,
+    _Inout_updates_bytes_(BufferLength) PUCHAR Buffer,
+    _In_ ULONG BufferLength
+);
+
+//
+// Maps XInput buttons to XBONE HID USB buttons. The override bits of the
+// buttons share the layout of XINPUT_GAMEPAD_STATE.wButtons, so the same
+// mapping translates both the button values and their override mask.
+//
+#define XINPUT_TO_XBONE_HID_USB_BUTTONS(_buttons_) (USHORT)(                                                    \
+    (((_buttons_) & XINPUT_GAMEPAD_A)               ? XBONE_HID_USB_INPUT_REPORT_BUTTON_A               : 0) |  \
+    (((_buttons_) & XINPUT_GAMEPAD_B)               ? XBONE_HID_USB_INPUT_REPORT_BUTTON_B               : 0) |  \
+    (((_buttons_) & XINPUT_GAMEPAD_X)               ? XBONE_HID_USB_INPUT_REPORT_BUTTON_X               : 0) |  \
+    (((_buttons_) & XINPUT_GAMEPAD_Y)               ? XBONE_HID_USB_INPUT_REPORT_BUTTON_Y               : 0) |  \
+    (((_buttons_) & XINPUT_GAMEPAD_LEFT_SHOULDER)   ? XBONE_HID_USB_INPUT_REPORT_BUTTON_LEFT_SHOULDER   : 0) |  \
+    (((_buttons_) & XINPUT_GAMEPAD_RIGHT_SHOULDER)  ? XBONE_HID_USB_INPUT_REPORT_BUTTON_RIGHT_SHOULDER  : 0) |  \
+    (((_buttons_) & XINPUT_GAMEPAD_START)           ? XBONE_HID_USB_INPUT_REPORT_BUTTON_START           : 0) |  \
+    (((_buttons_) & XINPUT_GAMEPAD_BACK)            ? XBONE_HID_USB_INPUT_REPORT_BUTTON_BACK            : 0) |  \
+    (((_buttons_) & XINPUT_GAMEPAD_LEFT_THUMB)      ? XBONE_HID_USB_INPUT_REPORT_BUTTON_LEFT_THUMB      : 0) |  \
+    (((_buttons_) & XINPUT_GAMEPAD_RIGHT_THUMB)     ? XBONE_HID_USB_INPUT_REPORT_BUTTON_RIGHT_THUMB     : 0))
+
+#define XINPUT_TO_XBONE_HID_USB_BUTTONS_LOW_ENTRY(_index_)  XINPUT_TO_XBONE_HID_USB_BUTTONS(_index_)
+#define XINPUT_TO_XBONE_HID_USB_BUTTONS_HIGH_ENTRY(_index_) XINPUT_TO_XBONE_HID_USB_BUTTONS((_index_) << 8)
+
+//
+// XBONE HID USB buttons indexed by the low and high byte of XInput buttons.
+//
+extern const USHORT XInputToXboneHidUsbButtonsLow[256];
+extern const USHORT XInputToXboneHidUsbButtonsHigh[256];
+
+//
+// Maps XInput buttons to X360 HID USB buttons, bits above the ten buttons are left untouched.
+//
+#define XINPUT_TO_X360_HID_USB_BUTTONS(_buttons_) (USHORT)(                                                     \
+    (((_buttons_) & XINPUT_GAMEPAD_A)               ? X360_HID_USB_INPUT_REPORT_BUTTON_A                : 0) |  \
+    (((_buttons_) & XINPUT_GAMEPAD_B)               ? X360_HID_USB_INPUT_REPORT_BUTTON_B                : 0) |  \
+    (((_buttons_) & XINPUT_GAMEPAD_X)               ? X360_HID_USB_INPUT_REPORT_BUTTON_X                : 0) |  \
+    (((_buttons_) & XINPUT_GAMEPAD_Y)               ? X360_HID_USB_INPUT_REPORT_BUTTON_Y                : 0) |  \
+    (((_buttons_) & XINPUT_GAMEPAD_LEFT_SHOULDER)   ? X360_HID_USB_INPUT_REPORT_BUTTON_LEFT_SHOULDER    : 0) |  \
+    (((_buttons_) & XINPUT_GAMEPAD_RIGHT_SHOULDER)  ? X360_HID_USB_INPUT_REPORT_BUTTON_RIGHT_SHOULDER   : 0) |  \
+    (((_buttons_) & XINPUT_GAMEPAD_BACK)            ? X360_HID_USB_INPUT_REPORT_BUTTON_BACK             : 0) |  \
+    (((_buttons_) & XINPUT_GAMEPAD_START)           ? X360_HID_USB_INPUT_REPORT_BUTTON_START            : 0) |  \
+    (((_buttons_) & XINPUT_GAMEPAD_LEFT_THUMB)      ? X360_HID_USB_INPUT_REPORT_BUTTON_LEFT_THUMB       : 0) |  \
+    (((_buttons_) & XINPUT_GAMEPAD_RIGHT_THUMB)     ? X360_HID_USB_INPUT_REPORT_BUTTON_RIGHT_THUMB      : 0))
+
+#define XINPUT_TO_X360_HID_USB_BUTTONS_LOW_ENTRY(_index_)   XINPUT_TO_X360_HID_USB_BUTTONS(_index_)
+#define XINPUT_TO_X360_HID_USB_BUTTONS_HIGH_ENTRY(_index_)  XINPUT_TO_X360_HID_USB_BUTTONS((_index_) << 8)
+
+//
+// X360 HID USB buttons indexed by the low and high byte of XInput buttons.
+//
+extern const USHORT XInputToX360HidUsbButtonsLow[256];
+extern const USHORT XInputToX360HidUsbButtonsHigh[256];
+
+//
+// Returns all bits set if the given override bit is set, zero otherwise.
+//
+#define XINPUT_GAMEPAD_OVERRIDE_MASK(_overrides_, _override_) \
+    ((USHORT)(0 - (USHORT)(((_overrides_) & (_override_)) != 0)))
+
+//
+// Replaces the bits of _target_ selected by _mask_ with the bits of _value_.
+//
+#define XINPUT_GAMEPAD_MERGE_MASKED(_target_, _value_, _mask_) \
+    (_target_) = (USHORT)(((_target_) & ~(_mask_)) | ((_value_) & (_mask_)))
+
 VOID FORCEINLINE XINPUT_GAMEPAD_TO_XBONE_HID_USB_INPUT_REPORT(
     PXINPUT_PAD_STATE_INTERNAL pPad,
     PXBONE_HID_USB_INPUT_REPORT pXboneReport
 )
 {
+    ULONG overrides = pPad->Overrides;
+    USHORT wButtons = pPad->Gamepad.wButtons;
+    USHORT buttons;
+    USHORT mask;
+    UCHAR dpad;
+
+    // Left Thumb Axes
+    XINPUT_GAMEPAD_MERGE_MASKED(pXboneReport->LeftThumbX,
+        pPad->Gamepad.sThumbLX + XBONE_HID_USB_THUMB_AXIS_OFFSET,
+        XINPUT_GAMEPAD_OVERRIDE_MASK(overrides, XINPUT_GAMEPAD_OVERRIDE_LEFT_THUMB_X));
+    XINPUT_GAMEPAD_MERGE_MASKED(pXboneReport->LeftThumbY,
+        pPad->Gamepad.sThumbLY + XBONE_HID_USB_THUMB_AXIS_OFFSET,
+        XINPUT_GAMEPAD_OVERRIDE_MASK(overrides, XINPUT_GAMEPAD_OVERRIDE_LEFT_THUMB_Y));
+
+    // Right Thumb Axes
+    XINPUT_GAMEPAD_MERGE_MASKED(pXboneReport->RightThumbX,
+        pPad->Gamepad.sThumbRX + XBONE_HID_USB_THUMB_AXIS_OFFSET,
+        XINPUT_GAMEPAD_OVERRIDE_MASK(overrides, XINPUT_GAMEPAD_OVERRIDE_RIGHT_THUMB_X));
+    XINPUT_GAMEPAD_MERGE_MASKED(pXboneReport->RightThumbY,
+        pPad->Gamepad.sThumbRY + XBONE_HID_USB_THUMB_AXIS_OFFSET,
+        XINPUT_GAMEPAD_OVERRIDE_MASK(overrides, XINPUT_GAMEPAD_OVERRIDE_RIGHT_THUMB_Y));
+
+    // Triggers (10-bit, precomputed when the override was set)
+    XINPUT_GAMEPAD_MERGE_MASKED(pXboneReport->LeftTrigger,
+        pPad->LeftTrigger,
+        XINPUT_GAMEPAD_OVERRIDE_MASK(overrides, XINPUT_GAMEPAD_OVERRIDE_LEFT_TRIGGER));
+    XINPUT_GAMEPAD_MERGE_MASKED(pXboneReport->RightTrigger,
+        pPad->RightTrigger,
+        XINPUT_GAMEPAD_OVERRIDE_MASK(overrides, XINPUT_GAMEPAD_OVERRIDE_RIGHT_TRIGGER));
+
+    // Buttons
+    buttons = XInputToXboneHidUsbButtonsLow[wButtons & 0xFF]
+        | XInputToXboneHidUsbButtonsHigh[wButtons >> 8];
+    mask = XInputToXboneHidUsbButtonsLow[overrides & 0xFF]
+        | XInputToXboneHidUsbButtonsHigh[(overrides >> 8) & 0xFF];
+
+    XINPUT_GAMEPAD_MERGE_MASKED(pXboneReport->Buttons, buttons, mask);
+
+    // D-PAD (merged as direction bits, the HAT is left untouched without override)
+    mask = (USHORT)(overrides & VIGEM_DPAD_MASK);
+    buttons = VIGEM_XBONE_HAT_TO_DPAD_MASK[pXboneReport->Dpad & VIGEM_DPAD_MASK];
+    buttons = (USHORT)((buttons & ~mask) | (wButtons & mask));
+    dpad = (UCHAR)(0 - (mask != 0));
+
+    pXboneReport->Dpad = (UCHAR)((pXboneReport->Dpad & ~dpad)
+        | (VIGEM_DPAD_MASK_TO_XBONE_HAT[buttons] & dpad));
+}
+
+//
+// The X360 HID report shares a single Z axis between both triggers: it rests
+// at 0x8000 (ZAxis 0x80, ZAxisEngaged 0x00), the left trigger moves it up
+// and the right trigger moves it down. Only the difference of both triggers
+// is reported, so the physical values are recovered from its sign.
+//
+VOID FORCEINLINE XINPUT_GAMEPAD_TO_X360_HID_USB_INPUT_REPORT(
+    PXINPUT_PAD_STATE_INTERNAL pPad,
+    PX360_HID_USB_INPUT_REPORT pX360Report
+)
+{
+    ULONG overrides = pPad->Overrides;
+    USHORT wButtons = pPad->Gamepad.wButtons;
+    USHORT buttons;
+    USHORT mask;
+    LONG zAxis;
+    LONG delta;
+    LONG leftTrigger;
+    LONG rightTrigger;
+    LONG leftMask;
+    LONG rightMask;
+
     // Left Thumb Axes
-    if (pPad->Overrides & XINPUT_GAMEPAD_OVERRIDE_LEFT_THUMB_X)
-        pXboneReport->LeftThumbX = pPad->Gamepad.sThumbLX + XBONE_HID_USB_THUMB_AXIS_OFFSET;
-    if (pPad->Overrides & XINPUT_GAMEPAD_OVERRIDE_LEFT_THUMB_Y)
-        pXboneReport->LeftThumbY = pPad->Gamepad.sThumbLY + XBONE_HID_USB_THUMB_AXIS_OFFSET;
+    XINPUT_GAMEPAD_MERGE_MASKED(pX360Report->LeftThumbX,
+        pPad->Gamepad.sThumbLX + X360_HID_USB_THUMB_AXIS_OFFSET,
+        XINPUT_GAMEPAD_OVERRIDE_MASK(overrides, XINPUT_GAMEPAD_OVERRIDE_LEFT_THUMB_X));
+    XINPUT_GAMEPAD_MERGE_MASKED(pX360Report->LeftThumbY,
+        pPad->Gamepad.sThumbLY + X360_HID_USB_THUMB_AXIS_OFFSET,
+        XINPUT_GAMEPAD_OVERRIDE_MASK(overrides, XINPUT_GAMEPAD_OVERRIDE_LEFT_THUMB_Y));
 
     // Right Thumb Axes
-    if (pPad->Overrides & XINPUT_GAMEPAD_OVERRIDE_RIGHT_THUMB_X)
-        pXboneReport->RightThumbX = pPad->Gamepad.sThumbRX + XBONE_HID_USB_THUMB_AXIS_OFFSET;
-    if (pPad->Overrides & XINPUT_GAMEPAD_OVERRIDE_RIGHT_THUMB_Y)
-        pXboneReport->RightThumbY = pPad->Gamepad.sThumbRY + XBONE_HID_USB_THUMB_AXIS_OFFSET;
+    XINPUT_GAMEPAD_MERGE_MASKED(pX360Report->RightThumbX,
+        pPad->Gamepad.sThumbRX + X360_HID_USB_THUMB_AXIS_OFFSET,
+        XINPUT_GAMEPAD_OVERRIDE_MASK(overrides, XINPUT_GAMEPAD_OVERRIDE_RIGHT_THUMB_X));
+    XINPUT_GAMEPAD_MERGE_MASKED(pX360Report->RightThumbY,
+        pPad->Gamepad.sThumbRY + X360_HID_USB_THUMB_AXIS_OFFSET,
+        XINPUT_GAMEPAD_OVERRIDE_MASK(overrides, XINPUT_GAMEPAD_OVERRIDE_RIGHT_THUMB_Y));
+
+    // Triggers
+    zAxis = (LONG)pX360Report->ZAxis << 8 | pX360Report->ZAxisEngaged;
+    delta = zAxis - X360_HID_USB_Z_AXIS_CENTER;
+    leftTrigger = (delta & ~(delta >> 31)) / X360_HID_USB_Z_AXIS_TRIGGER_SCALE;
+    rightTrigger = (-delta & (delta >> 31)) / X360_HID_USB_Z_AXIS_TRIGGER_SCALE;
+    leftMask = -(LONG)((overrides & XINPUT_GAMEPAD_OVERRIDE_LEFT_TRIGGER) != 0);
+    rightMask = -(LONG)((overrides & XINPUT_GAMEPAD_OVERRIDE_RIGHT_TRIGGER) != 0);
+    leftTrigger = (leftTrigger & ~leftMask) | (pPad->Gamepad.bLeftTrigger & leftMask);
+    rightTrigger = (rightTrigger & ~rightMask) | (pPad->Gamepad.bRightTrigger & rightMask);
+    delta = (leftTrigger - rightTrigger) * X360_HID_USB_Z_AXIS_TRIGGER_SCALE;
+    zAxis = (zAxis & ~(leftMask | rightMask))
+        | ((X360_HID_USB_Z_AXIS_CENTER + delta) & (leftMask | rightMask));
+    pX360Report->ZAxisEngaged = (UCHAR)zAxis;
+    pX360Report->ZAxis = (UCHAR)(zAxis >> 8);
+
+    // Buttons
+    buttons = XInputToX360HidUsbButtonsLow[wButtons & 0xFF]
+        | XInputToX360HidUsbButtonsHigh[wButtons >> 8];
+    mask = XInputToX360HidUsbButtonsLow[overrides & 0xFF]
+        | XInputToX360HidUsbButtonsHigh[(overrides >> 8) & 0xFF];
+
+    XINPUT_GAMEPAD_MERGE_MASKED(pX360Report->Buttons, buttons, mask);
+
+    // D-PAD (a HAT encoded like the XBONE one, merged as direction bits)
+    mask = (USHORT)(overrides & VIGEM_DPAD_MASK);
+    buttons = VIGEM_XBONE_HAT_TO_DPAD_MASK[(pX360Report->Buttons >> X360_HID_USB_DPAD_SHIFT) & VIGEM_DPAD_MASK];
+    buttons = (USHORT)((buttons & ~mask) | (wButtons & mask));
+    mask = (USHORT)(0 - (mask != 0)) & X360_HID_USB_DPAD_MASK;
 
-    // Left Trigger
-    if (pPad->Overrides & XINPUT_GAMEPAD_OVERRIDE_LEFT_TRIGGER)
+    XINPUT_GAMEPAD_MERGE_MASKED(pX360Report->Buttons,
+        (USHORT)VIGEM_DPAD_MASK_TO_XBONE_HAT[buttons] << X360_HID_USB_DPAD_SHIFT,
+        mask);
+}
+
+//
+// Applies the pad overrides to an upper HID USB input report, dispatched by
+// report length. Reports of unknown length are passed through untouched.
+//
+VOID FORCEINLINE XINPUT_GAMEPAD_TO_HID_USB_INPUT_REPORT(
+    PXINPUT_PAD_STATE_INTERNAL pPad,
+    PUCHAR Buffer,
+    ULONG BufferLength
+)
+{
+    switch (BufferLength)
     {
-        pXboneReport->LeftTrigger = pPad->Gamepad.bLeftTrigger * 4;
+    case X360_HID_USB_INPUT_REPORT_BUFFER_LENGTH:
+        XINPUT_GAMEPAD_TO_X360_HID_USB_INPUT_REPORT(pPad, (PX360_HID_USB_INPUT_REPORT)Buffer);
+        break;
+    case XBONE_HID_USB_INPUT_REPORT_BUFFER_LENGTH:
+        XINPUT_GAMEPAD_TO_XBONE_HID_USB_INPUT_REPORT(pPad, (PXBONE_HID_USB_INPUT_REPORT)Buffer);
+        break;
+    default:
+        break;
     }
+}
+
+//
+// Maps XBONE HID USB buttons to XInput buttons, the D-PAD is reported separately.
+//
+#define XBONE_HID_USB_TO_XINPUT_BUTTONS(_buttons_) (USHORT)(                                                    \
+    (((_buttons_) & XBONE_HID_USB_INPUT_REPORT_BUTTON_A)                ? XINPUT_GAMEPAD_A              : 0) |  \
+    (((_buttons_) & XBONE_HID_USB_INPUT_REPORT_BUTTON_B)                ? XINPUT_GAMEPAD_B              : 0) |  \
+    (((_buttons_) & XBONE_HID_USB_INPUT_REPORT_BUTTON_X)                ? XINPUT_GAMEPAD_X              : 0) |  \
+    (((_buttons_) & XBONE_HID_USB_INPUT_REPORT_BUTTON_Y)                ? XINPUT_GAMEPAD_Y              : 0) |  \
+    (((_buttons_) & XBONE_HID_USB_INPUT_REPORT_BUTTON_LEFT_SHOULDER)    ? XINPUT_GAMEPAD_LEFT_SHOULDER  : 0) |  \
+    (((_buttons_) & XBONE_HID_USB_INPUT_REPORT_BUTTON_RIGHT_SHOULDER)   ? XINPUT_GAMEPAD_RIGHT_SHOULDER : 0) |  \
+    (((_buttons_) & XBONE_HID_USB_INPUT_REPORT_BUTTON_START)            ? XINPUT_GAMEPAD_START          : 0) |  \
+    (((_buttons_) & XBONE_HID_USB_INPUT_REPORT_BUTTON_BACK)             ? XINPUT_GAMEPAD_BACK           : 0) |  \
+    (((_buttons_) & XBONE_HID_USB_INPUT_REPORT_BUTTON_LEFT_THUMB)       ? XINPUT_GAMEPAD_LEFT_THUMB     : 0) |  \
+    (((_buttons_) & XBONE_HID_USB_INPUT_REPORT_BUTTON_RIGHT_THUMB)      ? XINPUT_GAMEPAD_RIGHT_THUMB    : 0))
+
+//
+// Maps X360 HID USB buttons to XInput buttons.
+//
+#define X360_HID_USB_TO_XINPUT_BUTTONS(_buttons_) (USHORT)(                                                     \
+    (((_buttons_) & X360_HID_USB_INPUT_REPORT_BUTTON_A)                 ? XINPUT_GAMEPAD_A              : 0) |  \
+    (((_buttons_) & X360_HID_USB_INPUT_REPORT_BUTTON_B)                 ? XINPUT_GAMEPAD_B              : 0) |  \
+    (((_buttons_) & X360_HID_USB_INPUT_REPORT_BUTTON_X)                 ? XINPUT_GAMEPAD_X              : 0) |  \
+    (((_buttons_) & X360_HID_USB_INPUT_REPORT_BUTTON_Y)                 ? XINPUT_GAMEPAD_Y              : 0) |  \
+    (((_buttons_) & X360_HID_USB_INPUT_REPORT_BUTTON_LEFT_SHOULDER)     ? XINPUT_GAMEPAD_LEFT_SHOULDER  : 0) |  \
+    (((_buttons_) & X360_HID_USB_INPUT_REPORT_BUTTON_RIGHT_SHOULDER)    ? XINPUT_GAMEPAD_RIGHT_SHOULDER : 0) |  \
+    (((_buttons_) & X360_HID_USB_INPUT_REPORT_BUTTON_BACK)              ? XINPUT_GAMEPAD_BACK           : 0) |  \
+    (((_buttons_) & X360_HID_USB_INPUT_REPORT_BUTTON_START)             ? XINPUT_GAMEPAD_START          : 0) |  \
+    (((_buttons_) & X360_HID_USB_INPUT_REPORT_BUTTON_LEFT_THUMB)        ? XINPUT_GAMEPAD_LEFT_THUMB     : 0) |  \
+    (((_buttons_) & X360_HID_USB_INPUT_REPORT_BUTTON_RIGHT_THUMB)       ? XINPUT_GAMEPAD_RIGHT_THUMB    : 0))
 
-    // Right Trigger
-    if (pPad->Overrides & XINPUT_GAMEPAD_OVERRIDE_RIGHT_TRIGGER)
+//
+// Decodes a lower XBONE HID USB input report in place, the inverse of
+// XINPUT_GAMEPAD_TO_XBONE_HID_USB_INPUT_REPORT without overrides.
+//
+VOID FORCEINLINE XBONE_HID_USB_INPUT_REPORT_TO_XINPUT_GAMEPAD(
+    const XBONE_HID_USB_INPUT_REPORT* pXboneReport,
+    PXINPUT_GAMEPAD_STATE pGamepad
+)
+{
+    pGamepad->sThumbLX = (SHORT)(pXboneReport->LeftThumbX - XBONE_HID_USB_THUMB_AXIS_OFFSET);
+    pGamepad->sThumbLY = (SHORT)(pXboneReport->LeftThumbY - XBONE_HID_USB_THUMB_AXIS_OFFSET);
+    pGamepad->sThumbRX = (SHORT)(pXboneReport->RightThumbX - XBONE_HID_USB_THUMB_AXIS_OFFSET);
+    pGamepad->sThumbRY = (SHORT)(pXboneReport->RightThumbY - XBONE_HID_USB_THUMB_AXIS_OFFSET);
+
+    pGamepad->bLeftTrigger = XINPUT_TRIGGER_FROM_HIGH_RES(min(pXboneReport->LeftTrigger, XINPUT_HIGH_RES_TRIGGER_MAX));
+    pGamepad->bRightTrigger = XINPUT_TRIGGER_FROM_HIGH_RES(min(pXboneReport->RightTrigger, XINPUT_HIGH_RES_TRIGGER_MAX));
+
+    pGamepad->wButtons = XBONE_HID_USB_TO_XINPUT_BUTTONS(pXboneReport->Buttons)
+        | VIGEM_XBONE_HAT_TO_DPAD_MASK[pXboneReport->Dpad & VIGEM_DPAD_MASK];
+}
+
+//
+// Decodes a lower X360 HID USB input report in place. The triggers share the
+// Z axis, so at most one of them is reported as pressed.
+//
+VOID FORCEINLINE X360_HID_USB_INPUT_REPORT_TO_XINPUT_GAMEPAD(
+    const X360_HID_USB_INPUT_REPORT* pX360Report,
+    PXINPUT_GAMEPAD_STATE pGamepad
+)
+{
+    LONG delta;
+
+    pGamepad->sThumbLX = (SHORT)(pX360Report->LeftThumbX - X360_HID_USB_THUMB_AXIS_OFFSET);
+    pGamepad->sThumbLY = (SHORT)(pX360Report->LeftThumbY - X360_HID_USB_THUMB_AXIS_OFFSET);
+    pGamepad->sThumbRX = (SHORT)(pX360Report->RightThumbX - X360_HID_USB_THUMB_AXIS_OFFSET);
+    pGamepad->sThumbRY = (SHORT)(pX360Report->RightThumbY - X360_HID_USB_THUMB_AXIS_OFFSET);
+
+    delta = ((LONG)pX360Report->ZAxis << 8 | pX360Report->ZAxisEngaged) - X360_HID_USB_Z_AXIS_CENTER;
+    pGamepad->bLeftTrigger = (BYTE)min((delta & ~(delta >> 31)) / X360_HID_USB_Z_AXIS_TRIGGER_SCALE, UCHAR_MAX);
+    pGamepad->bRightTrigger = (BYTE)min((-delta & (delta >> 31)) / X360_HID_USB_Z_AXIS_TRIGGER_SCALE, UCHAR_MAX);
+
+    pGamepad->wButtons = X360_HID_USB_TO_XINPUT_BUTTONS(pX360Report->Buttons)
+        | VIGEM_XBONE_HAT_TO_DPAD_MASK[(pX360Report->Buttons >> X360_HID_USB_DPAD_SHIFT) & VIGEM_DPAD_MASK];
+}
+
+//
+// Decodes a lower HID USB input report into the physical pad state, dispatched
+// by the transferred length like XINPUT_GAMEPAD_TO_HID_USB_INPUT_REPORT.
+// Returns FALSE for reports of unknown length.
+//
+BOOLEAN FORCEINLINE XINPUT_GAMEPAD_FROM_HID_USB_INPUT_REPORT(
+    const UCHAR* Buffer,
+    size_t BufferLength,
+    PXINPUT_GAMEPAD_STATE pGamepad
+)
+{
+    switch (BufferLength)
     {
-        pXboneReport->RightTrigger = pPad->Gamepad.bRightTrigger * 4;
+    case X360_HID_USB_INPUT_REPORT_BUFFER_LENGTH:
+        X360_HID_USB_INPUT_REPORT_TO_XINPUT_GAMEPAD((const X360_HID_USB_INPUT_REPORT*)Buffer, pGamepad);
+        return TRUE;
+    case XBONE_HID_USB_INPUT_REPORT_BUFFER_LENGTH:
+        XBONE_HID_USB_INPUT_REPORT_TO_XINPUT_GAMEPAD((const XBONE_HID_USB_INPUT_REPORT*)Buffer, pGamepad);
+        return TRUE;
+    default:
+        return FALSE;
     }
-
-    // A
-    if (pPad->Overrides & XINPUT_GAMEPAD_OVERRIDE_A)
-        if ((pPad->Gamepad.wButtons & XINPUT_GAMEPAD_A) != 0)
-            pXboneReport->Buttons |= XBONE_HID_USB_INPUT_REPORT_BUTTON_A;
-        else
-            pXboneReport->Buttons &= ~XBONE_HID_USB_INPUT_REPORT_BUTTON_A;
-
-    // B
-    if (pPad->Overrides & XINPUT_GAMEPAD_OVERRIDE_B)
-        if ((pPad->Gamepad.wButtons & XINPUT_GAMEPAD_B) != 0)
-            pXboneReport->Buttons |= XBONE_HID_USB_INPUT_REPORT_BUTTON_B;
-        else
-            pXboneReport->Buttons &= ~XBONE_HID_USB_INPUT_REPORT_BUTTON_B;
-
-    // X
-    if (pPad->Overrides & XINPUT_GAMEPAD_OVERRIDE_X)
-        if ((pPad->Gamepad.wButtons & XINPUT_GAMEPAD_X) != 0)
-            pXboneReport->Buttons |= XBONE_HID_USB_INPUT_REPORT_BUTTON_X;
-        else
-            pXboneReport->Buttons &= ~XBONE_HID_USB_INPUT_REPORT_BUTTON_X;
-
-    // Y
-    if (pPad->Overrides & XINPUT_GAMEPAD_OVERRIDE_Y)
-        if ((pPad->Gamepad.wButtons & XINPUT_GAMEPAD_Y) != 0)
-            pXboneReport->Buttons |= XBONE_HID_USB_INPUT_REPORT_BUTTON_Y;
-        else
-            pXboneReport->Buttons &= ~XBONE_HID_USB_INPUT_REPORT_BUTTON_Y;
-
-    // Left shoulder
-    if (pPad->Overrides & XINPUT_GAMEPAD_OVERRIDE_LEFT_SHOULDER)
-        if ((pPad->Gamepad.wButtons & XINPUT_GAMEPAD_LEFT_SHOULDER) != 0)
-            pXboneReport->Buttons |= XBONE_HID_USB_INPUT_REPORT_BUTTON_LEFT_SHOULDER;
-        else
-            pXboneReport->Buttons &= ~XBONE_HID_USB_INPUT_REPORT_BUTTON_LEFT_SHOULDER;
-
-    // Right shoulder
-    if (pPad->Overrides & XINPUT_GAMEPAD_OVERRIDE_RIGHT_SHOULDER)
-        if ((pPad->Gamepad.wButtons & XINPUT_GAMEPAD_RIGHT_SHOULDER) != 0)
-            pXboneReport->Buttons |= XBONE_HID_USB_INPUT_REPORT_BUTTON_RIGHT_SHOULDER;
-        else
-            pXboneReport->Buttons &= ~XBONE_HID_USB_INPUT_REPORT_BUTTON_RIGHT_SHOULDER;
-
-    // Start
-    if (pPad->Overrides & XINPUT_GAMEPAD_OVERRIDE_START)
-        if ((pPad->Gamepad.wButtons & XINPUT_GAMEPAD_START) != 0)
-            pXboneReport->Buttons |= XBONE_HID_USB_INPUT_REPORT_BUTTON_START;
-        else
-            pXboneReport->Buttons &= ~XBONE_HID_USB_INPUT_REPORT_BUTTON_START;
-
-    // Back
-    if (pPad->Overrides & XINPUT_GAMEPAD_OVERRIDE_BACK)
-        if ((pPad->Gamepad.wButtons & XINPUT_GAMEPAD_BACK) != 0)
-            pXboneReport->Buttons |= XBONE_HID_USB_INPUT_REPORT_BUTTON_BACK;
-        else
-            pXboneReport->Buttons &= ~XBONE_HID_USB_INPUT_REPORT_BUTTON_BACK;
-
-    // Left thumb
-    if (pPad->Overrides & XINPUT_GAMEPAD_OVERRIDE_LEFT_THUMB)
-        if ((pPad->Gamepad.wButtons & XINPUT_GAMEPAD_LEFT_THUMB) != 0)
-            pXboneReport->Buttons |= XBONE_HID_USB_INPUT_REPORT_BUTTON_LEFT_THUMB;
-        else
-            pXboneReport->Buttons &= ~XBONE_HID_USB_INPUT_REPORT_BUTTON_LEFT_THUMB;
-
-    // Right thumb
-    if (pPad->Overrides & XINPUT_GAMEPAD_OVERRIDE_RIGHT_THUMB)
-        if ((pPad->Gamepad.wButtons & XINPUT_GAMEPAD_RIGHT_THUMB) != 0)
-            pXboneReport->Buttons |= XBONE_HID_USB_INPUT_REPORT_BUTTON_RIGHT_THUMB;
-        else
-            pXboneReport->Buttons &= ~XBONE_HID_USB_INPUT_REPORT_BUTTON_RIGHT_THUMB;
 }
@@ -0,0 +1,299 @@
+/*
+MIT License
+
+Copyright (c) 2017 Benjamin "Nefarius" Hglinger
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#include "Driver.h"
+#include "Mailbox.tmh"
+
+
+WDFSPINLOCK                     MailboxLock;
+
+//
+// Manual queue holding the pended attach request, which keeps the pages
+// of the mailbox locked
+//
+static WDFQUEUE                 MailboxQueue;
+static WDFREQUEST               MailboxRequest;
+
+//
+// System address of the attached mailbox
+//
+static PXNA_GUARDIAN_MAILBOX    Mailbox;
+
+//
+// Last consistent data of every slot, used while the writer is busy
+//
+static XNA_GUARDIAN_MAILBOX_OVERRIDE    MailboxLastOverride[XINPUT_MAX_DEVICES];
+
+static EVT_WDF_IO_QUEUE_IO_CANCELED_ON_QUEUE XnaGuardianMailboxEvtIoCanceledOnQueue;
+
+//
+// Forgets the mailbox if Request is the one it was attached with.
+//
+static VOID XnaGuardianMailboxRelease(
+    WDFREQUEST Request
+)
+{
+    WdfSpinLockAcquire(MailboxLock);
+
+    if (MailboxRequest == Request)
+    {
+        Mailbox = NULL;
+        MailboxRequest = NULL;
+    }
+
+    WdfSpinLockRelease(MailboxLock);
+}
+
+static VOID XnaGuardianMailboxEvtIoCanceledOnQueue(
+    WDFQUEUE Queue,
+    WDFREQUEST Request
+)
+{
+    UNREFERENCED_PARAMETER(Queue);
+
+    XnaGuardianMailboxRelease(Request);
+
+    WdfRequestComplete(Request, STATUS_CANCELLED);
+}
+
+_Use_decl_annotations_
+NTSTATUS
+XnaGuardianMailboxInitialize(
+    WDFDEVICE ControlDevice
+)
+{
+    NTSTATUS            status;
+    WDF_IO_QUEUE_CONFIG queueConfig;
+    WDFQUEUE            queue;
+
+    WDF_IO_QUEUE_CONFIG_INIT(&queueConfig, WdfIoQueueDispatchManual);
+    queueConfig.EvtIoCanceledOnQueue = XnaGuardianMailboxEvtIoCanceledOnQueue;
+
+    status = WdfIoQueueCreate(ControlDevice, &queueConfig, WDF_NO_OBJECT_ATTRIBUTES, &queue);
+    if (!NT_SUCCESS(status))
+    {
+        TraceEvents(TRACE_LEVEL_ERROR, TRACE_SIDEBAND, "WdfIoQueueCreate failed with status %!STATUS!", status);
+        return status;
+    }
+
+    WdfSpinLockAcquire(MailboxLock);
+    MailboxQueue = queue;
+    WdfSpinLockRelease(MailboxLock);
+
+    return STATUS_SUCCESS;
+}
+
+_Use_decl_annotations_
+VOID
+XnaGuardianMailboxUninitialize(
+    VOID
+)
+{
+    //
+    // The queue is deleted with the control device, which also cancels the
+    // pending attach request
+    //
+    WdfSpinLockAcquire(MailboxLock);
+
+    MailboxQueue = NULL;
+    Mailbox = NULL;
+    MailboxRequest = NULL;
+
+    WdfSpinLockRelease(MailboxLock);
+}
+
+_Use_decl_annotations_
+VOID
+XnaGuardianMailboxAttach(
+    WDFREQUEST Request
+)
+{
+    NTSTATUS                status;
+    PMDL                    mdl;
+    PXNA_GUARDIAN_MAILBOX   pMailbox;
+    WDFQUEUE                queue = NULL;
+
+    status = WdfRequestRetrieveOutputWdmMdl(Request, &mdl);
+    if (!NT_SUCCESS(status))
+    {
+        TraceEvents(TRACE_LEVEL_ERROR, TRACE_SIDEBAND, "WdfRequestRetrieveOutputWdmMdl failed with status %!STATUS!", status);
+        WdfRequestComplete(Request, status);
+        return;
+    }
+
+    //
+    // Slots must stay on their own cache lines
+    //
+    if (MmGetMdlByteCount(mdl) < sizeof(XNA_GUARDIAN_MAILBOX)
+        || (MmGetMdlByteOffset(mdl) & (XNA_GUARDIAN_MAILBOX_ALIGNMENT - 1)))
+    {
+        WdfRequestComplete(Request, STATUS_INVALID_PARAMETER);
+        return;
+    }
+
+    pMailbox = MmGetSystemAddressForMdlSafe(mdl, NormalPagePriority | MdlMappingNoExecute);
+    if (pMailbox == NULL)
+    {
+        WdfRequestComplete(Request, STATUS_INSUFFICIENT_RESOURCES);
+        return;
+    }
+
+    if (pMailbox->Size != sizeof(XNA_GUARDIAN_MAILBOX))
+    {
+        WdfRequestComplete(Request, STATUS_INVALID_PARAMETER);
+        return;
+    }
+
+    WdfSpinLockAcquire(MailboxLock);
+
+    if (MailboxQueue == NULL)
+    {
+        status = STATUS_INVALID_DEVICE_STATE;
+    }
+    else if (MailboxRequest != NULL)
+    {
+        status = STATUS_DEVICE_BUSY;
+    }
+    else
+    {
+        RtlZeroMemory(MailboxLastOverride, sizeof(MailboxLastOverride));
+
+        Mailbox = pMailbox;
+        MailboxRequest = Request;
+        queue = MailboxQueue;
+    }
+
+    WdfSpinLockRelease(MailboxLock);
+
+    if (!NT_SUCCESS(status))
+    {
+        WdfRequestComplete(Request, status);
+        return;
+    }
+
+    //
+    // Forwarded outside the lock as the cancel callback acquires it
+    //
+    status = WdfRequestForwardToIoQueue(Request, queue);
+    if (!NT_SUCCESS(status))
+    {
+        TraceEvents(TRACE_LEVEL_ERROR, TRACE_SIDEBAND, "WdfRequestForwardToIoQueue failed with status %!STATUS!", status);
+        XnaGuardianMailboxRelease(Request);
+        WdfRequestComplete(Request, status);
+        return;
+    }
+
+    TraceEvents(TRACE_LEVEL_INFORMATION, TRACE_SIDEBAND, "%!FUNC! Mailbox attached");
+}
+
+_Use_decl_annotations_
+NTSTATUS
+XnaGuardianMailboxDetach(
+    WDFFILEOBJECT FileObject
+)
+{
+    NTSTATUS    status = STATUS_NOT_FOUND;
+    WDFREQUEST  request;
+
+    WdfSpinLockAcquire(MailboxLock);
+
+    if (MailboxQueue != NULL)
+    {
+        status = WdfIoQueueRetrieveRequestByFileObject(MailboxQueue, FileObject, &request);
+    }
+
+    if (NT_SUCCESS(status))
+    {
+        Mailbox = NULL;
+        MailboxRequest = NULL;
+    }
+
+    WdfSpinLockRelease(MailboxLock);
+
+    if (!NT_SUCCESS(status))
+    {
+        return STATUS_NOT_FOUND;
+    }
+
+    WdfRequestComplete(request, STATUS_SUCCESS);
+
+    TraceEvents(TRACE_LEVEL_INFORMATION, TRACE_SIDEBAND, "%!FUNC! Mailbox detached");
+
+    return STATUS_SUCCESS;
+}
+
+_Use_decl_annotations_
+BOOLEAN
+XnaGuardianMailboxGet(
+    UCHAR UserIndex,
+    PXINPUT_PAD_STATE_INTERNAL State
+)
+{
+    XNA_GUARDIAN_MAILBOX_OVERRIDE   override;
+    XINPUT_EXT_OVERRIDE_GAMEPAD     request;
+
+    //
+    // The lock keeps the mapping alive while the slot is copied
+    //
+    WdfSpinLockAcquire(MailboxLock);
+
+    if (Mailbox == NULL)
+    {
+        WdfSpinLockRelease(MailboxLock);
+        return FALSE;
+    }
+
+    //
+    // Never wait for the user mode writer at DISPATCH_LEVEL
+    //
+    if (XNA_GUARDIAN_MAILBOX_SLOT_TRY_READ(&Mailbox->Slots[UserIndex], &override))
+    {
+        MailboxLastOverride[UserIndex] = override;
+    }
+    else
+    {
+        override = MailboxLastOverride[UserIndex];
+    }
+
+    WdfSpinLockRelease(MailboxLock);
+
+    if ((override.Overrides & ~XINPUT_GAMEPAD_OVERRIDE_HIGH_RES_TRIGGERS) == 0)
+    {
+        return FALSE;
+    }
+
+    //
+    // Same validation as an override request
+    //
+    XINPUT_EXT_OVERRIDE_GAMEPAD_INIT(&request, UserIndex);
+    request.Overrides = override.Overrides;
+    request.Gamepad = override.Gamepad;
+    request.LeftTrigger = override.LeftTrigger;
+    request.RightTrigger = override.RightTrigger;
+
+    XINPUT_PAD_STATE_INTERNAL_SET(State, &request);
+
+    return TRUE;
+}
@@ -0,0 +1,79 @@
+/*
+MIT License
+
+Copyright (c) 2017 Benjamin "Nefarius" Hglinger
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#pragma once
+
+#include "XnaGuardianMailbox.h"
+
+EXTERN_C_START
+
+//
+// Protects the attached mailbox
+//
+extern WDFSPINLOCK  MailboxLock;
+
+//
+// Creates the queue holding the pended attach request on the control device.
+//
+NTSTATUS
+XnaGuardianMailboxInitialize(
+    _In_ WDFDEVICE ControlDevice
+);
+
+//
+// Detaches the queue before the control device is deleted.
+//
+VOID
+XnaGuardianMailboxUninitialize(
+    VOID
+);
+
+//
+// Handles IOCTL_XINPUT_EXT_MAILBOX_ATTACH, completes or pends Request.
+//
+VOID
+XnaGuardianMailboxAttach(
+    _In_ WDFREQUEST Request
+);
+
+//
+// Detaches the mailbox if it was attached through FileObject.
+//
+NTSTATUS
+XnaGuardianMailboxDetach(
+    _In_ WDFFILEOBJECT FileObject
+);
+
+//
+// Copies the mailbox overrides of a pad, callable at IRQL <= DISPATCH_LEVEL.
+// Returns FALSE if no mailbox is attached or the pad has no overrides.
+//
+BOOLEAN
+XnaGuardianMailboxGet(
+    _In_ UCHAR UserIndex,
+    _Out_ PXINPUT_PAD_STATE_INTERNAL State
+);
+
+EXTERN_C_END
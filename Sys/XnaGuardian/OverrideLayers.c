@@ -0,0 +1,538 @@
+/*
+MIT License
+
+Copyright (c) 2017 Benjamin "Nefarius" Hglinger
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#include "Driver.h"
+#include "Sideband.h"
+#include "OverrideLayers.tmh"
+
+
+XINPUT_PAD_OVERRIDE_LAYERS  PadOverrideLayers[XINPUT_MAX_DEVICES];
+
+//
+// Serializes writers of PadOverrideLayers and PadStates, readers of
+// PadStates use PadStatesSequence instead
+//
+WDFWAITLOCK                 PadOverrideLayersLock;
+
+//
+// Owner and lease of every layer, protected by PadOverrideLayersLock
+//
+static XNA_OWNERSHIP_TABLE  PadOverrideOwnership;
+
+//
+// Legacy overrides of every pad, the most recently set one first.
+// Protected by PadOverrideLayersLock.
+//
+static LIST_ENTRY           PadLegacyOverrides[XINPUT_MAX_DEVICES];
+
+//
+// Fires when the earliest lease ends
+//
+static WDFTIMER             PadOverrideLeaseTimer;
+
+static EVT_WDF_TIMER XInputOverrideLayersEvtLeaseTimer;
+
+static VOID XInputOverrideLayersResolve(
+    UCHAR UserIndex
+);
+
+//
+// Removes the layers of a slot mask and resolves the affected pads. The
+// caller holds PadOverrideLayersLock. Returns a bit mask of these pads.
+//
+static ULONG XInputOverrideLayersDrop(
+    ULONG Slots
+)
+{
+    ULONG   pads = 0;
+    ULONG   layers;
+    UCHAR   index;
+    UCHAR   layerId;
+
+    for (index = 0; index < XINPUT_MAX_DEVICES; index++)
+    {
+        layers = XNA_OWNERSHIP_PAD_LAYERS(Slots, index);
+
+        if (layers == 0)
+            continue;
+
+        for (layerId = 0; layerId < XINPUT_OVERRIDE_LAYERS_MAX; layerId++)
+        {
+            if (layers & (1UL << layerId))
+            {
+                RtlZeroMemory(&PadOverrideLayers[index].Layers[layerId], sizeof(XINPUT_OVERRIDE_LAYER));
+            }
+        }
+
+        XInputOverrideLayersResolve(index);
+
+        pads |= 1UL << index;
+    }
+
+    return pads;
+}
+
+//
+// Arms the lease timer for the earliest lease. The caller holds
+// PadOverrideLayersLock.
+//
+static VOID XInputOverrideLayersArmLeaseTimer(
+    VOID
+)
+{
+    ULONGLONG   next = XNA_OWNERSHIP_TABLE_NEXT_EXPIRATION(&PadOverrideOwnership);
+    ULONGLONG   now;
+
+    if (next == 0 || PadOverrideLeaseTimer == NULL)
+        return;
+
+    now = KeQueryUnbiasedInterruptTime();
+
+    //
+    // Negative due times are relative, in 100-nanosecond units
+    //
+    WdfTimerStart(PadOverrideLeaseTimer, -(LONGLONG)((next > now) ? next - now : 1));
+}
+
+static VOID XInputOverrideLayersEvtLeaseTimer(
+    WDFTIMER Timer
+)
+{
+    ULONG   pads;
+    UCHAR   index;
+
+    UNREFERENCED_PARAMETER(Timer);
+
+    WdfWaitLockAcquire(PadOverrideLayersLock, NULL);
+
+    pads = XInputOverrideLayersDrop(XNA_OWNERSHIP_TABLE_EXPIRE(&PadOverrideOwnership, KeQueryUnbiasedInterruptTime()));
+
+    XInputOverrideLayersArmLeaseTimer();
+
+    WdfWaitLockRelease(PadOverrideLayersLock);
+
+    for (index = 0; index < XINPUT_MAX_DEVICES; index++)
+    {
+        if (pads & (1UL << index))
+        {
+            TraceEvents(TRACE_LEVEL_INFORMATION, TRACE_SIDEBAND, "%!FUNC! Lease of pad %d expired", index);
+
+            XnaGuardianSidebandUpdateHidUsbDevice(index);
+        }
+    }
+}
+
+_Use_decl_annotations_
+NTSTATUS
+XInputOverrideLayersInitialize(
+    WDFDEVICE ControlDevice
+)
+{
+    NTSTATUS                status;
+    WDF_TIMER_CONFIG        timerConfig;
+    WDF_OBJECT_ATTRIBUTES   attributes;
+    WDFTIMER                timer;
+    UCHAR                   index;
+
+    WDF_TIMER_CONFIG_INIT(&timerConfig, XInputOverrideLayersEvtLeaseTimer);
+    timerConfig.AutomaticSerialization = FALSE;
+
+    WDF_OBJECT_ATTRIBUTES_INIT(&attributes);
+    attributes.ParentObject = ControlDevice;
+
+    //
+    // Expired layers are removed under PadOverrideLayersLock
+    //
+    attributes.ExecutionLevel = WdfExecutionLevelPassive;
+
+    status = WdfTimerCreate(&timerConfig, &attributes, &timer);
+    if (!NT_SUCCESS(status))
+    {
+        TraceEvents(TRACE_LEVEL_ERROR, TRACE_SIDEBAND, "WdfTimerCreate failed with status %!STATUS!", status);
+        return status;
+    }
+
+    WdfWaitLockAcquire(PadOverrideLayersLock, NULL);
+
+    PadOverrideLeaseTimer = timer;
+
+    //
+    // Legacy overrides may have been stacked through a previous control device
+    //
+    for (index = 0; index < XINPUT_MAX_DEVICES; index++)
+    {
+        if (PadLegacyOverrides[index].Flink == NULL)
+        {
+            InitializeListHead(&PadLegacyOverrides[index]);
+        }
+    }
+
+    //
+    // Leases may have been granted through a previous control device
+    //
+    XInputOverrideLayersArmLeaseTimer();
+
+    WdfWaitLockRelease(PadOverrideLayersLock);
+
+    return STATUS_SUCCESS;
+}
+
+_Use_decl_annotations_
+VOID
+XInputOverrideLayersUninitialize(
+    VOID
+)
+{
+    WDFTIMER    timer;
+
+    WdfWaitLockAcquire(PadOverrideLayersLock, NULL);
+
+    timer = PadOverrideLeaseTimer;
+    PadOverrideLeaseTimer = NULL;
+
+    WdfWaitLockRelease(PadOverrideLayersLock);
+
+    //
+    // Waits for a running callback, which acquires the lock
+    //
+    if (timer != NULL)
+    {
+        WdfTimerStop(timer, TRUE);
+    }
+}
+
+//
+// Combines the value of a layer with the value accumulated from the layers
+// below it. Controls start out neutral (zero), so the first layer
+// overriding a control always yields its own value.
+//
+static LONG XInputOverrideLayerBlend(
+    XINPUT_OVERRIDE_BLEND_MODE BlendMode,
+    LONG Current,
+    LONG Value,
+    LONG Minimum,
+    LONG Maximum
+)
+{
+    switch (BlendMode)
+    {
+    case XINPUT_OVERRIDE_BLEND_ADD:
+        return max(Minimum, min(Maximum, Current + Value));
+    case XINPUT_OVERRIDE_BLEND_MAX:
+    case XINPUT_OVERRIDE_BLEND_OR:
+        return ((Value < 0) ? -Value : Value) > ((Current < 0) ? -Current : Current) ? Value : Current;
+    default:
+        return Value;
+    }
+}
+
+_Use_decl_annotations_
+NTSTATUS
+XInputOverrideLayerSet(
+    UCHAR LayerId,
+    LONG Priority,
+    XINPUT_OVERRIDE_BLEND_MODE BlendMode,
+    const XINPUT_EXT_OVERRIDE_GAMEPAD* Override,
+    WDFFILEOBJECT Owner,
+    ULONGLONG LeaseDuration
+)
+{
+    PXINPUT_OVERRIDE_LAYER  pLayer;
+    ULONGLONG               expirationTime = 0;
+
+    if (!VALID_USER_INDEX(Override->UserIndex)
+        || !VALID_LAYER_ID(LayerId)
+        || (ULONG)BlendMode >= XINPUT_OVERRIDE_BLEND_MODE_MAX)
+    {
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    pLayer = &PadOverrideLayers[Override->UserIndex].Layers[LayerId];
+
+    WdfWaitLockAcquire(PadOverrideLayersLock, NULL);
+
+    XINPUT_PAD_STATE_INTERNAL_SET(&pLayer->State, Override);
+
+    pLayer->Priority = Priority;
+    pLayer->BlendMode = BlendMode;
+    pLayer->InUse = (pLayer->State.Overrides & ~XINPUT_GAMEPAD_OVERRIDE_HIGH_RES_TRIGGERS) != 0;
+
+    if (pLayer->InUse)
+    {
+        if (LeaseDuration != 0)
+        {
+            expirationTime = KeQueryUnbiasedInterruptTime() + LeaseDuration;
+
+            if (expirationTime < LeaseDuration)
+                expirationTime = MAXULONGLONG;
+        }
+
+        XNA_OWNERSHIP_TABLE_CLAIM(&PadOverrideOwnership, Override->UserIndex, LayerId, Owner, expirationTime);
+    }
+    else
+    {
+        XNA_OWNERSHIP_TABLE_DROP(&PadOverrideOwnership, Override->UserIndex, LayerId);
+    }
+
+    XInputOverrideLayersResolve(Override->UserIndex);
+
+    if (expirationTime != 0)
+    {
+        XInputOverrideLayersArmLeaseTimer();
+    }
+
+    WdfWaitLockRelease(PadOverrideLayersLock);
+
+    return STATUS_SUCCESS;
+}
+
+//
+// Rebuilds the legacy layer of a pad from the legacy overrides of all
+// handles. Stacking starts with the oldest override, so per control the
+// handle that set it last wins. The caller holds PadOverrideLayersLock.
+//
+static VOID XInputOverrideLayersStackLegacy(
+    UCHAR UserIndex
+)
+{
+    PXINPUT_OVERRIDE_LAYER  pLayer = &PadOverrideLayers[UserIndex].Layers[XINPUT_OVERRIDE_LEGACY_LAYER_ID];
+    PLIST_ENTRY             pHead = &PadLegacyOverrides[UserIndex];
+    PLIST_ENTRY             pEntry;
+    PXINPUT_LEGACY_OVERRIDE pLegacy;
+
+    RtlZeroMemory(pLayer, sizeof(XINPUT_OVERRIDE_LAYER));
+
+    for (pEntry = pHead->Blink; pEntry != pHead; pEntry = pEntry->Blink)
+    {
+        pLegacy = CONTAINING_RECORD(pEntry, XINPUT_LEGACY_OVERRIDE, Link);
+
+        pLayer->State.Overrides |= pLegacy->State.Overrides;
+
+        XINPUT_GAMEPAD_STATE_MERGE(&pLayer->State.Gamepad, &pLegacy->State.Gamepad, &pLegacy->State.Mask);
+
+        if (pLegacy->State.Overrides & XINPUT_GAMEPAD_OVERRIDE_LEFT_TRIGGER)
+            pLayer->State.LeftTrigger = pLegacy->State.LeftTrigger;
+
+        if (pLegacy->State.Overrides & XINPUT_GAMEPAD_OVERRIDE_RIGHT_TRIGGER)
+            pLayer->State.RightTrigger = pLegacy->State.RightTrigger;
+    }
+
+    XINPUT_GAMEPAD_MERGE_MASK_FROM_OVERRIDES(pLayer->State.Overrides, &pLayer->State.Mask);
+
+    pLayer->BlendMode = XINPUT_OVERRIDE_BLEND_REPLACE;
+    pLayer->InUse = (pLayer->State.Overrides & ~XINPUT_GAMEPAD_OVERRIDE_HIGH_RES_TRIGGERS) != 0;
+}
+
+_Use_decl_annotations_
+NTSTATUS
+XInputOverrideLayerSetLegacy(
+    const XINPUT_EXT_OVERRIDE_GAMEPAD* Override,
+    WDFFILEOBJECT Owner
+)
+{
+    PXINPUT_LEGACY_OVERRIDE pLegacy;
+
+    if (!VALID_USER_INDEX(Override->UserIndex))
+    {
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    pLegacy = &SidebandFileGetContext(Owner)->LegacyOverrides[Override->UserIndex];
+
+    WdfWaitLockAcquire(PadOverrideLayersLock, NULL);
+
+    if (pLegacy->Link.Flink != NULL)
+    {
+        RemoveEntryList(&pLegacy->Link);
+        pLegacy->Link.Flink = NULL;
+    }
+
+    XINPUT_PAD_STATE_INTERNAL_SET(&pLegacy->State, Override);
+
+    //
+    // The newest override goes on top, an empty one leaves the stack
+    //
+    if ((pLegacy->State.Overrides & ~XINPUT_GAMEPAD_OVERRIDE_HIGH_RES_TRIGGERS) != 0)
+    {
+        InsertHeadList(&PadLegacyOverrides[Override->UserIndex], &pLegacy->Link);
+    }
+
+    XInputOverrideLayersStackLegacy(Override->UserIndex);
+    XInputOverrideLayersResolve(Override->UserIndex);
+
+    WdfWaitLockRelease(PadOverrideLayersLock);
+
+    return STATUS_SUCCESS;
+}
+
+//
+// Blends all layers of a pad and publishes the result in PadStates.
+// The caller holds PadOverrideLayersLock.
+//
+static VOID XInputOverrideLayersResolve(
+    UCHAR UserIndex
+)
+{
+    PXINPUT_OVERRIDE_LAYER      order[XINPUT_OVERRIDE_LAYERS_MAX];
+    PXINPUT_OVERRIDE_LAYER      pLayer;
+    XINPUT_PAD_STATE_INTERNAL   effective;
+    ULONG                       count = 0;
+    ULONG                       index;
+    ULONG                       position;
+    USHORT                      buttons;
+    KIRQL                       oldIrql;
+
+    //
+    // Sort used layers by priority, equal priorities keep the layer id order
+    //
+    for (index = 0; index < XINPUT_OVERRIDE_LAYERS_MAX; index++)
+    {
+        pLayer = &PadOverrideLayers[UserIndex].Layers[index];
+
+        if (!pLayer->InUse)
+            continue;
+
+        for (position = count; position > 0 && order[position - 1]->Priority > pLayer->Priority; position--)
+        {
+            order[position] = order[position - 1];
+        }
+
+        order[position] = pLayer;
+        count++;
+    }
+
+    RtlZeroMemory(&effective, sizeof(XINPUT_PAD_STATE_INTERNAL));
+
+#define XINPUT_OVERRIDE_LAYER_BLEND(_field_, _type_, _override_, _min_, _max_)          \
+    if (pLayer->State.Overrides & (_override_))                                         \
+    {                                                                                   \
+        effective._field_ = (_type_)XInputOverrideLayerBlend(pLayer->BlendMode,         \
+            effective._field_, pLayer->State._field_, (_min_), (_max_));                \
+    }
+
+    for (index = 0; index < count; index++)
+    {
+        pLayer = order[index];
+
+        effective.Overrides |= pLayer->State.Overrides;
+
+        //
+        // Buttons are pressed or not, all modes but replace combine like OR
+        //
+        buttons = (USHORT)(pLayer->State.Overrides & 0xFFFF);
+
+        if (pLayer->BlendMode == XINPUT_OVERRIDE_BLEND_REPLACE)
+            effective.Gamepad.wButtons &= ~buttons;
+
+        effective.Gamepad.wButtons |= pLayer->State.Gamepad.wButtons & buttons;
+
+        //
+        // Triggers are blended in high resolution
+        //
+        XINPUT_OVERRIDE_LAYER_BLEND(LeftTrigger, USHORT, XINPUT_GAMEPAD_OVERRIDE_LEFT_TRIGGER, 0, XINPUT_HIGH_RES_TRIGGER_MAX);
+        XINPUT_OVERRIDE_LAYER_BLEND(RightTrigger, USHORT, XINPUT_GAMEPAD_OVERRIDE_RIGHT_TRIGGER, 0, XINPUT_HIGH_RES_TRIGGER_MAX);
+
+        XINPUT_OVERRIDE_LAYER_BLEND(Gamepad.sThumbLX, SHORT, XINPUT_GAMEPAD_OVERRIDE_LEFT_THUMB_X, SHRT_MIN, SHRT_MAX);
+        XINPUT_OVERRIDE_LAYER_BLEND(Gamepad.sThumbLY, SHORT, XINPUT_GAMEPAD_OVERRIDE_LEFT_THUMB_Y, SHRT_MIN, SHRT_MAX);
+        XINPUT_OVERRIDE_LAYER_BLEND(Gamepad.sThumbRX, SHORT, XINPUT_GAMEPAD_OVERRIDE_RIGHT_THUMB_X, SHRT_MIN, SHRT_MAX);
+        XINPUT_OVERRIDE_LAYER_BLEND(Gamepad.sThumbRY, SHORT, XINPUT_GAMEPAD_OVERRIDE_RIGHT_THUMB_Y, SHRT_MIN, SHRT_MAX);
+    }
+
+#undef XINPUT_OVERRIDE_LAYER_BLEND
+
+    effective.Gamepad.bLeftTrigger = XINPUT_TRIGGER_FROM_HIGH_RES(effective.LeftTrigger);
+    effective.Gamepad.bRightTrigger = XINPUT_TRIGGER_FROM_HIGH_RES(effective.RightTrigger);
+
+    XINPUT_GAMEPAD_MERGE_MASK_FROM_OVERRIDES(effective.Overrides, &effective.Mask);
+
+    //
+    // Readers run at DISPATCH_LEVEL and would spin on a writer preempted
+    // on the same processor
+    //
+    KeRaiseIrql(DISPATCH_LEVEL, &oldIrql);
+    XNA_SEQ_LOCK_WRITE(&PadStatesSequence[UserIndex], &PadStates[UserIndex], &effective, sizeof(XINPUT_PAD_STATE_INTERNAL));
+    KeLowerIrql(oldIrql);
+
+    TraceEvents(TRACE_LEVEL_VERBOSE, TRACE_SIDEBAND, "%!FUNC! Pad %d resolved %d layer(s) to overrides 0x%X",
+        UserIndex, count, effective.Overrides);
+}
+
+_Use_decl_annotations_
+ULONG
+XInputOverrideLayersRelease(
+    WDFFILEOBJECT Owner
+)
+{
+    PSIDEBAND_FILE_CONTEXT  pContext = SidebandFileGetContext(Owner);
+    ULONG                   pads;
+    ULONG                   legacyPads = 0;
+    UCHAR                   index;
+
+    WdfWaitLockAcquire(PadOverrideLayersLock, NULL);
+
+    //
+    // Layers of other handles stay, unaffected pads aren't resolved again
+    //
+    pads = XInputOverrideLayersDrop(XNA_OWNERSHIP_TABLE_RELEASE(&PadOverrideOwnership, Owner));
+
+    //
+    // Legacy overrides of other handles stay stacked as well
+    //
+    for (index = 0; index < XINPUT_MAX_DEVICES; index++)
+    {
+        if (pContext->LegacyOverrides[index].Link.Flink == NULL)
+            continue;
+
+        RemoveEntryList(&pContext->LegacyOverrides[index].Link);
+        pContext->LegacyOverrides[index].Link.Flink = NULL;
+
+        XInputOverrideLayersStackLegacy(index);
+
+        if (!(pads & (1UL << index)))
+        {
+            XInputOverrideLayersResolve(index);
+        }
+
+        legacyPads |= 1UL << index;
+    }
+
+    pads |= legacyPads;
+
+    WdfWaitLockRelease(PadOverrideLayersLock);
+
+    TraceEvents(TRACE_LEVEL_INFORMATION, TRACE_SIDEBAND, "%!FUNC! Released layers of pads 0x%X", pads);
+
+    return pads;
+}
+
+_Use_decl_annotations_
+LONG
+XInputOverrideLayersGetEffective(
+    UCHAR UserIndex,
+    PXINPUT_PAD_STATE_INTERNAL State
+)
+{
+    return XNA_SEQ_LOCK_READ(&PadStatesSequence[UserIndex], State, &PadStates[UserIndex], sizeof(XINPUT_PAD_STATE_INTERNAL));
+}
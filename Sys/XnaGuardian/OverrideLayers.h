@@ -0,0 +1,128 @@
+/*
+MIT License
+
+Copyright (c) 2017 Benjamin "Nefarius" Hglinger
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#pragma once
+
+#include "XnaGuardianOwnership.h"
+
+EXTERN_C_START
+
+//
+// A single override source of a pad
+//
+typedef struct _XINPUT_OVERRIDE_LAYER
+{
+    BOOLEAN                     InUse;
+    LONG                        Priority;
+    XINPUT_OVERRIDE_BLEND_MODE  BlendMode;
+    XINPUT_PAD_STATE_INTERNAL   State;
+
+} XINPUT_OVERRIDE_LAYER, *PXINPUT_OVERRIDE_LAYER;
+
+//
+// All override layers of a pad, resolved into PadStates on every change
+//
+typedef struct _XINPUT_PAD_OVERRIDE_LAYERS
+{
+    XINPUT_OVERRIDE_LAYER       Layers[XINPUT_OVERRIDE_LAYERS_MAX];
+
+} XINPUT_PAD_OVERRIDE_LAYERS, *PXINPUT_PAD_OVERRIDE_LAYERS;
+
+//
+// Override of a pad set by one handle through the legacy requests. The
+// overrides of all handles are stacked into layer
+// XINPUT_OVERRIDE_LEGACY_LAYER_ID, a Link.Flink of NULL means not stacked.
+//
+typedef struct _XINPUT_LEGACY_OVERRIDE
+{
+    LIST_ENTRY                  Link;
+    XINPUT_PAD_STATE_INTERNAL   State;
+
+} XINPUT_LEGACY_OVERRIDE, *PXINPUT_LEGACY_OVERRIDE;
+
+extern XINPUT_PAD_OVERRIDE_LAYERS   PadOverrideLayers[XINPUT_MAX_DEVICES];
+
+//
+// Creates the lease timer on the control device.
+//
+NTSTATUS
+XInputOverrideLayersInitialize(
+    _In_ WDFDEVICE ControlDevice
+);
+
+//
+// Stops the lease timer before the control device is deleted.
+//
+VOID
+XInputOverrideLayersUninitialize(
+    VOID
+);
+
+//
+// Stores or removes a layer owned by Owner and updates the effective pad
+// state. A non-zero LeaseDuration (in 100-nanosecond units) removes the
+// layer once it elapsed.
+//
+NTSTATUS
+XInputOverrideLayerSet(
+    _In_ UCHAR LayerId,
+    _In_ LONG Priority,
+    _In_ XINPUT_OVERRIDE_BLEND_MODE BlendMode,
+    _In_ const XINPUT_EXT_OVERRIDE_GAMEPAD* Override,
+    _In_ WDFFILEOBJECT Owner,
+    _In_ ULONGLONG LeaseDuration
+);
+
+//
+// Stores or removes the legacy override of Owner and updates the effective
+// pad state. Per control the handle that set it last wins, the overrides
+// of other handles stay in place.
+//
+NTSTATUS
+XInputOverrideLayerSetLegacy(
+    _In_ const XINPUT_EXT_OVERRIDE_GAMEPAD* Override,
+    _In_ WDFFILEOBJECT Owner
+);
+
+//
+// Copies a consistent snapshot of the effective overrides of a pad without
+// blocking, callable at any IRQL. Returns the sequence of the snapshot.
+//
+LONG
+XInputOverrideLayersGetEffective(
+    _In_ UCHAR UserIndex,
+    _Out_ PXINPUT_PAD_STATE_INTERNAL State
+);
+
+//
+// Removes all layers and legacy overrides owned by Owner and updates the
+// affected pads. Returns a bit mask of the pads whose layers changed.
+//
+ULONG
+XInputOverrideLayersRelease(
+    _In_ WDFFILEOBJECT Owner
+);
+
+EXTERN_C_END
@@ -0,0 +1,216 @@
+/*
+MIT License
+
+Copyright (c) 2017 Benjamin "Nefarius" Hglinger
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#include "Driver.h"
+#include "PeekCache.tmh"
+
+
+WDFSPINLOCK     PeekPadCacheLock;
+
+//
+// Manual queues holding pended IOCTL_XINPUT_EXT_WAIT_GAMEPAD_STATE requests
+//
+static WDFQUEUE PeekPadCacheWaitQueues[XINPUT_MAX_DEVICES];
+
+//
+// Completes a wait request with the current cached state of a pad.
+//
+static VOID PeekPadCacheCompleteWait(
+    WDFREQUEST Request,
+    UCHAR UserIndex
+)
+{
+    NTSTATUS                            status;
+    PXINPUT_EXT_VERSIONED_GAMEPAD_STATE pState;
+
+    status = WdfRequestRetrieveOutputBuffer(Request, sizeof(XINPUT_EXT_VERSIONED_GAMEPAD_STATE), (PVOID*)&pState, NULL);
+    if (!NT_SUCCESS(status))
+    {
+        WdfRequestComplete(Request, status);
+        return;
+    }
+
+    pState->Sequence = PeekPadCacheGet(UserIndex, &pState->Gamepad);
+
+    WdfRequestCompleteWithInformation(Request, STATUS_SUCCESS, sizeof(XINPUT_EXT_VERSIONED_GAMEPAD_STATE));
+}
+
+_Use_decl_annotations_
+NTSTATUS
+PeekPadCacheInitialize(
+    WDFDEVICE ControlDevice
+)
+{
+    NTSTATUS            status;
+    WDF_IO_QUEUE_CONFIG queueConfig;
+    WDFQUEUE            queues[XINPUT_MAX_DEVICES];
+    UCHAR               index;
+
+    WDF_IO_QUEUE_CONFIG_INIT(&queueConfig, WdfIoQueueDispatchManual);
+
+    for (index = 0; index < XINPUT_MAX_DEVICES; index++)
+    {
+        status = WdfIoQueueCreate(ControlDevice, &queueConfig, WDF_NO_OBJECT_ATTRIBUTES, &queues[index]);
+        if (!NT_SUCCESS(status))
+        {
+            TraceEvents(TRACE_LEVEL_ERROR, TRACE_SIDEBAND, "WdfIoQueueCreate failed with status %!STATUS!", status);
+            return status;
+        }
+    }
+
+    WdfSpinLockAcquire(PeekPadCacheLock);
+
+    for (index = 0; index < XINPUT_MAX_DEVICES; index++)
+    {
+        PeekPadCacheWaitQueues[index] = queues[index];
+    }
+
+    WdfSpinLockRelease(PeekPadCacheLock);
+
+    return STATUS_SUCCESS;
+}
+
+_Use_decl_annotations_
+VOID
+PeekPadCacheUninitialize(
+    VOID
+)
+{
+    UCHAR   index;
+
+    //
+    // The queues are deleted with the control device, which also cancels
+    // the requests still pending
+    //
+    WdfSpinLockAcquire(PeekPadCacheLock);
+
+    for (index = 0; index < XINPUT_MAX_DEVICES; index++)
+    {
+        PeekPadCacheWaitQueues[index] = NULL;
+    }
+
+    WdfSpinLockRelease(PeekPadCacheLock);
+}
+
+_Use_decl_annotations_
+VOID
+PeekPadCacheUpdate(
+    UCHAR UserIndex,
+    const XINPUT_GAMEPAD_STATE* State
+)
+{
+    WDFREQUEST  request;
+
+    //
+    // The lock also raises to DISPATCH_LEVEL as required by the sequence
+    // lock writer
+    //
+    WdfSpinLockAcquire(PeekPadCacheLock);
+
+    if (XNA_PEEK_CACHE_UPDATE(&PeekPadCache[UserIndex], State)
+        && PeekPadCacheWaitQueues[UserIndex] != NULL)
+    {
+        while (NT_SUCCESS(WdfIoQueueRetrieveNextRequest(PeekPadCacheWaitQueues[UserIndex], &request)))
+        {
+            PeekPadCacheCompleteWait(request, UserIndex);
+        }
+    }
+
+    WdfSpinLockRelease(PeekPadCacheLock);
+}
+
+_Use_decl_annotations_
+ULONG
+PeekPadCacheGet(
+    UCHAR UserIndex,
+    PXINPUT_GAMEPAD_STATE State
+)
+{
+    return XNA_PEEK_CACHE_GET(&PeekPadCache[UserIndex], State);
+}
+
+_Use_decl_annotations_
+VOID
+PeekPadCacheWait(
+    WDFREQUEST Request,
+    UCHAR UserIndex,
+    ULONG Sequence
+)
+{
+    NTSTATUS    status = STATUS_SUCCESS;
+    BOOLEAN     pended = FALSE;
+
+    //
+    // Checking the sequence and queuing the request under the writer lock
+    // guarantees that no update can slip in between and get lost
+    //
+    WdfSpinLockAcquire(PeekPadCacheLock);
+
+    if (XNA_PEEK_CACHE_IS_CURRENT(&PeekPadCache[UserIndex], Sequence)
+        && PeekPadCacheWaitQueues[UserIndex] != NULL)
+    {
+        status = WdfRequestForwardToIoQueue(Request, PeekPadCacheWaitQueues[UserIndex]);
+        pended = NT_SUCCESS(status);
+    }
+
+    WdfSpinLockRelease(PeekPadCacheLock);
+
+    if (pended)
+        return;
+
+    if (!NT_SUCCESS(status))
+    {
+        TraceEvents(TRACE_LEVEL_ERROR, TRACE_SIDEBAND, "WdfRequestForwardToIoQueue failed with status %!STATUS!", status);
+        WdfRequestComplete(Request, status);
+        return;
+    }
+
+    PeekPadCacheCompleteWait(Request, UserIndex);
+}
+
+_Use_decl_annotations_
+VOID
+PeekPadCacheCancelWaits(
+    WDFFILEOBJECT FileObject
+)
+{
+    WDFREQUEST  request;
+    UCHAR       index;
+
+    WdfSpinLockAcquire(PeekPadCacheLock);
+
+    for (index = 0; index < XINPUT_MAX_DEVICES; index++)
+    {
+        if (PeekPadCacheWaitQueues[index] == NULL)
+            continue;
+
+        while (NT_SUCCESS(WdfIoQueueRetrieveRequestByFileObject(PeekPadCacheWaitQueues[index], FileObject, &request)))
+        {
+            WdfRequestComplete(request, STATUS_CANCELLED);
+        }
+    }
+
+    WdfSpinLockRelease(PeekPadCacheLock);
+}
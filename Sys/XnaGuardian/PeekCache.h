@@ -0,0 +1,90 @@
+/*
+MIT License
+
+Copyright (c) 2017 Benjamin "Nefarius" Hglinger
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#pragma once
+
+EXTERN_C_START
+
+//
+// Protects the peek cache writers and the wait queues
+//
+extern WDFSPINLOCK  PeekPadCacheLock;
+
+//
+// Creates the queues holding pended wait requests on the control device.
+//
+NTSTATUS
+PeekPadCacheInitialize(
+    _In_ WDFDEVICE ControlDevice
+);
+
+//
+// Detaches the wait queues before the control device is deleted.
+//
+VOID
+PeekPadCacheUninitialize(
+    VOID
+);
+
+//
+// Stores the physical state of a pad and completes pended wait requests if
+// it differs from the cached state. Callable at IRQL <= DISPATCH_LEVEL.
+//
+VOID
+PeekPadCacheUpdate(
+    _In_ UCHAR UserIndex,
+    _In_ const XINPUT_GAMEPAD_STATE* State
+);
+
+//
+// Copies a consistent snapshot of the cached state of a pad without
+// blocking and returns its sequence.
+//
+ULONG
+PeekPadCacheGet(
+    _In_ UCHAR UserIndex,
+    _Out_ PXINPUT_GAMEPAD_STATE State
+);
+
+//
+// Completes Request with the cached state if its sequence differs from
+// Sequence, otherwise pends it until the state changes.
+//
+VOID
+PeekPadCacheWait(
+    _In_ WDFREQUEST Request,
+    _In_ UCHAR UserIndex,
+    _In_ ULONG Sequence
+);
+
+//
+// Cancels all pended wait requests of a file object.
+//
+VOID
+PeekPadCacheCancelWaits(
+    _In_ WDFFILEOBJECT FileObject
+);
+
+EXTERN_C_END
@@ -27,13 +27,59 @@ SOFTWARE.
 #include "power.tmh"
 
 
+static VOID XnaGuardianQueryReaderParameters(
+    _In_ WDFDEVICE Device,
+    _Inout_ PULONG PendingReads,
+    _Inout_ PULONG TransferLength
+);
+
 #ifdef ALLOC_PRAGMA
+#pragma alloc_text(PAGE, XnaGuardianQueryReaderParameters)
 #pragma alloc_text(PAGE, XnaGuardianEvtDevicePrepareHardware)
 #pragma alloc_text(PAGE, XnaGuardianEvtDeviceD0Entry)
 #pragma alloc_text(PAGE, XnaGuardianEvtDeviceD0Exit)
 #endif
 
 
+//
+// Overrides the continuous reader defaults with the values present in the
+// hardware key of the device.
+// 
+static VOID XnaGuardianQueryReaderParameters(
+    WDFDEVICE Device,
+    PULONG PendingReads,
+    PULONG TransferLength
+)
+{
+    NTSTATUS    status;
+    WDFKEY      key;
+    ULONG       value;
+
+    DECLARE_CONST_UNICODE_STRING(pendingReadsName, L"ContinuousReaderPendingReads");
+    DECLARE_CONST_UNICODE_STRING(transferLengthName, L"ContinuousReaderTransferLength");
+
+    PAGED_CODE();
+
+    status = WdfDeviceOpenRegistryKey(Device, PLUGPLAY_REGKEY_DEVICE, KEY_READ, WDF_NO_OBJECT_ATTRIBUTES, &key);
+    if (!NT_SUCCESS(status))
+    {
+        TraceEvents(TRACE_LEVEL_WARNING, TRACE_POWER, "WdfDeviceOpenRegistryKey failed with status %!STATUS!", status);
+        return;
+    }
+
+    if (NT_SUCCESS(WdfRegistryQueryULong(key, &pendingReadsName, &value)))
+    {
+        *PendingReads = value;
+    }
+
+    if (NT_SUCCESS(WdfRegistryQueryULong(key, &transferLengthName, &value)))
+    {
+        *TransferLength = value;
+    }
+
+    WdfRegistryClose(key);
+}
+
 _Use_decl_annotations_
 NTSTATUS
 XnaGuardianEvtDevicePrepareHardware(
@@ -47,9 +93,13 @@ XnaGuardianEvtDevicePrepareHardware(
     UCHAR                                   numberConfiguredPipes;
     UCHAR                                   index;
     WDF_USB_PIPE_INFORMATION                pipeInfo;
+    WDF_USB_PIPE_INFORMATION                interruptPipeInfo;
+    ULONG                                   pendingReads;
+    ULONG                                   transferLength;
     WDFUSBPIPE                              pipe;
     WDF_USB_CONTINUOUS_READER_CONFIG        contReaderConfig;
     WDF_USB_DEVICE_SELECT_CONFIG_PARAMS     configParams;
+    WDF_USB_DEVICE_INFORMATION              deviceInfo;
 
     UNREFERENCED_PARAMETER(ResourcesRaw);
     UNREFERENCED_PARAMETER(ResourcesTranslated);
@@ -83,6 +133,8 @@ XnaGuardianEvtDevicePrepareHardware(
         pDeviceContext->UsbInterface = configParams.Types.SingleInterface.ConfiguredUsbInterface;
         numberConfiguredPipes = configParams.Types.SingleInterface.NumberConfiguredPipes;
 
+        WDF_USB_PIPE_INFORMATION_INIT(&interruptPipeInfo);
+
         //
         // Get pipe handles
         //
@@ -101,23 +153,60 @@ XnaGuardianEvtDevicePrepareHardware(
             //
             WdfUsbTargetPipeSetNoMaximumPacketSizeCheck(pipe);
 
-            if (WdfUsbPipeTypeInterrupt == pipeInfo.PipeType) {
+            if (WdfUsbPipeTypeInterrupt == pipeInfo.PipeType && WdfUsbTargetPipeIsInEndpoint(pipe)) {
                 KdPrint((DRIVERNAME "Interrupt Pipe is 0x%p\n", pipe));
                 pDeviceContext->InterruptPipe = pipe;
+                interruptPipeInfo = pipeInfo;
             }
         }
 
+        //
+        // Without an interrupt-IN pipe there is nothing to read from, HID
+        // class fails such devices as well
+        // 
+        if (pDeviceContext->InterruptPipe == NULL)
+        {
+            TraceEvents(TRACE_LEVEL_ERROR, TRACE_POWER, "No interrupt pipe among %d configured pipes", numberConfiguredPipes);
+            return STATUS_DEVICE_CONFIGURATION_ERROR;
+        }
+
+        //
+        // The meaning of bInterval depends on the speed the device runs at
+        //
+        WDF_USB_DEVICE_INFORMATION_INIT(&deviceInfo);
+
+        status = WdfUsbTargetDeviceRetrieveInformation(pDeviceContext->UsbDevice, &deviceInfo);
+        if (!NT_SUCCESS(status))
+        {
+            TraceEvents(TRACE_LEVEL_ERROR, TRACE_POWER, "WdfUsbTargetDeviceRetrieveInformation failed with status %!STATUS!", status);
+            return status;
+        }
+
+        XNA_READER_PARAMETERS_FROM_ENDPOINT(
+            (deviceInfo.Traits & WDF_USB_DEVICE_TRAIT_AT_HIGH_SPEED) != 0,
+            interruptPipeInfo.Interval, interruptPipeInfo.MaximumPacketSize,
+            &pendingReads, &transferLength);
+
+        XnaGuardianQueryReaderParameters(Device, &pendingReads, &transferLength);
+
+        XNA_READER_PARAMETERS_CLAMP(interruptPipeInfo.MaximumPacketSize, HID_USB_INPUT_REPORT_MAX_LENGTH,
+            &pendingReads, &transferLength);
+
+        TraceEvents(TRACE_LEVEL_INFORMATION, TRACE_POWER,
+            "Continuous reader uses %d pending reads of %d bytes (interval %d, max packet size %d, high speed %d)",
+            pendingReads, transferLength, interruptPipeInfo.Interval, interruptPipeInfo.MaximumPacketSize,
+            (deviceInfo.Traits & WDF_USB_DEVICE_TRAIT_AT_HIGH_SPEED) != 0);
+
         WDF_USB_CONTINUOUS_READER_CONFIG_INIT(&contReaderConfig,
             XnaGuardianEvtUsbTargetPipeReadComplete,
             Device, // Context
-            20); // TransferLength
+            transferLength); // TransferLength
                  //
                  // Reader requests are not posted to the target automatically.
                  // Driver must explictly call WdfIoTargetStart to kick start the
                  // reader. In this sample, it's done in D0Entry.
-                 // By defaut, framework queues two requests to the target
-                 // endpoint. Driver can configure up to 10 requests with CONFIG macro.
                  //
+        contReaderConfig.NumPendingReads = (UCHAR)pendingReads;
         status = WdfUsbTargetPipeConfigContinuousReader(pDeviceContext->InterruptPipe,
             &contReaderConfig);
 
@@ -153,6 +242,8 @@ NTSTATUS XnaGuardianEvtDeviceD0Entry(
 
     if (pDeviceContext->IsHidUsbDevice)
     {
+        InterlockedExchange(&pDeviceContext->UpperUsbRequestsAccepted, TRUE);
+
         //
         // Since continuous reader is configured for this interrupt-pipe, we must explicitly start
         // the I/O target to get the framework to post read requests.
@@ -188,9 +279,17 @@ NTSTATUS XnaGuardianEvtDeviceD0Exit(
 
     if (pDeviceContext->IsHidUsbDevice)
     {
+        //
+        // Full barrier, pairs with the check in UpperUsbRequestPush so no
+        // request stays in the ring past the drain below
+        // 
+        InterlockedExchange(&pDeviceContext->UpperUsbRequestsAccepted, FALSE);
+
         WdfIoTargetStop(WdfUsbTargetPipeGetIoTarget(pDeviceContext->InterruptPipe), WdfIoTargetCancelSentIo);
+        UpperUsbRequestCancelAll(pDeviceContext);
+
         URB_QUEUE_LOCK();
-        WdfIoQueuePurgeSynchronously(pDeviceContext->UpperUsbInterruptRequests);
+        XNA_LATEST_REPORT_DISCARD(&pDeviceContext->LatestReport);
         URB_QUEUE_UNLOCK();
     }
 
@@ -25,6 +25,8 @@ SOFTWARE.
 
 #pragma once
 
+#include "XnaGuardianReader.h"
+
 EVT_WDF_DEVICE_PREPARE_HARDWARE XnaGuardianEvtDevicePrepareHardware;
 EVT_WDF_DEVICE_D0_ENTRY XnaGuardianEvtDeviceD0Entry;
 EVT_WDF_DEVICE_D0_EXIT XnaGuardianEvtDeviceD0Exit;
@@ -97,7 +97,6 @@ UpperUsbInterruptRequestsQueueInitialize(
 )
 {
     NTSTATUS                status;
-    WDF_IO_QUEUE_CONFIG     queueConfig;
     PDEVICE_CONTEXT         pDeviceContext;
     WDF_OBJECT_ATTRIBUTES   attributes;
 
@@ -110,17 +109,10 @@ UpperUsbInterruptRequestsQueueInitialize(
 
     pDeviceContext = DeviceGetContext(Device);
 
-    // Create and assign queue for incoming interrupt transfer
-    WDF_IO_QUEUE_CONFIG_INIT(&queueConfig, WdfIoQueueDispatchManual);
-
-    status = WdfIoQueueCreate(Device, &queueConfig, WDF_NO_OBJECT_ATTRIBUTES, &pDeviceContext->UpperUsbInterruptRequests);
-    if (!NT_SUCCESS(status))
-    {
-        TraceEvents(TRACE_LEVEL_ERROR, TRACE_QUEUE, "WdfIoQueueCreate failed with status %!STATUS!", status);
-        return status;
-    }
+    // Pending incoming interrupt transfers
+    XNA_REQUEST_RING_INIT(&pDeviceContext->UpperUsbInterruptRequests);
 
-    // Create queue lock
+    // Create latest report lock
     status = WdfSpinLockCreate(&attributes, &pDeviceContext->UpperUsbInterruptRequestsLock);
     if (!NT_SUCCESS(status))
     {
@@ -407,14 +399,12 @@ VOID XnaGuardianEvtIoInternalDeviceControl(
             {
                 KdPrint((DRIVERNAME ">> >> Interrupt IN\n"));
 
-                URB_QUEUE_LOCK();
-                status = WdfRequestForwardToIoQueue(Request, pDeviceContext->UpperUsbInterruptRequests);
-                URB_QUEUE_UNLOCK();
+                status = XnaGuardianHidUsbQueueInterruptRequest(Device, Request);
 
                 if (!NT_SUCCESS(status))
                 {
-                    KdPrint((DRIVERNAME "WdfRequestForwardToIoQueue failed with status 0x%X\n", status));
-                    WdfRequestComplete(Request, STATUS_UNSUCCESSFUL);
+                    KdPrint((DRIVERNAME "XnaGuardianHidUsbQueueInterruptRequest failed with status 0x%X\n", status));
+                    WdfRequestComplete(Request, status);
                 }
 
                 return;
@@ -33,7 +33,8 @@ EXTERN_C_START
 
 
 extern XINPUT_PAD_STATE_INTERNAL    PadStates[XINPUT_MAX_DEVICES];
-extern XINPUT_GAMEPAD_STATE         PeekPadCache[XINPUT_MAX_DEVICES];
+extern XNA_SEQ_LOCK                 PadStatesSequence[XINPUT_MAX_DEVICES];
+extern XNA_PEEK_CACHE_ENTRY         PeekPadCache[XINPUT_MAX_DEVICES];
 
 NTSTATUS
 XnaGuardianQueueInitialize(
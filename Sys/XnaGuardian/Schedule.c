@@ -0,0 +1,117 @@
+/*
+MIT License
+
+Copyright (c) 2017 Benjamin "Nefarius" Hglinger
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#include "Driver.h"
+#include "Schedule.tmh"
+
+
+WDFSPINLOCK                 PadSchedulesLock;
+
+static XINPUT_OVERRIDE_SCHEDULE PadSchedules[XINPUT_MAX_DEVICES];
+
+_Use_decl_annotations_
+NTSTATUS
+XInputOverrideScheduleAdd(
+    const XINPUT_EXT_SCHEDULE_GAMEPAD* Request,
+    WDFFILEOBJECT Owner
+)
+{
+    XINPUT_OVERRIDE_SCHEDULE_ENTRY  entry;
+    UCHAR                           userIndex = Request->Override.UserIndex;
+    BOOLEAN                         ret;
+
+    if (!VALID_USER_INDEX(userIndex)
+        || Request->Override.Size != sizeof(XINPUT_EXT_OVERRIDE_GAMEPAD)
+        || Request->Duration == 0)
+    {
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    XINPUT_OVERRIDE_SCHEDULE_ENTRY_FROM_REQUEST(&entry, Request, Owner, KeQueryUnbiasedInterruptTime());
+
+    WdfSpinLockAcquire(PadSchedulesLock);
+    ret = XINPUT_OVERRIDE_SCHEDULE_INSERT(&PadSchedules[userIndex], &entry);
+    WdfSpinLockRelease(PadSchedulesLock);
+
+    if (!ret)
+    {
+        TraceEvents(TRACE_LEVEL_WARNING, TRACE_SIDEBAND, "%!FUNC! Schedule of pad %d is full", userIndex);
+        return STATUS_DEVICE_BUSY;
+    }
+
+    TraceEvents(TRACE_LEVEL_VERBOSE, TRACE_SIDEBAND, "%!FUNC! Pad %d override 0x%X scheduled at %I64u for %I64u",
+        userIndex, entry.Override.Overrides, entry.ActivationTime, Request->Duration);
+
+    return STATUS_SUCCESS;
+}
+
+_Use_decl_annotations_
+BOOLEAN
+XInputOverrideScheduleGet(
+    UCHAR UserIndex,
+    ULONGLONG Time,
+    PXINPUT_PAD_STATE_INTERNAL State
+)
+{
+    XINPUT_EXT_OVERRIDE_GAMEPAD override;
+    BOOLEAN                     ret;
+
+    //
+    // Cheap check without the lock, a racing insert is seen next report
+    //
+    if (PadSchedules[UserIndex].Count == 0)
+        return FALSE;
+
+    XINPUT_EXT_OVERRIDE_GAMEPAD_INIT(&override, UserIndex);
+
+    WdfSpinLockAcquire(PadSchedulesLock);
+    ret = XINPUT_OVERRIDE_SCHEDULE_EVALUATE(&PadSchedules[UserIndex], Time, &override);
+    WdfSpinLockRelease(PadSchedulesLock);
+
+    if (!ret)
+        return FALSE;
+
+    XINPUT_PAD_STATE_INTERNAL_SET(State, &override);
+
+    return TRUE;
+}
+
+_Use_decl_annotations_
+VOID
+XInputOverrideScheduleRelease(
+    WDFFILEOBJECT Owner
+)
+{
+    UCHAR   index;
+
+    WdfSpinLockAcquire(PadSchedulesLock);
+
+    for (index = 0; index < XINPUT_MAX_DEVICES; index++)
+    {
+        XINPUT_OVERRIDE_SCHEDULE_REMOVE_OWNER(&PadSchedules[index], Owner);
+    }
+
+    WdfSpinLockRelease(PadSchedulesLock);
+}
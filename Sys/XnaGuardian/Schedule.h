@@ -0,0 +1,66 @@
+/*
+MIT License
+
+Copyright (c) 2017 Benjamin "Nefarius" Hglinger
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#pragma once
+
+#include "XInputOverrideSchedule.h"
+
+EXTERN_C_START
+
+//
+// Protects the override schedules of all pads
+//
+extern WDFSPINLOCK  PadSchedulesLock;
+
+//
+// Queues a timed override request of Owner received at the current time.
+//
+NTSTATUS
+XInputOverrideScheduleAdd(
+    _In_ const XINPUT_EXT_SCHEDULE_GAMEPAD* Request,
+    _In_ WDFFILEOBJECT Owner
+);
+
+//
+// Evaluates the schedule of a pad at Time, which should be the completion
+// time of the report. Callable at IRQL <= DISPATCH_LEVEL. Returns FALSE if
+// no scheduled override is active.
+//
+BOOLEAN
+XInputOverrideScheduleGet(
+    _In_ UCHAR UserIndex,
+    _In_ ULONGLONG Time,
+    _Out_ PXINPUT_PAD_STATE_INTERNAL State
+);
+
+//
+// Removes all scheduled overrides of Owner.
+//
+VOID
+XInputOverrideScheduleRelease(
+    _In_ WDFFILEOBJECT Owner
+);
+
+EXTERN_C_END
@@ -54,6 +54,7 @@ FilterCreateControlDevice(
     NTSTATUS                    status;
     WDFQUEUE                    queue;
     WDF_FILEOBJECT_CONFIG       foCfg;
+    WDF_OBJECT_ATTRIBUTES       fileAttributes;
     DECLARE_CONST_UNICODE_STRING(ntDeviceName, NTDEVICE_NAME_STRING);
     DECLARE_CONST_UNICODE_STRING(symbolicLinkName, SYMBOLIC_NAME_STRING);
 
@@ -111,7 +112,8 @@ FilterCreateControlDevice(
     }
 
     WDF_FILEOBJECT_CONFIG_INIT(&foCfg, NULL, NULL, XnaGuardianSidebandFileCleanup);
-    WdfDeviceInitSetFileObjectConfig(pInit, &foCfg, WDF_NO_OBJECT_ATTRIBUTES);
+    WDF_OBJECT_ATTRIBUTES_INIT_CONTEXT_TYPE(&fileAttributes, SIDEBAND_FILE_CONTEXT);
+    WdfDeviceInitSetFileObjectConfig(pInit, &foCfg, &fileAttributes);
 
     //
     // Specify the size of device context
@@ -159,6 +161,30 @@ FilterCreateControlDevice(
         goto Error;
     }
 
+    //
+    // Queues for pended wait-for-change requests
+    //
+    status = PeekPadCacheInitialize(controlDevice);
+    if (!NT_SUCCESS(status)) {
+        goto Error;
+    }
+
+    //
+    // Queue for the pended shared memory attach request
+    //
+    status = XnaGuardianMailboxInitialize(controlDevice);
+    if (!NT_SUCCESS(status)) {
+        goto Error;
+    }
+
+    //
+    // Timer removing layers with an expired lease
+    //
+    status = XInputOverrideLayersInitialize(controlDevice);
+    if (!NT_SUCCESS(status)) {
+        goto Error;
+    }
+
     //
     // Control devices must notify WDF when they are done initializing.   I/O is
     // rejected until this call is made.
@@ -207,11 +233,117 @@ FilterDeleteControlDevice(
     KdPrint((DRIVERNAME "Deleting Control Device\n"));
 
     if (ControlDevice) {
+        PeekPadCacheUninitialize();
+        XnaGuardianMailboxUninitialize();
+        XInputOverrideLayersUninitialize();
         WdfObjectDelete(ControlDevice);
         ControlDevice = NULL;
     }
 }
 
+//
+// Completes a pending interrupt transfer of a HID USB device with the
+// current effective overrides applied.
+// 
+_Use_decl_annotations_
+VOID
+XnaGuardianSidebandUpdateHidUsbDevice(
+    UCHAR UserIndex
+)
+{
+    WDFDEVICE                       device;
+    WDFREQUEST                      UsbRequest;
+    PUCHAR                          pUpperBuffer;
+    ULONG                           upperBufferLength;
+    BOOLEAN                         ret;
+
+    //
+    // Keep the device alive in case it gets removed meanwhile
+    // 
+    WdfWaitLockAcquire(HidUsbDeviceSlotsLock, NULL);
+    device = (WDFDEVICE)XNA_SLOT_TABLE_LOOKUP(&HidUsbDeviceSlots, UserIndex);
+    if (device)
+    {
+        WdfObjectReference(device);
+    }
+    WdfWaitLockRelease(HidUsbDeviceSlotsLock);
+
+    if (!device)
+    {
+        return;
+    }
+
+    ret = GetUpperUsbRequest(
+        device,
+        &UsbRequest,
+        &pUpperBuffer,
+        &upperBufferLength);
+
+    if (ret)
+    {
+        KdPrint((DRIVERNAME "GetUpperUsbRequest succeeded\n"));
+
+#ifdef DBG
+        KdPrint((DRIVERNAME "SIDEBAND_BUFFER_BEFORE: "));
+        for (ULONG i = 0; i < upperBufferLength; i++)
+        {
+            KdPrint(("%02X ", pUpperBuffer[i]));
+        }
+        KdPrint(("\n"));
+#endif
+
+        XnaGuardianHidUsbApplyOverrides(UserIndex, KeQueryUnbiasedInterruptTime(), pUpperBuffer, upperBufferLength);
+
+#ifdef DBG
+        KdPrint((DRIVERNAME "SIDEBAND_BUFFER_AFTER: "));
+        for (ULONG i = 0; i < upperBufferLength; i++)
+        {
+            KdPrint(("%02X ", pUpperBuffer[i]));
+        }
+        KdPrint(("\n"));
+#endif
+
+        WdfRequestComplete(UsbRequest, STATUS_SUCCESS);
+    }
+
+    WdfObjectDereference(device);
+}
+
+//
+// Sets the legacy override of a pad on behalf of a handle and keeps the
+// override as base for the delta requests of that handle.
+// 
+static NTSTATUS XnaGuardianSidebandSetOverride(
+    _In_ WDFFILEOBJECT FileObject,
+    _In_ const XINPUT_EXT_OVERRIDE_GAMEPAD* Override
+)
+{
+    NTSTATUS                        status;
+    PXINPUT_EXT_OVERRIDE_GAMEPAD    pBase;
+
+    status = XInputOverrideLayerSetLegacy(Override, FileObject);
+    if (!NT_SUCCESS(status))
+    {
+        return status;
+    }
+
+    pBase = &SidebandFileGetContext(FileObject)->PadOverrides[Override->UserIndex];
+
+    RtlCopyMemory(pBase, Override, Override->Size);
+
+    //
+    // Pre high resolution trigger layout
+    // 
+    if (Override->Size < sizeof(XINPUT_EXT_OVERRIDE_GAMEPAD))
+    {
+        pBase->Size = sizeof(XINPUT_EXT_OVERRIDE_GAMEPAD);
+        pBase->LeftTrigger = XINPUT_TRIGGER_TO_HIGH_RES(pBase->Gamepad.bLeftTrigger);
+        pBase->RightTrigger = XINPUT_TRIGGER_TO_HIGH_RES(pBase->Gamepad.bRightTrigger);
+    }
+
+    return STATUS_SUCCESS;
+}
+
 //
 // Handles requests sent to the sideband control device.
 // 
@@ -231,21 +363,21 @@ VOID XnaGuardianSidebandIoDeviceControl(
     PVOID                           pBuffer;
     PXINPUT_EXT_OVERRIDE_GAMEPAD    pOverride;
     PXINPUT_EXT_PEEK_GAMEPAD        pPeek;
+    PXINPUT_EXT_WAIT_GAMEPAD        pWait;
+    PXINPUT_EXT_VERSIONED_GAMEPAD_STATE pVersioned;
     UCHAR                           userIndex;
-    PXINPUT_PAD_STATE_INTERNAL      pPad;
-    WDFREQUEST                      UsbRequest;
-    PUCHAR                          pUpperBuffer;
-    ULONG                           upperBufferLength;
-    BOOLEAN                         ret;
-    PX360_HID_USB_INPUT_REPORT      pX360Report;
-    PXBONE_HID_USB_INPUT_REPORT     pXboneReport;
+    PXINPUT_EXT_OVERRIDE_GAMEPAD_LAYER  pLayer;
+    PXINPUT_EXT_OVERRIDE_GAMEPAD_BATCH  pBatch;
+    PXINPUT_EXT_SCHEDULE_GAMEPAD        pSchedule;
+    PSIDEBAND_FILE_CONTEXT              pFileContext;
+    XINPUT_EXT_OVERRIDE_GAMEPAD     override;
+    ULONG                           index;
 
     KdPrint((DRIVERNAME "XnaGuardianSidebandIoDeviceControl called with code 0x%X\n", IoControlCode));
 
     UNREFERENCED_PARAMETER(Queue);
     UNREFERENCED_PARAMETER(OutputBufferLength);
     UNREFERENCED_PARAMETER(InputBufferLength);
-    UNREFERENCED_PARAMETER(pX360Report);
 
     switch (IoControlCode)
     {
@@ -257,8 +389,8 @@ VOID XnaGuardianSidebandIoDeviceControl(
         // 
         // Retrieve input buffer
         // 
-        status = WdfRequestRetrieveInputBuffer(Request, sizeof(XINPUT_EXT_OVERRIDE_GAMEPAD), &pBuffer, &buflen);
-        if (!NT_SUCCESS(status) || buflen < sizeof(XINPUT_EXT_OVERRIDE_GAMEPAD))
+        status = WdfRequestRetrieveInputBuffer(Request, XINPUT_EXT_OVERRIDE_GAMEPAD_V1_SIZE, &pBuffer, &buflen);
+        if (!NT_SUCCESS(status) || buflen < XINPUT_EXT_OVERRIDE_GAMEPAD_V1_SIZE)
         {
             KdPrint((DRIVERNAME "WdfRequestRetrieveInputBuffer failed with status 0x%X\n", status));
             break;
@@ -267,9 +399,11 @@ VOID XnaGuardianSidebandIoDeviceControl(
         pOverride = (PXINPUT_EXT_OVERRIDE_GAMEPAD)pBuffer;
 
         //
-        // Validate padding
+        // Validate padding (current or pre high resolution trigger layout)
         // 
-        if (pOverride->Size != sizeof(XINPUT_EXT_OVERRIDE_GAMEPAD))
+        if ((pOverride->Size != sizeof(XINPUT_EXT_OVERRIDE_GAMEPAD)
+            && pOverride->Size != XINPUT_EXT_OVERRIDE_GAMEPAD_V1_SIZE)
+            || buflen < pOverride->Size)
         {
             status = STATUS_INVALID_PARAMETER;
             break;
@@ -285,55 +419,170 @@ VOID XnaGuardianSidebandIoDeviceControl(
         }
 
         //
-        // Set pad overrides
+        // Set pad overrides, stacked with the ones of other handles on layer 0
         // 
-        pPad = &PadStates[pOverride->UserIndex];
-        pPad->Overrides = pOverride->Overrides;
-        pPad->Gamepad = pOverride->Gamepad;
+        status = XnaGuardianSidebandSetOverride(WdfRequestGetFileObject(Request), pOverride);
+        if (!NT_SUCCESS(status))
+        {
+            break;
+        }
+
+        XnaGuardianSidebandUpdateHidUsbDevice(pOverride->UserIndex);
+
+        break;
+#pragma endregion
 
-        ret = GetUpperUsbRequest(
-            WdfCollectionGetItem(HidUsbDeviceCollection, pOverride->UserIndex),
-            &UsbRequest,
-            &pUpperBuffer,
-            &upperBufferLength);
+#pragma region IOCTL_XINPUT_EXT_OVERRIDE_GAMEPAD_DELTA
+    case IOCTL_XINPUT_EXT_OVERRIDE_GAMEPAD_DELTA:
 
-        if (ret)
+        KdPrint((DRIVERNAME ">> IOCTL_XINPUT_EXT_OVERRIDE_GAMEPAD_DELTA\n"));
+
+        // 
+        // Retrieve input buffer
+        // 
+        status = WdfRequestRetrieveInputBuffer(Request, XINPUT_EXT_OVERRIDE_GAMEPAD_DELTA_HEADER_SIZE, &pBuffer, &buflen);
+        if (!NT_SUCCESS(status))
         {
-            KdPrint((DRIVERNAME "GetUpperUsbRequest succeeded\n"));
+            KdPrint((DRIVERNAME "WdfRequestRetrieveInputBuffer failed with status 0x%X\n", status));
+            break;
+        }
 
-            if (upperBufferLength == XBONE_HID_USB_INPUT_REPORT_BUFFER_LENGTH)
-            {
-                KdPrint((DRIVERNAME "Report is XBONE Report\n"));
-                KdPrint((DRIVERNAME "BUTTON_OVERRIDES: 0x%X\n", pPad->Overrides));
+        userIndex = XINPUT_EXT_OVERRIDE_GAMEPAD_DELTA_USER_INDEX((PUCHAR)pBuffer);
 
-                pXboneReport = (PXBONE_HID_USB_INPUT_REPORT)pUpperBuffer;
+        // 
+        // Validate range
+        // 
+        if (!VALID_USER_INDEX(userIndex))
+        {
+            status = STATUS_INVALID_PARAMETER;
+            break;
+        }
 
-#ifdef DBG
-                KdPrint((DRIVERNAME "SIDEBAND_BUFFER_BEFORE: "));
-                for (ULONG i = 0; i < upperBufferLength; i++)
-                {
-                    KdPrint(("%02X ", pUpperBuffer[i]));
-                }
-                KdPrint(("\n"));
-#endif
+        pFileContext = SidebandFileGetContext(WdfRequestGetFileObject(Request));
 
-                XINPUT_GAMEPAD_TO_XBONE_HID_USB_INPUT_REPORT(pPad, pXboneReport);
+        override = pFileContext->PadOverrides[userIndex];
 
-#ifdef DBG
-                KdPrint((DRIVERNAME "SIDEBAND_BUFFER_AFTER: "));
-                for (ULONG i = 0; i < upperBufferLength; i++)
-                {
-                    KdPrint(("%02X ", pUpperBuffer[i]));
-                }
-                KdPrint(("\n"));
-#endif
-            }
+        //
+        // Nothing was set through this handle yet
+        // 
+        if (override.Size == 0)
+        {
+            XINPUT_EXT_OVERRIDE_GAMEPAD_INIT(&override, userIndex);
+        }
+
+        //
+        // Validates the length against the field bitmap
+        // 
+        if (!XINPUT_EXT_OVERRIDE_GAMEPAD_DELTA_DECODE((PUCHAR)pBuffer, buflen, &override))
+        {
+            status = STATUS_INVALID_PARAMETER;
+            break;
+        }
+
+        status = XnaGuardianSidebandSetOverride(WdfRequestGetFileObject(Request), &override);
+        if (!NT_SUCCESS(status))
+        {
+            break;
+        }
+
+        XnaGuardianSidebandUpdateHidUsbDevice(userIndex);
+
+        break;
+#pragma endregion
+
+#pragma region IOCTL_XINPUT_EXT_OVERRIDE_GAMEPAD_STATE_BATCH
+    case IOCTL_XINPUT_EXT_OVERRIDE_GAMEPAD_STATE_BATCH:
+
+        KdPrint((DRIVERNAME ">> IOCTL_XINPUT_EXT_OVERRIDE_GAMEPAD_STATE_BATCH\n"));
+
+        // 
+        // Retrieve input buffer
+        // 
+        status = WdfRequestRetrieveInputBuffer(Request, XINPUT_EXT_OVERRIDE_GAMEPAD_BATCH_SIZE(0), &pBuffer, &buflen);
+        if (!NT_SUCCESS(status))
+        {
+            KdPrint((DRIVERNAME "WdfRequestRetrieveInputBuffer failed with status 0x%X\n", status));
+            break;
+        }
+
+        pBatch = (PXINPUT_EXT_OVERRIDE_GAMEPAD_BATCH)pBuffer;
+
+        //
+        // Validate all entries before applying any
+        // 
+        if (!XINPUT_EXT_OVERRIDE_GAMEPAD_BATCH_VALIDATE(pBatch, buflen))
+        {
+            status = STATUS_INVALID_PARAMETER;
+            break;
+        }
 
-            WdfRequestComplete(UsbRequest, STATUS_SUCCESS);
+        //
+        // Set pad overrides, like the single pad request on layer 0. The
+        // user indices were validated above, so no entry can fail and the
+        // batch never applies partially.
+        // 
+        for (index = 0; index < pBatch->Count; index++)
+        {
+            XINPUT_EXT_OVERRIDE_GAMEPAD_FROM_BATCH_ENTRY(&override, &pBatch->Entries[index]);
+
+            (VOID)XnaGuardianSidebandSetOverride(WdfRequestGetFileObject(Request), &override);
         }
 
         status = STATUS_SUCCESS;
 
+        //
+        // Push the new state to all affected HID USB devices in one sweep
+        // 
+        for (index = 0; index < pBatch->Count; index++)
+        {
+            XnaGuardianSidebandUpdateHidUsbDevice(pBatch->Entries[index].UserIndex);
+        }
+
+        break;
+#pragma endregion
+
+#pragma region IOCTL_XINPUT_EXT_OVERRIDE_GAMEPAD_LAYER
+    case IOCTL_XINPUT_EXT_OVERRIDE_GAMEPAD_LAYER:
+
+        KdPrint((DRIVERNAME ">> IOCTL_XINPUT_EXT_OVERRIDE_GAMEPAD_LAYER\n"));
+
+        // 
+        // Retrieve input buffer
+        // 
+        status = WdfRequestRetrieveInputBuffer(Request, XINPUT_EXT_OVERRIDE_GAMEPAD_LAYER_V1_SIZE, &pBuffer, &buflen);
+        if (!NT_SUCCESS(status) || buflen < XINPUT_EXT_OVERRIDE_GAMEPAD_LAYER_V1_SIZE)
+        {
+            KdPrint((DRIVERNAME "WdfRequestRetrieveInputBuffer failed with status 0x%X\n", status));
+            break;
+        }
+
+        pLayer = (PXINPUT_EXT_OVERRIDE_GAMEPAD_LAYER)pBuffer;
+
+        //
+        // Validate padding (current or pre lease layout)
+        // 
+        if ((pLayer->Size != sizeof(XINPUT_EXT_OVERRIDE_GAMEPAD_LAYER)
+            && pLayer->Size != XINPUT_EXT_OVERRIDE_GAMEPAD_LAYER_V1_SIZE)
+            || buflen < pLayer->Size
+            || pLayer->Override.Size != sizeof(XINPUT_EXT_OVERRIDE_GAMEPAD))
+        {
+            status = STATUS_INVALID_PARAMETER;
+            break;
+        }
+
+        //
+        // Validates range and blend mode
+        // 
+        status = XInputOverrideLayerSet(pLayer->LayerId, pLayer->Priority, pLayer->BlendMode, &pLayer->Override,
+            WdfRequestGetFileObject(Request),
+            (pLayer->Size == sizeof(XINPUT_EXT_OVERRIDE_GAMEPAD_LAYER)) ? pLayer->LeaseDuration : 0);
+        if (!NT_SUCCESS(status))
+        {
+            break;
+        }
+
+        XnaGuardianSidebandUpdateHidUsbDevice(pLayer->Override.UserIndex);
+
         break;
 #pragma endregion
 
@@ -384,12 +633,133 @@ VOID XnaGuardianSidebandIoDeviceControl(
             break;
         }
 
-        RtlCopyBytes(pBuffer, &PeekPadCache[userIndex], sizeof(XINPUT_GAMEPAD_STATE));
+        //
+        // Callers aware of the sequence get it along with the state
+        // 
+        if (buflen >= sizeof(XINPUT_EXT_VERSIONED_GAMEPAD_STATE))
+        {
+            pVersioned = (PXINPUT_EXT_VERSIONED_GAMEPAD_STATE)pBuffer;
+            pVersioned->Sequence = PeekPadCacheGet(userIndex, &pVersioned->Gamepad);
+
+            WdfRequestCompleteWithInformation(Request, status, sizeof(XINPUT_EXT_VERSIONED_GAMEPAD_STATE));
+            return;
+        }
+
+        PeekPadCacheGet(userIndex, (PXINPUT_GAMEPAD_STATE)pBuffer);
 
         WdfRequestCompleteWithInformation(Request, status, sizeof(XINPUT_GAMEPAD_STATE));
         return;
 #pragma endregion 
 
+#pragma region IOCTL_XINPUT_EXT_WAIT_GAMEPAD_STATE
+    case IOCTL_XINPUT_EXT_WAIT_GAMEPAD_STATE:
+
+        KdPrint((DRIVERNAME ">> IOCTL_XINPUT_EXT_WAIT_GAMEPAD_STATE\n"));
+
+        // 
+        // Retrieve input buffer
+        // 
+        status = WdfRequestRetrieveInputBuffer(Request, sizeof(XINPUT_EXT_WAIT_GAMEPAD), &pBuffer, &buflen);
+        if (!NT_SUCCESS(status) || buflen < sizeof(XINPUT_EXT_WAIT_GAMEPAD))
+        {
+            KdPrint((DRIVERNAME "WdfRequestRetrieveInputBuffer failed with status 0x%X\n", status));
+            break;
+        }
+
+        pWait = (PXINPUT_EXT_WAIT_GAMEPAD)pBuffer;
+
+        //
+        // Validate padding
+        // 
+        if (pWait->Size != sizeof(XINPUT_EXT_WAIT_GAMEPAD))
+        {
+            status = STATUS_INVALID_PARAMETER;
+            break;
+        }
+
+        userIndex = pWait->UserIndex;
+
+        // 
+        // Validate range
+        // 
+        if (!VALID_USER_INDEX(userIndex))
+        {
+            status = STATUS_INVALID_PARAMETER;
+            break;
+        }
+
+        // 
+        // Validate output buffer
+        // 
+        status = WdfRequestRetrieveOutputBuffer(Request, sizeof(XINPUT_EXT_VERSIONED_GAMEPAD_STATE), &pBuffer, &buflen);
+        if (!NT_SUCCESS(status))
+        {
+            KdPrint((DRIVERNAME "WdfRequestRetrieveOutputBuffer failed with status 0x%X\n", status));
+            break;
+        }
+
+        //
+        // Completes now or once the state changes
+        // 
+        PeekPadCacheWait(Request, userIndex, pWait->Sequence);
+        return;
+#pragma endregion
+
+#pragma region IOCTL_XINPUT_EXT_MAILBOX_ATTACH
+    case IOCTL_XINPUT_EXT_MAILBOX_ATTACH:
+
+        KdPrint((DRIVERNAME ">> IOCTL_XINPUT_EXT_MAILBOX_ATTACH\n"));
+
+        //
+        // Stays pending until detached, keeps the mailbox pages locked
+        // 
+        XnaGuardianMailboxAttach(Request);
+        return;
+#pragma endregion
+
+#pragma region IOCTL_XINPUT_EXT_MAILBOX_DETACH
+    case IOCTL_XINPUT_EXT_MAILBOX_DETACH:
+
+        KdPrint((DRIVERNAME ">> IOCTL_XINPUT_EXT_MAILBOX_DETACH\n"));
+
+        status = XnaGuardianMailboxDetach(WdfRequestGetFileObject(Request));
+        break;
+#pragma endregion
+
+#pragma region IOCTL_XINPUT_EXT_SCHEDULE_GAMEPAD_STATE
+    case IOCTL_XINPUT_EXT_SCHEDULE_GAMEPAD_STATE:
+
+        KdPrint((DRIVERNAME ">> IOCTL_XINPUT_EXT_SCHEDULE_GAMEPAD_STATE\n"));
+
+        // 
+        // Retrieve input buffer
+        // 
+        status = WdfRequestRetrieveInputBuffer(Request, sizeof(XINPUT_EXT_SCHEDULE_GAMEPAD), &pBuffer, &buflen);
+        if (!NT_SUCCESS(status) || buflen < sizeof(XINPUT_EXT_SCHEDULE_GAMEPAD))
+        {
+            KdPrint((DRIVERNAME "WdfRequestRetrieveInputBuffer failed with status 0x%X\n", status));
+            break;
+        }
+
+        pSchedule = (PXINPUT_EXT_SCHEDULE_GAMEPAD)pBuffer;
+
+        //
+        // Validate padding
+        // 
+        if (pSchedule->Size != sizeof(XINPUT_EXT_SCHEDULE_GAMEPAD))
+        {
+            status = STATUS_INVALID_PARAMETER;
+            break;
+        }
+
+        //
+        // Applied by the completion routines once due, range is validated
+        // on insertion
+        // 
+        status = XInputOverrideScheduleAdd(pSchedule, WdfRequestGetFileObject(Request));
+        break;
+#pragma endregion
+
     default:
         break;
     }
@@ -404,15 +774,28 @@ XnaGuardianSidebandFileCleanup(
     WDFFILEOBJECT  FileObject
 )
 {
-    ULONG   index;
-
-    UNREFERENCED_PARAMETER(FileObject);
+    ULONG   pads;
+    UCHAR   index;
 
     KdPrint((DRIVERNAME "XnaGuardianSidebandFileCleanup called\n"));
 
+    PeekPadCacheCancelWaits(FileObject);
+
+    XnaGuardianMailboxDetach(FileObject);
+
+    //
+    // Only the overrides of this handle are dropped, other clients keep theirs
+    // 
+    XInputOverrideScheduleRelease(FileObject);
+
+    pads = XInputOverrideLayersRelease(FileObject);
+
     for (index = 0; index < XINPUT_MAX_DEVICES; index++)
     {
-        RtlZeroBytes(&PadStates[index], sizeof(XINPUT_PAD_STATE_INTERNAL));
+        if (pads & (1UL << index))
+        {
+            XnaGuardianSidebandUpdateHidUsbDevice(index);
+        }
     }
 }
 
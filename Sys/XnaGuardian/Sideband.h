@@ -26,10 +26,31 @@ SOFTWARE.
 #pragma once
 
 #include "driver.h"
+#include "XInputOverrideDelta.h"
 
 #define NTDEVICE_NAME_STRING        L"\\Device\\XnaGuardian"
 #define SYMBOLIC_NAME_STRING        L"\\DosDevices\\XnaGuardian"
 
+//
+// Per handle state of the control device
+//
+typedef struct _SIDEBAND_FILE_CONTEXT
+{
+    //
+    // Last legacy override set through the handle, base of delta requests
+    //
+    XINPUT_EXT_OVERRIDE_GAMEPAD PadOverrides[XINPUT_MAX_DEVICES];
+
+    //
+    // Legacy overrides of the handle, stacked into layer 0 with the ones of
+    // other handles and protected by PadOverrideLayersLock
+    //
+    XINPUT_LEGACY_OVERRIDE      LegacyOverrides[XINPUT_MAX_DEVICES];
+
+} SIDEBAND_FILE_CONTEXT, *PSIDEBAND_FILE_CONTEXT;
+
+WDF_DECLARE_CONTEXT_TYPE_WITH_NAME(SIDEBAND_FILE_CONTEXT, SidebandFileGetContext)
+
 EVT_WDF_IO_QUEUE_IO_DEVICE_CONTROL XnaGuardianSidebandIoDeviceControl;
 EVT_WDF_FILE_CLEANUP XnaGuardianSidebandFileCleanup;
 
@@ -42,3 +63,8 @@ VOID
 FilterDeleteControlDevice(
     WDFDEVICE Device
 );
+
+VOID
+XnaGuardianSidebandUpdateHidUsbDevice(
+    _In_ UCHAR UserIndex
+);
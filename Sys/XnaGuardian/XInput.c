@@ -91,9 +91,13 @@ void XInputGetGamepadStateCompleted(
     PXINPUT_GAMEPAD_STATE           pGamepad;
     PDEVICE_CONTEXT                 pDeviceContext;
     PXINPUT_PAD_IDENTIFIER_CONTEXT  pRequestContext;
-    PXINPUT_PAD_STATE_INTERNAL      pPad;
+    XINPUT_PAD_STATE_INTERNAL       pad;
+    XINPUT_PAD_STATE_INTERNAL       scheduled;
+    XINPUT_PAD_STATE_INTERNAL       mailbox;
+    BOOLEAN                         hasScheduled;
+    BOOLEAN                         hasMailbox;
+    ULONGLONG                       completionTime;
     LONG                            padIndex = 0;
-    LONG                            nButtonOverrides;
 
     UNREFERENCED_PARAMETER(Target);
     UNREFERENCED_PARAMETER(Params);
@@ -102,6 +106,11 @@ void XInputGetGamepadStateCompleted(
 
     status = WdfRequestGetStatus(Request);
 
+    //
+    // Scheduled overrides are evaluated at the time the report arrived
+    // 
+    completionTime = KeQueryUnbiasedInterruptTime();
+
     KdPrint((DRIVERNAME "IOCTL_XINPUT_GET_GAMEPAD_STATE called with status 0x%x\n", status));
 
     pDeviceContext = DeviceGetContext(Context);
@@ -136,10 +145,11 @@ void XInputGetGamepadStateCompleted(
     }
 
     //
-    // Get global pad override data
+    // Get a consistent snapshot of the global pad override data
     // 
-
-    pPad = &PadStates[padIndex];
+    XInputOverrideLayersGetEffective((UCHAR)padIndex, &pad);
+    hasScheduled = XInputOverrideScheduleGet((UCHAR)padIndex, completionTime, &scheduled);
+    hasMailbox = XnaGuardianMailboxGet((UCHAR)padIndex, &mailbox);
 
     status = WdfRequestRetrieveOutputBuffer(Request, IO_GET_GAMEPAD_STATE_OUT_SIZE, &buffer, &buflen);
 
@@ -151,38 +161,27 @@ void XInputGetGamepadStateCompleted(
         pGamepad = GAMEPAD_FROM_STATE_BUFFER(buffer);
 
         //
-        // Cache the values of the physical pad for use in peek call
+        // Cache the values of the physical pad for use in peek and wait calls
         // 
-        RtlCopyBytes(&PeekPadCache[padIndex], pGamepad, sizeof(XINPUT_GAMEPAD_STATE));
+        PeekPadCacheUpdate((UCHAR)padIndex, pGamepad);
 
         //
-        // Override buttons
+        // Override buttons and axes
         // 
+        XINPUT_GAMEPAD_STATE_MERGE(pGamepad, &pad.Gamepad, &pad.Mask);
 
-        nButtonOverrides = pPad->Overrides & 0xFFFF;
-        pGamepad->wButtons = (pGamepad->wButtons&~nButtonOverrides) | (pPad->Gamepad.wButtons&nButtonOverrides);
+        if (hasScheduled)
+        {
+            XINPUT_GAMEPAD_STATE_MERGE(pGamepad, &scheduled.Gamepad, &scheduled.Mask);
+        }
 
         //
-        // Override axes
-        //
-
-        // Triggers
-        if (pPad->Overrides & XINPUT_GAMEPAD_OVERRIDE_LEFT_TRIGGER)
-            pGamepad->bLeftTrigger = pPad->Gamepad.bLeftTrigger;
-        if (pPad->Overrides & XINPUT_GAMEPAD_OVERRIDE_RIGHT_TRIGGER)
-            pGamepad->bRightTrigger = pPad->Gamepad.bRightTrigger;
-
-        // Left Thumb
-        if (pPad->Overrides & XINPUT_GAMEPAD_OVERRIDE_LEFT_THUMB_X)
-            pGamepad->sThumbLX = pPad->Gamepad.sThumbLX;
-        if (pPad->Overrides & XINPUT_GAMEPAD_OVERRIDE_LEFT_THUMB_Y)
-            pGamepad->sThumbLY = pPad->Gamepad.sThumbLY;
-
-        // Right Thumb
-        if (pPad->Overrides & XINPUT_GAMEPAD_OVERRIDE_RIGHT_THUMB_X)
-            pGamepad->sThumbRX = pPad->Gamepad.sThumbRX;
-        if (pPad->Overrides & XINPUT_GAMEPAD_OVERRIDE_RIGHT_THUMB_Y)
-            pGamepad->sThumbRY = pPad->Gamepad.sThumbRY;
+        // Shared memory overrides take precedence over all layers
+        // 
+        if (hasMailbox)
+        {
+            XINPUT_GAMEPAD_STATE_MERGE(pGamepad, &mailbox.Gamepad, &mailbox.Mask);
+        }
     }
     else
     {
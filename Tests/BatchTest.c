@@ -0,0 +1,323 @@
+/*
+MIT License
+
+Copyright (c) 2017 Benjamin "Nefarius" Hglinger
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+
+
+#include "XnaTest.h"
+#include "Public.h"
+#include "XInputOverrides.h"
+#include "XnaGuardianShared.h"
+
+#define BATCH_ENTRY_OFFSET(_index_) \
+    (FIELD_OFFSET(XINPUT_EXT_OVERRIDE_GAMEPAD_BATCH, Entries) + (_index_) * sizeof(XINPUT_EXT_OVERRIDE_GAMEPAD_BATCH_ENTRY))
+
+//
+// Bytes of a received buffer, every read is checked against its length
+//
+typedef struct _BATCH_TEST_BUFFER
+{
+    const UCHAR*    Buffer;
+    size_t          Length;
+
+} BATCH_TEST_BUFFER, *PBATCH_TEST_BUFFER;
+
+static ULONG BatchTestRead(
+    const BATCH_TEST_BUFFER* Buffer,
+    size_t Offset,
+    size_t Size
+)
+{
+    ULONG value = 0;
+
+    XNA_TEST_EXPECT(Offset + Size <= Buffer->Length);
+
+    if (Offset + Size > Buffer->Length)
+        return 0;
+
+    RtlCopyMemory(&value, &Buffer->Buffer[Offset], Size);
+
+    return value;
+}
+
+//
+// The rules of XINPUT_EXT_OVERRIDE_GAMEPAD_BATCH_VALIDATE, one bounds
+// checked field at a time
+//
+static BOOLEAN ReferenceValidate(
+    const BATCH_TEST_BUFFER* Buffer
+)
+{
+    ULONG   count;
+    ULONG   index;
+    ULONG   userIndex;
+    BOOLEAN seen[XINPUT_MAX_DEVICES] = { FALSE };
+
+    if (Buffer->Length < BATCH_ENTRY_OFFSET(0))
+        return FALSE;
+
+    count = BatchTestRead(Buffer, FIELD_OFFSET(XINPUT_EXT_OVERRIDE_GAMEPAD_BATCH, Count), sizeof(ULONG));
+
+    if (count > XINPUT_MAX_DEVICES
+        || BatchTestRead(Buffer, FIELD_OFFSET(XINPUT_EXT_OVERRIDE_GAMEPAD_BATCH, Size), sizeof(ULONG)) != BATCH_ENTRY_OFFSET(count)
+        || Buffer->Length < BATCH_ENTRY_OFFSET(count))
+    {
+        return FALSE;
+    }
+
+    for (index = 0; index < count; index++)
+    {
+        userIndex = BatchTestRead(Buffer, BATCH_ENTRY_OFFSET(index), sizeof(UCHAR));
+
+        if (userIndex >= XINPUT_MAX_DEVICES || seen[userIndex])
+            return FALSE;
+
+        seen[userIndex] = TRUE;
+    }
+
+    return TRUE;
+}
+
+static VOID TestSize(
+    VOID
+)
+{
+    C_ASSERT(XINPUT_EXT_OVERRIDE_GAMEPAD_BATCH_SIZE(XINPUT_MAX_DEVICES) == sizeof(XINPUT_EXT_OVERRIDE_GAMEPAD_BATCH));
+
+    XNA_TEST_EXPECT(XINPUT_EXT_OVERRIDE_GAMEPAD_BATCH_SIZE(0) == BATCH_ENTRY_OFFSET(0));
+    XNA_TEST_EXPECT(XINPUT_EXT_OVERRIDE_GAMEPAD_BATCH_SIZE(3) == BATCH_ENTRY_OFFSET(3));
+}
+
+//
+// Entries are added once per pad, later adds replace the pad's entry
+//
+static VOID TestAdd(
+    VOID
+)
+{
+    XINPUT_EXT_OVERRIDE_GAMEPAD_BATCH   batch;
+    XINPUT_EXT_OVERRIDE_GAMEPAD         override;
+    UCHAR                               index;
+
+    XINPUT_EXT_OVERRIDE_GAMEPAD_BATCH_INIT(&batch);
+
+    XNA_TEST_EXPECT(batch.Count == 0 && batch.Size == XINPUT_EXT_OVERRIDE_GAMEPAD_BATCH_SIZE(0));
+
+    //
+    // Pads in descending order keep the order they were added in
+    //
+    for (index = 0; index < XINPUT_MAX_DEVICES; index++)
+    {
+        XINPUT_EXT_OVERRIDE_GAMEPAD_INIT(&override, (UCHAR)(XINPUT_MAX_DEVICES - 1 - index));
+        override.Overrides = XINPUT_GAMEPAD_OVERRIDE_A;
+        override.Gamepad.wButtons = XINPUT_GAMEPAD_A;
+        override.LeftTrigger = index;
+
+        XNA_TEST_EXPECT(XINPUT_EXT_OVERRIDE_GAMEPAD_BATCH_ADD(&batch, &override));
+        XNA_TEST_EXPECT(batch.Count == index + 1UL && batch.Size == XINPUT_EXT_OVERRIDE_GAMEPAD_BATCH_SIZE(index + 1));
+        XNA_TEST_EXPECT(batch.Entries[index].UserIndex == XINPUT_MAX_DEVICES - 1 - index);
+    }
+
+    //
+    // Duplicates merge into the existing entry
+    //
+    XINPUT_EXT_OVERRIDE_GAMEPAD_INIT(&override, 1);
+    override.Overrides = XINPUT_GAMEPAD_OVERRIDE_B | XINPUT_GAMEPAD_OVERRIDE_LEFT_TRIGGER;
+    override.Gamepad.wButtons = XINPUT_GAMEPAD_B;
+    override.Gamepad.bLeftTrigger = 0x7F;
+    override.LeftTrigger = 0x3FF;
+    override.RightTrigger = 0x155;
+
+    XNA_TEST_EXPECT(XINPUT_EXT_OVERRIDE_GAMEPAD_BATCH_ADD(&batch, &override));
+    XNA_TEST_EXPECT(batch.Count == XINPUT_MAX_DEVICES);
+    XNA_TEST_EXPECT(batch.Size == XINPUT_EXT_OVERRIDE_GAMEPAD_BATCH_SIZE(XINPUT_MAX_DEVICES));
+
+    index = XINPUT_MAX_DEVICES - 2;
+    XNA_TEST_EXPECT(batch.Entries[index].UserIndex == 1);
+    XNA_TEST_EXPECT(batch.Entries[index].Overrides == override.Overrides);
+    XNA_TEST_EXPECT(memcmp(&batch.Entries[index].Gamepad, &override.Gamepad, sizeof(override.Gamepad)) == 0);
+    XNA_TEST_EXPECT(batch.Entries[index].LeftTrigger == 0x3FF && batch.Entries[index].RightTrigger == 0x155);
+
+    //
+    // Out of range pads are refused and change nothing
+    //
+    XINPUT_EXT_OVERRIDE_GAMEPAD_INIT(&override, XINPUT_MAX_DEVICES);
+    XNA_TEST_EXPECT(!XINPUT_EXT_OVERRIDE_GAMEPAD_BATCH_ADD(&batch, &override));
+    XINPUT_EXT_OVERRIDE_GAMEPAD_INIT(&override, UCHAR_MAX);
+    XNA_TEST_EXPECT(!XINPUT_EXT_OVERRIDE_GAMEPAD_BATCH_ADD(&batch, &override));
+    XNA_TEST_EXPECT(batch.Count == XINPUT_MAX_DEVICES);
+
+    XNA_TEST_EXPECT(XINPUT_EXT_OVERRIDE_GAMEPAD_BATCH_VALIDATE(&batch, sizeof(batch)));
+}
+
+static VOID TestValidate(
+    VOID
+)
+{
+    XINPUT_EXT_OVERRIDE_GAMEPAD_BATCH   batch;
+    XINPUT_EXT_OVERRIDE_GAMEPAD         override;
+    ULONG                               size;
+    UCHAR                               index;
+
+    //
+    // An empty batch is valid and applies nothing
+    //
+    XINPUT_EXT_OVERRIDE_GAMEPAD_BATCH_INIT(&batch);
+    XNA_TEST_EXPECT(XINPUT_EXT_OVERRIDE_GAMEPAD_BATCH_VALIDATE(&batch, XINPUT_EXT_OVERRIDE_GAMEPAD_BATCH_SIZE(0)));
+    XNA_TEST_EXPECT(!XINPUT_EXT_OVERRIDE_GAMEPAD_BATCH_VALIDATE(&batch, XINPUT_EXT_OVERRIDE_GAMEPAD_BATCH_SIZE(0) - 1));
+    XNA_TEST_EXPECT(!XINPUT_EXT_OVERRIDE_GAMEPAD_BATCH_VALIDATE(&batch, 0));
+
+    for (index = 0; index < XINPUT_MAX_DEVICES; index++)
+    {
+        XINPUT_EXT_OVERRIDE_GAMEPAD_INIT(&override, index);
+        XINPUT_EXT_OVERRIDE_GAMEPAD_BATCH_ADD(&batch, &override);
+    }
+
+    //
+    // The buffer must hold Size bytes, larger buffers are fine
+    //
+    size = XINPUT_EXT_OVERRIDE_GAMEPAD_BATCH_SIZE(XINPUT_MAX_DEVICES);
+    XNA_TEST_EXPECT(XINPUT_EXT_OVERRIDE_GAMEPAD_BATCH_VALIDATE(&batch, size));
+    XNA_TEST_EXPECT(XINPUT_EXT_OVERRIDE_GAMEPAD_BATCH_VALIDATE(&batch, size + 100));
+    XNA_TEST_EXPECT(!XINPUT_EXT_OVERRIDE_GAMEPAD_BATCH_VALIDATE(&batch, size - 1));
+    XNA_TEST_EXPECT(!XINPUT_EXT_OVERRIDE_GAMEPAD_BATCH_VALIDATE(&batch, XINPUT_EXT_OVERRIDE_GAMEPAD_BATCH_SIZE(XINPUT_MAX_DEVICES - 1)));
+
+    //
+    // Size and Count must agree
+    //
+    batch.Size = XINPUT_EXT_OVERRIDE_GAMEPAD_BATCH_SIZE(XINPUT_MAX_DEVICES - 1);
+    XNA_TEST_EXPECT(!XINPUT_EXT_OVERRIDE_GAMEPAD_BATCH_VALIDATE(&batch, sizeof(batch)));
+    batch.Count = XINPUT_MAX_DEVICES - 1;
+    XNA_TEST_EXPECT(XINPUT_EXT_OVERRIDE_GAMEPAD_BATCH_VALIDATE(&batch, sizeof(batch)));
+
+    //
+    // More entries than pads, whatever Size claims
+    //
+    batch.Count = XINPUT_MAX_DEVICES + 1;
+    batch.Size = XINPUT_EXT_OVERRIDE_GAMEPAD_BATCH_SIZE(XINPUT_MAX_DEVICES + 1);
+    XNA_TEST_EXPECT(!XINPUT_EXT_OVERRIDE_GAMEPAD_BATCH_VALIDATE(&batch, batch.Size));
+
+    batch.Count = 0xFFFFFFFF;
+    batch.Size = XINPUT_EXT_OVERRIDE_GAMEPAD_BATCH_SIZE(batch.Count);
+    XNA_TEST_EXPECT(!XINPUT_EXT_OVERRIDE_GAMEPAD_BATCH_VALIDATE(&batch, sizeof(batch)));
+
+    //
+    // Every pad at most once and in range
+    //
+    batch.Count = XINPUT_MAX_DEVICES;
+    batch.Size = XINPUT_EXT_OVERRIDE_GAMEPAD_BATCH_SIZE(XINPUT_MAX_DEVICES);
+    batch.Entries[3].UserIndex = 0;
+    XNA_TEST_EXPECT(!XINPUT_EXT_OVERRIDE_GAMEPAD_BATCH_VALIDATE(&batch, sizeof(batch)));
+
+    batch.Entries[3].UserIndex = XINPUT_MAX_DEVICES;
+    XNA_TEST_EXPECT(!XINPUT_EXT_OVERRIDE_GAMEPAD_BATCH_VALIDATE(&batch, sizeof(batch)));
+
+    batch.Entries[3].UserIndex = UCHAR_MAX;
+    XNA_TEST_EXPECT(!XINPUT_EXT_OVERRIDE_GAMEPAD_BATCH_VALIDATE(&batch, sizeof(batch)));
+
+    batch.Entries[3].UserIndex = 3;
+    XNA_TEST_EXPECT(XINPUT_EXT_OVERRIDE_GAMEPAD_BATCH_VALIDATE(&batch, sizeof(batch)));
+
+    //
+    // A duplicate beyond Count is not part of the batch
+    //
+    batch.Count = 2;
+    batch.Size = XINPUT_EXT_OVERRIDE_GAMEPAD_BATCH_SIZE(2);
+    batch.Entries[2].UserIndex = 0;
+    XNA_TEST_EXPECT(XINPUT_EXT_OVERRIDE_GAMEPAD_BATCH_VALIDATE(&batch, XINPUT_EXT_OVERRIDE_GAMEPAD_BATCH_SIZE(2)));
+}
+
+//
+// Random bytes in buffers of the exact length, so sanitizer builds catch
+// reads past the end. The verdict must match the bounds checked reference
+// and an accepted batch must lie within the buffer.
+//
+static VOID TestFuzz(
+    VOID
+)
+{
+    PUCHAR                              buffer;
+    PXINPUT_EXT_OVERRIDE_GAMEPAD_BATCH  batch;
+    BATCH_TEST_BUFFER                   reference;
+    size_t                              length;
+    ULONG                               count;
+    ULONG                               index;
+    ULONG                               iteration;
+    ULONG                               accepted = 0;
+    BOOLEAN                             valid;
+
+    for (iteration = 0; iteration < 1000000; iteration++)
+    {
+        length = XnaTestRandom() % (sizeof(XINPUT_EXT_OVERRIDE_GAMEPAD_BATCH) + 8);
+        buffer = (PUCHAR)malloc(length ? length : 1);
+
+        XnaTestRandomFill(buffer, length);
+
+        //
+        // Mostly consistent headers and pads in range to get past the
+        // first checks
+        //
+        batch = (PXINPUT_EXT_OVERRIDE_GAMEPAD_BATCH)buffer;
+        count = XnaTestRandom() % (XINPUT_MAX_DEVICES + 2);
+
+        if (length >= BATCH_ENTRY_OFFSET(0) && (XnaTestRandom() & 3))
+        {
+            batch->Count = count;
+            batch->Size = XINPUT_EXT_OVERRIDE_GAMEPAD_BATCH_SIZE(count);
+
+            for (index = 0; index < count && BATCH_ENTRY_OFFSET(index) < length; index++)
+                buffer[BATCH_ENTRY_OFFSET(index)] = (UCHAR)(XnaTestRandom() % (XINPUT_MAX_DEVICES + 1));
+        }
+
+        reference.Buffer = buffer;
+        reference.Length = length;
+
+        valid = XINPUT_EXT_OVERRIDE_GAMEPAD_BATCH_VALIDATE(batch, length);
+
+        XNA_TEST_EXPECT(valid == ReferenceValidate(&reference));
+
+        if (valid)
+        {
+            XNA_TEST_EXPECT(batch->Count <= XINPUT_MAX_DEVICES);
+            XNA_TEST_EXPECT(XINPUT_EXT_OVERRIDE_GAMEPAD_BATCH_SIZE(batch->Count) <= length);
+            accepted++;
+        }
+
+        free(buffer);
+    }
+
+    XNA_TEST_EXPECT(accepted > 0);
+}
+
+int main(
+    VOID
+)
+{
+    TestSize();
+    TestAdd();
+    TestValidate();
+    TestFuzz();
+
+    return XNA_TEST_RESULT();
+}
@@ -0,0 +1,327 @@
+/*
+MIT License
+
+Copyright (c) 2017 Benjamin "Nefarius" Hglinger
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#include "XnaTest.h"
+#include "ViGEmDeadZone.h"
+#include <math.h>
+
+#define DEAD_ZONE_TEST_STICKS   200
+
+static VIGEM_STICK_LUT DeadZoneTestLut;
+
+static const USHORT DeadZoneTestInner[] = { 0, 4000, 7849 };
+static const USHORT DeadZoneTestOuter[] = { 32767, 30000, 29000 };
+
+//
+// The float math the tables replace
+//
+static double ProfileEvaluateReference(
+    const VIGEM_STICK_PROFILE* Profile,
+    double Deflection
+)
+{
+    double t;
+
+    if (Deflection <= Profile->InnerDeadZone)
+        return 0.0;
+
+    if (Deflection >= Profile->OuterDeadZone)
+        return VIGEM_STICK_AXIS_MAX;
+
+    t = (Deflection - Profile->InnerDeadZone) / (Profile->OuterDeadZone - Profile->InnerDeadZone);
+
+    switch (Profile->Curve)
+    {
+    case VIGEM_STICK_RESPONSE_QUADRATIC:
+        t = t * t;
+        break;
+    case VIGEM_STICK_RESPONSE_CUBIC:
+        t = t * t * t;
+        break;
+    default:
+        break;
+    }
+
+    return t * VIGEM_STICK_AXIS_MAX;
+}
+
+static SHORT ClampReference(
+    double Value
+)
+{
+    if (Value > SHRT_MAX)
+        return SHRT_MAX;
+    if (Value < SHRT_MIN)
+        return SHRT_MIN;
+
+    return (SHORT)lrint(Value);
+}
+
+static VOID ApplyReference(
+    const VIGEM_STICK_PROFILE* Profile,
+    PSHORT X,
+    PSHORT Y
+)
+{
+    double radius;
+    double gain;
+
+    if (Profile->Mode == VIGEM_STICK_DEADZONE_AXIAL)
+    {
+        *X = ClampReference(copysign(ProfileEvaluateReference(Profile, fabs((double)*X)), *X));
+        *Y = ClampReference(copysign(ProfileEvaluateReference(Profile, fabs((double)*Y)), *Y));
+        return;
+    }
+
+    radius = hypot(*X, *Y);
+
+    if (radius == 0.0)
+        return;
+
+    gain = ProfileEvaluateReference(Profile, radius) / radius;
+
+    *X = ClampReference(*X * gain);
+    *Y = ClampReference(*Y * gain);
+}
+
+static VOID TestProfile(
+    VOID
+)
+{
+    VIGEM_STICK_PROFILE profile;
+
+    VIGEM_STICK_PROFILE_INIT(&profile, VIGEM_STICK_DEADZONE_RADIAL, 4000, 30000);
+    XNA_TEST_EXPECT(VIGEM_STICK_LUT_INIT(&DeadZoneTestLut, &profile));
+
+    //
+    // Dead zones out of range or in the wrong order
+    //
+    profile.InnerDeadZone = 30000;
+    XNA_TEST_EXPECT(!VIGEM_STICK_LUT_INIT(&DeadZoneTestLut, &profile));
+    profile.InnerDeadZone = 0;
+    profile.OuterDeadZone = 32768;
+    XNA_TEST_EXPECT(!VIGEM_STICK_LUT_INIT(&DeadZoneTestLut, &profile));
+
+    XNA_TEST_EXPECT(VIGEM_STICK_ISQRT(0) == 0);
+    XNA_TEST_EXPECT(VIGEM_STICK_ISQRT(2ULL * 32768 * 32768) == 46340);
+    XNA_TEST_EXPECT(VIGEM_STICK_ISQRT(0xFFFFFFFFFFFFFFFFULL) == 0xFFFFFFFF);
+}
+
+//
+// Every axis value in axial mode and a grid over both axes in radial mode,
+// compared to the float reference. The radial error peaks at the kink of
+// a linear curve on the inner dead zone, which the interpolation between
+// entries rounds off.
+//
+static VOID TestAccuracy(
+    VOID
+)
+{
+    VIGEM_STICK_PROFILE profile;
+    ULONG               mode;
+    ULONG               curve;
+    ULONG               zone;
+    LONG                x;
+    LONG                y;
+    LONG                error;
+    LONG                maxError;
+    double              sumError;
+    ULONG               samples;
+    SHORT               lutX;
+    SHORT               lutY;
+    SHORT               refX;
+    SHORT               refY;
+
+    for (mode = VIGEM_STICK_DEADZONE_AXIAL; mode <= VIGEM_STICK_DEADZONE_RADIAL; mode++)
+    {
+        for (curve = VIGEM_STICK_RESPONSE_LINEAR; curve <= VIGEM_STICK_RESPONSE_CUBIC; curve++)
+        {
+            for (zone = 0; zone < ARRAYSIZE(DeadZoneTestInner); zone++)
+            {
+                VIGEM_STICK_PROFILE_INIT(&profile, (VIGEM_STICK_DEADZONE_MODE)mode,
+                    DeadZoneTestInner[zone], DeadZoneTestOuter[zone]);
+                profile.Curve = (VIGEM_STICK_RESPONSE_CURVE)curve;
+
+                XNA_TEST_EXPECT(VIGEM_STICK_LUT_INIT(&DeadZoneTestLut, &profile));
+
+                maxError = 0;
+                sumError = 0.0;
+                samples = 0;
+
+                for (x = SHRT_MIN; x <= SHRT_MAX; x += (mode == VIGEM_STICK_DEADZONE_RADIAL) ? 97 : 1)
+                {
+                    for (y = SHRT_MIN; y <= SHRT_MAX; y += (mode == VIGEM_STICK_DEADZONE_RADIAL) ? 89 : 0x10000)
+                    {
+                        lutX = refX = (SHORT)x;
+                        lutY = refY = (SHORT)((mode == VIGEM_STICK_DEADZONE_RADIAL) ? y : x);
+
+                        VIGEM_STICK_LUT_APPLY(&DeadZoneTestLut, &lutX, &lutY);
+                        ApplyReference(&profile, &refX, &refY);
+
+                        error = max(labs((long)lutX - refX), labs((long)lutY - refY));
+                        maxError = max(maxError, error);
+                        sumError += error;
+                        samples++;
+                    }
+                }
+
+                printf("%-6s %-9s %5u..%5u: max %2ld LSB, mean %.2f LSB\n",
+                    (mode == VIGEM_STICK_DEADZONE_RADIAL) ? "radial" : "axial",
+                    (curve == VIGEM_STICK_RESPONSE_CUBIC) ? "cubic" : (curve == VIGEM_STICK_RESPONSE_QUADRATIC) ? "quadratic" : "linear",
+                    DeadZoneTestInner[zone], DeadZoneTestOuter[zone], (long)maxError, sumError / samples);
+
+                XNA_TEST_EXPECT(maxError <= ((mode == VIGEM_STICK_DEADZONE_RADIAL) ? 24 : 3));
+                XNA_TEST_EXPECT(sumError / samples < 1.0);
+            }
+        }
+    }
+}
+
+static VOID TestBatch(
+    VOID
+)
+{
+    static XUSB_REPORT          reports[DEAD_ZONE_TEST_STICKS];
+    static XINPUT_GAMEPAD_STATE states[DEAD_ZONE_TEST_STICKS];
+    static VIGEM_STICK_LUT      axial;
+    PVIGEM_STICK_LUT volatile   slot = NULL;
+    VIGEM_STICK_PROFILE         profile;
+    XUSB_REPORT                 expected;
+    ULONG                       index;
+    BOOLEAN                     equal = TRUE;
+
+    VIGEM_STICK_PROFILE_INIT(&profile, VIGEM_STICK_DEADZONE_RADIAL, 7849, 30000);
+    VIGEM_STICK_LUT_INIT(&DeadZoneTestLut, &profile);
+    VIGEM_STICK_PROFILE_INIT(&profile, VIGEM_STICK_DEADZONE_AXIAL, 2000, 32000);
+    VIGEM_STICK_LUT_INIT(&axial, &profile);
+
+    XnaTestRandomFill(reports, sizeof(reports));
+
+    for (index = 0; index < DEAD_ZONE_TEST_STICKS; index++)
+    {
+        states[index].sThumbLX = reports[index].sThumbLX;
+        states[index].sThumbLY = reports[index].sThumbLY;
+        states[index].sThumbRX = reports[index].sThumbRX;
+        states[index].sThumbRY = reports[index].sThumbRY;
+    }
+
+    //
+    // Hot swap, a batch uses the table acquired before it
+    //
+    XNA_TEST_EXPECT(VIGEM_STICK_LUT_EXCHANGE(&slot, &DeadZoneTestLut) == NULL);
+    XNA_TEST_EXPECT(VIGEM_STICK_LUT_ACQUIRE(&slot) == &DeadZoneTestLut);
+
+    for (index = 0; index < DEAD_ZONE_TEST_STICKS; index++)
+    {
+        expected = reports[index];
+
+        VIGEM_STICK_LUT_APPLY(&DeadZoneTestLut, &expected.sThumbLX, &expected.sThumbLY);
+        VIGEM_STICK_LUT_APPLY(&axial, &expected.sThumbRX, &expected.sThumbRY);
+
+        XUSB_REPORT_APPLY_STICK_LUT_BATCH(VIGEM_STICK_LUT_ACQUIRE(&slot), &axial, &reports[index], 1);
+        XINPUT_GAMEPAD_STATE_APPLY_STICK_LUT_BATCH(VIGEM_STICK_LUT_ACQUIRE(&slot), &axial, &states[index], 1);
+
+        equal = equal && memcmp(&reports[index], &expected, sizeof(expected)) == 0
+            && states[index].sThumbLX == expected.sThumbLX && states[index].sThumbLY == expected.sThumbLY
+            && states[index].sThumbRX == expected.sThumbRX && states[index].sThumbRY == expected.sThumbRY;
+    }
+
+    XNA_TEST_EXPECT(equal);
+    XNA_TEST_EXPECT(VIGEM_STICK_LUT_EXCHANGE(&slot, &axial) == &DeadZoneTestLut);
+
+    //
+    // NULL tables leave the sticks untouched
+    //
+    expected = reports[0];
+    XUSB_REPORT_APPLY_STICK_LUT_BATCH(NULL, NULL, reports, 1);
+    XNA_TEST_EXPECT(memcmp(&reports[0], &expected, sizeof(expected)) == 0);
+}
+
+//
+// 200 pads, both sticks, like one 1 kHz frame of the input process
+//
+static VOID Bench(
+    VOID
+)
+{
+    const ULONG                 iterations = 20000;
+    static XUSB_REPORT          source[DEAD_ZONE_TEST_STICKS];
+    static XUSB_REPORT          reports[DEAD_ZONE_TEST_STICKS];
+    VIGEM_STICK_PROFILE         profile;
+    ULONG                       iteration;
+    ULONG                       index;
+    double                      start;
+
+    VIGEM_STICK_PROFILE_INIT(&profile, VIGEM_STICK_DEADZONE_RADIAL, 7849, 30000);
+    profile.Curve = VIGEM_STICK_RESPONSE_QUADRATIC;
+    VIGEM_STICK_LUT_INIT(&DeadZoneTestLut, &profile);
+
+    XnaTestRandomFill(source, sizeof(source));
+
+    start = XnaTestNow();
+
+    for (iteration = 0; iteration < iterations; iteration++)
+    {
+        memcpy(reports, source, sizeof(reports));
+
+        for (index = 0; index < DEAD_ZONE_TEST_STICKS; index++)
+        {
+            ApplyReference(&profile, &reports[index].sThumbLX, &reports[index].sThumbLY);
+            ApplyReference(&profile, &reports[index].sThumbRX, &reports[index].sThumbRY);
+        }
+
+        XNA_TEST_CONSUME(reports, sizeof(reports));
+    }
+
+    XnaTestReport("Radial dead zone (float reference)", 2.0 * iterations * DEAD_ZONE_TEST_STICKS, XnaTestNow() - start);
+
+    start = XnaTestNow();
+
+    for (iteration = 0; iteration < iterations; iteration++)
+    {
+        memcpy(reports, source, sizeof(reports));
+
+        XUSB_REPORT_APPLY_STICK_LUT_BATCH(&DeadZoneTestLut, &DeadZoneTestLut, reports, DEAD_ZONE_TEST_STICKS);
+
+        XNA_TEST_CONSUME(reports, sizeof(reports));
+    }
+
+    XnaTestReport("XUSB_REPORT_APPLY_STICK_LUT_BATCH (radial)", 2.0 * iterations * DEAD_ZONE_TEST_STICKS, XnaTestNow() - start);
+}
+
+int main(
+    int argc,
+    char** argv
+)
+{
+    TestProfile();
+    TestAccuracy();
+    TestBatch();
+
+    if (XnaTestBenchEnabled(argc, argv))
+        Bench();
+
+    return XNA_TEST_RESULT();
+}
@@ -0,0 +1,249 @@
+/*
+MIT License
+
+Copyright (c) 2017 Benjamin "Nefarius" Hglinger
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#include "XnaTest.h"
+#include "XInputOverrideDelta.h"
+
+//
+// Compares the fields carried by deltas plus the header fields
+//
+static BOOLEAN DeltaTestEqual(
+    const XINPUT_EXT_OVERRIDE_GAMEPAD* Left,
+    const XINPUT_EXT_OVERRIDE_GAMEPAD* Right
+)
+{
+    BOOLEAN equal = Left->Size == Right->Size && Left->UserIndex == Right->UserIndex;
+
+#define DELTA_TEST_EQUAL_FIELD(_flag_, _field_)     equal = equal && Left->_field_ == Right->_field_;
+
+    XINPUT_EXT_DELTA_FIELD_TABLE(DELTA_TEST_EQUAL_FIELD)
+
+#undef DELTA_TEST_EQUAL_FIELD
+
+    return equal;
+}
+
+//
+// Copy of Base with a random subset of the fields changed
+//
+static VOID DeltaTestMutate(
+    PXINPUT_EXT_OVERRIDE_GAMEPAD Target,
+    const XINPUT_EXT_OVERRIDE_GAMEPAD* Base
+)
+{
+    ULONG fields = XnaTestRandom();
+
+    *Target = *Base;
+
+#define DELTA_TEST_MUTATE_FIELD(_flag_, _field_)                                \
+    if (fields & (_flag_))                                                      \
+        XnaTestRandomFill(&Target->_field_, sizeof(Target->_field_));
+
+    XINPUT_EXT_DELTA_FIELD_TABLE(DELTA_TEST_MUTATE_FIELD)
+
+#undef DELTA_TEST_MUTATE_FIELD
+}
+
+static VOID TestRoundTrip(
+    VOID
+)
+{
+    XINPUT_EXT_OVERRIDE_GAMEPAD previous;
+    XINPUT_EXT_OVERRIDE_GAMEPAD current;
+    XINPUT_EXT_OVERRIDE_GAMEPAD target;
+    UCHAR                       buffer[XINPUT_EXT_OVERRIDE_GAMEPAD_DELTA_MAX_SIZE + 1];
+    ULONG                       length;
+    ULONG                       iteration;
+
+    XINPUT_EXT_OVERRIDE_GAMEPAD_INIT(&previous, 2);
+
+    XNA_TEST_EXPECT(XINPUT_EXT_OVERRIDE_GAMEPAD_DELTA_ENCODE(buffer, XINPUT_EXT_OVERRIDE_GAMEPAD_DELTA_MAX_SIZE - 1, &previous, &previous) == 0);
+    XNA_TEST_EXPECT(XINPUT_EXT_OVERRIDE_GAMEPAD_DELTA_ENCODE(buffer, sizeof(buffer), &previous, &previous) == XINPUT_EXT_OVERRIDE_GAMEPAD_DELTA_HEADER_SIZE);
+    XNA_TEST_EXPECT(XINPUT_EXT_OVERRIDE_GAMEPAD_DELTA_USER_INDEX(buffer) == 2);
+
+    for (iteration = 0; iteration < 1000000; iteration++)
+    {
+        DeltaTestMutate(&current, &previous);
+
+        length = XINPUT_EXT_OVERRIDE_GAMEPAD_DELTA_ENCODE(buffer, sizeof(buffer), &previous, &current);
+
+        XNA_TEST_EXPECT(length >= XINPUT_EXT_OVERRIDE_GAMEPAD_DELTA_HEADER_SIZE);
+        XNA_TEST_EXPECT(length <= XINPUT_EXT_OVERRIDE_GAMEPAD_DELTA_MAX_SIZE);
+
+        target = previous;
+        XNA_TEST_EXPECT(XINPUT_EXT_OVERRIDE_GAMEPAD_DELTA_DECODE(buffer, length, &target));
+        XNA_TEST_EXPECT(DeltaTestEqual(&target, &current));
+
+        //
+        // Truncated and extended deltas are rejected without side effects
+        //
+        target = previous;
+        XNA_TEST_EXPECT(length == XINPUT_EXT_OVERRIDE_GAMEPAD_DELTA_HEADER_SIZE
+            || !XINPUT_EXT_OVERRIDE_GAMEPAD_DELTA_DECODE(buffer, length - 1, &target));
+        XNA_TEST_EXPECT(!XINPUT_EXT_OVERRIDE_GAMEPAD_DELTA_DECODE(buffer, length + 1, &target));
+        XNA_TEST_EXPECT(DeltaTestEqual(&target, &previous));
+
+        previous = current;
+    }
+}
+
+static VOID TestMalformed(
+    VOID
+)
+{
+    XINPUT_EXT_OVERRIDE_GAMEPAD previous;
+    XINPUT_EXT_OVERRIDE_GAMEPAD current;
+    XINPUT_EXT_OVERRIDE_GAMEPAD target;
+    UCHAR                       buffer[XINPUT_EXT_OVERRIDE_GAMEPAD_DELTA_MAX_SIZE];
+    ULONG                       length;
+
+    XINPUT_EXT_OVERRIDE_GAMEPAD_INIT(&previous, 1);
+    current = previous;
+    current.Gamepad.sThumbLX = 0x1234;
+
+    length = XINPUT_EXT_OVERRIDE_GAMEPAD_DELTA_ENCODE(buffer, sizeof(buffer), &previous, &current);
+    XNA_TEST_EXPECT(length == XINPUT_EXT_OVERRIDE_GAMEPAD_DELTA_HEADER_SIZE + sizeof(SHORT));
+    XNA_TEST_EXPECT(buffer[1] == XINPUT_EXT_DELTA_FIELD_LEFT_THUMB_X && buffer[2] == 0);
+
+    //
+    // Deltas of another pad
+    //
+    XINPUT_EXT_OVERRIDE_GAMEPAD_INIT(&target, 0);
+    XNA_TEST_EXPECT(!XINPUT_EXT_OVERRIDE_GAMEPAD_DELTA_DECODE(buffer, length, &target));
+    XNA_TEST_EXPECT(target.Gamepad.sThumbLX == 0);
+
+    //
+    // Unknown field bits
+    //
+    target = previous;
+    buffer[2] |= 0x04;
+    XNA_TEST_EXPECT(!XINPUT_EXT_OVERRIDE_GAMEPAD_DELTA_DECODE(buffer, length, &target));
+    buffer[2] &= ~0x04;
+    XNA_TEST_EXPECT(XINPUT_EXT_OVERRIDE_GAMEPAD_DELTA_DECODE(buffer, length, &target));
+    XNA_TEST_EXPECT(target.Gamepad.sThumbLX == 0x1234);
+
+    //
+    // Shorter than the header
+    //
+    XNA_TEST_EXPECT(!XINPUT_EXT_OVERRIDE_GAMEPAD_DELTA_DECODE(buffer, 0, &target));
+    XNA_TEST_EXPECT(!XINPUT_EXT_OVERRIDE_GAMEPAD_DELTA_DECODE(buffer, XINPUT_EXT_OVERRIDE_GAMEPAD_DELTA_HEADER_SIZE - 1, &target));
+}
+
+//
+// Random bytes in buffers of the exact length, so sanitizer builds catch
+// reads past the end. Rejected deltas must leave the target untouched.
+//
+static VOID TestFuzz(
+    VOID
+)
+{
+    XINPUT_EXT_OVERRIDE_GAMEPAD base;
+    XINPUT_EXT_OVERRIDE_GAMEPAD target;
+    PUCHAR                      buffer;
+    size_t                      length;
+    ULONG                       iteration;
+    ULONG                       accepted = 0;
+
+    XINPUT_EXT_OVERRIDE_GAMEPAD_INIT(&base, 2);
+
+    for (iteration = 0; iteration < 1000000; iteration++)
+    {
+        length = XnaTestRandom() % (XINPUT_EXT_OVERRIDE_GAMEPAD_DELTA_MAX_SIZE + 8);
+        buffer = (PUCHAR)malloc(length ? length : 1);
+
+        XnaTestRandomFill(buffer, length);
+
+        //
+        // Mostly well-formed headers to get past the first checks
+        //
+        if (length > 0 && (XnaTestRandom() & 1))
+            buffer[0] = 2;
+        if (length > 2 && (XnaTestRandom() & 1))
+            buffer[2] &= XINPUT_EXT_DELTA_FIELDS_ALL >> 8;
+
+        target = base;
+
+        if (XINPUT_EXT_OVERRIDE_GAMEPAD_DELTA_DECODE(buffer, length, &target))
+            accepted++;
+        else
+            XNA_TEST_EXPECT(DeltaTestEqual(&target, &base));
+
+        free(buffer);
+    }
+
+    XNA_TEST_EXPECT(accepted > 0);
+}
+
+static VOID Bench(
+    VOID
+)
+{
+    const ULONG                 iterations = 10000000;
+    XINPUT_EXT_OVERRIDE_GAMEPAD previous;
+    XINPUT_EXT_OVERRIDE_GAMEPAD current;
+    UCHAR                       buffer[XINPUT_EXT_OVERRIDE_GAMEPAD_DELTA_MAX_SIZE];
+    ULONG                       iteration;
+    ULONG                       length;
+    ULONGLONG                   total = 0;
+    double                      start;
+
+    XINPUT_EXT_OVERRIDE_GAMEPAD_INIT(&previous, 0);
+
+    //
+    // A single axis moving, the common case of a remapper
+    //
+    start = XnaTestNow();
+
+    for (iteration = 0; iteration < iterations; iteration++)
+    {
+        current = previous;
+        current.Gamepad.sThumbLX = (SHORT)iteration;
+
+        length = XINPUT_EXT_OVERRIDE_GAMEPAD_DELTA_ENCODE(buffer, sizeof(buffer), &previous, &current);
+        XINPUT_EXT_OVERRIDE_GAMEPAD_DELTA_DECODE(buffer, length, &previous);
+
+        total += length;
+    }
+
+    XnaTestReport("Delta encode + decode (single axis)", (double)iterations, XnaTestNow() - start);
+
+    printf("%.1f bytes per delta, %u bytes per full override\n",
+        (double)total / iterations, (unsigned)sizeof(XINPUT_EXT_OVERRIDE_GAMEPAD));
+}
+
+int main(
+    int argc,
+    char** argv
+)
+{
+    TestRoundTrip();
+    TestMalformed();
+    TestFuzz();
+
+    if (XnaTestBenchEnabled(argc, argv))
+        Bench();
+
+    return XNA_TEST_RESULT();
+}
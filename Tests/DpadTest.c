@@ -0,0 +1,111 @@
+/*
+MIT License
+
+Copyright (c) 2017 Benjamin "Nefarius" Hglinger
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#include "XnaTest.h"
+#include "ViGEmCommon.h"
+#include "ViGEmDpad.h"
+
+//
+// The if-chain XUSB_TO_DS4_REPORT used before the tables, later checks
+// override earlier ones
+//
+static BYTE DpadMaskToDs4HatReference(
+    ULONG Mask
+)
+{
+    BYTE hat = DS4_BUTTON_DPAD_NONE;
+
+    if (Mask & XUSB_GAMEPAD_DPAD_UP) hat = DS4_BUTTON_DPAD_NORTH;
+    if (Mask & XUSB_GAMEPAD_DPAD_RIGHT) hat = DS4_BUTTON_DPAD_EAST;
+    if (Mask & XUSB_GAMEPAD_DPAD_DOWN) hat = DS4_BUTTON_DPAD_SOUTH;
+    if (Mask & XUSB_GAMEPAD_DPAD_LEFT) hat = DS4_BUTTON_DPAD_WEST;
+
+    if ((Mask & XUSB_GAMEPAD_DPAD_UP) && (Mask & XUSB_GAMEPAD_DPAD_RIGHT)) hat = DS4_BUTTON_DPAD_NORTHEAST;
+    if ((Mask & XUSB_GAMEPAD_DPAD_RIGHT) && (Mask & XUSB_GAMEPAD_DPAD_DOWN)) hat = DS4_BUTTON_DPAD_SOUTHEAST;
+    if ((Mask & XUSB_GAMEPAD_DPAD_DOWN) && (Mask & XUSB_GAMEPAD_DPAD_LEFT)) hat = DS4_BUTTON_DPAD_SOUTHWEST;
+    if ((Mask & XUSB_GAMEPAD_DPAD_LEFT) && (Mask & XUSB_GAMEPAD_DPAD_UP)) hat = DS4_BUTTON_DPAD_NORTHWEST;
+
+    return hat;
+}
+
+static VOID TestTables(
+    VOID
+)
+{
+    ULONG mask;
+    ULONG hat;
+    BYTE  ds4Hat;
+    BYTE  xboneHat;
+    BOOLEAN contradicting;
+
+    for (mask = 0; mask <= VIGEM_DPAD_MASK; mask++)
+    {
+        ds4Hat = VIGEM_DPAD_MASK_TO_DS4_HAT[mask];
+        xboneHat = VIGEM_DPAD_MASK_TO_XBONE_HAT[mask];
+
+        XNA_TEST_EXPECT(ds4Hat == DpadMaskToDs4HatReference(mask));
+
+        //
+        // The XBONE HAT is the DS4 one moved up by one, NONE becomes 0
+        //
+        XNA_TEST_EXPECT(xboneHat == ((ds4Hat == DS4_BUTTON_DPAD_NONE) ? 0 : ds4Hat + 1));
+
+        //
+        // Both HAT tables decode to the same directions, which encode
+        // back to the same HAT
+        //
+        XNA_TEST_EXPECT(VIGEM_DS4_HAT_TO_DPAD_MASK[ds4Hat] == VIGEM_XBONE_HAT_TO_DPAD_MASK[xboneHat]);
+        XNA_TEST_EXPECT(VIGEM_DPAD_MASK_TO_DS4_HAT[VIGEM_DS4_HAT_TO_DPAD_MASK[ds4Hat]] == ds4Hat);
+
+        //
+        // Masks without contradicting directions round trip exactly
+        //
+        contradicting = (mask & 0x3) == 0x3 || (mask & 0xC) == 0xC;
+
+        XNA_TEST_EXPECT(contradicting || VIGEM_DS4_HAT_TO_DPAD_MASK[ds4Hat] == mask);
+        XNA_TEST_EXPECT(contradicting || VIGEM_XBONE_HAT_TO_DPAD_MASK[xboneHat] == mask);
+    }
+
+    //
+    // Out of range HAT values decode to no direction
+    //
+    for (hat = 0x9; hat <= 0xF; hat++)
+    {
+        XNA_TEST_EXPECT(VIGEM_DS4_HAT_TO_DPAD_MASK[hat] == 0);
+        XNA_TEST_EXPECT(VIGEM_XBONE_HAT_TO_DPAD_MASK[hat] == 0);
+    }
+
+    XNA_TEST_EXPECT(VIGEM_DS4_HAT_TO_DPAD_MASK[DS4_BUTTON_DPAD_NONE] == 0);
+    XNA_TEST_EXPECT(VIGEM_XBONE_HAT_TO_DPAD_MASK[0] == 0);
+}
+
+int main(
+    VOID
+)
+{
+    TestTables();
+
+    return XNA_TEST_RESULT();
+}
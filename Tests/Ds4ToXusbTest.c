@@ -0,0 +1,188 @@
+/*
+MIT License
+
+Copyright (c) 2017 Benjamin "Nefarius" Hglinger
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#include "XnaTest.h"
+#include "ViGEmUtil.h"
+
+//
+// DS4 -> XUSB -> DS4 is lossless for every thumb byte XUSB_TO_DS4_REPORT
+// can produce
+//
+static VOID TestThumbRoundTrip(
+    VOID
+)
+{
+    BOOLEAN     reachableY[2][256] = { { FALSE } };
+    XUSB_REPORT xusb;
+    DS4_REPORT  ds4;
+    DS4_REPORT  roundTrip;
+    LONG        value;
+
+    for (value = SHRT_MIN; value <= SHRT_MAX; value++)
+    {
+        XUSB_REPORT_INIT(&xusb);
+        xusb.sThumbLY = xusb.sThumbRY = (SHORT)value;
+
+        DS4_REPORT_INIT(&ds4);
+        XUSB_TO_DS4_REPORT(&xusb, &ds4);
+
+        reachableY[0][ds4.bThumbLY] = TRUE;
+        reachableY[1][ds4.bThumbRY] = TRUE;
+    }
+
+    for (value = 0; value <= UCHAR_MAX; value++)
+    {
+        DS4_REPORT_INIT(&ds4);
+        ds4.bThumbLX = ds4.bThumbLY = ds4.bThumbRX = ds4.bThumbRY = (BYTE)value;
+
+        DS4_TO_XUSB_REPORT(&ds4, &xusb);
+
+        DS4_REPORT_INIT(&roundTrip);
+        XUSB_TO_DS4_REPORT(&xusb, &roundTrip);
+
+        XNA_TEST_EXPECT(roundTrip.bThumbLX == value);
+        XNA_TEST_EXPECT(roundTrip.bThumbRX == value);
+        XNA_TEST_EXPECT(!reachableY[0][value] || roundTrip.bThumbLY == value);
+        XNA_TEST_EXPECT(!reachableY[1][value] || roundTrip.bThumbRY == value);
+    }
+}
+
+//
+// XUSB -> DS4 -> XUSB keeps every button combination whose D-PAD isn't
+// contradicting, the unused XUSB bit 0x0800 has no DS4 counterpart
+//
+static VOID TestButtonRoundTrip(
+    VOID
+)
+{
+    XUSB_REPORT xusb;
+    XUSB_REPORT roundTrip;
+    DS4_REPORT  ds4;
+    ULONG       buttons;
+
+    for (buttons = 0; buttons <= USHRT_MAX; buttons++)
+    {
+        if ((buttons & 0x0800)
+            || (buttons & (XUSB_GAMEPAD_DPAD_UP | XUSB_GAMEPAD_DPAD_DOWN)) == (XUSB_GAMEPAD_DPAD_UP | XUSB_GAMEPAD_DPAD_DOWN)
+            || (buttons & (XUSB_GAMEPAD_DPAD_LEFT | XUSB_GAMEPAD_DPAD_RIGHT)) == (XUSB_GAMEPAD_DPAD_LEFT | XUSB_GAMEPAD_DPAD_RIGHT))
+        {
+            continue;
+        }
+
+        XUSB_REPORT_INIT(&xusb);
+        xusb.wButtons = (USHORT)buttons;
+
+        DS4_REPORT_INIT(&ds4);
+        XUSB_TO_DS4_REPORT(&xusb, &ds4);
+        DS4_TO_XUSB_REPORT(&ds4, &roundTrip);
+
+        XNA_TEST_EXPECT(roundTrip.wButtons == buttons);
+    }
+}
+
+//
+// HAT values above NORTHWEST, including the released value, map to no direction
+//
+static VOID TestHat(
+    VOID
+)
+{
+    XUSB_REPORT xusb;
+    DS4_REPORT  ds4;
+    ULONG       hat;
+
+    for (hat = 0; hat <= VIGEM_DPAD_MASK; hat++)
+    {
+        DS4_REPORT_INIT(&ds4);
+        DS4_SET_DPAD(&ds4, (DS4_DPAD_DIRECTIONS)hat);
+
+        DS4_TO_XUSB_REPORT(&ds4, &xusb);
+
+        XNA_TEST_EXPECT(((xusb.wButtons & VIGEM_DPAD_MASK) == 0) == (hat > DS4_BUTTON_DPAD_NORTHWEST));
+    }
+}
+
+#define BATCH_COUNT 4096
+
+static DS4_REPORT   BatchInput[BATCH_COUNT];
+static XUSB_REPORT  BatchOutput[BATCH_COUNT];
+static XUSB_REPORT  BatchExpected[BATCH_COUNT];
+
+static VOID TestBatch(
+    VOID
+)
+{
+    ULONG index;
+
+    XnaTestRandomFill(BatchInput, sizeof(BatchInput));
+    XnaTestRandomFill(BatchOutput, sizeof(BatchOutput));
+
+    for (index = 0; index < BATCH_COUNT; index++)
+    {
+        DS4_TO_XUSB_REPORT(&BatchInput[index], &BatchExpected[index]);
+    }
+
+    DS4_TO_XUSB_REPORT_BATCH(BatchInput, BatchOutput, BATCH_COUNT);
+
+    XNA_TEST_EXPECT(memcmp(BatchOutput, BatchExpected, sizeof(BatchOutput)) == 0);
+}
+
+static VOID Bench(
+    VOID
+)
+{
+    const ULONG iterations = 4000;
+    ULONG       iteration;
+    double      start;
+
+    XnaTestRandomFill(BatchInput, sizeof(BatchInput));
+
+    start = XnaTestNow();
+
+    for (iteration = 0; iteration < iterations; iteration++)
+    {
+        DS4_TO_XUSB_REPORT_BATCH(BatchInput, BatchOutput, BATCH_COUNT);
+
+        XNA_TEST_CONSUME(BatchOutput, sizeof(BatchOutput));
+    }
+
+    XnaTestReport("DS4_TO_XUSB_REPORT_BATCH", (double)iterations * BATCH_COUNT, XnaTestNow() - start);
+}
+
+int main(
+    int argc,
+    char** argv
+)
+{
+    TestThumbRoundTrip();
+    TestButtonRoundTrip();
+    TestHat();
+    TestBatch();
+
+    if (XnaTestBenchEnabled(argc, argv))
+        Bench();
+
+    return XNA_TEST_RESULT();
+}
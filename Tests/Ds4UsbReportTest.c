@@ -0,0 +1,333 @@
+/*
+MIT License
+
+Copyright (c) 2017 Benjamin "Nefarius" Hglinger
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#include "XnaTest.h"
+#include "ViGEmUtil.h"
+
+//
+// Reads a whole file, NULL on failure
+//
+static PUCHAR ReadFileContents(
+    const char* Path,
+    size_t* Length
+)
+{
+    FILE*   file = fopen(Path, "rb");
+    PUCHAR  contents = NULL;
+    long    size;
+
+    if (file == NULL)
+        return NULL;
+
+    if (fseek(file, 0, SEEK_END) == 0 && (size = ftell(file)) > 0 && fseek(file, 0, SEEK_SET) == 0)
+    {
+        contents = (PUCHAR)malloc((size_t)size);
+
+        if (contents != NULL && fread(contents, 1, (size_t)size, file) != (size_t)size)
+        {
+            free(contents);
+            contents = NULL;
+        }
+
+        *Length = (size_t)size;
+    }
+
+    fclose(file);
+
+    return contents;
+}
+
+static USHORT ReadUshort(
+    const UCHAR* Buffer
+)
+{
+    return (USHORT)(Buffer[0] | (Buffer[1] << 8));
+}
+
+static ULONG ReadUlong(
+    const UCHAR* Buffer
+)
+{
+    return (ULONG)Buffer[0] | ((ULONG)Buffer[1] << 8) | ((ULONG)Buffer[2] << 16) | ((ULONG)Buffer[3] << 24);
+}
+
+static VOID ParseTouchPoint(
+    const UCHAR* Buffer,
+    PDS4_TOUCH_POINT Touch
+)
+{
+    Touch->bIsDown = (Buffer[0] & 0x80) == 0;
+    Touch->bTrackingNum = Buffer[0] & 0x7F;
+    Touch->wX = (USHORT)(Buffer[1] | ((Buffer[2] & 0x0F) << 8));
+    Touch->wY = (USHORT)((Buffer[2] >> 4) | (Buffer[3] << 4));
+}
+
+//
+// Decodes a captured 64-byte USB input report, the context is seeded with
+// its frame counter and timestamp
+//
+static VOID ParseUsbReport(
+    const UCHAR* Buffer,
+    PDS4_REPORT_EX Report,
+    PDS4_USB_REPORT_CONTEXT Context
+)
+{
+    ULONG index;
+
+    DS4_REPORT_EX_INIT(Report);
+
+    Report->Report.bThumbLX = Buffer[1];
+    Report->Report.bThumbLY = Buffer[2];
+    Report->Report.bThumbRX = Buffer[3];
+    Report->Report.bThumbRY = Buffer[4];
+    Report->Report.wButtons = ReadUshort(&Buffer[5]);
+    Report->Report.bSpecial = Buffer[7] & 0x03;
+    Report->Report.bTriggerL = Buffer[8];
+    Report->Report.bTriggerR = Buffer[9];
+    Report->bTemperature = Buffer[12];
+    Report->wGyroX = (SHORT)ReadUshort(&Buffer[13]);
+    Report->wGyroY = (SHORT)ReadUshort(&Buffer[15]);
+    Report->wGyroZ = (SHORT)ReadUshort(&Buffer[17]);
+    Report->wAccelX = (SHORT)ReadUshort(&Buffer[19]);
+    Report->wAccelY = (SHORT)ReadUshort(&Buffer[21]);
+    Report->wAccelZ = (SHORT)ReadUshort(&Buffer[23]);
+    Report->bBatteryLevel = Buffer[30] & 0x0F;
+    Report->bCableConnected = (Buffer[30] & 0x10) != 0;
+    Report->bTouchPacketCount = Buffer[33];
+
+    for (index = 0; index < DS4_TOUCH_PACKETS_MAX; index++)
+    {
+        Report->TouchPackets[index].bPacketCounter = Buffer[34 + index * 9];
+        ParseTouchPoint(&Buffer[35 + index * 9], &Report->TouchPackets[index].Touch[0]);
+        ParseTouchPoint(&Buffer[39 + index * 9], &Report->TouchPackets[index].Touch[1]);
+    }
+
+    DS4_USB_REPORT_CONTEXT_INIT(Context, 0);
+    Context->FrameCounter = Buffer[7] >> 2;
+    Context->Timestamp = ReadUshort(&Buffer[10]);
+}
+
+//
+// Every interrupt-IN input report of a USBPcap capture decoded and written
+// again must come out byte-identical
+//
+static VOID TestCapture(
+    const char* Path
+)
+{
+    PUCHAR                  capture;
+    size_t                  length = 0;
+    size_t                  offset;
+    ULONG                   blockLength;
+    ULONG                   captureLength;
+    const UCHAR*            packet;
+    USHORT                  headerLength;
+    ULONG                   reports = 0;
+    DS4_REPORT_EX           report;
+    DS4_USB_REPORT_CONTEXT  context;
+    UCHAR                   buffer[DS4_USB_INPUT_REPORT_LENGTH];
+
+    capture = ReadFileContents(Path, &length);
+    XNA_TEST_EXPECT(capture != NULL);
+
+    if (capture == NULL)
+        return;
+
+    for (offset = 0; offset + 12 <= length; offset += blockLength)
+    {
+        blockLength = ReadUlong(&capture[offset + 4]);
+
+        if (blockLength < 12 || offset + blockLength > length)
+            break;
+
+        //
+        // Enhanced packet blocks only, the packet starts with the USBPcap header
+        //
+        if (ReadUlong(&capture[offset]) != 6 || blockLength < 28 + 27)
+            continue;
+
+        captureLength = ReadUlong(&capture[offset + 20]);
+        packet = &capture[offset + 28];
+        headerLength = ReadUshort(packet);
+
+        if (captureLength > blockLength - 28 || headerLength < 27 || captureLength != headerLength + DS4_USB_INPUT_REPORT_LENGTH)
+            continue;
+
+        //
+        // Interrupt transfer from an IN endpoint carrying an input report
+        //
+        if (!(packet[21] & 0x80) || packet[22] != 1 || packet[headerLength] != DS4_USB_INPUT_REPORT_ID)
+            continue;
+
+        ParseUsbReport(&packet[headerLength], &report, &context);
+        DS4_REPORT_EX_TO_USB_REPORT(&report, &context, buffer);
+
+        XNA_TEST_EXPECT(memcmp(buffer, &packet[headerLength], DS4_USB_INPUT_REPORT_LENGTH) == 0);
+
+        reports++;
+    }
+
+    free(capture);
+
+    printf("%lu captured report(s) compared\n", (unsigned long)reports);
+
+    XNA_TEST_EXPECT(reports > 0);
+}
+
+//
+// Frame counter wraps after 64 reports, the timestamp advances by the
+// interval and wraps at 16 bits
+//
+static VOID TestContext(
+    VOID
+)
+{
+    DS4_REPORT_EX           report;
+    DS4_USB_REPORT_CONTEXT  context;
+    UCHAR                   buffer[DS4_USB_INPUT_REPORT_LENGTH];
+    ULONG                   index;
+
+    DS4_REPORT_EX_INIT(&report);
+    report.Report.bSpecial = DS4_SPECIAL_BUTTON_PS;
+
+    DS4_USB_REPORT_CONTEXT_INIT(&context, 752);
+
+    for (index = 0; index < 1000; index++)
+    {
+        DS4_REPORT_EX_TO_USB_REPORT(&report, &context, buffer);
+
+        XNA_TEST_EXPECT(buffer[0] == DS4_USB_INPUT_REPORT_ID);
+        XNA_TEST_EXPECT(buffer[7] == (UCHAR)(((index & 0x3F) << 2) | DS4_SPECIAL_BUTTON_PS));
+        XNA_TEST_EXPECT(ReadUshort(&buffer[10]) == (USHORT)(index * 752));
+        XNA_TEST_EXPECT(buffer[62] == 0x80);
+    }
+}
+
+//
+// Every 12-bit touch position survives serialization
+//
+static VOID TestTouchPoint(
+    VOID
+)
+{
+    DS4_TOUCH_POINT touch;
+    DS4_TOUCH_POINT parsed;
+    UCHAR           buffer[4];
+    ULONG           x;
+    ULONG           y;
+
+    for (x = 0; x < 0x1000; x++)
+    {
+        for (y = 0; y < 0x1000; y += 7)
+        {
+            touch.bIsDown = (BOOLEAN)(x & 1);
+            touch.bTrackingNum = (BYTE)(y & 0x7F);
+            touch.wX = (USHORT)x;
+            touch.wY = (USHORT)y;
+
+            DS4_TOUCH_POINT_SERIALIZE(&touch, buffer);
+            ParseTouchPoint(buffer, &parsed);
+
+            XNA_TEST_EXPECT(parsed.bIsDown == touch.bIsDown && parsed.bTrackingNum == touch.bTrackingNum
+                && parsed.wX == touch.wX && parsed.wY == touch.wY);
+        }
+    }
+}
+
+#define BATCH_COUNT 1024
+
+static DS4_REPORT_EX            BatchInput[BATCH_COUNT];
+static DS4_USB_REPORT_CONTEXT   BatchContext[BATCH_COUNT];
+static UCHAR                    BatchOutput[BATCH_COUNT * DS4_USB_INPUT_REPORT_LENGTH];
+
+static VOID TestBatch(
+    VOID
+)
+{
+    DS4_USB_REPORT_CONTEXT  context;
+    UCHAR                   buffer[DS4_USB_INPUT_REPORT_LENGTH];
+    ULONG                   index;
+
+    XnaTestRandomFill(BatchInput, sizeof(BatchInput));
+
+    for (index = 0; index < BATCH_COUNT; index++)
+    {
+        DS4_USB_REPORT_CONTEXT_INIT(&BatchContext[index], (USHORT)index);
+    }
+
+    DS4_REPORT_EX_TO_USB_REPORT_BATCH(BatchInput, BatchContext, BatchOutput, BATCH_COUNT);
+
+    for (index = 0; index < BATCH_COUNT; index++)
+    {
+        DS4_USB_REPORT_CONTEXT_INIT(&context, (USHORT)index);
+        DS4_REPORT_EX_TO_USB_REPORT(&BatchInput[index], &context, buffer);
+
+        XNA_TEST_EXPECT(memcmp(buffer, &BatchOutput[index * DS4_USB_INPUT_REPORT_LENGTH], sizeof(buffer)) == 0);
+        XNA_TEST_EXPECT(memcmp(&context, &BatchContext[index], sizeof(context)) == 0);
+    }
+}
+
+static VOID Bench(
+    VOID
+)
+{
+    const ULONG iterations = 4000;
+    ULONG       iteration;
+    double      start;
+
+    XnaTestRandomFill(BatchInput, sizeof(BatchInput));
+
+    start = XnaTestNow();
+
+    for (iteration = 0; iteration < iterations; iteration++)
+    {
+        DS4_REPORT_EX_TO_USB_REPORT_BATCH(BatchInput, BatchContext, BatchOutput, BATCH_COUNT);
+
+        XNA_TEST_CONSUME(BatchOutput, sizeof(BatchOutput));
+    }
+
+    XnaTestReport("DS4_REPORT_EX_TO_USB_REPORT_BATCH", (double)iterations * BATCH_COUNT, XnaTestNow() - start);
+}
+
+//
+// Takes the path of a DualShock 4 USB capture
+//
+int main(
+    int argc,
+    char** argv
+)
+{
+    if (argc > 1 && strcmp(argv[1], "--bench") != 0)
+        TestCapture(argv[1]);
+
+    TestContext();
+    TestTouchPoint();
+    TestBatch();
+
+    if (XnaTestBenchEnabled(argc, argv))
+        Bench();
+
+    return XNA_TEST_RESULT();
+}
@@ -0,0 +1,509 @@
+/*
+MIT License
+
+Copyright (c) 2017 Benjamin "Nefarius" Hglinger
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+
+
+#include "HidUsbTest.h"
+#include "ViGEmUtil.h"
+
+//
+// Every override bit of a pad state except the high resolution triggers
+//
+#define DECODE_TEST_ALL_OVERRIDES   ((XINPUT_GAMEPAD_OVERRIDES)(XINPUT_GAMEPAD_OVERRIDE_HIGH_RES_TRIGGERS - 1))
+
+//
+// XInput buttons carried by both layouts next to the D-pad
+//
+#define DECODE_TEST_BUTTONS         (XINPUT_GAMEPAD_START | XINPUT_GAMEPAD_BACK | XINPUT_GAMEPAD_LEFT_THUMB |   \
+                                     XINPUT_GAMEPAD_RIGHT_THUMB | XINPUT_GAMEPAD_LEFT_SHOULDER |                \
+                                     XINPUT_GAMEPAD_RIGHT_SHOULDER | XINPUT_GAMEPAD_A | XINPUT_GAMEPAD_B |      \
+                                     XINPUT_GAMEPAD_X | XINPUT_GAMEPAD_Y)
+
+//
+// D-pad directions of the nine HAT positions, centered first
+//
+static const USHORT DecodeTestDirections[] = {
+    0,
+    XINPUT_GAMEPAD_DPAD_UP,
+    XINPUT_GAMEPAD_DPAD_UP | XINPUT_GAMEPAD_DPAD_RIGHT,
+    XINPUT_GAMEPAD_DPAD_RIGHT,
+    XINPUT_GAMEPAD_DPAD_DOWN | XINPUT_GAMEPAD_DPAD_RIGHT,
+    XINPUT_GAMEPAD_DPAD_DOWN,
+    XINPUT_GAMEPAD_DPAD_DOWN | XINPUT_GAMEPAD_DPAD_LEFT,
+    XINPUT_GAMEPAD_DPAD_LEFT,
+    XINPUT_GAMEPAD_DPAD_UP | XINPUT_GAMEPAD_DPAD_LEFT,
+};
+
+static const SHORT DecodeTestThumbs[] = { SHRT_MIN, SHRT_MIN + 1, -1, 0, 1, SHRT_MAX - 1, SHRT_MAX };
+
+static ULONG DecodeTestMask(
+    ULONG Value
+)
+{
+    ULONG mask = 0;
+    ULONG bit;
+
+    for (bit = 0; bit < 16; bit++)
+    {
+        if (DECODE_TEST_BUTTONS & (1UL << bit))
+        {
+            if (Value & 1)
+                mask |= 1UL << bit;
+
+            Value >>= 1;
+        }
+    }
+
+    return mask;
+}
+
+//
+// Every button combination at every HAT position, encoded into a blank
+// report with all overrides set and decoded again
+//
+static VOID TestButtons(
+    VOID
+)
+{
+    XINPUT_PAD_STATE_INTERNAL   pad;
+    XBONE_HID_USB_INPUT_REPORT  xbone;
+    X360_HID_USB_INPUT_REPORT   x360;
+    XINPUT_GAMEPAD_STATE        gamepad;
+    ULONG                       combination;
+    ULONG                       direction;
+
+    RtlZeroMemory(&pad, sizeof(pad));
+    pad.Overrides = DECODE_TEST_ALL_OVERRIDES;
+
+    for (combination = 0; combination < 1024; combination++)
+    {
+        for (direction = 0; direction < ARRAYSIZE(DecodeTestDirections); direction++)
+        {
+            pad.Gamepad.wButtons = (USHORT)(DecodeTestMask(combination) | DecodeTestDirections[direction]);
+
+            RtlZeroMemory(&xbone, sizeof(xbone));
+            XINPUT_GAMEPAD_TO_XBONE_HID_USB_INPUT_REPORT(&pad, &xbone);
+            XBONE_HID_USB_INPUT_REPORT_TO_XINPUT_GAMEPAD(&xbone, &gamepad);
+
+            XNA_TEST_EXPECT(gamepad.wButtons == pad.Gamepad.wButtons);
+            XNA_TEST_EXPECT(xbone.Dpad == direction);
+
+            RtlZeroMemory(&x360, sizeof(x360));
+            XINPUT_GAMEPAD_TO_X360_HID_USB_INPUT_REPORT(&pad, &x360);
+            X360_HID_USB_INPUT_REPORT_TO_XINPUT_GAMEPAD(&x360, &gamepad);
+
+            XNA_TEST_EXPECT(gamepad.wButtons == pad.Gamepad.wButtons);
+            XNA_TEST_EXPECT((x360.Buttons >> X360_HID_USB_DPAD_SHIFT) == direction);
+        }
+    }
+}
+
+//
+// Thumb extremes of both layouts, every trigger value of the XBONE layout
+// and every value of either trigger on the shared X360 Z axis
+//
+static VOID TestAxes(
+    VOID
+)
+{
+    XINPUT_PAD_STATE_INTERNAL   pad;
+    XBONE_HID_USB_INPUT_REPORT  xbone;
+    X360_HID_USB_INPUT_REPORT   x360;
+    XINPUT_GAMEPAD_STATE        gamepad;
+    ULONG                       index;
+    ULONG                       value;
+
+    RtlZeroMemory(&pad, sizeof(pad));
+    pad.Overrides = DECODE_TEST_ALL_OVERRIDES;
+
+    for (index = 0; index < ARRAYSIZE(DecodeTestThumbs); index++)
+    {
+        pad.Gamepad.sThumbLX = DecodeTestThumbs[index];
+        pad.Gamepad.sThumbLY = DecodeTestThumbs[ARRAYSIZE(DecodeTestThumbs) - 1 - index];
+        pad.Gamepad.sThumbRX = DecodeTestThumbs[(index + 2) % ARRAYSIZE(DecodeTestThumbs)];
+        pad.Gamepad.sThumbRY = DecodeTestThumbs[(index + 5) % ARRAYSIZE(DecodeTestThumbs)];
+
+        XINPUT_GAMEPAD_TO_XBONE_HID_USB_INPUT_REPORT(&pad, &xbone);
+        XBONE_HID_USB_INPUT_REPORT_TO_XINPUT_GAMEPAD(&xbone, &gamepad);
+
+        XNA_TEST_EXPECT(gamepad.sThumbLX == pad.Gamepad.sThumbLX && gamepad.sThumbLY == pad.Gamepad.sThumbLY);
+        XNA_TEST_EXPECT(gamepad.sThumbRX == pad.Gamepad.sThumbRX && gamepad.sThumbRY == pad.Gamepad.sThumbRY);
+
+        XINPUT_GAMEPAD_TO_X360_HID_USB_INPUT_REPORT(&pad, &x360);
+        X360_HID_USB_INPUT_REPORT_TO_XINPUT_GAMEPAD(&x360, &gamepad);
+
+        XNA_TEST_EXPECT(gamepad.sThumbLX == pad.Gamepad.sThumbLX && gamepad.sThumbLY == pad.Gamepad.sThumbLY);
+        XNA_TEST_EXPECT(gamepad.sThumbRX == pad.Gamepad.sThumbRX && gamepad.sThumbRY == pad.Gamepad.sThumbRY);
+    }
+
+    //
+    // 10-bit XBONE triggers decode like XINPUT_TRIGGER_FROM_HIGH_RES, values
+    // above the range are clamped
+    //
+    for (value = 0; value <= USHRT_MAX; value++)
+    {
+        pad.LeftTrigger = (USHORT)value;
+        pad.RightTrigger = (USHORT)(USHRT_MAX - value);
+
+        XINPUT_GAMEPAD_TO_XBONE_HID_USB_INPUT_REPORT(&pad, &xbone);
+        XBONE_HID_USB_INPUT_REPORT_TO_XINPUT_GAMEPAD(&xbone, &gamepad);
+
+        XNA_TEST_EXPECT(gamepad.bLeftTrigger == XINPUT_TRIGGER_FROM_HIGH_RES(min(value, XINPUT_HIGH_RES_TRIGGER_MAX)));
+        XNA_TEST_EXPECT(gamepad.bRightTrigger == XINPUT_TRIGGER_FROM_HIGH_RES(min(USHRT_MAX - value, XINPUT_HIGH_RES_TRIGGER_MAX)));
+    }
+
+    //
+    // One X360 trigger at a time survives the shared Z axis
+    //
+    for (value = 0; value <= UCHAR_MAX; value++)
+    {
+        pad.Gamepad.bLeftTrigger = (BYTE)value;
+        pad.Gamepad.bRightTrigger = 0;
+
+        XINPUT_GAMEPAD_TO_X360_HID_USB_INPUT_REPORT(&pad, &x360);
+        X360_HID_USB_INPUT_REPORT_TO_XINPUT_GAMEPAD(&x360, &gamepad);
+
+        XNA_TEST_EXPECT(gamepad.bLeftTrigger == value && gamepad.bRightTrigger == 0);
+
+        pad.Gamepad.bLeftTrigger = 0;
+        pad.Gamepad.bRightTrigger = (BYTE)value;
+
+        XINPUT_GAMEPAD_TO_X360_HID_USB_INPUT_REPORT(&pad, &x360);
+        X360_HID_USB_INPUT_REPORT_TO_XINPUT_GAMEPAD(&x360, &gamepad);
+
+        XNA_TEST_EXPECT(gamepad.bLeftTrigger == 0 && gamepad.bRightTrigger == value);
+    }
+
+    //
+    // Z axis extremes and rest position, both ends saturate the trigger
+    //
+    x360.ZAxis = 0x00;
+    x360.ZAxisEngaged = 0x00;
+    X360_HID_USB_INPUT_REPORT_TO_XINPUT_GAMEPAD(&x360, &gamepad);
+    XNA_TEST_EXPECT(gamepad.bLeftTrigger == 0 && gamepad.bRightTrigger == UCHAR_MAX);
+
+    x360.ZAxis = 0xFF;
+    x360.ZAxisEngaged = 0xFF;
+    X360_HID_USB_INPUT_REPORT_TO_XINPUT_GAMEPAD(&x360, &gamepad);
+    XNA_TEST_EXPECT(gamepad.bLeftTrigger == UCHAR_MAX && gamepad.bRightTrigger == 0);
+
+    x360.ZAxis = 0x80;
+    x360.ZAxisEngaged = 0x00;
+    X360_HID_USB_INPUT_REPORT_TO_XINPUT_GAMEPAD(&x360, &gamepad);
+    XNA_TEST_EXPECT(gamepad.bLeftTrigger == 0 && gamepad.bRightTrigger == 0);
+
+    //
+    // Both triggers pressed only report their difference
+    //
+    pad.Gamepad.bLeftTrigger = 200;
+    pad.Gamepad.bRightTrigger = 50;
+
+    XINPUT_GAMEPAD_TO_X360_HID_USB_INPUT_REPORT(&pad, &x360);
+    X360_HID_USB_INPUT_REPORT_TO_XINPUT_GAMEPAD(&x360, &gamepad);
+
+    XNA_TEST_EXPECT(gamepad.bLeftTrigger == 150 && gamepad.bRightTrigger == 0);
+}
+
+//
+// Only the two report lengths decode, anything else leaves the state alone
+//
+static VOID TestLengths(
+    VOID
+)
+{
+    UCHAR                   buffer[0x40];
+    XINPUT_GAMEPAD_STATE    gamepad;
+    XINPUT_GAMEPAD_STATE    untouched;
+    XINPUT_GAMEPAD_STATE    expected;
+    ULONG                   length;
+    BOOLEAN                 decoded;
+
+    XnaTestRandomFill(buffer, sizeof(buffer));
+    XnaTestRandomFill(&untouched, sizeof(untouched));
+
+    for (length = 0; length <= sizeof(buffer); length++)
+    {
+        gamepad = untouched;
+        decoded = XINPUT_GAMEPAD_FROM_HID_USB_INPUT_REPORT(buffer, length, &gamepad);
+
+        switch (length)
+        {
+        case X360_HID_USB_INPUT_REPORT_BUFFER_LENGTH:
+            X360_HID_USB_INPUT_REPORT_TO_XINPUT_GAMEPAD((const X360_HID_USB_INPUT_REPORT*)buffer, &expected);
+            XNA_TEST_EXPECT(decoded && memcmp(&gamepad, &expected, sizeof(expected)) == 0);
+            break;
+        case XBONE_HID_USB_INPUT_REPORT_BUFFER_LENGTH:
+            XBONE_HID_USB_INPUT_REPORT_TO_XINPUT_GAMEPAD((const XBONE_HID_USB_INPUT_REPORT*)buffer, &expected);
+            XNA_TEST_EXPECT(decoded && memcmp(&gamepad, &expected, sizeof(expected)) == 0);
+            break;
+        default:
+            //
+            // Including reports truncated by one byte and the 18 bytes
+            // of a raw GIP input frame
+            //
+            XNA_TEST_EXPECT(!decoded && memcmp(&gamepad, &untouched, sizeof(untouched)) == 0);
+            break;
+        }
+    }
+}
+
+//
+// The XBONE HID USB report of a GIP input report payload, following the
+// field order of Research/XUSB_XGIB_HID_USB_Notes.txt
+//
+static VOID XboneReportFromXgip(
+    const XGIP_REPORT* Xgip,
+    PXBONE_HID_USB_INPUT_REPORT Report
+)
+{
+    XUSB_REPORT xusb;
+
+    XGIP_TO_XUSB_REPORT(Xgip, &xusb);
+
+    Report->LeftThumbX = (USHORT)(Xgip->ThumbLX + XBONE_HID_USB_THUMB_AXIS_OFFSET);
+    Report->LeftThumbY = (USHORT)(Xgip->ThumbLY + XBONE_HID_USB_THUMB_AXIS_OFFSET);
+    Report->RightThumbX = (USHORT)(Xgip->ThumbRX + XBONE_HID_USB_THUMB_AXIS_OFFSET);
+    Report->RightThumbY = (USHORT)(Xgip->ThumbRY + XBONE_HID_USB_THUMB_AXIS_OFFSET);
+    Report->LeftTrigger = (USHORT)Xgip->LeftTrigger;
+    Report->RightTrigger = (USHORT)Xgip->RightTrigger;
+    Report->Buttons = XINPUT_TO_XBONE_HID_USB_BUTTONS(xusb.wButtons);
+    Report->Dpad = VIGEM_DPAD_MASK_TO_XBONE_HAT[xusb.wButtons & VIGEM_DPAD_MASK];
+}
+
+//
+// The first input report of Research/AfterglowXBONE_USB-Capture.pcapng: GIP
+// header 20 00 04 0E, no buttons or triggers, slight stick drift
+//
+static const UCHAR DecodeTestAfterglowFrame[] = {
+    0x20, 0x00, 0x04, 0x0E, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x37, 0xFF, 0x0C, 0x02, 0x1E, 0x00, 0x64, 0x01,
+};
+
+#define GIP_INPUT_FRAME_LENGTH      sizeof(DecodeTestAfterglowFrame)
+
+//
+// A GIP input frame carried as XBONE HID USB report decodes to the same
+// state as the GIP payload itself
+//
+static BOOLEAN DecodeXgipFrame(
+    const UCHAR* Frame
+)
+{
+    XGIP_REPORT                 xgip;
+    XUSB_REPORT                 xusb;
+    XBONE_HID_USB_INPUT_REPORT  report;
+    XINPUT_GAMEPAD_STATE        gamepad;
+
+    RtlCopyMemory(&xgip, &Frame[4], sizeof(xgip));
+    XGIP_TO_XUSB_REPORT(&xgip, &xusb);
+    XboneReportFromXgip(&xgip, &report);
+
+    if (!XINPUT_GAMEPAD_FROM_HID_USB_INPUT_REPORT((const UCHAR*)&report, XBONE_HID_USB_INPUT_REPORT_BUFFER_LENGTH, &gamepad))
+        return FALSE;
+
+    return gamepad.wButtons == xusb.wButtons
+        && gamepad.bLeftTrigger == xusb.bLeftTrigger
+        && gamepad.bRightTrigger == xusb.bRightTrigger
+        && gamepad.sThumbLX == xusb.sThumbLX
+        && gamepad.sThumbLY == xusb.sThumbLY
+        && gamepad.sThumbRX == xusb.sThumbRX
+        && gamepad.sThumbRY == xusb.sThumbRY;
+}
+
+static VOID TestAfterglowFrame(
+    VOID
+)
+{
+    XINPUT_GAMEPAD_STATE        gamepad;
+    XBONE_HID_USB_INPUT_REPORT  report;
+    XGIP_REPORT                 xgip;
+
+    C_ASSERT(sizeof(XGIP_REPORT) == 14);
+
+    XNA_TEST_EXPECT(DecodeXgipFrame(DecodeTestAfterglowFrame));
+
+    RtlCopyMemory(&xgip, &DecodeTestAfterglowFrame[4], sizeof(xgip));
+    XboneReportFromXgip(&xgip, &report);
+    XBONE_HID_USB_INPUT_REPORT_TO_XINPUT_GAMEPAD(&report, &gamepad);
+
+    XNA_TEST_EXPECT(gamepad.sThumbLX == -201 && gamepad.sThumbLY == 524);
+    XNA_TEST_EXPECT(gamepad.sThumbRX == 30 && gamepad.sThumbRY == 356);
+    XNA_TEST_EXPECT(gamepad.wButtons == 0 && gamepad.bLeftTrigger == 0 && gamepad.bRightTrigger == 0);
+}
+
+//
+// Random GIP payloads, buttons, D-pad and triggers the capture lacks
+//
+static VOID TestXgipFuzz(
+    VOID
+)
+{
+    UCHAR frame[GIP_INPUT_FRAME_LENGTH];
+    ULONG iteration;
+    ULONG trigger;
+
+    for (iteration = 0; iteration < 100000; iteration++)
+    {
+        XnaTestRandomFill(frame, sizeof(frame));
+
+        //
+        // A single D-pad direction per axis, 10-bit triggers
+        //
+        if ((frame[5] & 0x03) == 0x03)
+            frame[5] &= ~0x02;
+        if ((frame[5] & 0x0C) == 0x0C)
+            frame[5] &= ~0x08;
+
+        trigger = XnaTestRandom() % (XINPUT_HIGH_RES_TRIGGER_MAX + 1);
+        frame[6] = (UCHAR)trigger;
+        frame[7] = (UCHAR)(trigger >> 8);
+        trigger = XnaTestRandom() % (XINPUT_HIGH_RES_TRIGGER_MAX + 1);
+        frame[8] = (UCHAR)trigger;
+        frame[9] = (UCHAR)(trigger >> 8);
+
+        XNA_TEST_EXPECT(DecodeXgipFrame(frame));
+    }
+}
+
+static PUCHAR ReadFileContents(
+    const char* Path,
+    size_t* Length
+)
+{
+    FILE*   file = fopen(Path, "rb");
+    PUCHAR  contents = NULL;
+    long    size;
+
+    if (file == NULL)
+        return NULL;
+
+    if (fseek(file, 0, SEEK_END) == 0 && (size = ftell(file)) > 0 && fseek(file, 0, SEEK_SET) == 0)
+    {
+        contents = (PUCHAR)malloc((size_t)size);
+
+        if (contents != NULL && fread(contents, 1, (size_t)size, file) != (size_t)size)
+        {
+            free(contents);
+            contents = NULL;
+        }
+
+        *Length = (size_t)size;
+    }
+
+    fclose(file);
+
+    return contents;
+}
+
+static ULONG ReadUlong(
+    const UCHAR* Buffer
+)
+{
+    return (ULONG)Buffer[0] | ((ULONG)Buffer[1] << 8) | ((ULONG)Buffer[2] << 16) | ((ULONG)Buffer[3] << 24);
+}
+
+//
+// Every GIP input report of a USBPcap capture
+//
+static VOID TestCapture(
+    const char* Path
+)
+{
+    PUCHAR          capture;
+    size_t          length = 0;
+    size_t          offset;
+    ULONG           blockLength;
+    ULONG           captureLength;
+    const UCHAR*    packet;
+    USHORT          headerLength;
+    ULONG           reports = 0;
+    BOOLEAN         first = TRUE;
+
+    capture = ReadFileContents(Path, &length);
+    XNA_TEST_EXPECT(capture != NULL);
+
+    if (capture == NULL)
+        return;
+
+    for (offset = 0; offset + 12 <= length; offset += blockLength)
+    {
+        blockLength = ReadUlong(&capture[offset + 4]);
+
+        if (blockLength < 12 || offset + blockLength > length)
+            break;
+
+        //
+        // Enhanced packet blocks only, the packet starts with the USBPcap header
+        //
+        if (ReadUlong(&capture[offset]) != 6 || blockLength < 28 + 27)
+            continue;
+
+        captureLength = ReadUlong(&capture[offset + 20]);
+        packet = &capture[offset + 28];
+        headerLength = (USHORT)(packet[0] | (packet[1] << 8));
+
+        if (captureLength > blockLength - 28 || headerLength < 27 || captureLength != headerLength + GIP_INPUT_FRAME_LENGTH)
+            continue;
+
+        //
+        // Interrupt transfer from an IN endpoint carrying an input report
+        //
+        if (!(packet[21] & 0x80) || packet[22] != 1 || packet[headerLength] != 0x20 || packet[headerLength + 3] != 0x0E)
+            continue;
+
+        if (first)
+        {
+            XNA_TEST_EXPECT(memcmp(&packet[headerLength], DecodeTestAfterglowFrame, GIP_INPUT_FRAME_LENGTH) == 0);
+            first = FALSE;
+        }
+
+        XNA_TEST_EXPECT(DecodeXgipFrame(&packet[headerLength]));
+
+        reports++;
+    }
+
+    free(capture);
+
+    printf("%lu captured report(s) compared\n", (unsigned long)reports);
+
+    XNA_TEST_EXPECT(reports > 0);
+}
+
+int main(
+    int argc,
+    char** argv
+)
+{
+    TestButtons();
+    TestAxes();
+    TestLengths();
+    TestAfterglowFrame();
+    TestXgipFuzz();
+
+    if (argc > 1 && strcmp(argv[1], "--bench") != 0)
+        TestCapture(argv[1]);
+
+    return XNA_TEST_RESULT();
+}
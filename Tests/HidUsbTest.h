@@ -0,0 +1,93 @@
+/*
+MIT License
+
+Copyright (c) 2017 Benjamin "Nefarius" Hglinger
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#pragma once
+
+//
+// Builds the report helpers of Sys/XnaGuardian/HidUsb.h outside the driver.
+// The WDF types its prototypes use are opaque here, the pad state mirrors
+// XINPUT_PAD_STATE_INTERNAL of Device.h.
+//
+
+#include "XnaTest.h"
+
+typedef LONG NTSTATUS;
+typedef PVOID WDFDEVICE;
+typedef PVOID WDFREQUEST;
+typedef struct _DEVICE_CONTEXT* PDEVICE_CONTEXT;
+typedef VOID EVT_WDF_USB_READER_COMPLETION_ROUTINE(VOID);
+
+#include "Public.h"
+#include "XInputOverrides.h"
+#include "XnaGuardianShared.h"
+#include "XInputOverrideMerge.h"
+
+typedef struct _XINPUT_PAD_STATE_INTERNAL
+{
+    XINPUT_GAMEPAD_OVERRIDES    Overrides;
+    XINPUT_GAMEPAD_STATE        Gamepad;
+    USHORT                      LeftTrigger;
+    USHORT                      RightTrigger;
+    XINPUT_GAMEPAD_STATE        Mask;
+
+} XINPUT_PAD_STATE_INTERNAL, *PXINPUT_PAD_STATE_INTERNAL;
+
+#include "HidUsb.h"
+
+//
+// Defined in HidUsb.c in the driver
+//
+const USHORT XInputToXboneHidUsbButtonsLow[256] = {
+    VIGEM_LUT_256(XINPUT_TO_XBONE_HID_USB_BUTTONS_LOW_ENTRY, 0)
+};
+
+const USHORT XInputToXboneHidUsbButtonsHigh[256] = {
+    VIGEM_LUT_256(XINPUT_TO_XBONE_HID_USB_BUTTONS_HIGH_ENTRY, 0)
+};
+
+const USHORT XInputToX360HidUsbButtonsLow[256] = {
+    VIGEM_LUT_256(XINPUT_TO_X360_HID_USB_BUTTONS_LOW_ENTRY, 0)
+};
+
+const USHORT XInputToX360HidUsbButtonsHigh[256] = {
+    VIGEM_LUT_256(XINPUT_TO_X360_HID_USB_BUTTONS_HIGH_ENTRY, 0)
+};
+
+//
+// Random pad state, the 10-bit triggers derived from the 8-bit ones like
+// XINPUT_PAD_STATE_INTERNAL_SET does without high resolution triggers
+//
+static VOID XnaTestRandomPadState(
+    PXINPUT_PAD_STATE_INTERNAL Pad
+)
+{
+    XnaTestRandomFill(&Pad->Gamepad, sizeof(Pad->Gamepad));
+
+    Pad->Overrides = XnaTestRandom() & ~XINPUT_GAMEPAD_OVERRIDE_HIGH_RES_TRIGGERS;
+    Pad->LeftTrigger = XINPUT_TRIGGER_TO_HIGH_RES(Pad->Gamepad.bLeftTrigger);
+    Pad->RightTrigger = XINPUT_TRIGGER_TO_HIGH_RES(Pad->Gamepad.bRightTrigger);
+
+    XINPUT_GAMEPAD_MERGE_MASK_FROM_OVERRIDES(Pad->Overrides, &Pad->Mask);
+}
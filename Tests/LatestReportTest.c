@@ -0,0 +1,302 @@
+/*
+MIT License
+
+Copyright (c) 2017 Benjamin "Nefarius" Hglinger
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+
+
+#include "XnaTest.h"
+#include "XnaGuardianLatestReport.h"
+
+#include <math.h>
+
+#define LATEST_TEST_REPORTS     200000
+
+typedef struct _LATEST_SIM_RESULT
+{
+    //
+    // Requests completed and reports delivered, replaced in the mailbox or
+    // dropped for lack of a pending request
+    //
+    ULONG Delivered;
+    ULONG Coalesced;
+    ULONG Dropped;
+
+    //
+    // Time an upper request waits for its completion, in ms
+    //
+    double MeanWait;
+    double MaxWait;
+
+    //
+    // Age of the delivered report at completion, in ms
+    //
+    double MeanAge;
+    double MaxAge;
+
+} LATEST_SIM_RESULT, *PLATEST_SIM_RESULT;
+
+static double LatestSimUniform(
+    VOID
+)
+{
+    return ((double)XnaTestRandom() + 0.5) / 4294967296.0;
+}
+
+//
+// Delivers the report numbered Sequence read at ReportTime to the request
+// pending since RequestTime
+//
+static VOID LatestSimDeliver(
+    PLATEST_SIM_RESULT Result,
+    PULONG LastSequence,
+    ULONG Sequence,
+    double ReportTime,
+    double RequestTime,
+    double Time
+)
+{
+    //
+    // Never twice, never older than one delivered before
+    //
+    XNA_TEST_EXPECT(Sequence > *LastSequence);
+    *LastSequence = Sequence;
+
+    Result->Delivered++;
+    Result->MeanWait += Time - RequestTime;
+    Result->MaxWait = max(Result->MaxWait, Time - RequestTime);
+    Result->MeanAge += Time - ReportTime;
+    Result->MaxAge = max(Result->MaxAge, Time - ReportTime);
+}
+
+//
+// The device reports every ReportInterval ms. A single upper requester
+// thinks for ThinkTime ms on average after each completion before it sends
+// the next request. With the mailbox a report finding no request pending
+// is stored for the next one like in the driver, without it is dropped.
+//
+static VOID LatestSimulate(
+    BOOLEAN Mailbox,
+    double ReportInterval,
+    double ThinkTime,
+    PLATEST_SIM_RESULT Result
+)
+{
+    XNA_LATEST_REPORT   latest;
+    UCHAR               report[XNA_LATEST_REPORT_MAX_LENGTH];
+    ULONG               length;
+    ULONGLONG           time;
+    ULONG               sequence;
+    ULONG               lastSequence = 0;
+    ULONG               stored = 0;
+    ULONG               taken = 0;
+    BOOLEAN             pending = FALSE;
+    double              requestTime = 0.0;
+    double              reportTime;
+
+    RtlZeroMemory(&latest, sizeof(latest));
+    RtlZeroMemory(Result, sizeof(*Result));
+
+    //
+    // Times are kept in microseconds in the mailbox
+    //
+    for (sequence = 1; sequence <= LATEST_TEST_REPORTS; sequence++)
+    {
+        reportTime = sequence * ReportInterval;
+
+        //
+        // Requests sent before this report, served from the mailbox
+        //
+        while (!pending && requestTime < reportTime)
+        {
+            if (Mailbox && XNA_LATEST_REPORT_TAKE(&latest, report, &length, &time))
+            {
+                XNA_TEST_EXPECT(length == sizeof(ULONG));
+                taken++;
+
+                LatestSimDeliver(Result, &lastSequence, *(PULONG)report, time / 1000.0, requestTime, requestTime);
+                requestTime += -log(LatestSimUniform()) * ThinkTime;
+                continue;
+            }
+
+            pending = TRUE;
+        }
+
+        if (pending)
+        {
+            LatestSimDeliver(Result, &lastSequence, sequence, reportTime, requestTime, reportTime);
+            requestTime = reportTime - log(LatestSimUniform()) * ThinkTime;
+            pending = FALSE;
+        }
+        else if (Mailbox)
+        {
+            XNA_LATEST_REPORT_STORE(&latest, (const UCHAR*)&sequence, sizeof(ULONG),
+                (ULONGLONG)(reportTime * 1000.0 + 0.5));
+            stored++;
+        }
+        else
+        {
+            Result->Dropped++;
+        }
+    }
+
+    //
+    // Every stored report is either taken, replaced or still stored
+    //
+    Result->Coalesced = (ULONG)latest.Coalesced;
+    XNA_TEST_EXPECT(stored == taken + Result->Coalesced + (latest.Length > 0 ? 1 : 0));
+
+    Result->MeanWait /= Result->Delivered;
+    Result->MeanAge /= Result->Delivered;
+}
+
+static VOID TestStoreTake(
+    VOID
+)
+{
+    XNA_LATEST_REPORT   latest;
+    UCHAR               input[XNA_LATEST_REPORT_MAX_LENGTH + 8];
+    UCHAR               report[XNA_LATEST_REPORT_MAX_LENGTH];
+    ULONG               length;
+    ULONGLONG           time;
+    ULONG               index;
+
+    RtlZeroMemory(&latest, sizeof(latest));
+
+    for (index = 0; index < sizeof(input); index++)
+        input[index] = (UCHAR)index;
+
+    XNA_TEST_EXPECT(!XNA_LATEST_REPORT_TAKE(&latest, report, &length, &time));
+    XNA_TEST_EXPECT(length == 0);
+
+    //
+    // Taken once only
+    //
+    XNA_TEST_EXPECT(!XNA_LATEST_REPORT_STORE(&latest, input, 17, 100));
+    XNA_TEST_EXPECT(XNA_LATEST_REPORT_TAKE(&latest, report, &length, &time));
+    XNA_TEST_EXPECT(length == 17 && time == 100 && RtlEqualMemory(report, input, 17));
+    XNA_TEST_EXPECT(!XNA_LATEST_REPORT_TAKE(&latest, report, &length, &time));
+    XNA_TEST_EXPECT(latest.Coalesced == 0);
+
+    //
+    // The newer report replaces the older one, which counts as coalesced
+    //
+    XNA_TEST_EXPECT(!XNA_LATEST_REPORT_STORE(&latest, input, 17, 200));
+    XNA_TEST_EXPECT(XNA_LATEST_REPORT_STORE(&latest, input + 1, 17, 300));
+    XNA_TEST_EXPECT(latest.Coalesced == 1);
+    XNA_TEST_EXPECT(XNA_LATEST_REPORT_TAKE(&latest, report, &length, &time));
+    XNA_TEST_EXPECT(length == 17 && time == 300 && RtlEqualMemory(report, input + 1, 17));
+
+    //
+    // Discarded reports are neither taken nor coalesced
+    //
+    XNA_TEST_EXPECT(!XNA_LATEST_REPORT_STORE(&latest, input, 17, 400));
+    XNA_LATEST_REPORT_DISCARD(&latest);
+    XNA_TEST_EXPECT(!XNA_LATEST_REPORT_TAKE(&latest, report, &length, &time));
+    XNA_TEST_EXPECT(!XNA_LATEST_REPORT_STORE(&latest, input, 17, 500));
+    XNA_TEST_EXPECT(latest.Coalesced == 1);
+
+    //
+    // The longest report fits, longer ones are dropped instead of truncated
+    // and keep the stored report
+    //
+    XNA_LATEST_REPORT_DISCARD(&latest);
+    XNA_TEST_EXPECT(!XNA_LATEST_REPORT_STORE(&latest, input, XNA_LATEST_REPORT_MAX_LENGTH, 600));
+    XNA_TEST_EXPECT(XNA_LATEST_REPORT_TAKE(&latest, report, &length, &time));
+    XNA_TEST_EXPECT(length == XNA_LATEST_REPORT_MAX_LENGTH && RtlEqualMemory(report, input, length));
+    XNA_TEST_EXPECT(latest.Dropped == 0);
+
+    XNA_TEST_EXPECT(!XNA_LATEST_REPORT_STORE(&latest, input, XNA_LATEST_REPORT_MAX_LENGTH + 1, 700));
+    XNA_TEST_EXPECT(!XNA_LATEST_REPORT_TAKE(&latest, report, &length, &time));
+    XNA_TEST_EXPECT(latest.Dropped == 1);
+
+    XNA_TEST_EXPECT(!XNA_LATEST_REPORT_STORE(&latest, input + 2, 17, 800));
+    XNA_TEST_EXPECT(!XNA_LATEST_REPORT_STORE(&latest, input, sizeof(input), 900));
+    XNA_TEST_EXPECT(XNA_LATEST_REPORT_TAKE(&latest, report, &length, &time));
+    XNA_TEST_EXPECT(length == 17 && time == 800 && RtlEqualMemory(report, input + 2, 17));
+    XNA_TEST_EXPECT(latest.Dropped == 2 && latest.Coalesced == 1);
+}
+
+//
+// Delivery with and without the mailbox for requesters faster and slower
+// than the device
+//
+static VOID TestSimulation(
+    VOID
+)
+{
+    static const double rates[][2] =
+    {
+        //
+        // Report interval and think time in ms
+        //
+        { 8.0, 3.0 },
+        { 8.0, 16.0 },
+        { 1.0, 3.0 },
+        { 1.0, 0.25 },
+    };
+    LATEST_SIM_RESULT   off;
+    LATEST_SIM_RESULT   on;
+    ULONG               rate;
+
+    printf("interval  think     mailbox  delivered  coalesced  dropped  mean wait  max wait  mean age  max age\n");
+
+    for (rate = 0; rate < ARRAYSIZE(rates); rate++)
+    {
+        LatestSimulate(FALSE, rates[rate][0], rates[rate][1], &off);
+        LatestSimulate(TRUE, rates[rate][0], rates[rate][1], &on);
+
+        printf("%5.2f ms  %5.2f ms  off  %11lu  %9lu  %7lu  %6.3f ms  %5.2f ms  %5.3f ms  %4.2f ms\n",
+            rates[rate][0], rates[rate][1], (unsigned long)off.Delivered, (unsigned long)off.Coalesced,
+            (unsigned long)off.Dropped, off.MeanWait, off.MaxWait, off.MeanAge, off.MaxAge);
+        printf("%5.2f ms  %5.2f ms  on   %11lu  %9lu  %7lu  %6.3f ms  %5.2f ms  %5.3f ms  %4.2f ms\n",
+            rates[rate][0], rates[rate][1], (unsigned long)on.Delivered, (unsigned long)on.Coalesced,
+            (unsigned long)on.Dropped, on.MeanWait, on.MaxWait, on.MeanAge, on.MaxAge);
+
+        //
+        // Without the mailbox reports are fresh but requests wait for the
+        // next one, with it they don't wait for data already read
+        //
+        XNA_TEST_EXPECT(off.Coalesced == 0 && off.MeanAge == 0.0);
+        XNA_TEST_EXPECT(on.Dropped == 0);
+        XNA_TEST_EXPECT(on.Delivered >= off.Delivered);
+        XNA_TEST_EXPECT(on.MeanWait < off.MeanWait);
+        XNA_TEST_EXPECT(on.MaxWait <= rates[rate][0] + 1e-9);
+
+        //
+        // A stored report is replaced by the next one, so no request gets
+        // data older than one report interval
+        //
+        XNA_TEST_EXPECT(on.MaxAge <= rates[rate][0] + 1e-3);
+    }
+}
+
+int main(
+    VOID
+)
+{
+    TestStoreTake();
+    TestSimulation();
+
+    return XNA_TEST_RESULT();
+}
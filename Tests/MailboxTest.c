@@ -0,0 +1,254 @@
+/*
+MIT License
+
+Copyright (c) 2017 Benjamin "Nefarius" Hglinger
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#include "XnaTest.h"
+#include "XnaGuardianShared.h"
+#include "XnaGuardianMailbox.h"
+
+#define MAILBOX_TEST_WRITES     200000
+
+static XNA_GUARDIAN_MAILBOX MailboxTestMailbox;
+static volatile LONG        MailboxTestDone;
+
+//
+// Every field carries the low bits of the generation of the write
+//
+static VOID MailboxTestFill(
+    PXNA_GUARDIAN_MAILBOX_OVERRIDE Override,
+    ULONG Generation
+)
+{
+    Override->Overrides = Generation;
+    Override->Gamepad.wButtons = (USHORT)Generation;
+    Override->Gamepad.bLeftTrigger = (BYTE)Generation;
+    Override->Gamepad.bRightTrigger = (BYTE)Generation;
+    Override->Gamepad.sThumbLX = (SHORT)Generation;
+    Override->Gamepad.sThumbLY = (SHORT)Generation;
+    Override->Gamepad.sThumbRX = (SHORT)Generation;
+    Override->Gamepad.sThumbRY = (SHORT)Generation;
+    Override->LeftTrigger = (USHORT)Generation;
+    Override->RightTrigger = (USHORT)Generation;
+}
+
+static BOOLEAN MailboxTestIsTorn(
+    const XNA_GUARDIAN_MAILBOX_OVERRIDE* Override
+)
+{
+    XNA_GUARDIAN_MAILBOX_OVERRIDE expected;
+
+    RtlZeroMemory(&expected, sizeof(expected));
+    MailboxTestFill(&expected, Override->Overrides);
+
+    return !RtlEqualMemory(Override, &expected, sizeof(expected));
+}
+
+static VOID TestLayout(
+    VOID
+)
+{
+    ULONG index;
+
+    XNA_GUARDIAN_MAILBOX_INIT(&MailboxTestMailbox);
+
+    XNA_TEST_EXPECT(MailboxTestMailbox.Size == sizeof(XNA_GUARDIAN_MAILBOX));
+    XNA_TEST_EXPECT(sizeof(XNA_GUARDIAN_MAILBOX) == (XINPUT_MAX_DEVICES + 1) * XNA_GUARDIAN_MAILBOX_ALIGNMENT);
+
+    //
+    // Every slot has its cache line for itself
+    //
+    for (index = 0; index < XINPUT_MAX_DEVICES; index++)
+    {
+        XNA_TEST_EXPECT(((ULONG_PTR)&MailboxTestMailbox.Slots[index] - (ULONG_PTR)&MailboxTestMailbox)
+            == (index + 1) * XNA_GUARDIAN_MAILBOX_ALIGNMENT);
+        XNA_TEST_EXPECT(MailboxTestMailbox.Slots[index].Lock.Sequence == 0);
+    }
+}
+
+static VOID TestBusyWriter(
+    VOID
+)
+{
+    XNA_GUARDIAN_MAILBOX_SLOT     slot;
+    XNA_GUARDIAN_MAILBOX_OVERRIDE override;
+    XNA_GUARDIAN_MAILBOX_OVERRIDE read;
+
+    RtlZeroMemory(&slot, sizeof(slot));
+    RtlZeroMemory(&override, sizeof(override));
+    MailboxTestFill(&override, 0x1234);
+
+    XNA_GUARDIAN_MAILBOX_SLOT_WRITE(&slot, &override);
+    XNA_TEST_EXPECT(XNA_GUARDIAN_MAILBOX_SLOT_TRY_READ(&slot, &read));
+    XNA_TEST_EXPECT(RtlEqualMemory(&read, &override, sizeof(read)));
+
+    //
+    // A writer stuck in the middle of an update, e.g. a suspended process,
+    // must not stall the reader
+    //
+    XNA_SEQ_LOCK_WRITE_BEGIN(&slot.Lock);
+    XNA_TEST_EXPECT(!XNA_GUARDIAN_MAILBOX_SLOT_TRY_READ(&slot, &read));
+    XNA_SEQ_LOCK_WRITE_END(&slot.Lock);
+
+    XNA_TEST_EXPECT(XNA_GUARDIAN_MAILBOX_SLOT_TRY_READ(&slot, &read));
+}
+
+static VOID MailboxTestWriter(
+    PVOID Context
+)
+{
+    XNA_GUARDIAN_MAILBOX_OVERRIDE override;
+    ULONG generation;
+
+    UNREFERENCED_PARAMETER(Context);
+
+    RtlZeroMemory(&override, sizeof(override));
+
+    for (generation = 1; generation <= MAILBOX_TEST_WRITES; generation++)
+    {
+        MailboxTestFill(&override, generation);
+
+        XNA_GUARDIAN_MAILBOX_SLOT_WRITE(&MailboxTestMailbox.Slots[generation % XINPUT_MAX_DEVICES], &override);
+
+        if ((generation & 0xFF) == 0)
+            XnaTestThreadYield();
+    }
+
+    InterlockedExchange(&MailboxTestDone, TRUE);
+}
+
+static VOID TestStress(
+    VOID
+)
+{
+    XNA_TEST_THREAD               writer;
+    XNA_GUARDIAN_MAILBOX_OVERRIDE last[XINPUT_MAX_DEVICES];
+    XNA_GUARDIAN_MAILBOX_OVERRIDE override;
+    ULONG                         reads = 0;
+    ULONG                         busy = 0;
+    ULONG                         torn = 0;
+    ULONG                         backwards = 0;
+    ULONG                         index;
+
+    XNA_GUARDIAN_MAILBOX_INIT(&MailboxTestMailbox);
+    RtlZeroMemory(last, sizeof(last));
+    MailboxTestDone = FALSE;
+
+    XnaTestThreadStart(&writer, MailboxTestWriter, NULL);
+
+    //
+    // Reads like the driver does on every report, falling back to the last
+    // consistent data while the writer is busy
+    //
+    while (!MailboxTestDone)
+    {
+        for (index = 0; index < XINPUT_MAX_DEVICES; index++)
+        {
+            if (XNA_GUARDIAN_MAILBOX_SLOT_TRY_READ(&MailboxTestMailbox.Slots[index], &override))
+            {
+                reads++;
+
+                if (MailboxTestIsTorn(&override))
+                    torn++;
+
+                if (override.Overrides < last[index].Overrides)
+                    backwards++;
+
+                last[index] = override;
+            }
+            else
+            {
+                busy++;
+            }
+        }
+
+        if ((reads & 0xFF) == 0)
+            XnaTestThreadYield();
+    }
+
+    XnaTestThreadJoin(&writer);
+
+    printf("%lu reads, %lu busy, %lu torn\n", (unsigned long)reads, (unsigned long)busy, (unsigned long)torn);
+
+    XNA_TEST_EXPECT(torn == 0);
+    XNA_TEST_EXPECT(backwards == 0);
+
+    //
+    // Once the writer is done every slot holds its last write
+    //
+    for (index = 0; index < XINPUT_MAX_DEVICES; index++)
+    {
+        XNA_TEST_EXPECT(XNA_GUARDIAN_MAILBOX_SLOT_TRY_READ(&MailboxTestMailbox.Slots[index], &override));
+        XNA_TEST_EXPECT(!MailboxTestIsTorn(&override));
+        XNA_TEST_EXPECT(override.Overrides + XINPUT_MAX_DEVICES > MAILBOX_TEST_WRITES);
+        XNA_TEST_EXPECT(override.Overrides % XINPUT_MAX_DEVICES == index);
+    }
+}
+
+static VOID Bench(
+    VOID
+)
+{
+    const ULONG                   iterations = 10000000;
+    XNA_GUARDIAN_MAILBOX_OVERRIDE override;
+    ULONG                         iteration;
+    double                        start;
+
+    RtlZeroMemory(&override, sizeof(override));
+
+    start = XnaTestNow();
+
+    for (iteration = 0; iteration < iterations; iteration++)
+    {
+        override.Overrides = iteration;
+        XNA_GUARDIAN_MAILBOX_SLOT_WRITE(&MailboxTestMailbox.Slots[iteration % XINPUT_MAX_DEVICES], &override);
+    }
+
+    XnaTestReport("XNA_GUARDIAN_MAILBOX_SLOT_WRITE", (double)iterations, XnaTestNow() - start);
+
+    start = XnaTestNow();
+
+    for (iteration = 0; iteration < iterations; iteration++)
+    {
+        XNA_GUARDIAN_MAILBOX_SLOT_TRY_READ(&MailboxTestMailbox.Slots[iteration % XINPUT_MAX_DEVICES], &override);
+
+        XNA_TEST_CONSUME(&override, sizeof(override));
+    }
+
+    XnaTestReport("XNA_GUARDIAN_MAILBOX_SLOT_TRY_READ", (double)iterations, XnaTestNow() - start);
+}
+
+int main(
+    int argc,
+    char** argv
+)
+{
+    TestLayout();
+    TestBusyWriter();
+    TestStress();
+
+    if (XnaTestBenchEnabled(argc, argv))
+        Bench();
+
+    return XNA_TEST_RESULT();
+}
@@ -0,0 +1,173 @@
+/*
+MIT License
+
+Copyright (c) 2017 Benjamin "Nefarius" Hglinger
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#include "XnaTest.h"
+#include "XInputOverrideMerge.h"
+
+//
+// One field at a time, the way overrides were merged before the mask
+//
+static VOID MergeReference(
+    PXINPUT_GAMEPAD_STATE Target,
+    ULONG Overrides,
+    const XINPUT_GAMEPAD_STATE* Value
+)
+{
+    USHORT buttons = (USHORT)(Overrides & 0xFFFF);
+
+    Target->wButtons = (USHORT)((Target->wButtons & ~buttons) | (Value->wButtons & buttons));
+
+    if (Overrides & XINPUT_GAMEPAD_OVERRIDE_LEFT_TRIGGER)
+        Target->bLeftTrigger = Value->bLeftTrigger;
+    if (Overrides & XINPUT_GAMEPAD_OVERRIDE_RIGHT_TRIGGER)
+        Target->bRightTrigger = Value->bRightTrigger;
+    if (Overrides & XINPUT_GAMEPAD_OVERRIDE_LEFT_THUMB_X)
+        Target->sThumbLX = Value->sThumbLX;
+    if (Overrides & XINPUT_GAMEPAD_OVERRIDE_LEFT_THUMB_Y)
+        Target->sThumbLY = Value->sThumbLY;
+    if (Overrides & XINPUT_GAMEPAD_OVERRIDE_RIGHT_THUMB_X)
+        Target->sThumbRX = Value->sThumbRX;
+    if (Overrides & XINPUT_GAMEPAD_OVERRIDE_RIGHT_THUMB_Y)
+        Target->sThumbRY = Value->sThumbRY;
+}
+
+//
+// Random states and overrides, merged into a target at every alignment
+//
+static VOID TestFuzz(
+    VOID
+)
+{
+    UCHAR                   buffer[sizeof(XINPUT_GAMEPAD_STATE) + 8];
+    XINPUT_GAMEPAD_STATE    target;
+    XINPUT_GAMEPAD_STATE    value;
+    XINPUT_GAMEPAD_STATE    mask;
+    ULONG                   overrides;
+    ULONG                   iteration;
+    ULONG                   alignment;
+
+    for (iteration = 0; iteration < 1000000; iteration++)
+    {
+        XnaTestRandomFill(&target, sizeof(target));
+        XnaTestRandomFill(&value, sizeof(value));
+
+        overrides = XnaTestRandom();
+        alignment = iteration % 8;
+
+        RtlCopyMemory(&buffer[alignment], &target, sizeof(target));
+
+        XINPUT_GAMEPAD_MERGE_MASK_FROM_OVERRIDES(overrides, &mask);
+        XINPUT_GAMEPAD_STATE_MERGE((PXINPUT_GAMEPAD_STATE)&buffer[alignment], &value, &mask);
+
+        MergeReference(&target, overrides, &value);
+
+        XNA_TEST_EXPECT(memcmp(&buffer[alignment], &target, sizeof(target)) == 0);
+    }
+}
+
+#define BATCH_COUNT 4096
+
+static XINPUT_GAMEPAD_STATE BatchTargets[BATCH_COUNT];
+static XINPUT_GAMEPAD_STATE BatchExpected[BATCH_COUNT];
+static XINPUT_GAMEPAD_STATE BatchValues[BATCH_COUNT];
+static XINPUT_GAMEPAD_STATE BatchMasks[BATCH_COUNT];
+
+static VOID TestBatch(
+    VOID
+)
+{
+    ULONG index;
+
+    XnaTestRandomFill(BatchTargets, sizeof(BatchTargets));
+    XnaTestRandomFill(BatchValues, sizeof(BatchValues));
+
+    for (index = 0; index < BATCH_COUNT; index++)
+    {
+        XINPUT_GAMEPAD_MERGE_MASK_FROM_OVERRIDES(XnaTestRandom(), &BatchMasks[index]);
+
+        BatchExpected[index] = BatchTargets[index];
+        XINPUT_GAMEPAD_STATE_MERGE(&BatchExpected[index], &BatchValues[index], &BatchMasks[index]);
+    }
+
+    XINPUT_GAMEPAD_STATE_MERGE_BATCH(BatchTargets, BatchValues, BatchMasks, BATCH_COUNT);
+
+    XNA_TEST_EXPECT(memcmp(BatchTargets, BatchExpected, sizeof(BatchTargets)) == 0);
+}
+
+static VOID Bench(
+    VOID
+)
+{
+    const ULONG iterations = 4000;
+    ULONG       overrides[BATCH_COUNT];
+    ULONG       iteration;
+    ULONG       index;
+    double      start;
+
+    for (index = 0; index < BATCH_COUNT; index++)
+    {
+        overrides[index] = XnaTestRandom();
+        XINPUT_GAMEPAD_MERGE_MASK_FROM_OVERRIDES(overrides[index], &BatchMasks[index]);
+    }
+
+    start = XnaTestNow();
+
+    for (iteration = 0; iteration < iterations; iteration++)
+    {
+        for (index = 0; index < BATCH_COUNT; index++)
+        {
+            MergeReference(&BatchTargets[index], overrides[index], &BatchValues[index]);
+        }
+
+        XNA_TEST_CONSUME(BatchTargets, sizeof(BatchTargets));
+    }
+
+    XnaTestReport("Merge (branching reference)", (double)iterations * BATCH_COUNT, XnaTestNow() - start);
+
+    start = XnaTestNow();
+
+    for (iteration = 0; iteration < iterations; iteration++)
+    {
+        XINPUT_GAMEPAD_STATE_MERGE_BATCH(BatchTargets, BatchValues, BatchMasks, BATCH_COUNT);
+
+        XNA_TEST_CONSUME(BatchTargets, sizeof(BatchTargets));
+    }
+
+    XnaTestReport("XINPUT_GAMEPAD_STATE_MERGE_BATCH", (double)iterations * BATCH_COUNT, XnaTestNow() - start);
+}
+
+int main(
+    int argc,
+    char** argv
+)
+{
+    TestFuzz();
+    TestBatch();
+
+    if (XnaTestBenchEnabled(argc, argv))
+        Bench();
+
+    return XNA_TEST_RESULT();
+}
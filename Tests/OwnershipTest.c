@@ -0,0 +1,366 @@
+/*
+MIT License
+
+Copyright (c) 2017 Benjamin "Nefarius" Hglinger
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+
+
+#include "XnaTest.h"
+#include "XnaGuardianOwnership.h"
+
+#define OWNERSHIP_TEST_OWNERS   5
+
+//
+// Owner and lease of every slot kept without slot masks
+//
+typedef struct _OWNERSHIP_REFERENCE
+{
+    BOOLEAN     Owned[XNA_OWNERSHIP_SLOTS];
+    PVOID       Owner[XNA_OWNERSHIP_SLOTS];
+    ULONGLONG   ExpirationTime[XNA_OWNERSHIP_SLOTS];
+
+} OWNERSHIP_REFERENCE, *POWNERSHIP_REFERENCE;
+
+static ULONG ReferenceRelease(
+    POWNERSHIP_REFERENCE Reference,
+    PVOID Owner
+)
+{
+    ULONG slots = 0;
+    ULONG slot;
+
+    for (slot = 0; slot < XNA_OWNERSHIP_SLOTS; slot++)
+    {
+        if (Reference->Owned[slot] && Reference->Owner[slot] == Owner)
+        {
+            Reference->Owned[slot] = FALSE;
+            slots |= 1UL << slot;
+        }
+    }
+
+    return slots;
+}
+
+static ULONG ReferenceExpire(
+    POWNERSHIP_REFERENCE Reference,
+    ULONGLONG Time
+)
+{
+    ULONG slots = 0;
+    ULONG slot;
+
+    for (slot = 0; slot < XNA_OWNERSHIP_SLOTS; slot++)
+    {
+        if (Reference->Owned[slot] && Reference->ExpirationTime[slot] != 0 && Reference->ExpirationTime[slot] <= Time)
+        {
+            Reference->Owned[slot] = FALSE;
+            slots |= 1UL << slot;
+        }
+    }
+
+    return slots;
+}
+
+static ULONGLONG ReferenceNextExpiration(
+    const OWNERSHIP_REFERENCE* Reference
+)
+{
+    ULONGLONG   next = ~0ULL;
+    ULONG       slot;
+
+    for (slot = 0; slot < XNA_OWNERSHIP_SLOTS; slot++)
+    {
+        if (Reference->Owned[slot] && Reference->ExpirationTime[slot] != 0)
+            next = min(next, Reference->ExpirationTime[slot]);
+    }
+
+    return (next == ~0ULL) ? 0 : next;
+}
+
+static VOID ExpectMatches(
+    const XNA_OWNERSHIP_TABLE* Table,
+    const OWNERSHIP_REFERENCE* Reference
+)
+{
+    ULONG slot;
+
+    for (slot = 0; slot < XNA_OWNERSHIP_SLOTS; slot++)
+    {
+        XNA_TEST_EXPECT(((Table->InUse >> slot) & 1) == Reference->Owned[slot]);
+
+        if (Reference->Owned[slot])
+        {
+            XNA_TEST_EXPECT(Table->Entries[slot].Owner == Reference->Owner[slot]);
+            XNA_TEST_EXPECT(Table->Entries[slot].ExpirationTime == Reference->ExpirationTime[slot]);
+        }
+    }
+
+    XNA_TEST_EXPECT(XNA_OWNERSHIP_TABLE_NEXT_EXPIRATION(Table) == ReferenceNextExpiration(Reference));
+}
+
+//
+// Claiming and dropping touches exactly the slot of its pad and layer
+//
+static VOID TestClaimDrop(
+    VOID
+)
+{
+    XNA_OWNERSHIP_TABLE table;
+    int                 owner;
+    UCHAR               index;
+    UCHAR               layer;
+    ULONG               slot;
+
+    XNA_OWNERSHIP_TABLE_INIT(&table);
+
+    for (index = 0; index < XINPUT_MAX_DEVICES; index++)
+    {
+        for (layer = 0; layer < XINPUT_OVERRIDE_LAYERS_MAX; layer++)
+        {
+            slot = XNA_OWNERSHIP_SLOT(index, layer);
+
+            XNA_OWNERSHIP_TABLE_CLAIM(&table, index, layer, &owner, 0);
+
+            XNA_TEST_EXPECT(table.InUse == 1UL << slot);
+            XNA_TEST_EXPECT(table.Entries[slot].Owner == &owner);
+            XNA_TEST_EXPECT(XNA_OWNERSHIP_PAD_LAYERS(table.InUse, index) == 1UL << layer);
+
+            //
+            // Claimed again by another owner with a lease
+            //
+            XNA_OWNERSHIP_TABLE_CLAIM(&table, index, layer, &table, 100);
+
+            XNA_TEST_EXPECT(table.InUse == 1UL << slot);
+            XNA_TEST_EXPECT(table.Entries[slot].Owner == &table);
+            XNA_TEST_EXPECT(XNA_OWNERSHIP_TABLE_NEXT_EXPIRATION(&table) == 100);
+
+            XNA_OWNERSHIP_TABLE_DROP(&table, index, layer);
+
+            XNA_TEST_EXPECT(table.InUse == 0);
+            XNA_TEST_EXPECT(table.Entries[slot].Owner == NULL);
+            XNA_TEST_EXPECT(XNA_OWNERSHIP_TABLE_NEXT_EXPIRATION(&table) == 0);
+        }
+    }
+
+    //
+    // Dropping a free slot is harmless
+    //
+    XNA_OWNERSHIP_TABLE_DROP(&table, 0, 0);
+    XNA_TEST_EXPECT(table.InUse == 0);
+}
+
+//
+// Closing a handle removes its layers only
+//
+static VOID TestRelease(
+    VOID
+)
+{
+    XNA_OWNERSHIP_TABLE table;
+    int                 owners[3];
+    ULONG               slots;
+    UCHAR               index;
+    UCHAR               layer;
+
+    XNA_OWNERSHIP_TABLE_INIT(&table);
+
+    //
+    // Owners alternate over the layers of every pad
+    //
+    for (index = 0; index < XINPUT_MAX_DEVICES; index++)
+    {
+        for (layer = 0; layer < XINPUT_OVERRIDE_LAYERS_MAX; layer++)
+            XNA_OWNERSHIP_TABLE_CLAIM(&table, index, layer, &owners[(index + layer) % 3], 0);
+    }
+
+    slots = XNA_OWNERSHIP_TABLE_RELEASE(&table, &owners[1]);
+
+    for (index = 0; index < XINPUT_MAX_DEVICES; index++)
+    {
+        for (layer = 0; layer < XINPUT_OVERRIDE_LAYERS_MAX; layer++)
+        {
+            if ((index + layer) % 3 == 1)
+            {
+                XNA_TEST_EXPECT(slots & (1UL << XNA_OWNERSHIP_SLOT(index, layer)));
+                XNA_TEST_EXPECT(!(table.InUse & (1UL << XNA_OWNERSHIP_SLOT(index, layer))));
+            }
+            else
+            {
+                XNA_TEST_EXPECT(!(slots & (1UL << XNA_OWNERSHIP_SLOT(index, layer))));
+                XNA_TEST_EXPECT(table.Entries[XNA_OWNERSHIP_SLOT(index, layer)].Owner == &owners[(index + layer) % 3]);
+            }
+        }
+    }
+
+    XNA_TEST_EXPECT((slots | table.InUse) == (ULONG)-1 >> (sizeof(ULONG) * 8 - XNA_OWNERSHIP_SLOTS));
+
+    //
+    // Nothing left of that owner, an unknown owner owns nothing
+    //
+    XNA_TEST_EXPECT(XNA_OWNERSHIP_TABLE_RELEASE(&table, &owners[1]) == 0);
+    XNA_TEST_EXPECT(XNA_OWNERSHIP_TABLE_RELEASE(&table, &table) == 0);
+    XNA_TEST_EXPECT(XNA_OWNERSHIP_TABLE_RELEASE(&table, NULL) == 0);
+
+    //
+    // A layer taken over by another handle stays when the first one closes
+    //
+    XNA_OWNERSHIP_TABLE_CLAIM(&table, 2, 3, &owners[1], 0);
+    XNA_OWNERSHIP_TABLE_CLAIM(&table, 2, 3, &owners[2], 0);
+    XNA_TEST_EXPECT(XNA_OWNERSHIP_TABLE_RELEASE(&table, &owners[1]) == 0);
+    XNA_TEST_EXPECT(table.Entries[XNA_OWNERSHIP_SLOT(2, 3)].Owner == &owners[2]);
+
+    XNA_OWNERSHIP_TABLE_RELEASE(&table, &owners[0]);
+    XNA_OWNERSHIP_TABLE_RELEASE(&table, &owners[2]);
+    XNA_TEST_EXPECT(table.InUse == 0);
+}
+
+//
+// Leases end at their expiration time, not a tick earlier
+//
+static VOID TestExpire(
+    VOID
+)
+{
+    XNA_OWNERSHIP_TABLE table;
+    int                 owner;
+
+    XNA_OWNERSHIP_TABLE_INIT(&table);
+
+    XNA_OWNERSHIP_TABLE_CLAIM(&table, 0, 1, &owner, 1000);
+    XNA_OWNERSHIP_TABLE_CLAIM(&table, 1, 2, &owner, 1000);
+    XNA_OWNERSHIP_TABLE_CLAIM(&table, 2, 3, &owner, 2000);
+    XNA_OWNERSHIP_TABLE_CLAIM(&table, 3, 4, &owner, 0);
+
+    XNA_TEST_EXPECT(XNA_OWNERSHIP_TABLE_NEXT_EXPIRATION(&table) == 1000);
+
+    XNA_TEST_EXPECT(XNA_OWNERSHIP_TABLE_EXPIRE(&table, 0) == 0);
+    XNA_TEST_EXPECT(XNA_OWNERSHIP_TABLE_EXPIRE(&table, 999) == 0);
+    XNA_TEST_EXPECT(XNA_OWNERSHIP_TABLE_EXPIRE(&table, 1000)
+        == ((1UL << XNA_OWNERSHIP_SLOT(0, 1)) | (1UL << XNA_OWNERSHIP_SLOT(1, 2))));
+    XNA_TEST_EXPECT(XNA_OWNERSHIP_TABLE_EXPIRE(&table, 1000) == 0);
+
+    XNA_TEST_EXPECT(XNA_OWNERSHIP_TABLE_NEXT_EXPIRATION(&table) == 2000);
+
+    //
+    // Renewing the lease moves it, a late expiry catches up
+    //
+    XNA_OWNERSHIP_TABLE_CLAIM(&table, 2, 3, &owner, 3000);
+    XNA_TEST_EXPECT(XNA_OWNERSHIP_TABLE_EXPIRE(&table, 2999) == 0);
+    XNA_TEST_EXPECT(XNA_OWNERSHIP_TABLE_NEXT_EXPIRATION(&table) == 3000);
+    XNA_TEST_EXPECT(XNA_OWNERSHIP_TABLE_EXPIRE(&table, 5000) == 1UL << XNA_OWNERSHIP_SLOT(2, 3));
+
+    //
+    // Layers without lease never expire
+    //
+    XNA_TEST_EXPECT(XNA_OWNERSHIP_TABLE_NEXT_EXPIRATION(&table) == 0);
+    XNA_TEST_EXPECT(XNA_OWNERSHIP_TABLE_EXPIRE(&table, ~0ULL) == 0);
+    XNA_TEST_EXPECT(table.InUse == 1UL << XNA_OWNERSHIP_SLOT(3, 4));
+
+    //
+    // Dropping the only lease clears the next expiration
+    //
+    XNA_OWNERSHIP_TABLE_CLAIM(&table, 3, 5, &owner, 10);
+    XNA_TEST_EXPECT(XNA_OWNERSHIP_TABLE_NEXT_EXPIRATION(&table) == 10);
+    XNA_OWNERSHIP_TABLE_DROP(&table, 3, 5);
+    XNA_TEST_EXPECT(XNA_OWNERSHIP_TABLE_NEXT_EXPIRATION(&table) == 0);
+}
+
+//
+// Random claims, drops, handle closes and time steps of several owners
+//
+static VOID TestChurn(
+    VOID
+)
+{
+    XNA_OWNERSHIP_TABLE table;
+    OWNERSHIP_REFERENCE reference;
+    int                 owners[OWNERSHIP_TEST_OWNERS];
+    ULONGLONG           time = 1;
+    ULONGLONG           lease;
+    ULONG               iteration;
+    ULONG               slot;
+    PVOID               owner;
+
+    XNA_OWNERSHIP_TABLE_INIT(&table);
+    RtlZeroMemory(&reference, sizeof(reference));
+
+    for (iteration = 0; iteration < 1000000; iteration++)
+    {
+        slot = XnaTestRandom() % XNA_OWNERSHIP_SLOTS;
+        owner = &owners[XnaTestRandom() % OWNERSHIP_TEST_OWNERS];
+
+        switch (XnaTestRandom() % 8)
+        {
+        case 0:
+        case 1:
+        case 2:
+            //
+            // Half of the claims carry a lease of up to 64 ticks
+            //
+            lease = (XnaTestRandom() & 1) ? time + 1 + XnaTestRandom() % 64 : 0;
+
+            XNA_OWNERSHIP_TABLE_CLAIM(&table, (UCHAR)(slot / XINPUT_OVERRIDE_LAYERS_MAX),
+                (UCHAR)(slot % XINPUT_OVERRIDE_LAYERS_MAX), owner, lease);
+
+            reference.Owned[slot] = TRUE;
+            reference.Owner[slot] = owner;
+            reference.ExpirationTime[slot] = lease;
+            break;
+        case 3:
+            XNA_OWNERSHIP_TABLE_DROP(&table, (UCHAR)(slot / XINPUT_OVERRIDE_LAYERS_MAX),
+                (UCHAR)(slot % XINPUT_OVERRIDE_LAYERS_MAX));
+
+            reference.Owned[slot] = FALSE;
+            break;
+        case 4:
+            XNA_TEST_EXPECT(XNA_OWNERSHIP_TABLE_RELEASE(&table, owner) == ReferenceRelease(&reference, owner));
+            break;
+        default:
+            //
+            // Either step a tick or jump to the next expiration like the
+            // lease timer does
+            //
+            if ((XnaTestRandom() & 3) == 0 && XNA_OWNERSHIP_TABLE_NEXT_EXPIRATION(&table) > time)
+                time = XNA_OWNERSHIP_TABLE_NEXT_EXPIRATION(&table);
+            else
+                time++;
+
+            XNA_TEST_EXPECT(XNA_OWNERSHIP_TABLE_EXPIRE(&table, time) == ReferenceExpire(&reference, time));
+            break;
+        }
+
+        ExpectMatches(&table, &reference);
+    }
+}
+
+int main(
+    VOID
+)
+{
+    TestClaimDrop();
+    TestRelease();
+    TestExpire();
+    TestChurn();
+
+    return XNA_TEST_RESULT();
+}
@@ -0,0 +1,339 @@
+/*
+MIT License
+
+Copyright (c) 2017 Benjamin "Nefarius" Hglinger
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#include "XnaTest.h"
+#include "ViGEmPadStore.h"
+
+#define PAD_STORE_TEST_PADS     10000
+
+static XUSB_REPORT  PadStoreTestReports[PAD_STORE_TEST_PADS];
+static XUSB_REPORT  PadStoreTestSaved[PAD_STORE_TEST_PADS];
+static DS4_REPORT   PadStoreTestDs4[PAD_STORE_TEST_PADS];
+static DS4_REPORT   PadStoreTestDs4Expected[PAD_STORE_TEST_PADS];
+static UCHAR        PadStoreTestChanged[PAD_STORE_TEST_PADS];
+
+//
+// Store over a heap buffer, misaligned on purpose
+//
+static PVOID PadStoreTestCreate(
+    PVIGEM_PAD_STATE_STORE Store,
+    size_t Count
+)
+{
+    PUCHAR buffer = (PUCHAR)malloc(VIGEM_PAD_STATE_STORE_SIZE(Count) + 1);
+
+    XNA_TEST_EXPECT(VIGEM_PAD_STATE_STORE_INIT(Store, buffer + 1, VIGEM_PAD_STATE_STORE_SIZE(Count), Count));
+
+    return buffer;
+}
+
+static VOID TestInit(
+    VOID
+)
+{
+    VIGEM_PAD_STATE_STORE   store;
+    PUCHAR                  buffer;
+    PUCHAR                  end;
+    size_t                  count;
+    size_t                  offset;
+
+    for (count = 1; count < 200; count += 7)
+    {
+        buffer = (PUCHAR)malloc(VIGEM_PAD_STATE_STORE_SIZE(count) + VIGEM_PAD_STATE_STORE_ALIGNMENT);
+
+        XNA_TEST_EXPECT(!VIGEM_PAD_STATE_STORE_INIT(&store, buffer, VIGEM_PAD_STATE_STORE_SIZE(count) - 1, count));
+        XNA_TEST_EXPECT(store.Count == 0 && store.Buttons == NULL);
+
+        //
+        // Any buffer alignment, every column aligned and inside the buffer
+        //
+        for (offset = 0; offset < VIGEM_PAD_STATE_STORE_ALIGNMENT; offset += 3)
+        {
+            XNA_TEST_EXPECT(VIGEM_PAD_STATE_STORE_INIT(&store, buffer + offset, VIGEM_PAD_STATE_STORE_SIZE(count), count));
+
+            end = buffer + offset + VIGEM_PAD_STATE_STORE_SIZE(count);
+
+            XNA_TEST_EXPECT(store.Count == count);
+            XNA_TEST_EXPECT(((ULONG_PTR)store.Buttons % VIGEM_PAD_STATE_STORE_ALIGNMENT) == 0);
+            XNA_TEST_EXPECT(((ULONG_PTR)store.LeftTrigger % VIGEM_PAD_STATE_STORE_ALIGNMENT) == 0);
+            XNA_TEST_EXPECT(((ULONG_PTR)store.RightTrigger % VIGEM_PAD_STATE_STORE_ALIGNMENT) == 0);
+            XNA_TEST_EXPECT(((ULONG_PTR)store.ThumbLX % VIGEM_PAD_STATE_STORE_ALIGNMENT) == 0);
+            XNA_TEST_EXPECT(((ULONG_PTR)store.ThumbLY % VIGEM_PAD_STATE_STORE_ALIGNMENT) == 0);
+            XNA_TEST_EXPECT(((ULONG_PTR)store.ThumbRX % VIGEM_PAD_STATE_STORE_ALIGNMENT) == 0);
+            XNA_TEST_EXPECT(((ULONG_PTR)store.ThumbRY % VIGEM_PAD_STATE_STORE_ALIGNMENT) == 0);
+            XNA_TEST_EXPECT((PUCHAR)store.Buttons >= buffer + offset);
+            XNA_TEST_EXPECT((PUCHAR)(store.ThumbRY + count) <= end);
+        }
+
+        free(buffer);
+    }
+}
+
+//
+// Gather/scatter against the XUSB_REPORT and DS4_REPORT structures of
+// ViGEmCommon.h, also at offsets into the store
+//
+static VOID TestRoundTrip(
+    VOID
+)
+{
+    VIGEM_PAD_STATE_STORE   store;
+    PVOID                   buffer;
+    XUSB_REPORT             report;
+    size_t                  index;
+    size_t                  first;
+
+    buffer = PadStoreTestCreate(&store, PAD_STORE_TEST_PADS);
+
+    XnaTestRandomFill(PadStoreTestReports, sizeof(PadStoreTestReports));
+
+    VIGEM_PAD_STATE_STORE_LOAD_XUSB(&store, 0, PadStoreTestReports, PAD_STORE_TEST_PADS);
+    VIGEM_PAD_STATE_STORE_SAVE_XUSB(&store, 0, PadStoreTestSaved, PAD_STORE_TEST_PADS);
+    XNA_TEST_EXPECT(memcmp(PadStoreTestSaved, PadStoreTestReports, sizeof(PadStoreTestSaved)) == 0);
+
+    //
+    // Columns hold the fields of the according pad
+    //
+    for (index = 0; index < PAD_STORE_TEST_PADS; index += 997)
+    {
+        XNA_TEST_EXPECT(store.Buttons[index] == PadStoreTestReports[index].wButtons);
+        XNA_TEST_EXPECT(store.RightTrigger[index] == PadStoreTestReports[index].bRightTrigger);
+        XNA_TEST_EXPECT(store.ThumbRY[index] == PadStoreTestReports[index].sThumbRY);
+    }
+
+    //
+    // Partial ranges only touch their pads
+    //
+    first = 1234;
+    XnaTestRandomFill(&report, sizeof(report));
+    VIGEM_PAD_STATE_STORE_LOAD_XUSB(&store, first, &report, 1);
+    VIGEM_PAD_STATE_STORE_SAVE_XUSB(&store, first - 1, PadStoreTestSaved, 3);
+    XNA_TEST_EXPECT(memcmp(&PadStoreTestSaved[0], &PadStoreTestReports[first - 1], sizeof(XUSB_REPORT)) == 0);
+    XNA_TEST_EXPECT(memcmp(&PadStoreTestSaved[1], &report, sizeof(XUSB_REPORT)) == 0);
+    XNA_TEST_EXPECT(memcmp(&PadStoreTestSaved[2], &PadStoreTestReports[first + 1], sizeof(XUSB_REPORT)) == 0);
+    PadStoreTestReports[first] = report;
+
+    //
+    // DualShock 4 reports match the single report translation
+    //
+    for (index = 0; index < PAD_STORE_TEST_PADS; index++)
+    {
+        DS4_REPORT_INIT(&PadStoreTestDs4[index]);
+        DS4_REPORT_INIT(&PadStoreTestDs4Expected[index]);
+        XUSB_TO_DS4_REPORT(&PadStoreTestReports[index], &PadStoreTestDs4Expected[index]);
+    }
+
+    VIGEM_PAD_STATE_STORE_SAVE_DS4(&store, 0, PadStoreTestDs4, PAD_STORE_TEST_PADS);
+    XNA_TEST_EXPECT(memcmp(PadStoreTestDs4, PadStoreTestDs4Expected, sizeof(PadStoreTestDs4)) == 0);
+
+    VIGEM_PAD_STATE_STORE_LOAD_DS4(&store, 0, PadStoreTestDs4, PAD_STORE_TEST_PADS);
+    VIGEM_PAD_STATE_STORE_SAVE_XUSB(&store, 0, PadStoreTestSaved, PAD_STORE_TEST_PADS);
+
+    for (index = 0; index < PAD_STORE_TEST_PADS; index++)
+    {
+        DS4_TO_XUSB_REPORT(&PadStoreTestDs4[index], &report);
+        XNA_TEST_EXPECT(memcmp(&PadStoreTestSaved[index], &report, sizeof(report)) == 0);
+    }
+
+    free(buffer);
+}
+
+static VOID TestKernels(
+    VOID
+)
+{
+    VIGEM_PAD_STATE_STORE   store;
+    VIGEM_PAD_STATE_STORE   source;
+    VIGEM_PAD_STATE_STORE   previous;
+    PVOID                   buffers[3];
+    VIGEM_STICK_PROFILE     profile;
+    static VIGEM_STICK_LUT  radial;
+    static VIGEM_STICK_LUT  axial;
+    XUSB_REPORT             expected;
+    ULONG                   overrides;
+    size_t                  index;
+    size_t                  changes;
+    USHORT                  mask;
+
+    buffers[0] = PadStoreTestCreate(&store, PAD_STORE_TEST_PADS);
+    buffers[1] = PadStoreTestCreate(&source, PAD_STORE_TEST_PADS);
+    buffers[2] = PadStoreTestCreate(&previous, PAD_STORE_TEST_PADS);
+
+    XnaTestRandomFill(PadStoreTestReports, sizeof(PadStoreTestReports));
+    XnaTestRandomFill(PadStoreTestSaved, sizeof(PadStoreTestSaved));
+
+    //
+    // Stick tables match the XUSB_REPORT batch
+    //
+    VIGEM_STICK_PROFILE_INIT(&profile, VIGEM_STICK_DEADZONE_RADIAL, 7849, 30000);
+    VIGEM_STICK_LUT_INIT(&radial, &profile);
+    VIGEM_STICK_PROFILE_INIT(&profile, VIGEM_STICK_DEADZONE_AXIAL, 2000, 32000);
+    VIGEM_STICK_LUT_INIT(&axial, &profile);
+
+    VIGEM_PAD_STATE_STORE_LOAD_XUSB(&store, 0, PadStoreTestReports, PAD_STORE_TEST_PADS);
+    VIGEM_PAD_STATE_STORE_APPLY_STICK_LUT(&store, &radial, &axial);
+    XUSB_REPORT_APPLY_STICK_LUT_BATCH(&radial, &axial, PadStoreTestReports, PAD_STORE_TEST_PADS);
+
+    for (index = 0; index < PAD_STORE_TEST_PADS; index++)
+    {
+        VIGEM_PAD_STATE_STORE_SAVE_XUSB(&store, index, &expected, 1);
+        XNA_TEST_EXPECT(memcmp(&expected, &PadStoreTestReports[index], sizeof(expected)) == 0);
+    }
+
+    //
+    // Merges match the per-field reference
+    //
+    XnaTestRandomFill(PadStoreTestSaved, sizeof(PadStoreTestSaved));
+    VIGEM_PAD_STATE_STORE_LOAD_XUSB(&source, 0, PadStoreTestSaved, PAD_STORE_TEST_PADS);
+
+    overrides = XnaTestRandom();
+    mask = (USHORT)(overrides & 0xFFFF);
+
+    VIGEM_PAD_STATE_STORE_MERGE(&store, &source, overrides);
+
+    for (index = 0; index < PAD_STORE_TEST_PADS; index++)
+    {
+        VIGEM_PAD_STATE_STORE_SAVE_XUSB(&store, index, &expected, 1);
+
+        XNA_TEST_EXPECT(expected.wButtons == (USHORT)((PadStoreTestReports[index].wButtons & ~mask) | (PadStoreTestSaved[index].wButtons & mask)));
+        XNA_TEST_EXPECT(expected.bLeftTrigger == ((overrides & XINPUT_GAMEPAD_OVERRIDE_LEFT_TRIGGER) ? PadStoreTestSaved : PadStoreTestReports)[index].bLeftTrigger);
+        XNA_TEST_EXPECT(expected.bRightTrigger == ((overrides & XINPUT_GAMEPAD_OVERRIDE_RIGHT_TRIGGER) ? PadStoreTestSaved : PadStoreTestReports)[index].bRightTrigger);
+        XNA_TEST_EXPECT(expected.sThumbLX == ((overrides & XINPUT_GAMEPAD_OVERRIDE_LEFT_THUMB_X) ? PadStoreTestSaved : PadStoreTestReports)[index].sThumbLX);
+        XNA_TEST_EXPECT(expected.sThumbLY == ((overrides & XINPUT_GAMEPAD_OVERRIDE_LEFT_THUMB_Y) ? PadStoreTestSaved : PadStoreTestReports)[index].sThumbLY);
+        XNA_TEST_EXPECT(expected.sThumbRX == ((overrides & XINPUT_GAMEPAD_OVERRIDE_RIGHT_THUMB_X) ? PadStoreTestSaved : PadStoreTestReports)[index].sThumbRX);
+        XNA_TEST_EXPECT(expected.sThumbRY == ((overrides & XINPUT_GAMEPAD_OVERRIDE_RIGHT_THUMB_Y) ? PadStoreTestSaved : PadStoreTestReports)[index].sThumbRY);
+    }
+
+    //
+    // A diff after a copy only reports the pads changed since
+    //
+    VIGEM_PAD_STATE_STORE_COPY(&previous, &store);
+    XNA_TEST_EXPECT(VIGEM_PAD_STATE_STORE_DIFF(&store, &previous, PadStoreTestChanged) == 0);
+
+    store.ThumbRY[77]++;
+    store.RightTrigger[4321] ^= 0x80;
+    store.Buttons[PAD_STORE_TEST_PADS - 1] ^= XINPUT_GAMEPAD_OVERRIDE_A;
+
+    changes = VIGEM_PAD_STATE_STORE_DIFF(&store, &previous, PadStoreTestChanged);
+    XNA_TEST_EXPECT(changes == 3);
+    XNA_TEST_EXPECT(PadStoreTestChanged[77] && PadStoreTestChanged[4321] && PadStoreTestChanged[PAD_STORE_TEST_PADS - 1]);
+    XNA_TEST_EXPECT(!PadStoreTestChanged[0] && !PadStoreTestChanged[78]);
+
+    free(buffers[0]);
+    free(buffers[1]);
+    free(buffers[2]);
+}
+
+//
+// One second of 10k pads polled at 1 kHz: load, dead zones, overrides,
+// diff and DualShock 4 translation on the store, compared to the dead
+// zones and translation on XUSB_REPORT arrays
+//
+static VOID Bench(
+    VOID
+)
+{
+    const ULONG             ticks = 1000;
+    VIGEM_PAD_STATE_STORE   store;
+    VIGEM_PAD_STATE_STORE   overrides;
+    VIGEM_PAD_STATE_STORE   previous;
+    PVOID                   buffers[3];
+    VIGEM_STICK_PROFILE     profile;
+    static VIGEM_STICK_LUT  lut;
+    ULONG                   tick;
+    size_t                  changes = 0;
+    double                  start;
+    double                  elapsed;
+
+    buffers[0] = PadStoreTestCreate(&store, PAD_STORE_TEST_PADS);
+    buffers[1] = PadStoreTestCreate(&overrides, PAD_STORE_TEST_PADS);
+    buffers[2] = PadStoreTestCreate(&previous, PAD_STORE_TEST_PADS);
+
+    VIGEM_STICK_PROFILE_INIT(&profile, VIGEM_STICK_DEADZONE_RADIAL, 7849, 30000);
+    VIGEM_STICK_LUT_INIT(&lut, &profile);
+
+    XnaTestRandomFill(PadStoreTestReports, sizeof(PadStoreTestReports));
+    VIGEM_PAD_STATE_STORE_LOAD_XUSB(&overrides, 0, PadStoreTestReports, PAD_STORE_TEST_PADS);
+
+    for (tick = 0; tick < PAD_STORE_TEST_PADS; tick++)
+        DS4_REPORT_INIT(&PadStoreTestDs4[tick]);
+
+    start = XnaTestNow();
+
+    for (tick = 0; tick < ticks; tick++)
+    {
+        PadStoreTestReports[tick % PAD_STORE_TEST_PADS].sThumbLX++;
+
+        VIGEM_PAD_STATE_STORE_LOAD_XUSB(&store, 0, PadStoreTestReports, PAD_STORE_TEST_PADS);
+        VIGEM_PAD_STATE_STORE_APPLY_STICK_LUT(&store, &lut, &lut);
+        VIGEM_PAD_STATE_STORE_MERGE(&store, &overrides, XINPUT_GAMEPAD_OVERRIDE_A | XINPUT_GAMEPAD_OVERRIDE_RIGHT_TRIGGER);
+        changes += VIGEM_PAD_STATE_STORE_DIFF(&store, &previous, PadStoreTestChanged);
+        VIGEM_PAD_STATE_STORE_COPY(&previous, &store);
+        VIGEM_PAD_STATE_STORE_SAVE_DS4(&store, 0, PadStoreTestDs4, PAD_STORE_TEST_PADS);
+
+        XNA_TEST_CONSUME(PadStoreTestDs4, sizeof(PadStoreTestDs4));
+    }
+
+    elapsed = XnaTestNow() - start;
+
+    XnaTestReport("Pad store tick (10k pads)", (double)ticks * PAD_STORE_TEST_PADS, elapsed);
+
+    //
+    // A tick has to finish within the 1 ms polling period
+    //
+    printf("%.3f ms per tick, %lu pad changes\n", elapsed * 1000.0 / ticks, (unsigned long)changes);
+
+    start = XnaTestNow();
+
+    for (tick = 0; tick < ticks; tick++)
+    {
+        memcpy(PadStoreTestSaved, PadStoreTestReports, sizeof(PadStoreTestSaved));
+        XUSB_REPORT_APPLY_STICK_LUT_BATCH(&lut, &lut, PadStoreTestSaved, PAD_STORE_TEST_PADS);
+        XUSB_TO_DS4_REPORT_BATCH(PadStoreTestSaved, PadStoreTestDs4, PAD_STORE_TEST_PADS);
+
+        XNA_TEST_CONSUME(PadStoreTestDs4, sizeof(PadStoreTestDs4));
+    }
+
+    XnaTestReport("XUSB_REPORT array tick (10k pads)", (double)ticks * PAD_STORE_TEST_PADS, XnaTestNow() - start);
+
+    free(buffers[0]);
+    free(buffers[1]);
+    free(buffers[2]);
+}
+
+int main(
+    int argc,
+    char** argv
+)
+{
+    TestInit();
+    TestRoundTrip();
+    TestKernels();
+
+    if (XnaTestBenchEnabled(argc, argv))
+        Bench();
+
+    return XNA_TEST_RESULT();
+}
@@ -0,0 +1,300 @@
+/*
+MIT License
+
+Copyright (c) 2017 Benjamin "Nefarius" Hglinger
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+
+
+#include "XnaTest.h"
+#include "XnaGuardianPeekCache.h"
+
+#define PEEK_CACHE_TEST_WAITERS     3
+#define PEEK_CACHE_TEST_UPDATES     200000
+
+//
+// Stands in for a pended WDF request, the lock for PeekPadCacheLock
+//
+typedef struct _PEEK_CACHE_TEST_WAITER
+{
+    volatile LONG   Pending;
+    ULONG           Sequence;
+    ULONG           Completed;
+    ULONG           Immediate;
+    ULONG           Stale;
+
+} PEEK_CACHE_TEST_WAITER, *PPEEK_CACHE_TEST_WAITER;
+
+static XNA_PEEK_CACHE_ENTRY   PeekCacheTestEntry;
+static PEEK_CACHE_TEST_WAITER PeekCacheTestWaiters[PEEK_CACHE_TEST_WAITERS];
+static volatile LONG          PeekCacheTestLock;
+static volatile LONG          PeekCacheTestDone;
+static ULONG                  PeekCacheTestLost;
+
+static VOID PeekCacheTestAcquire(
+    VOID
+)
+{
+    while (InterlockedCompareExchange(&PeekCacheTestLock, 1, 0) != 0)
+        XnaTestThreadYield();
+}
+
+static VOID PeekCacheTestRelease(
+    VOID
+)
+{
+    InterlockedExchange(&PeekCacheTestLock, 0);
+}
+
+static VOID TestUnchanged(
+    VOID
+)
+{
+    XNA_PEEK_CACHE_ENTRY entry;
+    XINPUT_GAMEPAD_STATE state;
+    XINPUT_GAMEPAD_STATE read;
+    ULONG                sequence;
+
+    RtlZeroMemory(&entry, sizeof(entry));
+    RtlZeroMemory(&state, sizeof(state));
+
+    sequence = XNA_PEEK_CACHE_GET(&entry, &read);
+    XNA_TEST_EXPECT(sequence == 0);
+    XNA_TEST_EXPECT(XNA_PEEK_CACHE_IS_CURRENT(&entry, sequence));
+
+    //
+    // Repeating the cached state, the idle pad reporting at its full rate,
+    // neither bumps the version nor wakes a waiter
+    //
+    XNA_TEST_EXPECT(!XNA_PEEK_CACHE_UPDATE(&entry, &state));
+    XNA_TEST_EXPECT(XNA_PEEK_CACHE_GET(&entry, &read) == sequence);
+    XNA_TEST_EXPECT(XNA_PEEK_CACHE_IS_CURRENT(&entry, sequence));
+
+    state.wButtons = 0x1000;
+    state.sThumbLX = -1;
+
+    XNA_TEST_EXPECT(XNA_PEEK_CACHE_UPDATE(&entry, &state));
+    XNA_TEST_EXPECT(XNA_PEEK_CACHE_GET(&entry, &read) == sequence + 2);
+    XNA_TEST_EXPECT(RtlEqualMemory(&read, &state, sizeof(read)));
+
+    sequence += 2;
+
+    XNA_TEST_EXPECT(!XNA_PEEK_CACHE_UPDATE(&entry, &state));
+    XNA_TEST_EXPECT(XNA_PEEK_CACHE_GET(&entry, &read) == sequence);
+    XNA_TEST_EXPECT(XNA_PEEK_CACHE_IS_CURRENT(&entry, sequence));
+}
+
+static VOID TestStale(
+    VOID
+)
+{
+    XNA_PEEK_CACHE_ENTRY entry;
+    XINPUT_GAMEPAD_STATE state;
+    XINPUT_GAMEPAD_STATE read;
+    ULONG                seen;
+
+    RtlZeroMemory(&entry, sizeof(entry));
+    RtlZeroMemory(&state, sizeof(state));
+
+    seen = XNA_PEEK_CACHE_GET(&entry, &read);
+
+    //
+    // An update between the read and the wait must not leave the waiter
+    // pending on a version nobody is going to replace
+    //
+    state.bRightTrigger = 0xFF;
+    XNA_TEST_EXPECT(XNA_PEEK_CACHE_UPDATE(&entry, &state));
+
+    XNA_TEST_EXPECT(!XNA_PEEK_CACHE_IS_CURRENT(&entry, seen));
+    XNA_TEST_EXPECT(XNA_PEEK_CACHE_IS_CURRENT(&entry, XNA_PEEK_CACHE_GET(&entry, &read)));
+
+    //
+    // Versions the cache never handed out don't pend either
+    //
+    XNA_TEST_EXPECT(!XNA_PEEK_CACHE_IS_CURRENT(&entry, seen + 1));
+    XNA_TEST_EXPECT(!XNA_PEEK_CACHE_IS_CURRENT(&entry, (ULONG)-1));
+}
+
+static VOID PeekCacheTestUpdater(
+    PVOID Context
+)
+{
+    XINPUT_GAMEPAD_STATE state;
+    ULONG                update;
+    ULONG                index;
+
+    UNREFERENCED_PARAMETER(Context);
+
+    RtlZeroMemory(&state, sizeof(state));
+
+    for (update = 1; update <= PEEK_CACHE_TEST_UPDATES; update++)
+    {
+        //
+        // Every other report repeats the previous one
+        //
+        if (update & 1)
+            state.sThumbRY = (SHORT)((update + 1) >> 1);
+
+        PeekCacheTestAcquire();
+
+        //
+        // A pended waiter always holds the current version, else an update
+        // got past it without completing it
+        //
+        for (index = 0; index < PEEK_CACHE_TEST_WAITERS; index++)
+        {
+            if (PeekCacheTestWaiters[index].Pending
+                && !XNA_PEEK_CACHE_IS_CURRENT(&PeekCacheTestEntry, PeekCacheTestWaiters[index].Sequence))
+                PeekCacheTestLost++;
+        }
+
+        if (XNA_PEEK_CACHE_UPDATE(&PeekCacheTestEntry, &state))
+        {
+            for (index = 0; index < PEEK_CACHE_TEST_WAITERS; index++)
+            {
+                if (PeekCacheTestWaiters[index].Pending)
+                    InterlockedExchange(&PeekCacheTestWaiters[index].Pending, FALSE);
+            }
+        }
+
+        PeekCacheTestRelease();
+
+        if ((update & 0x3F) == 0)
+            XnaTestThreadYield();
+    }
+
+    InterlockedExchange(&PeekCacheTestDone, TRUE);
+}
+
+static VOID PeekCacheTestWaiter(
+    PVOID Context
+)
+{
+    PPEEK_CACHE_TEST_WAITER waiter = (PPEEK_CACHE_TEST_WAITER)Context;
+    XINPUT_GAMEPAD_STATE    read;
+    ULONG                   seen;
+    ULONG                   sequence;
+
+    seen = XNA_PEEK_CACHE_GET(&PeekCacheTestEntry, &read);
+
+    while (!PeekCacheTestDone)
+    {
+        //
+        // Give the updater a chance to get between the read and the wait
+        //
+        if (waiter->Completed & 1)
+            XnaTestThreadYield();
+
+        //
+        // Same decision as PeekPadCacheWait
+        //
+        PeekCacheTestAcquire();
+
+        if (XNA_PEEK_CACHE_IS_CURRENT(&PeekCacheTestEntry, seen))
+        {
+            waiter->Sequence = seen;
+            InterlockedExchange(&waiter->Pending, TRUE);
+        }
+        else
+        {
+            waiter->Immediate++;
+        }
+
+        PeekCacheTestRelease();
+
+        while (waiter->Pending && !PeekCacheTestDone)
+            XnaTestThreadYield();
+
+        if (waiter->Pending)
+            break;
+
+        //
+        // Completed, the caller reads the new state and its version
+        //
+        sequence = XNA_PEEK_CACHE_GET(&PeekCacheTestEntry, &read);
+
+        if (sequence <= seen)
+            waiter->Stale++;
+
+        waiter->Completed++;
+        seen = sequence;
+    }
+}
+
+static VOID TestConcurrent(
+    VOID
+)
+{
+    XNA_TEST_THREAD updater;
+    XNA_TEST_THREAD waiters[PEEK_CACHE_TEST_WAITERS];
+    ULONG           index;
+
+    RtlZeroMemory(&PeekCacheTestEntry, sizeof(PeekCacheTestEntry));
+    RtlZeroMemory(PeekCacheTestWaiters, sizeof(PeekCacheTestWaiters));
+    PeekCacheTestLock = 0;
+    PeekCacheTestDone = FALSE;
+    PeekCacheTestLost = 0;
+
+    for (index = 0; index < PEEK_CACHE_TEST_WAITERS; index++)
+        XnaTestThreadStart(&waiters[index], PeekCacheTestWaiter, &PeekCacheTestWaiters[index]);
+
+    XnaTestThreadStart(&updater, PeekCacheTestUpdater, NULL);
+
+    XnaTestThreadJoin(&updater);
+
+    for (index = 0; index < PEEK_CACHE_TEST_WAITERS; index++)
+        XnaTestThreadJoin(&waiters[index]);
+
+    for (index = 0; index < PEEK_CACHE_TEST_WAITERS; index++)
+    {
+        printf("waiter %lu: %lu completed, %lu immediate\n", (unsigned long)index,
+            (unsigned long)PeekCacheTestWaiters[index].Completed,
+            (unsigned long)PeekCacheTestWaiters[index].Immediate);
+
+        XNA_TEST_EXPECT(PeekCacheTestWaiters[index].Completed > 0);
+        XNA_TEST_EXPECT(PeekCacheTestWaiters[index].Stale == 0);
+
+        //
+        // Whoever is still pended waits for the last version
+        //
+        if (PeekCacheTestWaiters[index].Pending)
+            XNA_TEST_EXPECT(XNA_PEEK_CACHE_IS_CURRENT(&PeekCacheTestEntry, PeekCacheTestWaiters[index].Sequence));
+    }
+
+    XNA_TEST_EXPECT(PeekCacheTestLost == 0);
+
+    //
+    // Only the changing half of the updates bumped the version
+    //
+    XNA_TEST_EXPECT(PeekCacheTestEntry.Sequence.Sequence == PEEK_CACHE_TEST_UPDATES);
+}
+
+int main(
+    VOID
+)
+{
+    TestUnchanged();
+    TestStale();
+    TestConcurrent();
+
+    return XNA_TEST_RESULT();
+}
@@ -0,0 +1,253 @@
+/*
+MIT License
+
+Copyright (c) 2017 Benjamin "Nefarius" Hglinger
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#include "XnaTest.h"
+#include "XnaGuardianReader.h"
+#include <math.h>
+
+#define READER_TEST_POLLS   200000
+
+typedef struct _READER_SIM_RESULT
+{
+    //
+    // Polls NAKed for lack of a pending read, their report is delayed
+    //
+    double NakedPercent;
+
+    //
+    // Delay from a poll to the completion carrying its report, in ms
+    //
+    double MeanLatency;
+    double MaxLatency;
+
+} READER_SIM_RESULT, *PREADER_SIM_RESULT;
+
+static double ReaderSimUniform(
+    VOID
+)
+{
+    return ((double)XnaTestRandom() + 0.5) / 4294967296.0;
+}
+
+//
+// Time from a completion until its read is pending again, in ms: mostly
+// short, sometimes a DPC latency spike
+//
+static double ReaderSimResubmitDelay(
+    VOID
+)
+{
+    double delay = -log(ReaderSimUniform()) * 0.15;
+
+    if (ReaderSimUniform() < 0.02)
+        delay += 1.0 + 3.0 * ReaderSimUniform();
+
+    return delay;
+}
+
+//
+// The device is polled every PollInterval ms. A poll completes the pending
+// read that became ready first, or is NAKed if none is pending, in which
+// case the report goes out with the next serviced poll.
+//
+static VOID ReaderSimulate(
+    ULONG PendingReads,
+    double PollInterval,
+    PREADER_SIM_RESULT Result
+)
+{
+    double  ready[XNA_READER_PENDING_READS_MAX];
+    double  time;
+    double  waitingSince = 0.0;
+    double  waitingSum = 0.0;
+    double  latencySum = 0.0;
+    double  maxLatency = 0.0;
+    ULONG   waiting = 0;
+    ULONG   naked = 0;
+    ULONG   poll;
+    ULONG   index;
+    ULONG   first;
+
+    for (index = 0; index < PendingReads; index++)
+        ready[index] = 0.0;
+
+    for (poll = 1; poll <= READER_TEST_POLLS; poll++)
+    {
+        time = poll * PollInterval;
+
+        for (index = 1, first = 0; index < PendingReads; index++)
+        {
+            if (ready[index] < ready[first])
+                first = index;
+        }
+
+        if (ready[first] > time)
+        {
+            if (waiting++ == 0)
+                waitingSince = time;
+
+            waitingSum += time;
+            naked++;
+            continue;
+        }
+
+        //
+        // This completion also carries the reports of the NAKed polls
+        //
+        if (waiting)
+        {
+            latencySum += waiting * time - waitingSum;
+            maxLatency = max(maxLatency, time - waitingSince);
+            waiting = 0;
+            waitingSum = 0.0;
+        }
+
+        ready[first] = time + ReaderSimResubmitDelay();
+    }
+
+    Result->NakedPercent = 100.0 * naked / READER_TEST_POLLS;
+    Result->MeanLatency = latencySum / READER_TEST_POLLS;
+    Result->MaxLatency = maxLatency;
+}
+
+static VOID TestParameters(
+    VOID
+)
+{
+    ULONG pendingReads;
+    ULONG transferLength;
+
+    //
+    // Every frame, slower and out of spec intervals
+    //
+    XNA_READER_PARAMETERS_FROM_ENDPOINT(FALSE, 1, 64, &pendingReads, &transferLength);
+    XNA_TEST_EXPECT(pendingReads == XNA_READER_PENDING_READS_FAST_POLLING && transferLength == 64);
+
+    XNA_READER_PARAMETERS_FROM_ENDPOINT(FALSE, 2, 32, &pendingReads, &transferLength);
+    XNA_TEST_EXPECT(pendingReads == XNA_READER_PENDING_READS_DEFAULT && transferLength == 32);
+
+    XNA_READER_PARAMETERS_FROM_ENDPOINT(FALSE, 8, 32, &pendingReads, &transferLength);
+    XNA_TEST_EXPECT(pendingReads == XNA_READER_PENDING_READS_DEFAULT && transferLength == 32);
+
+    XNA_READER_PARAMETERS_FROM_ENDPOINT(FALSE, 0, 0, &pendingReads, &transferLength);
+    XNA_TEST_EXPECT(pendingReads == XNA_READER_PENDING_READS_FAST_POLLING);
+    XNA_TEST_EXPECT(transferLength == XNA_READER_TRANSFER_LENGTH_DEFAULT);
+
+    //
+    // High speed bInterval 1 to 4 is 125 us to 1 ms, 5 is 2 ms
+    //
+    XNA_READER_PARAMETERS_FROM_ENDPOINT(TRUE, 1, 64, &pendingReads, &transferLength);
+    XNA_TEST_EXPECT(pendingReads == XNA_READER_PENDING_READS_FAST_POLLING);
+
+    XNA_READER_PARAMETERS_FROM_ENDPOINT(TRUE, 4, 64, &pendingReads, &transferLength);
+    XNA_TEST_EXPECT(pendingReads == XNA_READER_PENDING_READS_FAST_POLLING);
+
+    XNA_READER_PARAMETERS_FROM_ENDPOINT(TRUE, 5, 64, &pendingReads, &transferLength);
+    XNA_TEST_EXPECT(pendingReads == XNA_READER_PENDING_READS_DEFAULT);
+
+    XNA_READER_PARAMETERS_FROM_ENDPOINT(TRUE, 0, 64, &pendingReads, &transferLength);
+    XNA_TEST_EXPECT(pendingReads == XNA_READER_PENDING_READS_FAST_POLLING);
+
+    //
+    // Overrides out of range, reads never shorter than a packet or report
+    //
+    pendingReads = 0;
+    transferLength = 8;
+    XNA_READER_PARAMETERS_CLAMP(64, 48, &pendingReads, &transferLength);
+    XNA_TEST_EXPECT(pendingReads == 1 && transferLength == 64);
+
+    pendingReads = 100;
+    transferLength = 0x10000;
+    XNA_READER_PARAMETERS_CLAMP(64, 48, &pendingReads, &transferLength);
+    XNA_TEST_EXPECT(pendingReads == XNA_READER_PENDING_READS_MAX);
+    XNA_TEST_EXPECT(transferLength == XNA_READER_TRANSFER_LENGTH_MAX);
+
+    pendingReads = 3;
+    transferLength = 20;
+    XNA_READER_PARAMETERS_CLAMP(0, 48, &pendingReads, &transferLength);
+    XNA_TEST_EXPECT(pendingReads == 3 && transferLength == 48);
+
+    pendingReads = 6;
+    transferLength = 100;
+    XNA_READER_PARAMETERS_CLAMP(64, 48, &pendingReads, &transferLength);
+    XNA_TEST_EXPECT(pendingReads == 6 && transferLength == 100);
+}
+
+//
+// NAKed polls and report latency by read depth at 8 kHz, 1 kHz and 125 Hz
+//
+static VOID TestSimulation(
+    VOID
+)
+{
+    static const double intervals[] = { 0.125, 1.0, 8.0 };
+    READER_SIM_RESULT   results[ARRAYSIZE(intervals)][XNA_READER_PENDING_READS_MAX + 1];
+    ULONG               interval;
+    ULONG               depth;
+    ULONG               defaultDepth;
+    ULONG               transferLength;
+
+    printf("depth  interval  NAKed %%  mean latency  max latency\n");
+
+    for (interval = 0; interval < ARRAYSIZE(intervals); interval++)
+    {
+        for (depth = 1; depth <= XNA_READER_PENDING_READS_MAX; depth++)
+        {
+            ReaderSimulate(depth, intervals[interval], &results[interval][depth]);
+
+            printf("%5lu  %5.3f ms  %7.3f  %9.4f ms  %8.3f ms\n", (unsigned long)depth, intervals[interval],
+                results[interval][depth].NakedPercent, results[interval][depth].MeanLatency, results[interval][depth].MaxLatency);
+
+            //
+            // More reads in flight never make it worse
+            //
+            XNA_TEST_EXPECT(depth == 1 || results[interval][depth].NakedPercent <= results[interval][depth - 1].NakedPercent);
+            XNA_TEST_EXPECT(depth == 1 || results[interval][depth].MeanLatency <= results[interval][depth - 1].MeanLatency);
+        }
+    }
+
+    //
+    // The derived depth keeps 1 kHz pads below 0.01 % NAKed polls, slower
+    // pads don't need more than the default
+    //
+    XNA_READER_PARAMETERS_FROM_ENDPOINT(FALSE, 1, 64, &defaultDepth, &transferLength);
+    XNA_TEST_EXPECT(results[1][defaultDepth].NakedPercent < 0.01);
+
+    XNA_READER_PARAMETERS_FROM_ENDPOINT(TRUE, 4, 64, &defaultDepth, &transferLength);
+    XNA_TEST_EXPECT(results[1][defaultDepth].NakedPercent < 0.01);
+
+    XNA_READER_PARAMETERS_FROM_ENDPOINT(FALSE, 8, 64, &defaultDepth, &transferLength);
+    XNA_TEST_EXPECT(results[2][defaultDepth].NakedPercent == 0.0);
+}
+
+int main(
+    VOID
+)
+{
+    TestParameters();
+    TestSimulation();
+
+    return XNA_TEST_RESULT();
+}
@@ -0,0 +1,368 @@
+/*
+MIT License
+
+Copyright (c) 2017 Benjamin "Nefarius" Hglinger
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#include "XnaTest.h"
+#include "XnaGuardianRing.h"
+
+#define RING_TEST_PRODUCERS     3
+#define RING_TEST_CONSUMERS     3
+#define RING_TEST_CANCELLERS    2
+#define RING_TEST_ITEMS_EACH    40000
+#define RING_TEST_ITEMS         (RING_TEST_PRODUCERS * RING_TEST_ITEMS_EACH)
+
+typedef struct _RING_TEST_ITEM
+{
+    ULONG           Producer;
+    ULONG           Number;
+
+    //
+    // Claim state, like the context of a pended request
+    //
+    volatile LONG   State;
+
+    volatile LONG   Enqueued;
+    volatile LONG   Dequeued;
+    volatile LONG   Consumed;
+    volatile LONG   Cancelled;
+
+} RING_TEST_ITEM, *PRING_TEST_ITEM;
+
+typedef struct _RING_TEST_CONSUMER
+{
+    ULONG Consumed;
+    ULONG Skipped;
+
+    //
+    // A consumer sees the items of a producer in their order
+    //
+    LONG  Last[RING_TEST_PRODUCERS];
+    ULONG OutOfOrder;
+
+} RING_TEST_CONSUMER, *PRING_TEST_CONSUMER;
+
+static XNA_REQUEST_RING RingTestRing;
+static RING_TEST_ITEM   RingTestItems[RING_TEST_ITEMS];
+static volatile LONG    RingTestDequeued;
+static ULONG            RingTestProducerIds[RING_TEST_PRODUCERS];
+static ULONG            RingTestCancellerSeeds[RING_TEST_CANCELLERS];
+static volatile LONG    RingTestLastEnqueued[RING_TEST_PRODUCERS];
+
+static VOID TestSingleThreaded(
+    VOID
+)
+{
+    XNA_REQUEST_RING    ring;
+    PVOID               item;
+    ULONG_PTR           index;
+    ULONG               lap;
+    LONG                start;
+
+    XNA_REQUEST_RING_INIT(&ring);
+
+    XNA_TEST_EXPECT(!XNA_REQUEST_RING_DEQUEUE(&ring, &item));
+
+    for (index = 0; index < XNA_REQUEST_RING_CAPACITY; index++)
+        XNA_TEST_EXPECT(XNA_REQUEST_RING_ENQUEUE(&ring, (PVOID)(index + 1)));
+
+    XNA_TEST_EXPECT(!XNA_REQUEST_RING_ENQUEUE(&ring, (PVOID)1));
+
+    for (index = 0; index < XNA_REQUEST_RING_CAPACITY; index++)
+    {
+        XNA_TEST_EXPECT(XNA_REQUEST_RING_DEQUEUE(&ring, &item));
+        XNA_TEST_EXPECT(item == (PVOID)(index + 1));
+    }
+
+    XNA_TEST_EXPECT(!XNA_REQUEST_RING_DEQUEUE(&ring, &item));
+
+    //
+    // Positions wrapping around the sign and the end of the 32-bit range
+    //
+    for (lap = 0; lap < 2; lap++)
+    {
+        start = (lap == 0) ? (LONG)0x7FFFFFF0 : (LONG)0xFFFFFFF0;
+
+        for (index = 0; index < XNA_REQUEST_RING_CAPACITY; index++)
+            ring.Cells[((ULONG)start + index) & XNA_REQUEST_RING_MASK].Sequence = (LONG)((ULONG)start + (ULONG)index);
+
+        ring.EnqueuePosition = start;
+        ring.DequeuePosition = start;
+
+        for (index = 0; index < 4 * XNA_REQUEST_RING_CAPACITY; index++)
+        {
+            XNA_TEST_EXPECT(XNA_REQUEST_RING_ENQUEUE(&ring, (PVOID)(index + 1)));
+            XNA_TEST_EXPECT(XNA_REQUEST_RING_DEQUEUE(&ring, &item));
+            XNA_TEST_EXPECT(item == (PVOID)(index + 1));
+        }
+    }
+}
+
+static VOID TestClaim(
+    VOID
+)
+{
+    volatile LONG state = XNA_RING_ITEM_PENDING;
+
+    XNA_TEST_EXPECT(XNA_RING_ITEM_CLAIM(&state));
+    XNA_TEST_EXPECT(!XNA_RING_ITEM_CANCEL(&state));
+    XNA_TEST_EXPECT(!XNA_RING_ITEM_CLAIM(&state));
+    XNA_TEST_EXPECT(state == XNA_RING_ITEM_CLAIMED);
+
+    state = XNA_RING_ITEM_PENDING;
+
+    XNA_TEST_EXPECT(XNA_RING_ITEM_CANCEL(&state));
+    XNA_TEST_EXPECT(!XNA_RING_ITEM_CLAIM(&state));
+    XNA_TEST_EXPECT(!XNA_RING_ITEM_CANCEL(&state));
+    XNA_TEST_EXPECT(state == XNA_RING_ITEM_CANCELLED);
+}
+
+static VOID RingTestProducer(
+    PVOID Context
+)
+{
+    ULONG           producer = *(PULONG)Context;
+    PRING_TEST_ITEM pItem;
+    ULONG           number;
+
+    for (number = 0; number < RING_TEST_ITEMS_EACH; number++)
+    {
+        pItem = &RingTestItems[producer * RING_TEST_ITEMS_EACH + number];
+
+        InterlockedIncrement(&pItem->Enqueued);
+
+        while (!XNA_REQUEST_RING_ENQUEUE(&RingTestRing, pItem))
+            XnaTestThreadYield();
+
+        RingTestLastEnqueued[producer] = (LONG)number;
+
+        //
+        // Cancels an earlier item of its own, which may still be queued or
+        // just being claimed, like a request cancelled by its issuer
+        //
+        if ((number & 3) == 3)
+        {
+            pItem -= 2;
+
+            if (XNA_RING_ITEM_CANCEL(&pItem->State))
+                InterlockedIncrement(&pItem->Cancelled);
+        }
+    }
+}
+
+static VOID RingTestConsumer(
+    PVOID Context
+)
+{
+    PRING_TEST_CONSUMER consumer = (PRING_TEST_CONSUMER)Context;
+    PRING_TEST_ITEM     pItem;
+    PVOID               item;
+
+    while (RingTestDequeued < RING_TEST_ITEMS)
+    {
+        if (!XNA_REQUEST_RING_DEQUEUE(&RingTestRing, &item))
+        {
+            XnaTestThreadYield();
+            continue;
+        }
+
+        InterlockedIncrement(&RingTestDequeued);
+
+        pItem = (PRING_TEST_ITEM)item;
+
+        InterlockedIncrement(&pItem->Dequeued);
+
+        if ((LONG)pItem->Number <= consumer->Last[pItem->Producer])
+            consumer->OutOfOrder++;
+
+        consumer->Last[pItem->Producer] = (LONG)pItem->Number;
+
+        //
+        // Skipped items belong to the canceller which won the race
+        //
+        if (XNA_RING_ITEM_CLAIM(&pItem->State))
+        {
+            InterlockedIncrement(&pItem->Consumed);
+            consumer->Consumed++;
+        }
+        else
+        {
+            consumer->Skipped++;
+        }
+    }
+}
+
+static VOID RingTestCanceller(
+    PVOID Context
+)
+{
+    PRING_TEST_ITEM pItem;
+    ULONG           random = *(PULONG)Context;
+    ULONG           number;
+
+    while (RingTestDequeued < RING_TEST_ITEMS)
+    {
+        //
+        // Own generator, XnaTestRandom isn't thread safe
+        //
+        random ^= random << 13;
+        random ^= random >> 17;
+        random ^= random << 5;
+
+        //
+        // Items a little behind the last one enqueued by a producer, likely
+        // still in the ring
+        //
+        number = (ULONG)RingTestLastEnqueued[random % RING_TEST_PRODUCERS];
+        number -= min(number, (random >> 8) % (XNA_REQUEST_RING_CAPACITY / RING_TEST_PRODUCERS));
+        pItem = &RingTestItems[(random % RING_TEST_PRODUCERS) * RING_TEST_ITEMS_EACH + number];
+
+        if (pItem->Enqueued && XNA_RING_ITEM_CANCEL(&pItem->State))
+            InterlockedIncrement(&pItem->Cancelled);
+
+        if ((random & 0xF0) == 0)
+            XnaTestThreadYield();
+    }
+}
+
+static VOID TestStress(
+    VOID
+)
+{
+    XNA_TEST_THREAD     producers[RING_TEST_PRODUCERS];
+    XNA_TEST_THREAD     consumers[RING_TEST_CONSUMERS];
+    XNA_TEST_THREAD     cancellers[RING_TEST_CANCELLERS];
+    RING_TEST_CONSUMER  state[RING_TEST_CONSUMERS];
+    PRING_TEST_ITEM     pItem;
+    PVOID               item;
+    ULONG               index;
+    ULONG               consumed = 0;
+    ULONG               cancelled = 0;
+    ULONG               lost = 0;
+    ULONG               duplicated = 0;
+    ULONG               outOfOrder = 0;
+
+    XNA_REQUEST_RING_INIT(&RingTestRing);
+    RtlZeroMemory(RingTestItems, sizeof(RingTestItems));
+    RtlZeroMemory(state, sizeof(state));
+    RingTestDequeued = 0;
+    RtlZeroMemory((PVOID)RingTestLastEnqueued, sizeof(RingTestLastEnqueued));
+
+    for (index = 0; index < RING_TEST_ITEMS; index++)
+    {
+        RingTestItems[index].Producer = index / RING_TEST_ITEMS_EACH;
+        RingTestItems[index].Number = index % RING_TEST_ITEMS_EACH;
+        RingTestItems[index].State = XNA_RING_ITEM_PENDING;
+    }
+
+    for (index = 0; index < RING_TEST_CONSUMERS; index++)
+    {
+        RtlFillMemory(state[index].Last, sizeof(state[index].Last), 0xFF);
+        XnaTestThreadStart(&consumers[index], RingTestConsumer, &state[index]);
+    }
+
+    for (index = 0; index < RING_TEST_CANCELLERS; index++)
+    {
+        RingTestCancellerSeeds[index] = XnaTestRandom() | 1;
+        XnaTestThreadStart(&cancellers[index], RingTestCanceller, &RingTestCancellerSeeds[index]);
+    }
+
+    for (index = 0; index < RING_TEST_PRODUCERS; index++)
+    {
+        RingTestProducerIds[index] = index;
+        XnaTestThreadStart(&producers[index], RingTestProducer, &RingTestProducerIds[index]);
+    }
+
+    for (index = 0; index < RING_TEST_PRODUCERS; index++)
+        XnaTestThreadJoin(&producers[index]);
+    for (index = 0; index < RING_TEST_CONSUMERS; index++)
+        XnaTestThreadJoin(&consumers[index]);
+    for (index = 0; index < RING_TEST_CANCELLERS; index++)
+        XnaTestThreadJoin(&cancellers[index]);
+
+    //
+    // Every item went through the ring once and has exactly one owner
+    //
+    for (index = 0; index < RING_TEST_ITEMS; index++)
+    {
+        pItem = &RingTestItems[index];
+
+        if (pItem->Dequeued == 0)
+            lost++;
+        if (pItem->Dequeued > 1 || pItem->Consumed + pItem->Cancelled != 1)
+            duplicated++;
+
+        consumed += pItem->Consumed;
+        cancelled += pItem->Cancelled;
+    }
+
+    for (index = 0; index < RING_TEST_CONSUMERS; index++)
+        outOfOrder += state[index].OutOfOrder;
+
+    printf("%lu items, %lu consumed, %lu cancelled\n",
+        (unsigned long)RING_TEST_ITEMS, (unsigned long)consumed, (unsigned long)cancelled);
+
+    XNA_TEST_EXPECT(lost == 0);
+    XNA_TEST_EXPECT(duplicated == 0);
+    XNA_TEST_EXPECT(outOfOrder == 0);
+    XNA_TEST_EXPECT(consumed + cancelled == RING_TEST_ITEMS);
+    XNA_TEST_EXPECT(!XNA_REQUEST_RING_DEQUEUE(&RingTestRing, &item));
+}
+
+static VOID Bench(
+    VOID
+)
+{
+    const ULONG         iterations = 10000000;
+    XNA_REQUEST_RING    ring;
+    PVOID               item;
+    ULONG               iteration;
+    double              start;
+
+    XNA_REQUEST_RING_INIT(&ring);
+
+    start = XnaTestNow();
+
+    for (iteration = 0; iteration < iterations; iteration++)
+    {
+        XNA_REQUEST_RING_ENQUEUE(&ring, &ring);
+        XNA_REQUEST_RING_DEQUEUE(&ring, &item);
+    }
+
+    XnaTestReport("Ring enqueue + dequeue (uncontended)", (double)iterations, XnaTestNow() - start);
+}
+
+int main(
+    int argc,
+    char** argv
+)
+{
+    TestSingleThreaded();
+    TestClaim();
+    TestStress();
+
+    if (XnaTestBenchEnabled(argc, argv))
+        Bench();
+
+    return XNA_TEST_RESULT();
+}
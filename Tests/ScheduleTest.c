@@ -0,0 +1,362 @@
+/*
+MIT License
+
+Copyright (c) 2017 Benjamin "Nefarius" Hglinger
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#include "XnaTest.h"
+#include "XInputOverrideSchedule.h"
+
+//
+// 100-nanosecond units per millisecond
+//
+#define SCHEDULE_TEST_MS    10000ULL
+
+static VOID TestEvaluate(
+    VOID
+)
+{
+    XINPUT_OVERRIDE_SCHEDULE        schedule;
+    XINPUT_OVERRIDE_SCHEDULE_ENTRY  entry;
+    XINPUT_EXT_SCHEDULE_GAMEPAD     request;
+    XINPUT_EXT_OVERRIDE_GAMEPAD     result;
+
+    XINPUT_OVERRIDE_SCHEDULE_INIT(&schedule);
+
+    //
+    // A press of A with a full left trigger from 200 to 300
+    //
+    XINPUT_EXT_SCHEDULE_GAMEPAD_INIT(&request, 0, 200, 100);
+    request.Override.Overrides = XINPUT_GAMEPAD_OVERRIDE_A | XINPUT_GAMEPAD_OVERRIDE_LEFT_TRIGGER;
+    request.Override.Gamepad.wButtons = XINPUT_GAMEPAD_OVERRIDE_A;
+    request.Override.Gamepad.bLeftTrigger = 0xFF;
+
+    XINPUT_OVERRIDE_SCHEDULE_ENTRY_FROM_REQUEST(&entry, &request, NULL, 50);
+    XNA_TEST_EXPECT(XINPUT_OVERRIDE_SCHEDULE_INSERT(&schedule, &entry));
+
+    //
+    // A high resolution left trigger from now (100) to 1100
+    //
+    XINPUT_EXT_SCHEDULE_GAMEPAD_INIT(&request, 0, 0, 1000);
+    request.Override.Overrides = XINPUT_GAMEPAD_OVERRIDE_LEFT_TRIGGER | XINPUT_GAMEPAD_OVERRIDE_HIGH_RES_TRIGGERS;
+    request.Override.LeftTrigger = 500;
+
+    XINPUT_OVERRIDE_SCHEDULE_ENTRY_FROM_REQUEST(&entry, &request, NULL, 100);
+    XNA_TEST_EXPECT(entry.ActivationTime == 100 && entry.ExpirationTime == 1100);
+    XNA_TEST_EXPECT(XINPUT_OVERRIDE_SCHEDULE_INSERT(&schedule, &entry));
+
+    //
+    // Nothing is active before the first activation
+    //
+    XNA_TEST_EXPECT(!XINPUT_OVERRIDE_SCHEDULE_EVALUATE(&schedule, 99, &result));
+    XNA_TEST_EXPECT(result.Overrides == 0 && schedule.Count == 2);
+
+    XNA_TEST_EXPECT(XINPUT_OVERRIDE_SCHEDULE_EVALUATE(&schedule, 150, &result));
+    XNA_TEST_EXPECT(result.LeftTrigger == 500);
+    XNA_TEST_EXPECT(!(result.Overrides & XINPUT_GAMEPAD_OVERRIDE_A));
+    XNA_TEST_EXPECT(result.Overrides & XINPUT_GAMEPAD_OVERRIDE_HIGH_RES_TRIGGERS);
+
+    //
+    // The entry activated later wins, its 8-bit trigger is widened
+    //
+    XNA_TEST_EXPECT(XINPUT_OVERRIDE_SCHEDULE_EVALUATE(&schedule, 250, &result));
+    XNA_TEST_EXPECT(result.LeftTrigger == XINPUT_TRIGGER_TO_HIGH_RES(0xFF));
+    XNA_TEST_EXPECT(result.Gamepad.wButtons & XINPUT_GAMEPAD_OVERRIDE_A);
+    XNA_TEST_EXPECT(schedule.Count == 2);
+
+    //
+    // Expiration is exclusive, expired entries are dropped
+    //
+    XNA_TEST_EXPECT(XINPUT_OVERRIDE_SCHEDULE_EVALUATE(&schedule, 300, &result));
+    XNA_TEST_EXPECT(result.LeftTrigger == 500 && schedule.Count == 1);
+
+    XNA_TEST_EXPECT(!XINPUT_OVERRIDE_SCHEDULE_EVALUATE(&schedule, 1100, &result));
+    XNA_TEST_EXPECT(schedule.Count == 0);
+
+    //
+    // The expiration time saturates
+    //
+    XINPUT_EXT_SCHEDULE_GAMEPAD_INIT(&request, 0, (ULONGLONG)-5, 100);
+    XINPUT_OVERRIDE_SCHEDULE_ENTRY_FROM_REQUEST(&entry, &request, NULL, 0);
+    XNA_TEST_EXPECT(entry.ExpirationTime == (ULONGLONG)-1);
+}
+
+static VOID TestInsert(
+    VOID
+)
+{
+    XINPUT_OVERRIDE_SCHEDULE        schedule;
+    XINPUT_OVERRIDE_SCHEDULE_ENTRY  entry;
+    ULONG                           index;
+    ULONG                           owners[2] = { 0, 0 };
+
+    XINPUT_OVERRIDE_SCHEDULE_INIT(&schedule);
+    RtlZeroMemory(&entry, sizeof(entry));
+
+    for (index = 0; index < XINPUT_OVERRIDE_SCHEDULE_MAX; index++)
+    {
+        entry.ActivationTime = XnaTestRandom() % 4;
+        entry.Owner = &owners[index & 1];
+        entry.Override.Overrides = index;
+
+        XNA_TEST_EXPECT(XINPUT_OVERRIDE_SCHEDULE_INSERT(&schedule, &entry));
+    }
+
+    XNA_TEST_EXPECT(!XINPUT_OVERRIDE_SCHEDULE_INSERT(&schedule, &entry));
+    XNA_TEST_EXPECT(schedule.Count == XINPUT_OVERRIDE_SCHEDULE_MAX);
+
+    //
+    // Sorted by activation time, in insertion order for equal times
+    //
+    for (index = 1; index < schedule.Count; index++)
+    {
+        XNA_TEST_EXPECT(schedule.Entries[index - 1].ActivationTime <= schedule.Entries[index].ActivationTime);
+        XNA_TEST_EXPECT(schedule.Entries[index - 1].ActivationTime < schedule.Entries[index].ActivationTime
+            || schedule.Entries[index - 1].Override.Overrides < schedule.Entries[index].Override.Overrides);
+    }
+
+    XNA_TEST_EXPECT(XINPUT_OVERRIDE_SCHEDULE_REMOVE_OWNER(&schedule, &owners[0]) == XINPUT_OVERRIDE_SCHEDULE_MAX / 2);
+    XNA_TEST_EXPECT(XINPUT_OVERRIDE_SCHEDULE_REMOVE_OWNER(&schedule, &owners[0]) == 0);
+    XNA_TEST_EXPECT(schedule.Count == XINPUT_OVERRIDE_SCHEDULE_MAX / 2);
+
+    for (index = 0; index < schedule.Count; index++)
+    {
+        XNA_TEST_EXPECT(schedule.Entries[index].Owner == &owners[1]);
+        XNA_TEST_EXPECT(index == 0 || schedule.Entries[index - 1].ActivationTime <= schedule.Entries[index].ActivationTime);
+    }
+}
+
+//
+// Straightforward evaluation of entries kept in insertion order, the
+// active ones are applied by activation time, then by insertion order
+//
+static BOOLEAN EvaluateReference(
+    const XINPUT_OVERRIDE_SCHEDULE_ENTRY* Entries,
+    ULONG Count,
+    ULONGLONG Time,
+    PXINPUT_EXT_OVERRIDE_GAMEPAD Result
+)
+{
+    const XINPUT_OVERRIDE_SCHEDULE_ENTRY* pEntry;
+    ULONG       applied[XINPUT_OVERRIDE_SCHEDULE_MAX];
+    ULONG       next;
+    ULONG       index;
+    ULONG       step;
+    ULONG       overrides;
+    USHORT      buttons;
+    BOOLEAN     highRes;
+
+    RtlZeroMemory(Result, sizeof(XINPUT_EXT_OVERRIDE_GAMEPAD));
+    RtlZeroMemory(applied, sizeof(applied));
+
+    for (step = 0; step < Count; step++)
+    {
+        next = Count;
+
+        for (index = 0; index < Count; index++)
+        {
+            if (applied[index] || Entries[index].ExpirationTime <= Time || Entries[index].ActivationTime > Time)
+                continue;
+
+            if (next == Count || Entries[index].ActivationTime < Entries[next].ActivationTime)
+                next = index;
+        }
+
+        if (next == Count)
+            break;
+
+        applied[next] = TRUE;
+        pEntry = &Entries[next];
+
+        overrides = pEntry->Override.Overrides & ~XINPUT_GAMEPAD_OVERRIDE_HIGH_RES_TRIGGERS;
+        highRes = (pEntry->Override.Overrides & XINPUT_GAMEPAD_OVERRIDE_HIGH_RES_TRIGGERS) != 0;
+        buttons = (USHORT)(overrides & 0xFFFF);
+
+        Result->Gamepad.wButtons = (USHORT)((Result->Gamepad.wButtons & ~buttons) | (pEntry->Override.Gamepad.wButtons & buttons));
+
+        if (overrides & XINPUT_GAMEPAD_OVERRIDE_LEFT_TRIGGER)
+        {
+            Result->Gamepad.bLeftTrigger = pEntry->Override.Gamepad.bLeftTrigger;
+            Result->LeftTrigger = highRes ? pEntry->Override.LeftTrigger : XINPUT_TRIGGER_TO_HIGH_RES(pEntry->Override.Gamepad.bLeftTrigger);
+        }
+        if (overrides & XINPUT_GAMEPAD_OVERRIDE_RIGHT_TRIGGER)
+        {
+            Result->Gamepad.bRightTrigger = pEntry->Override.Gamepad.bRightTrigger;
+            Result->RightTrigger = highRes ? pEntry->Override.RightTrigger : XINPUT_TRIGGER_TO_HIGH_RES(pEntry->Override.Gamepad.bRightTrigger);
+        }
+        if (overrides & XINPUT_GAMEPAD_OVERRIDE_LEFT_THUMB_X)
+            Result->Gamepad.sThumbLX = pEntry->Override.Gamepad.sThumbLX;
+        if (overrides & XINPUT_GAMEPAD_OVERRIDE_LEFT_THUMB_Y)
+            Result->Gamepad.sThumbLY = pEntry->Override.Gamepad.sThumbLY;
+        if (overrides & XINPUT_GAMEPAD_OVERRIDE_RIGHT_THUMB_X)
+            Result->Gamepad.sThumbRX = pEntry->Override.Gamepad.sThumbRX;
+        if (overrides & XINPUT_GAMEPAD_OVERRIDE_RIGHT_THUMB_Y)
+            Result->Gamepad.sThumbRY = pEntry->Override.Gamepad.sThumbRY;
+
+        Result->Overrides |= overrides;
+    }
+
+    if (Result->Overrides == 0)
+        return FALSE;
+
+    Result->Overrides |= XINPUT_GAMEPAD_OVERRIDE_HIGH_RES_TRIGGERS;
+
+    return TRUE;
+}
+
+//
+// Random requests and evaluations on a short time line, compared to the
+// reference evaluation of all requests not expired yet
+//
+static VOID TestFuzz(
+    VOID
+)
+{
+    XINPUT_OVERRIDE_SCHEDULE        schedule;
+    XINPUT_OVERRIDE_SCHEDULE_ENTRY  pending[XINPUT_OVERRIDE_SCHEDULE_MAX];
+    XINPUT_OVERRIDE_SCHEDULE_ENTRY  entry;
+    XINPUT_EXT_SCHEDULE_GAMEPAD     request;
+    XINPUT_EXT_OVERRIDE_GAMEPAD     result;
+    XINPUT_EXT_OVERRIDE_GAMEPAD     expected;
+    ULONG                           count = 0;
+    ULONG                           iteration;
+    ULONG                           index;
+    ULONG                           kept;
+    ULONGLONG                       now = 1;
+    BOOLEAN                         active;
+
+    XINPUT_OVERRIDE_SCHEDULE_INIT(&schedule);
+
+    for (iteration = 0; iteration < 200000; iteration++)
+    {
+        if (XnaTestRandom() & 1)
+        {
+            XINPUT_EXT_SCHEDULE_GAMEPAD_INIT(&request, 0,
+                (XnaTestRandom() & 3) ? now + XnaTestRandom() % 64 : 0,
+                XnaTestRandom() % 128);
+            request.Override.Overrides = XnaTestRandom();
+            XnaTestRandomFill(&request.Override.Gamepad, sizeof(XINPUT_GAMEPAD_STATE));
+            request.Override.LeftTrigger = (USHORT)(XnaTestRandom() & 0x3FF);
+            request.Override.RightTrigger = (USHORT)(XnaTestRandom() & 0x3FF);
+
+            XINPUT_OVERRIDE_SCHEDULE_ENTRY_FROM_REQUEST(&entry, &request, NULL, now);
+
+            XNA_TEST_EXPECT(XINPUT_OVERRIDE_SCHEDULE_INSERT(&schedule, &entry) == (count < XINPUT_OVERRIDE_SCHEDULE_MAX));
+
+            if (count < XINPUT_OVERRIDE_SCHEDULE_MAX)
+                pending[count++] = entry;
+        }
+
+        now += XnaTestRandom() % 16;
+
+        active = XINPUT_OVERRIDE_SCHEDULE_EVALUATE(&schedule, now, &result);
+
+        XNA_TEST_EXPECT(active == EvaluateReference(pending, count, now, &expected));
+        XNA_TEST_EXPECT(result.Overrides == expected.Overrides);
+        XNA_TEST_EXPECT(result.LeftTrigger == expected.LeftTrigger);
+        XNA_TEST_EXPECT(result.RightTrigger == expected.RightTrigger);
+        XNA_TEST_EXPECT(memcmp(&result.Gamepad, &expected.Gamepad, sizeof(XINPUT_GAMEPAD_STATE)) == 0);
+
+        for (index = 0, kept = 0; index < count; index++)
+        {
+            if (pending[index].ExpirationTime > now)
+                pending[kept++] = pending[index];
+        }
+
+        count = kept;
+
+        XNA_TEST_EXPECT(schedule.Count == count);
+    }
+}
+
+//
+// 1 kHz polls with +-0.2 ms jitter, a press of A scheduled every 50 ms and
+// held for 16 ms, sent 10 ms ahead with 0 to 8 ms of delay. The press must
+// show on the first poll at or after its activation time.
+//
+static VOID TestTiming(
+    VOID
+)
+{
+    XINPUT_OVERRIDE_SCHEDULE        schedule;
+    XINPUT_OVERRIDE_SCHEDULE_ENTRY  entry;
+    XINPUT_EXT_SCHEDULE_GAMEPAD     request;
+    XINPUT_EXT_OVERRIDE_GAMEPAD     result;
+    ULONGLONG                       activation;
+    ULONGLONG                       arrival;
+    ULONGLONG                       poll;
+    ULONGLONG                       time;
+    ULONGLONG                       first;
+    ULONGLONG                       latest = 0;
+    ULONG                           press;
+
+    XINPUT_OVERRIDE_SCHEDULE_INIT(&schedule);
+
+    for (press = 1; press <= 2000; press++)
+    {
+        activation = press * 50 * SCHEDULE_TEST_MS;
+        arrival = activation - 10 * SCHEDULE_TEST_MS + XnaTestRandom() % (8 * SCHEDULE_TEST_MS);
+
+        XINPUT_EXT_SCHEDULE_GAMEPAD_INIT(&request, 0, activation, 16 * SCHEDULE_TEST_MS);
+        request.Override.Overrides = XINPUT_GAMEPAD_OVERRIDE_A;
+        request.Override.Gamepad.wButtons = XINPUT_GAMEPAD_OVERRIDE_A;
+
+        XINPUT_OVERRIDE_SCHEDULE_ENTRY_FROM_REQUEST(&entry, &request, NULL, arrival);
+        XNA_TEST_EXPECT(XINPUT_OVERRIDE_SCHEDULE_INSERT(&schedule, &entry));
+
+        first = 0;
+
+        for (poll = activation - 20 * SCHEDULE_TEST_MS; poll < activation + 20 * SCHEDULE_TEST_MS; poll += SCHEDULE_TEST_MS)
+        {
+            time = poll + XnaTestRandom() % 4000 - 2000;
+
+            if (XINPUT_OVERRIDE_SCHEDULE_EVALUATE(&schedule, time, &result)
+                && (result.Gamepad.wButtons & XINPUT_GAMEPAD_OVERRIDE_A))
+            {
+                XNA_TEST_EXPECT(time >= activation && time < activation + 16 * SCHEDULE_TEST_MS);
+
+                if (first == 0)
+                    first = time;
+            }
+        }
+
+        XNA_TEST_EXPECT(first != 0);
+        XNA_TEST_EXPECT(first - activation <= SCHEDULE_TEST_MS + 4000);
+
+        if (first - activation > latest)
+            latest = first - activation;
+    }
+
+    printf("latest press %.2f ms after its activation time\n", (double)latest / SCHEDULE_TEST_MS);
+}
+
+int main(
+    VOID
+)
+{
+    TestEvaluate();
+    TestInsert();
+    TestFuzz();
+    TestTiming();
+
+    return XNA_TEST_RESULT();
+}
@@ -0,0 +1,219 @@
+/*
+MIT License
+
+Copyright (c) 2017 Benjamin "Nefarius" Hglinger
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#include "XnaTest.h"
+#include "XnaGuardianSeqLock.h"
+
+#define SEQ_LOCK_TEST_READERS   3
+#define SEQ_LOCK_TEST_WRITES    200000
+
+//
+// Same size as XINPUT_PAD_STATE_INTERNAL, every word carries the
+// generation of the write so a torn snapshot mixes generations
+//
+typedef struct _SEQ_LOCK_TEST_DATA
+{
+    ULONG Words[8];
+
+} SEQ_LOCK_TEST_DATA, *PSEQ_LOCK_TEST_DATA;
+
+typedef struct _SEQ_LOCK_TEST_READER
+{
+    ULONG Reads;
+    ULONG TryReads;
+    ULONG Torn;
+    ULONG Backwards;
+
+} SEQ_LOCK_TEST_READER, *PSEQ_LOCK_TEST_READER;
+
+static XNA_SEQ_LOCK       SeqLockTestLock;
+static SEQ_LOCK_TEST_DATA SeqLockTestShared;
+static volatile LONG      SeqLockTestDone;
+
+static BOOLEAN SeqLockTestIsTorn(
+    const SEQ_LOCK_TEST_DATA* Data
+)
+{
+    ULONG index;
+
+    for (index = 1; index < ARRAYSIZE(Data->Words); index++)
+    {
+        if (Data->Words[index] != Data->Words[0])
+            return TRUE;
+    }
+
+    return FALSE;
+}
+
+static VOID SeqLockTestWriter(
+    PVOID Context
+)
+{
+    SEQ_LOCK_TEST_DATA data;
+    ULONG generation;
+    ULONG index;
+
+    UNREFERENCED_PARAMETER(Context);
+
+    for (generation = 1; generation <= SEQ_LOCK_TEST_WRITES; generation++)
+    {
+        for (index = 0; index < ARRAYSIZE(data.Words); index++)
+            data.Words[index] = generation;
+
+        XNA_SEQ_LOCK_WRITE(&SeqLockTestLock, &SeqLockTestShared, &data, sizeof(data));
+
+        //
+        // Lets the readers run between writes on a single processor
+        //
+        if ((generation & 0xFF) == 0)
+            XnaTestThreadYield();
+    }
+
+    InterlockedExchange(&SeqLockTestDone, TRUE);
+}
+
+static VOID SeqLockTestReader(
+    PVOID Context
+)
+{
+    PSEQ_LOCK_TEST_READER reader = (PSEQ_LOCK_TEST_READER)Context;
+    SEQ_LOCK_TEST_DATA data;
+    ULONG last = 0;
+
+    while (!SeqLockTestDone)
+    {
+        XNA_SEQ_LOCK_READ(&SeqLockTestLock, &data, &SeqLockTestShared, sizeof(data));
+        reader->Reads++;
+
+        if (SeqLockTestIsTorn(&data))
+            reader->Torn++;
+
+        //
+        // A single writer never lets a reader see an older generation
+        //
+        if (data.Words[0] < last)
+            reader->Backwards++;
+
+        last = data.Words[0];
+
+        if (XNA_SEQ_LOCK_TRY_READ(&SeqLockTestLock, &data, &SeqLockTestShared, sizeof(data), 4))
+        {
+            reader->TryReads++;
+
+            if (SeqLockTestIsTorn(&data))
+                reader->Torn++;
+        }
+
+        if ((reader->Reads & 0xFF) == 0)
+            XnaTestThreadYield();
+    }
+}
+
+static VOID TestStress(
+    VOID
+)
+{
+    XNA_TEST_THREAD writer;
+    XNA_TEST_THREAD readers[SEQ_LOCK_TEST_READERS];
+    SEQ_LOCK_TEST_READER state[SEQ_LOCK_TEST_READERS];
+    SEQ_LOCK_TEST_DATA data;
+    ULONG index;
+
+    XNA_SEQ_LOCK_INIT(&SeqLockTestLock);
+    RtlZeroMemory(&SeqLockTestShared, sizeof(SeqLockTestShared));
+    RtlZeroMemory(state, sizeof(state));
+    SeqLockTestDone = FALSE;
+
+    for (index = 0; index < SEQ_LOCK_TEST_READERS; index++)
+        XnaTestThreadStart(&readers[index], SeqLockTestReader, &state[index]);
+
+    XnaTestThreadStart(&writer, SeqLockTestWriter, NULL);
+
+    XnaTestThreadJoin(&writer);
+
+    for (index = 0; index < SEQ_LOCK_TEST_READERS; index++)
+    {
+        XnaTestThreadJoin(&readers[index]);
+
+        printf("reader %lu: %lu reads, %lu try reads, %lu torn\n",
+            (unsigned long)index, (unsigned long)state[index].Reads,
+            (unsigned long)state[index].TryReads, (unsigned long)state[index].Torn);
+
+        XNA_TEST_EXPECT(state[index].Torn == 0);
+        XNA_TEST_EXPECT(state[index].Backwards == 0);
+    }
+
+    //
+    // Every write was paired, the last one is visible
+    //
+    XNA_TEST_EXPECT(SeqLockTestLock.Sequence == 2 * SEQ_LOCK_TEST_WRITES);
+    XNA_SEQ_LOCK_READ(&SeqLockTestLock, &data, &SeqLockTestShared, sizeof(data));
+    XNA_TEST_EXPECT(!SeqLockTestIsTorn(&data) && data.Words[0] == SEQ_LOCK_TEST_WRITES);
+}
+
+static VOID TestTryRead(
+    VOID
+)
+{
+    XNA_SEQ_LOCK lock;
+    SEQ_LOCK_TEST_DATA shared;
+    SEQ_LOCK_TEST_DATA data;
+    LONG sequence;
+
+    XNA_SEQ_LOCK_INIT(&lock);
+    RtlFillMemory(&shared, sizeof(shared), 0x11);
+
+    //
+    // A writer that never finishes makes the reader give up instead of
+    // waiting forever
+    //
+    XNA_SEQ_LOCK_WRITE_BEGIN(&lock);
+    XNA_TEST_EXPECT(!XNA_SEQ_LOCK_TRY_READ(&lock, &data, &shared, sizeof(data), 16));
+    XNA_TEST_EXPECT(!XNA_SEQ_LOCK_TRY_READ(&lock, &data, &shared, sizeof(data), 0));
+    XNA_SEQ_LOCK_WRITE_END(&lock);
+
+    RtlZeroMemory(&data, sizeof(data));
+    XNA_TEST_EXPECT(XNA_SEQ_LOCK_TRY_READ(&lock, &data, &shared, sizeof(data), 1));
+    XNA_TEST_EXPECT(RtlEqualMemory(&data, &shared, sizeof(data)));
+
+    //
+    // The sequence changed during the read
+    //
+    sequence = XNA_SEQ_LOCK_READ_BEGIN(&lock);
+    XNA_TEST_EXPECT(!XNA_SEQ_LOCK_READ_RETRY(&lock, sequence));
+    XNA_SEQ_LOCK_WRITE(&lock, &shared, &data, sizeof(data));
+    XNA_TEST_EXPECT(XNA_SEQ_LOCK_READ_RETRY(&lock, sequence));
+    XNA_TEST_EXPECT(XNA_SEQ_LOCK_READ(&lock, &data, &shared, sizeof(data)) == sequence + 2);
+}
+
+int main(
+    VOID
+)
+{
+    TestTryRead();
+    TestStress();
+
+    return XNA_TEST_RESULT();
+}
@@ -0,0 +1,155 @@
+/*
+MIT License
+
+Copyright (c) 2017 Benjamin "Nefarius" Hglinger
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#include "XnaTest.h"
+#include "XnaGuardianSlots.h"
+
+//
+// More devices than slots, so arrivals also happen while all are taken
+//
+#define SLOTS_TEST_DEVICES  (XINPUT_MAX_DEVICES + 3)
+
+typedef struct _SLOTS_TEST_DEVICE
+{
+    BOOLEAN Present;
+
+    //
+    // Slot taken on arrival, like DEVICE_CONTEXT.HidUsbSlot
+    //
+    ULONG Slot;
+
+} SLOTS_TEST_DEVICE, *PSLOTS_TEST_DEVICE;
+
+static VOID TestArrivalOrder(
+    VOID
+)
+{
+    XNA_SLOT_TABLE  table;
+    ULONG           devices[XINPUT_MAX_DEVICES + 1];
+    ULONG           index;
+
+    XNA_SLOT_TABLE_INIT(&table);
+
+    for (index = 0; index < XINPUT_MAX_DEVICES; index++)
+        XNA_TEST_EXPECT(XNA_SLOT_TABLE_ACQUIRE(&table, &devices[index]) == index);
+
+    XNA_TEST_EXPECT(XNA_SLOT_TABLE_ACQUIRE(&table, &devices[XINPUT_MAX_DEVICES]) == XINPUT_MAX_DEVICES);
+    XNA_TEST_EXPECT(XNA_SLOT_TABLE_LOOKUP(&table, XINPUT_MAX_DEVICES) == NULL);
+
+    //
+    // Unplugging the first pad keeps the others on their user index, the
+    // next arrival fills the gap
+    //
+    XNA_SLOT_TABLE_RELEASE(&table, 0);
+    XNA_SLOT_TABLE_RELEASE(&table, XINPUT_MAX_DEVICES);
+
+    XNA_TEST_EXPECT(XNA_SLOT_TABLE_LOOKUP(&table, 0) == NULL);
+
+    for (index = 1; index < XINPUT_MAX_DEVICES; index++)
+        XNA_TEST_EXPECT(XNA_SLOT_TABLE_LOOKUP(&table, index) == &devices[index]);
+
+    XNA_TEST_EXPECT(XNA_SLOT_TABLE_ACQUIRE(&table, &devices[XINPUT_MAX_DEVICES]) == 0);
+    XNA_TEST_EXPECT(XNA_SLOT_TABLE_LOOKUP(&table, 0) == &devices[XINPUT_MAX_DEVICES]);
+}
+
+//
+// Random arrivals and removals, checked against the devices present
+//
+static VOID TestChurn(
+    VOID
+)
+{
+    XNA_SLOT_TABLE      table;
+    SLOTS_TEST_DEVICE   devices[SLOTS_TEST_DEVICES];
+    PSLOTS_TEST_DEVICE  pDevice;
+    ULONG               iteration;
+    ULONG               index;
+    ULONG               lowestFree;
+    ULONG               owners;
+    BOOLEAN             taken[XINPUT_MAX_DEVICES];
+
+    XNA_SLOT_TABLE_INIT(&table);
+    RtlZeroMemory(devices, sizeof(devices));
+
+    for (iteration = 0; iteration < 1000000; iteration++)
+    {
+        pDevice = &devices[XnaTestRandom() % SLOTS_TEST_DEVICES];
+
+        if (pDevice->Present)
+        {
+            XNA_SLOT_TABLE_RELEASE(&table, pDevice->Slot);
+            pDevice->Present = FALSE;
+        }
+        else
+        {
+            RtlZeroMemory(taken, sizeof(taken));
+
+            for (index = 0; index < SLOTS_TEST_DEVICES; index++)
+            {
+                if (devices[index].Present && devices[index].Slot < XINPUT_MAX_DEVICES)
+                    taken[devices[index].Slot] = TRUE;
+            }
+
+            for (lowestFree = 0; lowestFree < XINPUT_MAX_DEVICES && taken[lowestFree]; lowestFree++);
+
+            pDevice->Slot = XNA_SLOT_TABLE_ACQUIRE(&table, pDevice);
+            pDevice->Present = TRUE;
+
+            XNA_TEST_EXPECT(pDevice->Slot == lowestFree);
+        }
+
+        //
+        // Every present device with a slot is found there, every slot has
+        // at most one device and free slots look up to NULL
+        //
+        for (index = 0; index < XINPUT_MAX_DEVICES; index++)
+        {
+            pDevice = (PSLOTS_TEST_DEVICE)XNA_SLOT_TABLE_LOOKUP(&table, index);
+
+            XNA_TEST_EXPECT(pDevice == NULL || (pDevice->Present && pDevice->Slot == index));
+        }
+
+        for (index = 0, owners = 0; index < SLOTS_TEST_DEVICES; index++)
+        {
+            if (!devices[index].Present || devices[index].Slot >= XINPUT_MAX_DEVICES)
+                continue;
+
+            XNA_TEST_EXPECT(XNA_SLOT_TABLE_LOOKUP(&table, devices[index].Slot) == &devices[index]);
+            owners++;
+        }
+
+        XNA_TEST_EXPECT(owners <= XINPUT_MAX_DEVICES);
+    }
+}
+
+int main(
+    VOID
+)
+{
+    TestArrivalOrder();
+    TestChurn();
+
+    return XNA_TEST_RESULT();
+}
@@ -0,0 +1,401 @@
+/*
+MIT License
+
+Copyright (c) 2017 Benjamin "Nefarius" Hglinger
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+
+
+#include "HidUsbTest.h"
+
+//
+// XInput buttons and their X360 HID USB counterparts
+//
+static const USHORT X360ButtonMap[][2] = {
+    { XINPUT_GAMEPAD_A,                 X360_HID_USB_INPUT_REPORT_BUTTON_A },
+    { XINPUT_GAMEPAD_B,                 X360_HID_USB_INPUT_REPORT_BUTTON_B },
+    { XINPUT_GAMEPAD_X,                 X360_HID_USB_INPUT_REPORT_BUTTON_X },
+    { XINPUT_GAMEPAD_Y,                 X360_HID_USB_INPUT_REPORT_BUTTON_Y },
+    { XINPUT_GAMEPAD_LEFT_SHOULDER,     X360_HID_USB_INPUT_REPORT_BUTTON_LEFT_SHOULDER },
+    { XINPUT_GAMEPAD_RIGHT_SHOULDER,    X360_HID_USB_INPUT_REPORT_BUTTON_RIGHT_SHOULDER },
+    { XINPUT_GAMEPAD_BACK,              X360_HID_USB_INPUT_REPORT_BUTTON_BACK },
+    { XINPUT_GAMEPAD_START,             X360_HID_USB_INPUT_REPORT_BUTTON_START },
+    { XINPUT_GAMEPAD_LEFT_THUMB,        X360_HID_USB_INPUT_REPORT_BUTTON_LEFT_THUMB },
+    { XINPUT_GAMEPAD_RIGHT_THUMB,       X360_HID_USB_INPUT_REPORT_BUTTON_RIGHT_THUMB },
+};
+
+//
+// One field at a time with branches, the triggers recovered from the
+// shared Z axis only if one of them is overridden
+//
+static VOID X360ReportReference(
+    const XINPUT_PAD_STATE_INTERNAL* Pad,
+    PX360_HID_USB_INPUT_REPORT Report
+)
+{
+    ULONG   index;
+    USHORT  directions;
+    LONG    zAxis;
+    LONG    leftTrigger = 0;
+    LONG    rightTrigger = 0;
+
+    if (Pad->Overrides & XINPUT_GAMEPAD_OVERRIDE_LEFT_THUMB_X)
+        Report->LeftThumbX = (USHORT)(Pad->Gamepad.sThumbLX + X360_HID_USB_THUMB_AXIS_OFFSET);
+    if (Pad->Overrides & XINPUT_GAMEPAD_OVERRIDE_LEFT_THUMB_Y)
+        Report->LeftThumbY = (USHORT)(Pad->Gamepad.sThumbLY + X360_HID_USB_THUMB_AXIS_OFFSET);
+    if (Pad->Overrides & XINPUT_GAMEPAD_OVERRIDE_RIGHT_THUMB_X)
+        Report->RightThumbX = (USHORT)(Pad->Gamepad.sThumbRX + X360_HID_USB_THUMB_AXIS_OFFSET);
+    if (Pad->Overrides & XINPUT_GAMEPAD_OVERRIDE_RIGHT_THUMB_Y)
+        Report->RightThumbY = (USHORT)(Pad->Gamepad.sThumbRY + X360_HID_USB_THUMB_AXIS_OFFSET);
+
+    if (Pad->Overrides & (XINPUT_GAMEPAD_OVERRIDE_LEFT_TRIGGER | XINPUT_GAMEPAD_OVERRIDE_RIGHT_TRIGGER))
+    {
+        zAxis = (Report->ZAxis << 8 | Report->ZAxisEngaged) - X360_HID_USB_Z_AXIS_CENTER;
+
+        if (zAxis > 0)
+            leftTrigger = zAxis / X360_HID_USB_Z_AXIS_TRIGGER_SCALE;
+        else
+            rightTrigger = -zAxis / X360_HID_USB_Z_AXIS_TRIGGER_SCALE;
+
+        if (Pad->Overrides & XINPUT_GAMEPAD_OVERRIDE_LEFT_TRIGGER)
+            leftTrigger = Pad->Gamepad.bLeftTrigger;
+        if (Pad->Overrides & XINPUT_GAMEPAD_OVERRIDE_RIGHT_TRIGGER)
+            rightTrigger = Pad->Gamepad.bRightTrigger;
+
+        zAxis = X360_HID_USB_Z_AXIS_CENTER + (leftTrigger - rightTrigger) * X360_HID_USB_Z_AXIS_TRIGGER_SCALE;
+
+        Report->ZAxis = (UCHAR)(zAxis >> 8);
+        Report->ZAxisEngaged = (UCHAR)zAxis;
+    }
+
+    for (index = 0; index < ARRAYSIZE(X360ButtonMap); index++)
+    {
+        if (!(Pad->Overrides & X360ButtonMap[index][0]))
+            continue;
+
+        if (Pad->Gamepad.wButtons & X360ButtonMap[index][0])
+            Report->Buttons |= X360ButtonMap[index][1];
+        else
+            Report->Buttons &= ~X360ButtonMap[index][1];
+    }
+
+    if (Pad->Overrides & VIGEM_DPAD_MASK)
+    {
+        directions = VIGEM_XBONE_HAT_TO_DPAD_MASK[(Report->Buttons >> X360_HID_USB_DPAD_SHIFT) & VIGEM_DPAD_MASK];
+        directions = (USHORT)((directions & ~Pad->Overrides) | (Pad->Gamepad.wButtons & Pad->Overrides & VIGEM_DPAD_MASK));
+
+        Report->Buttons = (USHORT)((Report->Buttons & ~X360_HID_USB_DPAD_MASK)
+            | (VIGEM_DPAD_MASK_TO_XBONE_HAT[directions] << X360_HID_USB_DPAD_SHIFT));
+    }
+}
+
+//
+// A random report with a Z axis and HAT a pad can send
+//
+static VOID X360RandomReport(
+    PX360_HID_USB_INPUT_REPORT Report
+)
+{
+    LONG zAxis;
+
+    XnaTestRandomFill(Report, sizeof(*Report));
+
+    zAxis = X360_HID_USB_Z_AXIS_CENTER
+        + ((LONG)(XnaTestRandom() % 511) - UCHAR_MAX) * X360_HID_USB_Z_AXIS_TRIGGER_SCALE;
+
+    Report->ZAxis = (UCHAR)(zAxis >> 8);
+    Report->ZAxisEngaged = (UCHAR)zAxis;
+    Report->Buttons = (USHORT)((Report->Buttons & ~X360_HID_USB_DPAD_MASK)
+        | ((XnaTestRandom() % 9) << X360_HID_USB_DPAD_SHIFT));
+}
+
+static VOID X360Expect(
+    const XINPUT_PAD_STATE_INTERNAL* Pad,
+    const X360_HID_USB_INPUT_REPORT* Report
+)
+{
+    X360_HID_USB_INPUT_REPORT actual = *Report;
+    X360_HID_USB_INPUT_REPORT expected = *Report;
+
+    XINPUT_GAMEPAD_TO_X360_HID_USB_INPUT_REPORT((PXINPUT_PAD_STATE_INTERNAL)Pad, &actual);
+    X360ReportReference(Pad, &expected);
+
+    XNA_TEST_EXPECT(memcmp(&actual, &expected, sizeof(X360_HID_USB_INPUT_REPORT)) == 0);
+}
+
+//
+// The report layout and the thumb bias of Research/XUSB_XGIB_HID_USB_Notes.txt
+//
+static VOID TestLayout(
+    VOID
+)
+{
+    static const struct
+    {
+        SHORT   Value;
+        UCHAR   Bytes[2];
+
+    } thumbs[] = {
+        { 0,            { 0x00, 0x80 } },
+        { SHRT_MIN,     { 0x00, 0x00 } },
+        { SHRT_MAX,     { 0xFF, 0xFF } },
+        { -1,           { 0xFF, 0x7F } },
+        { 0x1234,       { 0x34, 0x92 } },
+    };
+    XINPUT_PAD_STATE_INTERNAL   pad;
+    X360_HID_USB_INPUT_REPORT   report;
+    PUCHAR                      bytes = (PUCHAR)&report;
+    XINPUT_GAMEPAD_STATE        gamepad;
+    ULONG                       index;
+
+    //
+    // The two trailing bytes of the report are not interpreted
+    //
+    C_ASSERT(sizeof(X360_HID_USB_INPUT_REPORT) == X360_HID_USB_INPUT_REPORT_BUFFER_LENGTH - 2);
+    C_ASSERT(FIELD_OFFSET(X360_HID_USB_INPUT_REPORT, LeftThumbY) == 2);
+    C_ASSERT(FIELD_OFFSET(X360_HID_USB_INPUT_REPORT, RightThumbX) == 4);
+    C_ASSERT(FIELD_OFFSET(X360_HID_USB_INPUT_REPORT, RightThumbY) == 6);
+    C_ASSERT(FIELD_OFFSET(X360_HID_USB_INPUT_REPORT, ZAxisEngaged) == 8);
+    C_ASSERT(FIELD_OFFSET(X360_HID_USB_INPUT_REPORT, ZAxis) == 9);
+    C_ASSERT(FIELD_OFFSET(X360_HID_USB_INPUT_REPORT, Buttons) == 10);
+    C_ASSERT(X360_HID_USB_THUMB_AXIS_OFFSET == 0x8000);
+
+    RtlZeroMemory(&pad, sizeof(pad));
+    pad.Overrides = XINPUT_GAMEPAD_OVERRIDE_LEFT_THUMB_X | XINPUT_GAMEPAD_OVERRIDE_LEFT_THUMB_Y
+        | XINPUT_GAMEPAD_OVERRIDE_RIGHT_THUMB_X | XINPUT_GAMEPAD_OVERRIDE_RIGHT_THUMB_Y;
+
+    for (index = 0; index < ARRAYSIZE(thumbs); index++)
+    {
+        pad.Gamepad.sThumbLX = thumbs[index].Value;
+        pad.Gamepad.sThumbLY = thumbs[index].Value;
+        pad.Gamepad.sThumbRX = thumbs[index].Value;
+        pad.Gamepad.sThumbRY = thumbs[index].Value;
+
+        RtlZeroMemory(&report, sizeof(report));
+        XINPUT_GAMEPAD_TO_X360_HID_USB_INPUT_REPORT(&pad, &report);
+
+        XNA_TEST_EXPECT(memcmp(&bytes[0], thumbs[index].Bytes, 2) == 0);
+        XNA_TEST_EXPECT(memcmp(&bytes[2], thumbs[index].Bytes, 2) == 0);
+        XNA_TEST_EXPECT(memcmp(&bytes[4], thumbs[index].Bytes, 2) == 0);
+        XNA_TEST_EXPECT(memcmp(&bytes[6], thumbs[index].Bytes, 2) == 0);
+
+        X360_HID_USB_INPUT_REPORT_TO_XINPUT_GAMEPAD(&report, &gamepad);
+        XNA_TEST_EXPECT(gamepad.sThumbLX == thumbs[index].Value && gamepad.sThumbRY == thumbs[index].Value);
+    }
+
+    //
+    // Full left and right trigger on the Z axis
+    //
+    pad.Overrides = XINPUT_GAMEPAD_OVERRIDE_LEFT_TRIGGER | XINPUT_GAMEPAD_OVERRIDE_RIGHT_TRIGGER;
+    pad.Gamepad.bLeftTrigger = UCHAR_MAX;
+    pad.Gamepad.bRightTrigger = 0;
+    XINPUT_GAMEPAD_TO_X360_HID_USB_INPUT_REPORT(&pad, &report);
+    XNA_TEST_EXPECT(bytes[8] == 0x80 && bytes[9] == 0xFF);
+
+    pad.Gamepad.bLeftTrigger = 0;
+    pad.Gamepad.bRightTrigger = UCHAR_MAX;
+    XINPUT_GAMEPAD_TO_X360_HID_USB_INPUT_REPORT(&pad, &report);
+    XNA_TEST_EXPECT(bytes[8] == 0x80 && bytes[9] == 0x00);
+}
+
+//
+// Either, both or neither trigger overridden over every Z axis position a
+// pad reports
+//
+static VOID TestTriggers(
+    VOID
+)
+{
+    static const XINPUT_GAMEPAD_OVERRIDES overrides[] = {
+        XINPUT_GAMEPAD_OVERRIDE_LEFT_TRIGGER,
+        XINPUT_GAMEPAD_OVERRIDE_RIGHT_TRIGGER,
+        XINPUT_GAMEPAD_OVERRIDE_LEFT_TRIGGER | XINPUT_GAMEPAD_OVERRIDE_RIGHT_TRIGGER,
+    };
+    XINPUT_PAD_STATE_INTERNAL   pad;
+    X360_HID_USB_INPUT_REPORT   report;
+    X360_HID_USB_INPUT_REPORT   original;
+    XINPUT_GAMEPAD_STATE        gamepad;
+    LONG                        zAxis;
+    ULONG                       index;
+    ULONG                       iteration;
+
+    RtlZeroMemory(&pad, sizeof(pad));
+
+    for (zAxis = X360_HID_USB_Z_AXIS_CENTER - UCHAR_MAX * X360_HID_USB_Z_AXIS_TRIGGER_SCALE;
+        zAxis <= X360_HID_USB_Z_AXIS_CENTER + UCHAR_MAX * X360_HID_USB_Z_AXIS_TRIGGER_SCALE;
+        zAxis += X360_HID_USB_Z_AXIS_TRIGGER_SCALE)
+    {
+        XnaTestRandomFill(&report, sizeof(report));
+        report.ZAxis = (UCHAR)(zAxis >> 8);
+        report.ZAxisEngaged = (UCHAR)zAxis;
+
+        for (index = 0; index < ARRAYSIZE(overrides); index++)
+        {
+            pad.Overrides = overrides[index];
+            pad.Gamepad.bLeftTrigger = (BYTE)XnaTestRandom();
+            pad.Gamepad.bRightTrigger = (BYTE)XnaTestRandom();
+
+            X360Expect(&pad, &report);
+
+            //
+            // With both overridden the Z axis carries their difference
+            //
+            original = report;
+            XINPUT_GAMEPAD_TO_X360_HID_USB_INPUT_REPORT(&pad, &original);
+            X360_HID_USB_INPUT_REPORT_TO_XINPUT_GAMEPAD(&original, &gamepad);
+
+            if (pad.Overrides == overrides[2])
+            {
+                XNA_TEST_EXPECT(gamepad.bLeftTrigger - gamepad.bRightTrigger
+                    == pad.Gamepad.bLeftTrigger - pad.Gamepad.bRightTrigger);
+            }
+        }
+    }
+
+    //
+    // Without a trigger override the Z axis stays bit-identical, even at
+    // positions between trigger steps
+    //
+    for (iteration = 0; iteration < 100000; iteration++)
+    {
+        XnaTestRandomPadState(&pad);
+        pad.Overrides &= ~(XINPUT_GAMEPAD_OVERRIDE_LEFT_TRIGGER | XINPUT_GAMEPAD_OVERRIDE_RIGHT_TRIGGER);
+
+        XnaTestRandomFill(&report, sizeof(report));
+        original = report;
+
+        XINPUT_GAMEPAD_TO_X360_HID_USB_INPUT_REPORT(&pad, &report);
+
+        XNA_TEST_EXPECT(report.ZAxis == original.ZAxis && report.ZAxisEngaged == original.ZAxisEngaged);
+    }
+
+    //
+    // Without any override the whole report stays bit-identical
+    //
+    RtlZeroMemory(&pad, sizeof(pad));
+
+    for (iteration = 0; iteration < 100000; iteration++)
+    {
+        XnaTestRandomFill(&pad.Gamepad, sizeof(pad.Gamepad));
+        XnaTestRandomFill(&report, sizeof(report));
+        original = report;
+
+        XINPUT_GAMEPAD_TO_X360_HID_USB_INPUT_REPORT(&pad, &report);
+
+        XNA_TEST_EXPECT(memcmp(&report, &original, sizeof(report)) == 0);
+    }
+}
+
+//
+// Every D-pad override and value over every HAT position
+//
+static VOID TestDpad(
+    VOID
+)
+{
+    XINPUT_PAD_STATE_INTERNAL   pad;
+    X360_HID_USB_INPUT_REPORT   report;
+    ULONG                       hat;
+    ULONG                       mask;
+    ULONG                       value;
+
+    RtlZeroMemory(&pad, sizeof(pad));
+
+    for (hat = 0; hat < 16; hat++)
+    {
+        for (mask = 0; mask <= VIGEM_DPAD_MASK; mask++)
+        {
+            for (value = 0; value <= VIGEM_DPAD_MASK; value++)
+            {
+                XnaTestRandomFill(&report, sizeof(report));
+                report.Buttons = (USHORT)((report.Buttons & ~X360_HID_USB_DPAD_MASK) | (hat << X360_HID_USB_DPAD_SHIFT));
+
+                pad.Overrides = (XINPUT_GAMEPAD_OVERRIDES)mask;
+                pad.Gamepad.wButtons = (USHORT)(value | (XnaTestRandom() & ~VIGEM_DPAD_MASK));
+
+                X360Expect(&pad, &report);
+            }
+        }
+    }
+}
+
+//
+// Random pad states applied to random reports
+//
+static VOID TestFuzz(
+    VOID
+)
+{
+    XINPUT_PAD_STATE_INTERNAL   pad;
+    X360_HID_USB_INPUT_REPORT   report;
+    ULONG                       iteration;
+
+    for (iteration = 0; iteration < 1000000; iteration++)
+    {
+        XnaTestRandomPadState(&pad);
+        X360RandomReport(&report);
+
+        X360Expect(&pad, &report);
+    }
+}
+
+//
+// Reports are dispatched by length, other lengths are left untouched
+//
+static VOID TestDispatch(
+    VOID
+)
+{
+    XINPUT_PAD_STATE_INTERNAL   pad;
+    UCHAR                       buffer[0x40];
+    UCHAR                       expected[0x40];
+    ULONG                       length;
+
+    for (length = 0; length <= sizeof(buffer); length++)
+    {
+        XnaTestRandomPadState(&pad);
+        XnaTestRandomFill(buffer, sizeof(buffer));
+        RtlCopyMemory(expected, buffer, sizeof(buffer));
+
+        if (length == X360_HID_USB_INPUT_REPORT_BUFFER_LENGTH)
+            XINPUT_GAMEPAD_TO_X360_HID_USB_INPUT_REPORT(&pad, (PX360_HID_USB_INPUT_REPORT)expected);
+        else if (length == XBONE_HID_USB_INPUT_REPORT_BUFFER_LENGTH)
+            XINPUT_GAMEPAD_TO_XBONE_HID_USB_INPUT_REPORT(&pad, (PXBONE_HID_USB_INPUT_REPORT)expected);
+
+        XINPUT_GAMEPAD_TO_HID_USB_INPUT_REPORT(&pad, buffer, length);
+
+        XNA_TEST_EXPECT(memcmp(buffer, expected, sizeof(buffer)) == 0);
+    }
+}
+
+int main(
+    VOID
+)
+{
+    TestLayout();
+    TestTriggers();
+    TestDpad();
+    TestFuzz();
+    TestDispatch();
+
+    return XNA_TEST_RESULT();
+}
@@ -0,0 +1,209 @@
+/*
+MIT License
+
+Copyright (c) 2017 Benjamin "Nefarius" Hglinger
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#include "HidUsbTest.h"
+
+//
+// XInput buttons and their XBONE HID USB counterparts
+//
+static const USHORT XboneButtonMap[][2] = {
+    { XINPUT_GAMEPAD_A,                 XBONE_HID_USB_INPUT_REPORT_BUTTON_A },
+    { XINPUT_GAMEPAD_B,                 XBONE_HID_USB_INPUT_REPORT_BUTTON_B },
+    { XINPUT_GAMEPAD_X,                 XBONE_HID_USB_INPUT_REPORT_BUTTON_X },
+    { XINPUT_GAMEPAD_Y,                 XBONE_HID_USB_INPUT_REPORT_BUTTON_Y },
+    { XINPUT_GAMEPAD_LEFT_SHOULDER,     XBONE_HID_USB_INPUT_REPORT_BUTTON_LEFT_SHOULDER },
+    { XINPUT_GAMEPAD_RIGHT_SHOULDER,    XBONE_HID_USB_INPUT_REPORT_BUTTON_RIGHT_SHOULDER },
+    { XINPUT_GAMEPAD_START,             XBONE_HID_USB_INPUT_REPORT_BUTTON_START },
+    { XINPUT_GAMEPAD_BACK,              XBONE_HID_USB_INPUT_REPORT_BUTTON_BACK },
+    { XINPUT_GAMEPAD_LEFT_THUMB,        XBONE_HID_USB_INPUT_REPORT_BUTTON_LEFT_THUMB },
+    { XINPUT_GAMEPAD_RIGHT_THUMB,       XBONE_HID_USB_INPUT_REPORT_BUTTON_RIGHT_THUMB },
+};
+
+//
+// One field at a time, the way the overrides were applied before the
+// table-driven merge
+//
+static VOID XboneReportReference(
+    const XINPUT_PAD_STATE_INTERNAL* Pad,
+    PXBONE_HID_USB_INPUT_REPORT Report
+)
+{
+    ULONG   index;
+    USHORT  directions;
+
+    if (Pad->Overrides & XINPUT_GAMEPAD_OVERRIDE_LEFT_THUMB_X)
+        Report->LeftThumbX = (USHORT)(Pad->Gamepad.sThumbLX + XBONE_HID_USB_THUMB_AXIS_OFFSET);
+    if (Pad->Overrides & XINPUT_GAMEPAD_OVERRIDE_LEFT_THUMB_Y)
+        Report->LeftThumbY = (USHORT)(Pad->Gamepad.sThumbLY + XBONE_HID_USB_THUMB_AXIS_OFFSET);
+    if (Pad->Overrides & XINPUT_GAMEPAD_OVERRIDE_RIGHT_THUMB_X)
+        Report->RightThumbX = (USHORT)(Pad->Gamepad.sThumbRX + XBONE_HID_USB_THUMB_AXIS_OFFSET);
+    if (Pad->Overrides & XINPUT_GAMEPAD_OVERRIDE_RIGHT_THUMB_Y)
+        Report->RightThumbY = (USHORT)(Pad->Gamepad.sThumbRY + XBONE_HID_USB_THUMB_AXIS_OFFSET);
+
+    if (Pad->Overrides & XINPUT_GAMEPAD_OVERRIDE_LEFT_TRIGGER)
+        Report->LeftTrigger = Pad->LeftTrigger;
+    if (Pad->Overrides & XINPUT_GAMEPAD_OVERRIDE_RIGHT_TRIGGER)
+        Report->RightTrigger = Pad->RightTrigger;
+
+    for (index = 0; index < sizeof(XboneButtonMap) / sizeof(XboneButtonMap[0]); index++)
+    {
+        if (!(Pad->Overrides & XboneButtonMap[index][0]))
+            continue;
+
+        if (Pad->Gamepad.wButtons & XboneButtonMap[index][0])
+            Report->Buttons |= XboneButtonMap[index][1];
+        else
+            Report->Buttons &= ~XboneButtonMap[index][1];
+    }
+
+    if (Pad->Overrides & VIGEM_DPAD_MASK)
+    {
+        directions = VIGEM_XBONE_HAT_TO_DPAD_MASK[Report->Dpad & VIGEM_DPAD_MASK];
+        directions = (USHORT)((directions & ~Pad->Overrides) | (Pad->Gamepad.wButtons & Pad->Overrides & VIGEM_DPAD_MASK));
+
+        Report->Dpad = VIGEM_DPAD_MASK_TO_XBONE_HAT[directions];
+    }
+}
+
+//
+// Random pad states applied to random reports
+//
+static VOID TestFuzz(
+    VOID
+)
+{
+    XINPUT_PAD_STATE_INTERNAL   pad;
+    XBONE_HID_USB_INPUT_REPORT  actual;
+    XBONE_HID_USB_INPUT_REPORT  expected;
+    ULONG                       iteration;
+
+    for (iteration = 0; iteration < 1000000; iteration++)
+    {
+        XnaTestRandomPadState(&pad);
+
+        XnaTestRandomFill(&actual, sizeof(actual));
+        expected = actual;
+
+        XINPUT_GAMEPAD_TO_XBONE_HID_USB_INPUT_REPORT(&pad, &actual);
+        XboneReportReference(&pad, &expected);
+
+        XNA_TEST_EXPECT(memcmp(&actual, &expected, sizeof(XBONE_HID_USB_INPUT_REPORT)) == 0);
+    }
+}
+
+//
+// Every button value under every single button override
+//
+static VOID TestButtons(
+    VOID
+)
+{
+    XINPUT_PAD_STATE_INTERNAL   pad;
+    XBONE_HID_USB_INPUT_REPORT  actual;
+    XBONE_HID_USB_INPUT_REPORT  expected;
+    ULONG                       buttons;
+    ULONG                       bit;
+
+    RtlZeroMemory(&pad, sizeof(pad));
+
+    for (buttons = 0; buttons <= USHRT_MAX; buttons++)
+    {
+        for (bit = 0; bit < 16; bit++)
+        {
+            pad.Gamepad.wButtons = (USHORT)buttons;
+            pad.Overrides = (XINPUT_GAMEPAD_OVERRIDES)(1UL << bit);
+
+            XnaTestRandomFill(&actual, sizeof(actual));
+            expected = actual;
+
+            XINPUT_GAMEPAD_TO_XBONE_HID_USB_INPUT_REPORT(&pad, &actual);
+            XboneReportReference(&pad, &expected);
+
+            XNA_TEST_EXPECT(memcmp(&actual, &expected, sizeof(XBONE_HID_USB_INPUT_REPORT)) == 0);
+        }
+    }
+}
+
+#define BENCH_COUNT 4096
+
+static XINPUT_PAD_STATE_INTERNAL    BenchPads[BENCH_COUNT];
+static XBONE_HID_USB_INPUT_REPORT   BenchReports[BENCH_COUNT];
+
+static VOID Bench(
+    VOID
+)
+{
+    const ULONG iterations = 4000;
+    ULONG       iteration;
+    ULONG       index;
+    double      start;
+
+    for (index = 0; index < BENCH_COUNT; index++)
+    {
+        XnaTestRandomPadState(&BenchPads[index]);
+    }
+
+    start = XnaTestNow();
+
+    for (iteration = 0; iteration < iterations; iteration++)
+    {
+        for (index = 0; index < BENCH_COUNT; index++)
+        {
+            XboneReportReference(&BenchPads[index], &BenchReports[index]);
+        }
+
+        XNA_TEST_CONSUME(BenchReports, sizeof(BenchReports));
+    }
+
+    XnaTestReport("XBONE overrides (branching reference)", (double)iterations * BENCH_COUNT, XnaTestNow() - start);
+
+    start = XnaTestNow();
+
+    for (iteration = 0; iteration < iterations; iteration++)
+    {
+        for (index = 0; index < BENCH_COUNT; index++)
+        {
+            XINPUT_GAMEPAD_TO_XBONE_HID_USB_INPUT_REPORT(&BenchPads[index], &BenchReports[index]);
+        }
+
+        XNA_TEST_CONSUME(BenchReports, sizeof(BenchReports));
+    }
+
+    XnaTestReport("XINPUT_GAMEPAD_TO_XBONE_HID_USB_INPUT_REPORT", (double)iterations * BENCH_COUNT, XnaTestNow() - start);
+}
+
+int main(
+    int argc,
+    char** argv
+)
+{
+    TestFuzz();
+    TestButtons();
+
+    if (XnaTestBenchEnabled(argc, argv))
+        Bench();
+
+    return XNA_TEST_RESULT();
+}
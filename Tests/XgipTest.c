@@ -0,0 +1,232 @@
+/*
+MIT License
+
+Copyright (c) 2017 Benjamin "Nefarius" Hglinger
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#include "XnaTest.h"
+#include "ViGEmUtil.h"
+
+//
+// XUSB buttons and their GIP counterparts, the byte is 1 or 2
+//
+static const struct
+{
+    USHORT  Xusb;
+    UCHAR   Byte;
+    UCHAR   Xgip;
+
+} XgipButtonMap[] = {
+    { XUSB_GAMEPAD_START,           1, XGIP_BUTTON1_MENU },
+    { XUSB_GAMEPAD_BACK,            1, XGIP_BUTTON1_VIEW },
+    { XUSB_GAMEPAD_A,               1, XGIP_BUTTON1_A },
+    { XUSB_GAMEPAD_B,               1, XGIP_BUTTON1_B },
+    { XUSB_GAMEPAD_X,               1, XGIP_BUTTON1_X },
+    { XUSB_GAMEPAD_Y,               1, XGIP_BUTTON1_Y },
+    { XUSB_GAMEPAD_DPAD_UP,         2, XGIP_BUTTON2_DPAD_UP },
+    { XUSB_GAMEPAD_DPAD_DOWN,       2, XGIP_BUTTON2_DPAD_DOWN },
+    { XUSB_GAMEPAD_DPAD_LEFT,       2, XGIP_BUTTON2_DPAD_LEFT },
+    { XUSB_GAMEPAD_DPAD_RIGHT,      2, XGIP_BUTTON2_DPAD_RIGHT },
+    { XUSB_GAMEPAD_LEFT_SHOULDER,   2, XGIP_BUTTON2_SHOULDER_LEFT },
+    { XUSB_GAMEPAD_RIGHT_SHOULDER,  2, XGIP_BUTTON2_SHOULDER_RIGHT },
+    { XUSB_GAMEPAD_LEFT_THUMB,      2, XGIP_BUTTON2_THUMB_LEFT },
+    { XUSB_GAMEPAD_RIGHT_THUMB,     2, XGIP_BUTTON2_THUMB_RIGHT },
+};
+
+#define XGIP_BUTTON_MAP_COUNT   (sizeof(XgipButtonMap) / sizeof(XgipButtonMap[0]))
+
+//
+// Every button combination, one button at a time against the map. GUIDE
+// and the unused bit 0x0800 are dropped.
+//
+static VOID TestButtons(
+    VOID
+)
+{
+    XUSB_REPORT xusb;
+    XUSB_REPORT roundTrip;
+    XGIP_REPORT xgip;
+    UCHAR       buttons1;
+    UCHAR       buttons2;
+    ULONG       buttons;
+    ULONG       index;
+
+    for (buttons = 0; buttons <= USHRT_MAX; buttons++)
+    {
+        XUSB_REPORT_INIT(&xusb);
+        xusb.wButtons = (USHORT)buttons;
+
+        buttons1 = 0;
+        buttons2 = 0;
+
+        for (index = 0; index < XGIP_BUTTON_MAP_COUNT; index++)
+        {
+            if (!(buttons & XgipButtonMap[index].Xusb))
+                continue;
+
+            if (XgipButtonMap[index].Byte == 1)
+                buttons1 |= XgipButtonMap[index].Xgip;
+            else
+                buttons2 |= XgipButtonMap[index].Xgip;
+        }
+
+        XUSB_TO_XGIP_REPORT(&xusb, &xgip);
+        XGIP_TO_XUSB_REPORT(&xgip, &roundTrip);
+
+        XNA_TEST_EXPECT(xgip.Buttons1 == buttons1);
+        XNA_TEST_EXPECT(xgip.Buttons2 == buttons2);
+        XNA_TEST_EXPECT(roundTrip.wButtons == (buttons & ~(XUSB_GAMEPAD_GUIDE | 0x0800)));
+    }
+}
+
+//
+// 8-bit triggers survive the round trip, 10-bit ones are clamped and
+// rounded to the nearest 8-bit value
+//
+static VOID TestTriggers(
+    VOID
+)
+{
+    XUSB_REPORT xusb;
+    XUSB_REPORT result;
+    XGIP_REPORT xgip;
+    LONG        value;
+    LONG        clamped;
+
+    XUSB_REPORT_INIT(&xusb);
+
+    for (value = 0; value <= UCHAR_MAX; value++)
+    {
+        xusb.bLeftTrigger = (BYTE)value;
+        xusb.bRightTrigger = (BYTE)(UCHAR_MAX - value);
+
+        XUSB_TO_XGIP_REPORT(&xusb, &xgip);
+        XGIP_TO_XUSB_REPORT(&xgip, &result);
+
+        XNA_TEST_EXPECT(xgip.LeftTrigger == (value * 1023 + 127) / 255);
+        XNA_TEST_EXPECT(result.bLeftTrigger == value);
+        XNA_TEST_EXPECT(result.bRightTrigger == UCHAR_MAX - value);
+    }
+
+    RtlZeroMemory(&xgip, sizeof(xgip));
+
+    for (value = -2048; value <= 2048; value++)
+    {
+        xgip.LeftTrigger = (SHORT)value;
+        xgip.RightTrigger = (SHORT)-value;
+
+        XGIP_TO_XUSB_REPORT(&xgip, &result);
+
+        clamped = (value < 0) ? 0 : (value > 1023) ? 1023 : value;
+        XNA_TEST_EXPECT(result.bLeftTrigger == (clamped * 255 + 511) / 1023);
+
+        clamped = (-value < 0) ? 0 : (-value > 1023) ? 1023 : -value;
+        XNA_TEST_EXPECT(result.bRightTrigger == (clamped * 255 + 511) / 1023);
+    }
+}
+
+#define BATCH_COUNT 4096
+
+static XUSB_REPORT  BatchXusb[BATCH_COUNT];
+static XUSB_REPORT  BatchXusbResult[BATCH_COUNT];
+static XGIP_REPORT  BatchXgip[BATCH_COUNT];
+static XGIP_REPORT  BatchXgipExpected[BATCH_COUNT];
+
+//
+// Random reports through the batch entry points, thumbs pass unchanged
+//
+static VOID TestBatch(
+    VOID
+)
+{
+    ULONG index;
+
+    XnaTestRandomFill(BatchXusb, sizeof(BatchXusb));
+
+    for (index = 0; index < BATCH_COUNT; index++)
+    {
+        XUSB_TO_XGIP_REPORT(&BatchXusb[index], &BatchXgipExpected[index]);
+    }
+
+    XUSB_TO_XGIP_REPORT_BATCH(BatchXusb, BatchXgip, BATCH_COUNT);
+    XGIP_TO_XUSB_REPORT_BATCH(BatchXgip, BatchXusbResult, BATCH_COUNT);
+
+    XNA_TEST_EXPECT(memcmp(BatchXgip, BatchXgipExpected, sizeof(BatchXgip)) == 0);
+
+    for (index = 0; index < BATCH_COUNT; index++)
+    {
+        XNA_TEST_EXPECT(BatchXusbResult[index].sThumbLX == BatchXusb[index].sThumbLX);
+        XNA_TEST_EXPECT(BatchXusbResult[index].sThumbLY == BatchXusb[index].sThumbLY);
+        XNA_TEST_EXPECT(BatchXusbResult[index].sThumbRX == BatchXusb[index].sThumbRX);
+        XNA_TEST_EXPECT(BatchXusbResult[index].sThumbRY == BatchXusb[index].sThumbRY);
+        XNA_TEST_EXPECT(BatchXusbResult[index].bLeftTrigger == BatchXusb[index].bLeftTrigger);
+        XNA_TEST_EXPECT(BatchXusbResult[index].bRightTrigger == BatchXusb[index].bRightTrigger);
+    }
+}
+
+static VOID Bench(
+    VOID
+)
+{
+    const ULONG iterations = 4000;
+    ULONG       iteration;
+    double      start;
+
+    XnaTestRandomFill(BatchXusb, sizeof(BatchXusb));
+
+    start = XnaTestNow();
+
+    for (iteration = 0; iteration < iterations; iteration++)
+    {
+        XUSB_TO_XGIP_REPORT_BATCH(BatchXusb, BatchXgip, BATCH_COUNT);
+
+        XNA_TEST_CONSUME(BatchXgip, sizeof(BatchXgip));
+    }
+
+    XnaTestReport("XUSB_TO_XGIP_REPORT_BATCH", (double)iterations * BATCH_COUNT, XnaTestNow() - start);
+
+    start = XnaTestNow();
+
+    for (iteration = 0; iteration < iterations; iteration++)
+    {
+        XGIP_TO_XUSB_REPORT_BATCH(BatchXgip, BatchXusbResult, BATCH_COUNT);
+
+        XNA_TEST_CONSUME(BatchXusbResult, sizeof(BatchXusbResult));
+    }
+
+    XnaTestReport("XGIP_TO_XUSB_REPORT_BATCH", (double)iterations * BATCH_COUNT, XnaTestNow() - start);
+}
+
+int main(
+    int argc,
+    char** argv
+)
+{
+    TestButtons();
+    TestTriggers();
+    TestBatch();
+
+    if (XnaTestBenchEnabled(argc, argv))
+        Bench();
+
+    return XNA_TEST_RESULT();
+}
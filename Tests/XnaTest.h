@@ -0,0 +1,226 @@
+/*
+MIT License
+
+Copyright (c) 2017 Benjamin "Nefarius" Hglinger
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#pragma once
+
+//
+// Minimal harness for the portable headers under Include. Every test is a
+// single translation unit built by CMakeLists.txt and run through CTest,
+// it returns non-zero if any expectation failed. Passing --bench also runs
+// the benchmarks of a test.
+//
+
+#ifdef _WIN32
+#include <Windows.h>
+#include <Xinput.h>
+#else
+#include "XnaTestWin.h"
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static ULONG XnaTestFailures;
+
+//
+// Counts a failed expectation, only the first few are printed
+//
+#define XNA_TEST_EXPECT(_expr_)                                                 \
+    do                                                                          \
+    {                                                                           \
+        if (!(_expr_))                                                          \
+        {                                                                       \
+            if (XnaTestFailures++ < 16)                                         \
+                fprintf(stderr, "%s(%d): expected %s\n", __FILE__, __LINE__, #_expr_); \
+        }                                                                       \
+    } while (0)
+
+//
+// Exit code of a test, prints the number of failed expectations
+//
+#define XNA_TEST_RESULT()   (printf("%lu failure(s)\n", (unsigned long)XnaTestFailures), XnaTestFailures != 0)
+
+//
+// Deterministic pseudo random numbers (xorshift64)
+//
+static ULONGLONG XnaTestRandomState = 88172645463325252ULL;
+
+static ULONG XnaTestRandom(
+    VOID
+)
+{
+    XnaTestRandomState ^= XnaTestRandomState << 13;
+    XnaTestRandomState ^= XnaTestRandomState >> 7;
+    XnaTestRandomState ^= XnaTestRandomState << 17;
+
+    return (ULONG)(XnaTestRandomState >> 16);
+}
+
+static VOID XnaTestRandomFill(
+    PVOID Buffer,
+    size_t Length
+)
+{
+    size_t index;
+
+    for (index = 0; index < Length; index++)
+    {
+        ((PUCHAR)Buffer)[index] = (UCHAR)XnaTestRandom();
+    }
+}
+
+//
+// TRUE if the benchmarks were requested on the command line
+//
+static BOOLEAN XnaTestBenchEnabled(
+    int argc,
+    char** argv
+)
+{
+    int index;
+
+    for (index = 1; index < argc; index++)
+    {
+        if (strcmp(argv[index], "--bench") == 0)
+            return TRUE;
+    }
+
+    return FALSE;
+}
+
+//
+// Wall clock time in seconds
+//
+static double XnaTestNow(
+    VOID
+)
+{
+    struct timespec now;
+
+    timespec_get(&now, TIME_UTC);
+
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+//
+// Keeps the compiler from discarding the results of a benchmark loop
+//
+static volatile ULONG XnaTestSink;
+
+#define XNA_TEST_CONSUME(_buffer_, _length_)    (XnaTestSink += ((const UCHAR*)(_buffer_))[(_length_) - 1])
+
+//
+// Threads of the stress tests
+//
+typedef VOID(*XNA_TEST_THREAD_ROUTINE)(PVOID Context);
+
+typedef struct _XNA_TEST_THREAD
+{
+    XNA_TEST_THREAD_ROUTINE Routine;
+    PVOID                   Context;
+#ifdef _WIN32
+    HANDLE                  Handle;
+#else
+    pthread_t               Handle;
+#endif
+
+} XNA_TEST_THREAD, *PXNA_TEST_THREAD;
+
+#ifdef _WIN32
+static DWORD WINAPI XnaTestThreadMain(
+    LPVOID Parameter
+)
+#else
+static PVOID XnaTestThreadMain(
+    PVOID Parameter
+)
+#endif
+{
+    PXNA_TEST_THREAD thread = (PXNA_TEST_THREAD)Parameter;
+
+    thread->Routine(thread->Context);
+
+    return 0;
+}
+
+static VOID XnaTestThreadStart(
+    PXNA_TEST_THREAD Thread,
+    XNA_TEST_THREAD_ROUTINE Routine,
+    PVOID Context
+)
+{
+    Thread->Routine = Routine;
+    Thread->Context = Context;
+
+#ifdef _WIN32
+    Thread->Handle = CreateThread(NULL, 0, XnaTestThreadMain, Thread, 0, NULL);
+    XNA_TEST_EXPECT(Thread->Handle != NULL);
+#else
+    XNA_TEST_EXPECT(pthread_create(&Thread->Handle, NULL, XnaTestThreadMain, Thread) == 0);
+#endif
+}
+
+static VOID XnaTestThreadJoin(
+    PXNA_TEST_THREAD Thread
+)
+{
+#ifdef _WIN32
+    WaitForSingleObject(Thread->Handle, INFINITE);
+    CloseHandle(Thread->Handle);
+#else
+    pthread_join(Thread->Handle, NULL);
+#endif
+}
+
+//
+// Gives up the processor, spinning threads would otherwise starve the
+// thread they wait for on machines with few processors
+//
+static VOID XnaTestThreadYield(
+    VOID
+)
+{
+#ifdef _WIN32
+    SwitchToThread();
+#else
+    sched_yield();
+#endif
+}
+
+//
+// Prints the throughput of Count operations that took Seconds
+//
+static VOID XnaTestReport(
+    const char* Name,
+    double Count,
+    double Seconds
+)
+{
+    printf("%-46s %10.1f M/s\n", Name, Count / Seconds / 1e6);
+}
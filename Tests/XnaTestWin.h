@@ -0,0 +1,117 @@
+/*
+MIT License
+
+Copyright (c) 2017 Benjamin "Nefarius" Hglinger
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#pragma once
+
+//
+// The subset of the Windows and WDK definitions used by the portable
+// headers, so the tests also build with GCC and Clang on other hosts.
+//
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <limits.h>
+
+typedef void            VOID, *PVOID;
+typedef char            CHAR;
+typedef int             BOOL;
+typedef uint8_t         BYTE, UCHAR, BOOLEAN, *PUCHAR;
+typedef int16_t         SHORT, *PSHORT;
+typedef uint16_t        USHORT, WORD, *PUSHORT;
+typedef int32_t         LONG;
+typedef uint32_t        ULONG, DWORD, *PULONG;
+typedef int64_t         LONGLONG;
+typedef uint64_t        ULONGLONG, *PULONGLONG;
+typedef uintptr_t       ULONG_PTR;
+typedef size_t          SIZE_T;
+
+#define TRUE            1
+#define FALSE           0
+
+#define IN
+#define OUT
+
+#define FORCEINLINE     static inline __attribute__((always_inline))
+
+#define C_ASSERT(_e_)                       _Static_assert(_e_, #_e_)
+#define FIELD_OFFSET(_type_, _field_)       offsetof(_type_, _field_)
+#define UNREFERENCED_PARAMETER(_p_)         ((void)(_p_))
+
+#define RtlZeroMemory(_d_, _l_)             memset((_d_), 0, (_l_))
+#define RtlCopyMemory(_d_, _s_, _l_)        memcpy((_d_), (_s_), (_l_))
+#define RtlFillMemory(_d_, _l_, _f_)        memset((_d_), (_f_), (_l_))
+#define RtlEqualMemory(_a_, _b_, _l_)       (memcmp((_a_), (_b_), (_l_)) == 0)
+
+#define ARRAYSIZE(_a_)                      (sizeof(_a_) / sizeof((_a_)[0]))
+
+#ifndef min
+#define min(_a_, _b_)                       (((_a_) < (_b_)) ? (_a_) : (_b_))
+#define max(_a_, _b_)                       (((_a_) > (_b_)) ? (_a_) : (_b_))
+#endif
+
+#define TEXT(_x_)                           _x_
+
+#define CTL_CODE(_type_, _function_, _method_, _access_) \
+    (((_type_) << 16) | ((_access_) << 14) | ((_function_) << 2) | (_method_))
+
+#define METHOD_BUFFERED                     0
+#define FILE_ANY_ACCESS                     0
+#define FILE_READ_DATA                      1
+#define FILE_WRITE_DATA                     2
+#define FILE_DEVICE_BUS_EXTENDER            0x2A
+
+#define DEFINE_GUID(_name_, ...)            extern const int _name_##_unused
+
+//
+// SAL annotations
+//
+#define _In_
+#define _In_opt_
+#define _Out_
+#define _Inout_
+#define _In_reads_(_n_)
+#define _In_reads_bytes_(_n_)
+#define _Out_writes_(_n_)
+#define _Out_writes_bytes_(_n_)
+#define _Inout_updates_(_n_)
+#define _Inout_updates_bytes_(_n_)
+
+//
+// Interlocked operations and barriers, all full barriers like on Windows
+//
+#define InterlockedIncrement(_p_)                       __atomic_add_fetch((_p_), 1, __ATOMIC_SEQ_CST)
+#define InterlockedDecrement(_p_)                       __atomic_sub_fetch((_p_), 1, __ATOMIC_SEQ_CST)
+#define InterlockedExchange(_p_, _v_)                   __atomic_exchange_n((_p_), (_v_), __ATOMIC_SEQ_CST)
+#define InterlockedCompareExchange(_p_, _v_, _c_)       __sync_val_compare_and_swap((_p_), (_c_), (_v_))
+#define InterlockedExchangePointer(_p_, _v_)            __atomic_exchange_n((_p_), (_v_), __ATOMIC_SEQ_CST)
+#define InterlockedCompareExchangePointer(_p_, _v_, _c_) __sync_val_compare_and_swap((_p_), (_c_), (_v_))
+#define MemoryBarrier()                                 __atomic_thread_fence(__ATOMIC_SEQ_CST)
+
+#if defined(__x86_64__) || defined(__i386__)
+#define YieldProcessor()                                __builtin_ia32_pause()
+#else
+#define YieldProcessor()                                __atomic_signal_fence(__ATOMIC_SEQ_CST)
+#endif
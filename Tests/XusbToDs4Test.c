@@ -0,0 +1,219 @@
+/*
+MIT License
+
+Copyright (c) 2017 Benjamin "Nefarius" Hglinger
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#include "XnaTest.h"
+#include "ViGEmUtil.h"
+
+//
+// The branching conversion XUSB_TO_DS4_REPORT replaced, kept as reference
+//
+static VOID XusbToDs4ReportReference(
+    const XUSB_REPORT* Input,
+    PDS4_REPORT Output
+)
+{
+    if (Input->wButtons & XUSB_GAMEPAD_BACK) Output->wButtons |= DS4_BUTTON_SHARE;
+    if (Input->wButtons & XUSB_GAMEPAD_START) Output->wButtons |= DS4_BUTTON_OPTIONS;
+    if (Input->wButtons & XUSB_GAMEPAD_LEFT_THUMB) Output->wButtons |= DS4_BUTTON_THUMB_LEFT;
+    if (Input->wButtons & XUSB_GAMEPAD_RIGHT_THUMB) Output->wButtons |= DS4_BUTTON_THUMB_RIGHT;
+    if (Input->wButtons & XUSB_GAMEPAD_LEFT_SHOULDER) Output->wButtons |= DS4_BUTTON_SHOULDER_LEFT;
+    if (Input->wButtons & XUSB_GAMEPAD_RIGHT_SHOULDER) Output->wButtons |= DS4_BUTTON_SHOULDER_RIGHT;
+    if (Input->wButtons & XUSB_GAMEPAD_GUIDE) Output->bSpecial |= DS4_SPECIAL_BUTTON_PS;
+    if (Input->wButtons & XUSB_GAMEPAD_A) Output->wButtons |= DS4_BUTTON_CROSS;
+    if (Input->wButtons & XUSB_GAMEPAD_B) Output->wButtons |= DS4_BUTTON_CIRCLE;
+    if (Input->wButtons & XUSB_GAMEPAD_X) Output->wButtons |= DS4_BUTTON_SQUARE;
+    if (Input->wButtons & XUSB_GAMEPAD_Y) Output->wButtons |= DS4_BUTTON_TRIANGLE;
+
+    Output->bTriggerL = Input->bLeftTrigger;
+    Output->bTriggerR = Input->bRightTrigger;
+
+    if (Input->bLeftTrigger > 0) Output->wButtons |= DS4_BUTTON_TRIGGER_LEFT;
+    if (Input->bRightTrigger > 0) Output->wButtons |= DS4_BUTTON_TRIGGER_RIGHT;
+
+    if (Input->wButtons & XUSB_GAMEPAD_DPAD_UP) DS4_SET_DPAD(Output, DS4_BUTTON_DPAD_NORTH);
+    if (Input->wButtons & XUSB_GAMEPAD_DPAD_RIGHT) DS4_SET_DPAD(Output, DS4_BUTTON_DPAD_EAST);
+    if (Input->wButtons & XUSB_GAMEPAD_DPAD_DOWN) DS4_SET_DPAD(Output, DS4_BUTTON_DPAD_SOUTH);
+    if (Input->wButtons & XUSB_GAMEPAD_DPAD_LEFT) DS4_SET_DPAD(Output, DS4_BUTTON_DPAD_WEST);
+
+    if (Input->wButtons & XUSB_GAMEPAD_DPAD_UP
+        && Input->wButtons & XUSB_GAMEPAD_DPAD_RIGHT) DS4_SET_DPAD(Output, DS4_BUTTON_DPAD_NORTHEAST);
+    if (Input->wButtons & XUSB_GAMEPAD_DPAD_RIGHT
+        && Input->wButtons & XUSB_GAMEPAD_DPAD_DOWN) DS4_SET_DPAD(Output, DS4_BUTTON_DPAD_SOUTHEAST);
+    if (Input->wButtons & XUSB_GAMEPAD_DPAD_DOWN
+        && Input->wButtons & XUSB_GAMEPAD_DPAD_LEFT) DS4_SET_DPAD(Output, DS4_BUTTON_DPAD_SOUTHWEST);
+    if (Input->wButtons & XUSB_GAMEPAD_DPAD_LEFT
+        && Input->wButtons & XUSB_GAMEPAD_DPAD_UP) DS4_SET_DPAD(Output, DS4_BUTTON_DPAD_NORTHWEST);
+
+    Output->bThumbLX = (BYTE)((Input->sThumbLX + ((USHRT_MAX / 2) + 1)) / 257);
+    Output->bThumbLY = (BYTE)(-(Input->sThumbLY + ((USHRT_MAX / 2) - 1)) / 257);
+    Output->bThumbLY = (Output->bThumbLY == 0) ? 0xFF : Output->bThumbLY;
+    Output->bThumbRX = (BYTE)((Input->sThumbRX + ((USHRT_MAX / 2) + 1)) / 257);
+    Output->bThumbRY = (BYTE)(-(Input->sThumbRY + ((USHRT_MAX / 2) + 1)) / 257);
+    Output->bThumbRY = (Output->bThumbRY == 0) ? 0xFF : Output->bThumbRY;
+}
+
+//
+// Every button combination, with and without triggers, merged into a fresh
+// and into a random previous report
+//
+static VOID TestButtons(
+    VOID
+)
+{
+    XUSB_REPORT input;
+    DS4_REPORT  actual;
+    DS4_REPORT  expected;
+    ULONG       buttons;
+    ULONG       variant;
+
+    for (buttons = 0; buttons <= USHRT_MAX; buttons++)
+    {
+        for (variant = 0; variant < 3; variant++)
+        {
+            XnaTestRandomFill(&input, sizeof(input));
+            input.wButtons = (USHORT)buttons;
+            input.bLeftTrigger = (variant == 1) ? 1 : 0;
+            input.bRightTrigger = (variant == 2) ? UCHAR_MAX : 0;
+
+            if (variant == 0)
+                DS4_REPORT_INIT(&actual);
+            else
+                XnaTestRandomFill(&actual, sizeof(actual));
+
+            expected = actual;
+
+            XUSB_TO_DS4_REPORT(&input, &actual);
+            XusbToDs4ReportReference(&input, &expected);
+
+            XNA_TEST_EXPECT(memcmp(&actual, &expected, sizeof(DS4_REPORT)) == 0);
+        }
+    }
+}
+
+//
+// Every thumb axis value
+//
+static VOID TestThumbs(
+    VOID
+)
+{
+    XUSB_REPORT input;
+    DS4_REPORT  actual;
+    DS4_REPORT  expected;
+    LONG        value;
+
+    for (value = SHRT_MIN; value <= SHRT_MAX; value++)
+    {
+        XUSB_REPORT_INIT(&input);
+        input.sThumbLX = input.sThumbLY = input.sThumbRX = input.sThumbRY = (SHORT)value;
+
+        DS4_REPORT_INIT(&actual);
+        expected = actual;
+
+        XUSB_TO_DS4_REPORT(&input, &actual);
+        XusbToDs4ReportReference(&input, &expected);
+
+        XNA_TEST_EXPECT(memcmp(&actual, &expected, sizeof(DS4_REPORT)) == 0);
+    }
+}
+
+#define BATCH_COUNT 4096
+
+static XUSB_REPORT  BatchInput[BATCH_COUNT];
+static DS4_REPORT   BatchOutput[BATCH_COUNT];
+static DS4_REPORT   BatchExpected[BATCH_COUNT];
+
+static VOID TestBatch(
+    VOID
+)
+{
+    ULONG index;
+
+    XnaTestRandomFill(BatchInput, sizeof(BatchInput));
+
+    for (index = 0; index < BATCH_COUNT; index++)
+    {
+        DS4_REPORT_INIT(&BatchOutput[index]);
+        DS4_REPORT_INIT(&BatchExpected[index]);
+
+        XUSB_TO_DS4_REPORT(&BatchInput[index], &BatchExpected[index]);
+    }
+
+    XUSB_TO_DS4_REPORT_BATCH(BatchInput, BatchOutput, BATCH_COUNT);
+
+    XNA_TEST_EXPECT(memcmp(BatchOutput, BatchExpected, sizeof(BatchOutput)) == 0);
+}
+
+static VOID Bench(
+    VOID
+)
+{
+    const ULONG iterations = 2000;
+    ULONG       iteration;
+    ULONG       index;
+    double      start;
+
+    XnaTestRandomFill(BatchInput, sizeof(BatchInput));
+
+    start = XnaTestNow();
+
+    for (iteration = 0; iteration < iterations; iteration++)
+    {
+        for (index = 0; index < BATCH_COUNT; index++)
+        {
+            XusbToDs4ReportReference(&BatchInput[index], &BatchOutput[index]);
+        }
+
+        XNA_TEST_CONSUME(BatchOutput, sizeof(BatchOutput));
+    }
+
+    XnaTestReport("XUSB to DS4 (branching reference)", (double)iterations * BATCH_COUNT, XnaTestNow() - start);
+
+    start = XnaTestNow();
+
+    for (iteration = 0; iteration < iterations; iteration++)
+    {
+        XUSB_TO_DS4_REPORT_BATCH(BatchInput, BatchOutput, BATCH_COUNT);
+
+        XNA_TEST_CONSUME(BatchOutput, sizeof(BatchOutput));
+    }
+
+    XnaTestReport("XUSB_TO_DS4_REPORT_BATCH", (double)iterations * BATCH_COUNT, XnaTestNow() - start);
+}
+
+int main(
+    int argc,
+    char** argv
+)
+{
+    TestButtons();
+    TestThumbs();
+    TestBatch();
+
+    if (XnaTestBenchEnabled(argc, argv))
+        Bench();
+
+    return XNA_TEST_RESULT();
+}